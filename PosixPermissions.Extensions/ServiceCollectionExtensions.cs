@@ -20,5 +20,28 @@ namespace PosixPermissions.Extensions
             serviceCollection.AddTransient<INativeLibraryInterface, NativeLibraryInterface>();
             serviceCollection.AddTransient<IPosixPermissionsProvider, PosixPermissionsProvider>();
         }
+
+        /// <summary>
+        /// Enables the POSIX permission service, with a <see cref="CachingPosixPermissionsProvider"/> caching the loaded permissions.
+        /// The cache is registered as a singleton, both as <see cref="IPosixPermissionsProvider"/> and as <see cref="CachingPosixPermissionsProvider"/> for accessing its counters.
+        /// </summary>
+        /// <param name="serviceCollection">Service collection to add the POSIX permission service.</param>
+        /// <param name="configureCache">Configures cache size and validation policy. May be null to use the defaults.</param>
+        public static void AddPosixAcls(this ServiceCollection serviceCollection, Action<PermissionCacheOptions> configureCache)
+        {
+            if(serviceCollection == null)
+                throw new ArgumentNullException(nameof(serviceCollection));
+
+            var cacheOptions = new PermissionCacheOptions();
+            configureCache?.Invoke(cacheOptions);
+
+            serviceCollection.AddTransient<INativeLibraryInterface, NativeLibraryInterface>();
+            serviceCollection.AddTransient<PosixPermissionsProvider>();
+            serviceCollection.AddSingleton(serviceProvider => new CachingPosixPermissionsProvider(
+                serviceProvider.GetRequiredService<PosixPermissionsProvider>(),
+                serviceProvider.GetRequiredService<INativeLibraryInterface>(),
+                cacheOptions));
+            serviceCollection.AddSingleton<IPosixPermissionsProvider>(serviceProvider => serviceProvider.GetRequiredService<CachingPosixPermissionsProvider>());
+        }
     }
 }
@@ -1,5 +1,11 @@
 ﻿using System;
+using System.Collections.Concurrent;
 using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Numerics;
+using System.Text;
+using System.Threading;
 using Moq;
 using Xunit;
 
@@ -144,6 +150,44 @@ namespace PosixPermissions.Tests
             Assert.Equal(r, permissionsGroup3000);
 
             Assert.Equal(r, posixPermissionInfo.OtherPermissions);
+
+            Assert.False(posixPermissionInfo.IsTrivial);
+        }
+
+        [Fact]
+        public void IsTrivial()
+        {
+            var mockNativeLibraryInterface = new Mock<INativeLibraryInterface>(MockBehavior.Strict);
+            FilePermissions r = FilePermissions.Read;
+            FilePermissions rw = FilePermissions.Read | FilePermissions.Write;
+            AccessControlListEntry[] acl =
+            {
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.UserObj, TagQualifier = 0, Permissions = rw },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.GroupObj, TagQualifier = 0, Permissions = r },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Other, TagQualifier = 0, Permissions = r }
+            };
+            NativePermissionDataContainer dataContainer = new NativePermissionDataContainer
+            {
+                AclSize = acl.Length,
+                OwnerId = 1000,
+                GroupId = 1000,
+                OwnerPermissions = rw,
+                GroupPermissions = r,
+                OtherPermissions = r
+            };
+            mockNativeLibraryInterface.Setup(obj => obj.GetPermissionData("file", 0, out dataContainer)).Returns(acl);
+
+            var posixPermissionInfo = new PosixPermissionInfo(mockNativeLibraryInterface.Object, "file", 0);
+            Assert.True(posixPermissionInfo.IsTrivial);
+
+            posixPermissionInfo.SetUserPermissions(1000, rw);
+            Assert.True(posixPermissionInfo.IsTrivial);
+
+            posixPermissionInfo.SetGroupPermissions(2000, r);
+            Assert.False(posixPermissionInfo.IsTrivial);
+
+            posixPermissionInfo.ClearAcls();
+            Assert.True(posixPermissionInfo.IsTrivial);
         }
 
         private delegate void SetPermissionDataCallback(string fileName, int setDefaultAcl, ref NativePermissionDataContainer dataContainer, AccessControlListEntry[] acl);
@@ -210,5 +254,978 @@ namespace PosixPermissions.Tests
             CheckAclEntry3(6, AccessControlListEntryTagTypes.Group, 3000, r);
             CheckAclEntry2(7, AccessControlListEntryTagTypes.Mask, rw);
         }
+
+        private delegate CompiledPermissionsHandle CompilePermissionDataCallback(int setDefaultAcl, ref NativePermissionDataContainer dataContainer, AccessControlListEntry[] acl);
+
+        [Fact]
+        public void Compile()
+        {
+            var mockNativeLibraryInterface = new Mock<INativeLibraryInterface>(MockBehavior.Strict);
+            AccessControlListEntry[] acl = null;
+            NativePermissionDataContainer dataContainer = default;
+            mockNativeLibraryInterface.Setup(obj => obj.CompilePermissionData(1, ref It.Ref<NativePermissionDataContainer>.IsAny, It.IsAny<AccessControlListEntry[]>()))
+                .Returns(new CompilePermissionDataCallback((int setDefaultAclParam, ref NativePermissionDataContainer dataContainerParam, AccessControlListEntry[] aclParam) =>
+                    {
+                        dataContainer = dataContainerParam;
+                        acl = aclParam;
+                        return new CompiledPermissionsHandle();
+                    }));
+
+            FilePermissions r = FilePermissions.Read;
+            FilePermissions rw = FilePermissions.Read | FilePermissions.Write;
+
+            var posixPermissionInfo = new PosixPermissionInfo(mockNativeLibraryInterface.Object, 1000, 1000);
+            posixPermissionInfo.OwnerPermissions = rw;
+            posixPermissionInfo.GroupPermissions = r;
+            posixPermissionInfo.SetUserPermissions(2000, rw);
+
+            using var compiledPermissions = posixPermissionInfo.Compile(true);
+
+            // Same layout as for a direct write
+            Assert.NotNull(compiledPermissions);
+            Assert.Equal(1000, dataContainer.OwnerId);
+            Assert.Equal(rw, dataContainer.OwnerPermissions);
+            Assert.Equal(5, acl.Length);
+            Assert.Equal(AccessControlListEntryTagTypes.UserObj, acl[0].TagType);
+            Assert.Equal(AccessControlListEntryTagTypes.User, acl[3].TagType);
+            Assert.Equal(2000, acl[3].TagQualifier);
+            Assert.Equal(AccessControlListEntryTagTypes.Mask, acl[4].TagType);
+            Assert.Equal(rw, acl[4].Permissions);
+        }
+
+        private delegate void SetDirectoryPermissionDataCallback(PosixDirectoryHandle directory, string directoryName, ref NativePermissionDataContainer dataContainer, AccessControlListEntry[] acl, AccessControlListEntry[] defaultAcl);
+
+        [Fact]
+        public void DirectoryPermissions()
+        {
+            var mockNativeLibraryInterface = new Mock<INativeLibraryInterface>(MockBehavior.Strict);
+            FilePermissions r = FilePermissions.Read;
+            FilePermissions rx = FilePermissions.Read | FilePermissions.Execute;
+            FilePermissions rwx = FilePermissions.Read | FilePermissions.Write | FilePermissions.Execute;
+            AccessControlListEntry[] acl =
+            {
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.UserObj, TagQualifier = 0, Permissions = rwx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.GroupObj, TagQualifier = 0, Permissions = rx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Other, TagQualifier = 0, Permissions = r }
+            };
+            AccessControlListEntry[] defaultAcl =
+            {
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.UserObj, TagQualifier = 0, Permissions = rwx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.User, TagQualifier = 2000, Permissions = rx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.GroupObj, TagQualifier = 0, Permissions = rx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Mask, TagQualifier = 0, Permissions = rx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Other, TagQualifier = 0, Permissions = r }
+            };
+            NativePermissionDataContainer dataContainer = new NativePermissionDataContainer
+            {
+                AclSize = acl.Length,
+                OwnerId = 1000,
+                GroupId = 1000,
+                OwnerPermissions = rwx,
+                GroupPermissions = rx,
+                OtherPermissions = r
+            };
+            mockNativeLibraryInterface.Setup(obj => obj.GetDirectoryPermissionData(null, "dir", out dataContainer, out defaultAcl)).Returns(acl);
+
+            AccessControlListEntry[] appliedAcl = null;
+            AccessControlListEntry[] appliedDefaultAcl = null;
+            mockNativeLibraryInterface.Setup(obj => obj.SetDirectoryPermissionData(null, "dir", ref It.Ref<NativePermissionDataContainer>.IsAny, It.IsAny<AccessControlListEntry[]>(), It.IsAny<AccessControlListEntry[]>()))
+                .Callback(new SetDirectoryPermissionDataCallback((PosixDirectoryHandle directoryParam, string directoryNameParam, ref NativePermissionDataContainer dataContainerParam, AccessControlListEntry[] aclParam, AccessControlListEntry[] defaultAclParam) =>
+                    {
+                        appliedAcl = aclParam;
+                        appliedDefaultAcl = defaultAclParam;
+                    }))
+                .Returns(NativePermissionChanges.AccessAcl | NativePermissionChanges.DefaultAcl);
+
+            var directoryPermissionInfo = new PosixDirectoryPermissionInfo(mockNativeLibraryInterface.Object, "dir");
+
+            Assert.True(directoryPermissionInfo.HasDefaultAcl);
+            Assert.True(directoryPermissionInfo.AccessPermissions.IsTrivial);
+            Assert.False(directoryPermissionInfo.AccessPermissions.TryGetUserPermissions(2000, out _));
+            Assert.True(directoryPermissionInfo.DefaultPermissions.TryGetUserPermissions(2000, out var permissionsUser2000));
+            Assert.Equal(rx, permissionsUser2000);
+            Assert.Equal(1000, directoryPermissionInfo.DefaultPermissions.OwnerId);
+
+            directoryPermissionInfo.ApplyPermissions("dir");
+            Assert.Equal(4, appliedAcl.Length);
+            Assert.Equal(5, appliedDefaultAcl.Length);
+            Assert.Equal(AccessControlListEntryTagTypes.User, appliedDefaultAcl[3].TagType);
+            Assert.Equal(2000, appliedDefaultAcl[3].TagQualifier);
+
+            // Without a default ACL, an empty one is passed to remove it
+            directoryPermissionInfo.HasDefaultAcl = false;
+            directoryPermissionInfo.ApplyPermissions("dir");
+            Assert.Equal(4, appliedAcl.Length);
+            Assert.Empty(appliedDefaultAcl);
+        }
+
+        [Fact]
+        public void ApplyPermissionsRecursive()
+        {
+            var mockNativeLibraryInterface = new Mock<INativeLibraryInterface>(MockBehavior.Strict);
+            FilePermissions rx = FilePermissions.Read | FilePermissions.Execute;
+            FilePermissions rwx = FilePermissions.Read | FilePermissions.Write | FilePermissions.Execute;
+            AccessControlListEntry[] acl =
+            {
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.UserObj, TagQualifier = 0, Permissions = rwx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.GroupObj, TagQualifier = 0, Permissions = rx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Other, TagQualifier = 0, Permissions = rx }
+            };
+            AccessControlListEntry[] defaultAcl = Array.Empty<AccessControlListEntry>();
+            NativePermissionDataContainer dataContainer = new NativePermissionDataContainer
+            {
+                AclSize = acl.Length,
+                OwnerId = 1000,
+                GroupId = 1000,
+                OwnerPermissions = rwx,
+                GroupPermissions = rx,
+                OtherPermissions = rx
+            };
+            mockNativeLibraryInterface.Setup(obj => obj.GetDirectoryPermissionData(null, "dir", out dataContainer, out defaultAcl)).Returns(acl);
+
+            // File permissions are compiled first, then the directory's access and default permissions
+            var compiledFilePermissions = new CompiledPermissionsHandle();
+            var compiledDirectoryPermissions = new CompiledPermissionsHandle();
+            var compiledDefaultPermissions = new CompiledPermissionsHandle();
+            mockNativeLibraryInterface.SetupSequence(obj => obj.CompilePermissionData(0, ref It.Ref<NativePermissionDataContainer>.IsAny, It.IsAny<AccessControlListEntry[]>()))
+                .Returns(compiledFilePermissions)
+                .Returns(compiledDirectoryPermissions);
+            mockNativeLibraryInterface.Setup(obj => obj.CompilePermissionData(1, ref It.Ref<NativePermissionDataContainer>.IsAny, It.IsAny<AccessControlListEntry[]>()))
+                .Returns(compiledDefaultPermissions);
+            mockNativeLibraryInterface.Setup(obj => obj.ApplyPermissionsRecursive("/srv/share", compiledFilePermissions, compiledDirectoryPermissions, compiledDefaultPermissions, 4, null))
+                .Returns(new NativeRecursiveApplyStatistics { DirectoryCount = 2, FileCount = 5 });
+
+            var directoryPermissionInfo = new PosixDirectoryPermissionInfo(mockNativeLibraryInterface.Object, "dir");
+            directoryPermissionInfo.HasDefaultAcl = true;
+            directoryPermissionInfo.DefaultPermissions.SetGroupPermissions(2000, rx);
+            var filePermissions = new PosixPermissionInfo(mockNativeLibraryInterface.Object, 1000, 1000);
+
+            var statistics = directoryPermissionInfo.ApplyPermissionsRecursive(new DirectoryInfo("/srv/share"), filePermissions, 4);
+            Assert.Equal(2, statistics.DirectoryCount);
+            Assert.Equal(5, statistics.FileCount);
+            mockNativeLibraryInterface.Verify(obj => obj.ApplyPermissionsRecursive("/srv/share", compiledFilePermissions, compiledDirectoryPermissions, compiledDefaultPermissions, 4, null), Times.Once);
+        }
+
+        [Fact]
+        public void DefaultAclInheritance()
+        {
+            var mockNativeLibraryInterface = new Mock<INativeLibraryInterface>(MockBehavior.Strict);
+            FilePermissions r = FilePermissions.Read;
+            FilePermissions rw = FilePermissions.Read | FilePermissions.Write;
+            FilePermissions rx = FilePermissions.Read | FilePermissions.Execute;
+            FilePermissions rwx = FilePermissions.Read | FilePermissions.Write | FilePermissions.Execute;
+            AccessControlListEntry[] defaultAcl =
+            {
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.UserObj, TagQualifier = 0, Permissions = rwx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.User, TagQualifier = 2000, Permissions = rwx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.GroupObj, TagQualifier = 0, Permissions = rx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Mask, TagQualifier = 0, Permissions = rwx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Other, TagQualifier = 0, Permissions = r }
+            };
+            NativePermissionDataContainer dataContainer = new NativePermissionDataContainer
+            {
+                AclSize = defaultAcl.Length,
+                OwnerId = 1000,
+                GroupId = 3000,
+                OwnerPermissions = rwx,
+                GroupPermissions = rx | FilePermissions.SetId,
+                OtherPermissions = rx
+            };
+            mockNativeLibraryInterface.Setup(obj => obj.GetPermissionData("dir", 1, out dataContainer)).Returns(defaultAcl);
+
+            var calculator = new DefaultAclInheritanceCalculator(mockNativeLibraryInterface.Object, 1000, 1000);
+
+            // File with mode 0644: the umask is ignored, the mask is restricted by the group bits
+            var filePermissions = calculator.GetInheritedPermissions("dir", Convert.ToInt32("644", 8), Convert.ToInt32("077", 8), false);
+            Assert.True(filePermissions.HasExtendedAcl);
+            Assert.Equal(rw, filePermissions.DataContainer.OwnerPermissions);
+            Assert.Equal(r, filePermissions.DataContainer.GroupPermissions);
+            Assert.Equal(r, filePermissions.DataContainer.OtherPermissions);
+            Assert.Equal(3000, filePermissions.DataContainer.GroupId);
+            Assert.Equal(5, filePermissions.AccessAcl.Length);
+            Assert.Equal(rwx, filePermissions.AccessAcl[1].Permissions);
+            Assert.Equal(rx, filePermissions.AccessAcl[2].Permissions);
+            Assert.Equal(r, filePermissions.AccessAcl[3].Permissions);
+            Assert.True(filePermissions.DefaultAcl.IsEmpty);
+
+            // Directories inherit the default ACL and the SGID bit
+            var directoryPermissions = calculator.GetInheritedPermissions("dir", Convert.ToInt32("777", 8), 0, true);
+            Assert.Equal(rwx | FilePermissions.SetId, directoryPermissions.DataContainer.GroupPermissions);
+            Assert.Equal(5, directoryPermissions.DefaultAcl.Length);
+
+            // Results and the default ACL are cached
+            Assert.Same(filePermissions, calculator.GetInheritedPermissions("dir", Convert.ToInt32("644", 8), Convert.ToInt32("077", 8), false));
+            Assert.Same(filePermissions, calculator.GetInheritedPermissions("dir/", Convert.ToInt32("644", 8), Convert.ToInt32("077", 8), false));
+            mockNativeLibraryInterface.Verify(obj => obj.GetPermissionData("dir", 1, out dataContainer), Times.Once);
+
+            // Like in the kernel, a mask without named entries keeps the ACL extended; only the mask is limited by the mode
+            AccessControlListEntry[] maskOnlyDefaultAcl =
+            {
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.UserObj, TagQualifier = 0, Permissions = rwx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.GroupObj, TagQualifier = 0, Permissions = rx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Mask, TagQualifier = 0, Permissions = r },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Other, TagQualifier = 0, Permissions = r }
+            };
+            var maskOnlyPermissions = DefaultAclInheritanceCalculator.Compute(dataContainer, maskOnlyDefaultAcl, Convert.ToInt32("666", 8), 0, false, 1000, 1000);
+            Assert.True(maskOnlyPermissions.HasExtendedAcl);
+            Assert.Equal(4, maskOnlyPermissions.AccessAcl.Length);
+            Assert.Equal(AccessControlListEntryTagTypes.GroupObj, maskOnlyPermissions.AccessAcl[1].TagType);
+            Assert.Equal(rx, maskOnlyPermissions.AccessAcl[1].Permissions);
+            Assert.Equal(AccessControlListEntryTagTypes.Mask, maskOnlyPermissions.AccessAcl[2].TagType);
+            Assert.Equal(r, maskOnlyPermissions.AccessAcl[2].Permissions);
+            Assert.Equal(r, maskOnlyPermissions.DataContainer.GroupPermissions);
+            Assert.Equal(4, maskOnlyPermissions.DataContainer.AclSize);
+
+            // Without a default ACL, the umask is applied
+            var minimalPermissions = DefaultAclInheritanceCalculator.Compute(dataContainer, ReadOnlySpan<AccessControlListEntry>.Empty, Convert.ToInt32("666", 8), Convert.ToInt32("022", 8), false, 1000, 1000);
+            Assert.False(minimalPermissions.HasExtendedAcl);
+            Assert.Equal(rw, minimalPermissions.DataContainer.OwnerPermissions);
+            Assert.Equal(r, minimalPermissions.DataContainer.GroupPermissions);
+            Assert.Equal(r, minimalPermissions.DataContainer.OtherPermissions);
+        }
+
+        [Fact]
+        public void EffectivePermissions()
+        {
+            FilePermissions r = FilePermissions.Read;
+            FilePermissions rw = FilePermissions.Read | FilePermissions.Write;
+            FilePermissions rx = FilePermissions.Read | FilePermissions.Execute;
+            FilePermissions rwx = FilePermissions.Read | FilePermissions.Write | FilePermissions.Execute;
+            AccessControlListEntry[] acl =
+            {
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.UserObj, TagQualifier = 0, Permissions = rwx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.User, TagQualifier = 2000, Permissions = rwx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.GroupObj, TagQualifier = 0, Permissions = r },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Group, TagQualifier = 4000, Permissions = FilePermissions.Write },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Mask, TagQualifier = 0, Permissions = rw },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Other, TagQualifier = 0, Permissions = FilePermissions.None }
+            };
+
+            // Owner, named user limited by the mask, other
+            Assert.Equal(rwx, PermissionEvaluator.Evaluate(acl, 1000, 3000, new AccessPrincipal(1000, new[] { 1000 })));
+            Assert.Equal(rw, PermissionEvaluator.Evaluate(acl, 1000, 3000, new AccessPrincipal(2000, new[] { 3000 })));
+            Assert.Equal(FilePermissions.None, PermissionEvaluator.Evaluate(acl, 1000, 3000, new AccessPrincipal(5000, new[] { 5000 })));
+
+            // Several matching group entries: each permission is granted, but not both at once
+            var groupMember = new AccessPrincipal(5000, new[] { 4000, 3000 });
+            Assert.Equal(rw, PermissionEvaluator.Evaluate(acl, 1000, 3000, groupMember));
+            Assert.True(PermissionEvaluator.CheckAccess(acl, 1000, 3000, groupMember, r));
+            Assert.True(PermissionEvaluator.CheckAccess(acl, 1000, 3000, groupMember, FilePermissions.Write));
+            Assert.False(PermissionEvaluator.CheckAccess(acl, 1000, 3000, groupMember, rw));
+
+            // Batch with trivial ACLs and one extended ACL
+            AccessControlListEntry[] trivialAcl =
+            {
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.UserObj, TagQualifier = 0, Permissions = rwx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.GroupObj, TagQualifier = 0, Permissions = rx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Other, TagQualifier = 0, Permissions = r }
+            };
+            int count = 37;
+            var results = new NativeBatchReadResult[count];
+            var entries = new List<AccessControlListEntry>();
+            for(int i = 0; i < count; ++i)
+            {
+                var itemAcl = i == 20 ? acl : trivialAcl;
+                results[i].DataContainer = new NativePermissionDataContainer { OwnerId = 1000 + i % 3, GroupId = 4000 + i % 2, AclSize = itemAcl.Length };
+                results[i].EntriesOffset = entries.Count;
+                entries.AddRange(itemAcl);
+            }
+            var batch = new PermissionEvaluationBatch(new PermissionDataBatch(results, entries.ToArray()));
+
+            var permissions = new FilePermissions[count];
+            batch.Evaluate(groupMember, permissions);
+            var access = new bool[count];
+            batch.CheckAccess(groupMember, rw, access);
+            for(int i = 0; i < count; ++i)
+            {
+                var itemAcl = i == 20 ? acl : trivialAcl;
+                Assert.Equal(PermissionEvaluator.Evaluate(itemAcl, 1000 + i % 3, 4000 + i % 2, groupMember), permissions[i]);
+                Assert.Equal(PermissionEvaluator.CheckAccess(itemAcl, 1000 + i % 3, 4000 + i % 2, groupMember, rw), access[i]);
+            }
+            Assert.Equal(rx, permissions[0]);
+            Assert.Equal(r, permissions[1]);
+        }
+
+        [Fact]
+        public void CanAccess()
+        {
+            var mockNativeLibraryInterface = new Mock<INativeLibraryInterface>(MockBehavior.Strict);
+            FilePermissions r = FilePermissions.Read;
+            FilePermissions rw = FilePermissions.Read | FilePermissions.Write;
+            FilePermissions rx = FilePermissions.Read | FilePermissions.Execute;
+            FilePermissions rwx = FilePermissions.Read | FilePermissions.Write | FilePermissions.Execute;
+            AccessControlListEntry[] rootAcl =
+            {
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.UserObj, TagQualifier = 0, Permissions = rwx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.GroupObj, TagQualifier = 0, Permissions = rx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Other, TagQualifier = 0, Permissions = rx }
+            };
+            AccessControlListEntry[] directoryAcl =
+            {
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.UserObj, TagQualifier = 0, Permissions = rwx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.GroupObj, TagQualifier = 0, Permissions = FilePermissions.None },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Group, TagQualifier = 3000, Permissions = rx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Mask, TagQualifier = 0, Permissions = rx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Other, TagQualifier = 0, Permissions = FilePermissions.None }
+            };
+            AccessControlListEntry[] fileAcl =
+            {
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.UserObj, TagQualifier = 0, Permissions = rw },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.GroupObj, TagQualifier = 0, Permissions = r },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Other, TagQualifier = 0, Permissions = r }
+            };
+            NativePermissionDataContainer rootDataContainer = new NativePermissionDataContainer { OwnerId = 0, GroupId = 0, OwnerPermissions = rwx, GroupPermissions = rx, OtherPermissions = rx, AclSize = 3 };
+            NativePermissionDataContainer directoryDataContainer = new NativePermissionDataContainer { OwnerId = 0, GroupId = 0, OwnerPermissions = rwx, GroupPermissions = rx, OtherPermissions = FilePermissions.None, AclSize = 5 };
+            NativePermissionDataContainer fileDataContainer = new NativePermissionDataContainer { OwnerId = 0, GroupId = 0, OwnerPermissions = rw, GroupPermissions = r, OtherPermissions = r, AclSize = 3 };
+            mockNativeLibraryInterface.Setup(obj => obj.GetPermissionData("/", 0, out rootDataContainer)).Returns(rootAcl);
+            mockNativeLibraryInterface.Setup(obj => obj.GetPermissionData("/srv", 0, out directoryDataContainer)).Returns(directoryAcl);
+            mockNativeLibraryInterface.Setup(obj => obj.GetPermissionData("/srv/file", 0, out fileDataContainer)).Returns(fileAcl);
+            mockNativeLibraryInterface.Setup(obj => obj.GetUserGroups(0)).Returns(new[] { 0 });
+            mockNativeLibraryInterface.Setup(obj => obj.GetUserGroups(1000)).Returns(new[] { 1000, 3000 });
+            mockNativeLibraryInterface.Setup(obj => obj.GetUserGroups(2000)).Returns(new[] { 2000 });
+            mockNativeLibraryInterface.Setup(obj => obj.GetUserGroups(4000)).Throws(new KeyNotFoundException());
+
+            var accessChecker = new AccessChecker(mockNativeLibraryInterface.Object, TimeSpan.FromMinutes(1));
+
+            // Only members of group 3000 may search the directory
+            Assert.True(accessChecker.CanAccess(1000, "/srv/file", r));
+            Assert.False(accessChecker.CanAccess(1000, "/srv/file", rw));
+            Assert.False(accessChecker.CanAccess(2000, "/srv/file", r));
+            Assert.False(accessChecker.CanAccess(4000, "/srv/file", r));
+            Assert.True(accessChecker.CanAccess(0, "/srv/file", rw));
+            Assert.False(accessChecker.CanAccess(0, "/srv/file", FilePermissions.Execute));
+            Assert.Throws<ArgumentException>(() => accessChecker.CanAccess(1000, "srv/file", r));
+
+            // Groups and directories are cached, the file itself is read on every check
+            mockNativeLibraryInterface.Verify(obj => obj.GetUserGroups(1000), Times.Once);
+            mockNativeLibraryInterface.Verify(obj => obj.GetPermissionData("/srv", 0, out directoryDataContainer), Times.Once);
+            mockNativeLibraryInterface.Verify(obj => obj.GetPermissionData("/srv/file", 0, out fileDataContainer), Times.Exactly(4));
+
+            // Caches do not grow beyond their capacity
+            var boundedAccessChecker = new AccessChecker(mockNativeLibraryInterface.Object, TimeSpan.FromMinutes(1), 1);
+            boundedAccessChecker.CanAccess(1000, "/srv/file", r);
+            boundedAccessChecker.CanAccess(2000, "/srv/file", r);
+            Assert.Equal(1, boundedAccessChecker.CachedPrincipalCount);
+            Assert.Equal(1, boundedAccessChecker.CachedDirectoryCount);
+        }
+
+        private delegate void SetPermissionDataWithChangesCallback(PosixDirectoryHandle directory, string fileName, int setDefaultAcl, ref NativePermissionDataContainer dataContainer, AccessControlListEntry[] acl, out NativePermissionChanges changes);
+
+        [Fact]
+        public void ImportAclText()
+        {
+            var mockNativeLibraryInterface = new Mock<INativeLibraryInterface>(MockBehavior.Strict);
+            FilePermissions r = FilePermissions.Read;
+            FilePermissions rw = FilePermissions.Read | FilePermissions.Write;
+            FilePermissions rx = FilePermissions.Read | FilePermissions.Execute;
+            FilePermissions rwx = FilePermissions.Read | FilePermissions.Write | FilePermissions.Execute;
+            mockNativeLibraryInterface.Setup(obj => obj.GetUserId("alice")).Returns(1000);
+            mockNativeLibraryInterface.Setup(obj => obj.GetUserId("bob")).Returns(1001);
+            mockNativeLibraryInterface.Setup(obj => obj.GetGroupId("staff")).Returns(3000);
+            mockNativeLibraryInterface.Setup(obj => obj.WithContextOptions(NativeContextOptions.NoFollow)).Returns(mockNativeLibraryInterface.Object);
+
+            // Files are accessed relative to their parent directory
+            var baseHandle = new PosixDirectoryHandle();
+            var srvHandle = new PosixDirectoryHandle();
+            mockNativeLibraryInterface.Setup(obj => obj.OpenDirectory("/base")).Returns(baseHandle);
+            mockNativeLibraryInterface.Setup(obj => obj.OpenDirectory(baseHandle, "srv")).Returns(srvHandle);
+
+            NativePermissionDataContainer appliedDirectoryDataContainer = default;
+            AccessControlListEntry[] appliedDirectoryAcl = null;
+            AccessControlListEntry[] appliedDirectoryDefaultAcl = null;
+            mockNativeLibraryInterface.Setup(obj => obj.SetDirectoryPermissionData(srvHandle, "dir a", ref It.Ref<NativePermissionDataContainer>.IsAny, It.IsAny<AccessControlListEntry[]>(), It.IsAny<AccessControlListEntry[]>()))
+                .Callback(new SetDirectoryPermissionDataCallback((PosixDirectoryHandle directoryParam, string directoryNameParam, ref NativePermissionDataContainer dataContainerParam, AccessControlListEntry[] aclParam, AccessControlListEntry[] defaultAclParam) =>
+                    {
+                        // The arrays are reused by the importer
+                        appliedDirectoryDataContainer = dataContainerParam;
+                        appliedDirectoryAcl = (AccessControlListEntry[])aclParam.Clone();
+                        appliedDirectoryDefaultAcl = (AccessControlListEntry[])defaultAclParam.Clone();
+                    }))
+                .Returns(NativePermissionChanges.AccessAcl);
+
+            NativePermissionDataContainer appliedFileDataContainer = default;
+            AccessControlListEntry[] appliedFileAcl = null;
+            mockNativeLibraryInterface.Setup(obj => obj.SetPermissionData(srvHandle, "file", 0, ref It.Ref<NativePermissionDataContainer>.IsAny, It.IsAny<AccessControlListEntry[]>(), out It.Ref<NativePermissionChanges>.IsAny))
+                .Callback(new SetPermissionDataWithChangesCallback((PosixDirectoryHandle directoryParam, string fileNameParam, int setDefaultAclParam, ref NativePermissionDataContainer dataContainerParam, AccessControlListEntry[] aclParam, out NativePermissionChanges changesParam) =>
+                    {
+                        appliedFileDataContainer = dataContainerParam;
+                        appliedFileAcl = (AccessControlListEntry[])aclParam.Clone();
+                        changesParam = NativePermissionChanges.Mode;
+                    }));
+
+            var text = "# file: srv/dir\\040a\n"
+                       + "# owner: alice\n"
+                       + "# group: 2000\n"
+                       + "# flags: -s-\n"
+                       + "user::rwx\n"
+                       + "user:bob:r-x\t\t\t#effective:r--\n"
+                       + "group::r-x\t\t\t#effective:r--\n"
+                       + "mask::r--\n"
+                       + "other::---\n"
+                       + "default:user::rwx\n"
+                       + "default:group::r-x\n"
+                       + "default:other::---\n"
+                       + "\n"
+                       + "# file: srv/file\n"
+                       + "# owner: alice\n"
+                       + "# group: staff\n"
+                       + "user::rw-\n"
+                       + "group::r--\n"
+                       + "other::r--\n";
+            var importer = new AclTextImporter(mockNativeLibraryInterface.Object, false);
+            Assert.Equal(2, importer.Import(new MemoryStream(System.Text.Encoding.UTF8.GetBytes(text)), "/base", null));
+
+            // The mask determines the group bits, the flags the special bits
+            Assert.Equal(1000, appliedDirectoryDataContainer.OwnerId);
+            Assert.Equal(2000, appliedDirectoryDataContainer.GroupId);
+            Assert.Equal(rwx, appliedDirectoryDataContainer.OwnerPermissions);
+            Assert.Equal(r | FilePermissions.SetId, appliedDirectoryDataContainer.GroupPermissions);
+            Assert.Equal(FilePermissions.None, appliedDirectoryDataContainer.OtherPermissions);
+            Assert.Equal(5, appliedDirectoryAcl.Length);
+            Assert.Equal(AccessControlListEntryTagTypes.User, appliedDirectoryAcl[1].TagType);
+            Assert.Equal(1001, appliedDirectoryAcl[1].TagQualifier);
+            Assert.Equal(rx, appliedDirectoryAcl[1].Permissions);
+            Assert.Equal(3, appliedDirectoryDefaultAcl.Length);
+
+            Assert.Equal(1000, appliedFileDataContainer.OwnerId);
+            Assert.Equal(3000, appliedFileDataContainer.GroupId);
+            Assert.Equal(rw, appliedFileDataContainer.OwnerPermissions);
+            Assert.Equal(3, appliedFileAcl.Length);
+            mockNativeLibraryInterface.Verify(obj => obj.GetUserId("alice"), Times.Once);
+            mockNativeLibraryInterface.Verify(obj => obj.OpenDirectory(baseHandle, "srv"), Times.Once);
+
+            // Paths leaving the base directory are rejected, also if they are escaped or hidden behind a NUL byte, and so are names with NUL bytes
+            var rejectedPaths = new List<string>();
+            var escapingText = "# file: srv/../../etc\n"
+                               + "user::rwx\n"
+                               + "group::r-x\n"
+                               + "other::---\n"
+                               + "\n"
+                               + "# file: srv/\\056\\056/file\n"
+                               + "user::rw-\n"
+                               + "group::r--\n"
+                               + "other::r--\n"
+                               + "\n"
+                               + "# file: ..\\000\n"
+                               + "user::rw-\n"
+                               + "group::r--\n"
+                               + "other::r--\n"
+                               + "\n"
+                               + "# file: srv/..\\000x/f\n"
+                               + "user::rw-\n"
+                               + "group::r--\n"
+                               + "other::r--\n"
+                               + "\n"
+                               + "# file: srv/./file\n"
+                               + "user::rw-\n"
+                               + "group::r--\n"
+                               + "other::r--\n"
+                               + "\n"
+                               + "# file: srv/file\n"
+                               + "# owner: alice\\000x\n"
+                               + "user::rw-\n"
+                               + "group::r--\n"
+                               + "other::r--\n";
+            Assert.Equal(0, importer.Import(new MemoryStream(System.Text.Encoding.UTF8.GetBytes(escapingText)), "/base", (path, ex) =>
+            {
+                Assert.IsType<InvalidDataException>(ex);
+                rejectedPaths.Add(path);
+                return true;
+            }));
+            Assert.Equal(new[] { "srv/../../etc", "srv/../file", "..\0", "srv/..\0x/f", "srv/./file", "srv/file" }, rejectedPaths);
+            mockNativeLibraryInterface.Verify(obj => obj.OpenDirectory(baseHandle, ".."), Times.Never);
+            mockNativeLibraryInterface.Verify(obj => obj.OpenDirectory(baseHandle, "..\0x"), Times.Never);
+
+            // Names are rejected in numeric mode
+            var failedPaths = new List<string>();
+            var numericImporter = new AclTextImporter(mockNativeLibraryInterface.Object, true);
+            Assert.Equal(0, numericImporter.Import(new MemoryStream(System.Text.Encoding.UTF8.GetBytes(text)), "/base", (path, ex) =>
+            {
+                Assert.IsType<FormatException>(ex);
+                failedPaths.Add(path);
+                return true;
+            }));
+            Assert.Equal(new[] { "srv/dir a", "srv/file" }, failedPaths);
+
+            // The exporter escapes whitespace, backslashes and non-ASCII bytes like getfacl
+            mockNativeLibraryInterface.Setup(obj => obj.ScanTree("/srv")).Returns(new[]
+            {
+                new PermissionScanRecord("d\u00fcr a\\b", 1, 1, 10, 1000, 3000, 0x81A4, CreateMinimalAcl(rw, r, r), Array.Empty<AccessControlListEntry>())
+            });
+            var output = new MemoryStream();
+            Assert.Equal(1, new AclTextExporter(mockNativeLibraryInterface.Object, true).Export("/srv", output, null));
+            var exportedText = System.Text.Encoding.UTF8.GetString(output.ToArray());
+            Assert.StartsWith("# file: srv/d\\303\\274r\\040a\\134b\n# owner: 1000\n# group: 3000\n", exportedText);
+        }
+
+        [Fact]
+        public void CachingProvider()
+        {
+            var mockNativeLibraryInterface = new Mock<INativeLibraryInterface>(MockBehavior.Strict);
+            var identity = new NativeFileIdentity { Device = 1, Inode = 100, ChangeTimeSeconds = 1000 };
+            mockNativeLibraryInterface.Setup(obj => obj.GetFileIdentity(null, "/srv/file")).Returns(() => identity);
+            mockNativeLibraryInterface.Setup(obj => obj.GetFileIdentity(null, "/srv/other")).Returns(new NativeFileIdentity { Device = 1, Inode = 101, ChangeTimeSeconds = 1000 });
+            var dataContainer = new NativePermissionDataContainer
+            {
+                OwnerId = 1000,
+                OwnerPermissions = FilePermissions.Read | FilePermissions.Write,
+                GroupId = 2000,
+                GroupPermissions = FilePermissions.Read,
+                OtherPermissions = FilePermissions.None
+            };
+            var acl = new[]
+            {
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.UserObj, Permissions = FilePermissions.Read | FilePermissions.Write },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.GroupObj, Permissions = FilePermissions.Read },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Other, Permissions = FilePermissions.None }
+            };
+            mockNativeLibraryInterface.Setup(obj => obj.GetPermissionData(null, "/srv/file", 0, out dataContainer)).Returns(acl);
+            mockNativeLibraryInterface.Setup(obj => obj.GetPermissionData(null, "/srv/other", 0, out dataContainer)).Returns(acl);
+
+            var provider = new CachingPosixPermissionsProvider(new PosixPermissionsProvider(mockNativeLibraryInterface.Object), mockNativeLibraryInterface.Object, new PermissionCacheOptions { Capacity = 1 });
+
+            // The second read is answered from the cache
+            var permissionInfo = provider.GetPosixPermissionInfo(new FileInfo("/srv/file"));
+            Assert.Equal(1000, permissionInfo.OwnerId);
+            Assert.Equal(FilePermissions.Read | FilePermissions.Write, permissionInfo.OwnerPermissions);
+            provider.GetPosixPermissionInfo(new FileInfo("/srv/file"));
+            Assert.Equal(1, provider.HitCount);
+            Assert.Equal(1, provider.MissCount);
+            mockNativeLibraryInterface.Verify(obj => obj.GetPermissionData(null, "/srv/file", 0, out dataContainer), Times.Once);
+
+            // A new change time invalidates the entry
+            identity.ChangeTimeNanoseconds = 1;
+            provider.GetPosixPermissionInfo(new FileInfo("/srv/file"));
+            Assert.Equal(2, provider.MissCount);
+            Assert.Equal(0, provider.EvictionCount);
+
+            // Another file evicts the only entry
+            provider.GetPosixPermissionInfo(new FileInfo("/srv/other"));
+            Assert.Equal(1, provider.EvictionCount);
+            Assert.Equal(1, provider.Count);
+        }
+
+        [Fact]
+        public void CachingProviderInvalidation()
+        {
+            var mockNativeLibraryInterface = new Mock<INativeLibraryInterface>(MockBehavior.Strict);
+            var dataContainer = new NativePermissionDataContainer
+            {
+                OwnerId = 1000,
+                OwnerPermissions = FilePermissions.Read,
+                GroupId = 2000
+            };
+            var acl = new[]
+            {
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.UserObj, Permissions = FilePermissions.Read },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.GroupObj, Permissions = FilePermissions.None },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Other, Permissions = FilePermissions.None }
+            };
+            mockNativeLibraryInterface.Setup(obj => obj.GetPermissionData(null, "/srv/dir/file", 0, out dataContainer)).Returns(acl);
+            mockNativeLibraryInterface.Setup(obj => obj.GetPermissionData(null, "/srv/other", 0, out dataContainer)).Returns(acl);
+
+            var provider = new CachingPosixPermissionsProvider(new PosixPermissionsProvider(mockNativeLibraryInterface.Object), mockNativeLibraryInterface.Object, new PermissionCacheOptions { Validation = PermissionCacheValidation.Invalidation });
+
+            // Hits do not query the file identity
+            provider.GetPosixPermissionInfo(new FileInfo("/srv/dir/file"));
+            provider.GetPosixPermissionInfo(new FileInfo("/srv/dir/file"));
+            provider.GetPosixPermissionInfo(new FileInfo("/srv/other"));
+            Assert.Equal(1, provider.HitCount);
+            Assert.Equal(2, provider.MissCount);
+
+            // Invalidated entries are read again
+            provider.Invalidate("/srv/dir/file");
+            provider.GetPosixPermissionInfo(new FileInfo("/srv/dir/file"));
+            Assert.Equal(3, provider.MissCount);
+            mockNativeLibraryInterface.Verify(obj => obj.GetPermissionData(null, "/srv/dir/file", 0, out dataContainer), Times.Exactly(2));
+
+            // Tree invalidation only removes entries below the given directory
+            provider.InvalidateTree("/srv/dir/");
+            Assert.Equal(1, provider.Count);
+            provider.GetPosixPermissionInfo(new FileInfo("/srv/other"));
+            Assert.Equal(2, provider.HitCount);
+        }
+
+        [Fact]
+        public void PermissionChangeWatcherEvents()
+        {
+            var root = Path.Combine(Path.GetTempPath(), Path.GetRandomFileName());
+            Directory.CreateDirectory(Path.Combine(root, "dir", "sub"));
+            try
+            {
+                var mockNativeLibraryInterface = new Mock<INativeLibraryInterface>(MockBehavior.Strict);
+                var dataContainer = new NativePermissionDataContainer { OwnerId = 1000, GroupId = 2000 };
+                var acl = CreateMinimalAcl(FilePermissions.Read, FilePermissions.None, FilePermissions.None);
+                mockNativeLibraryInterface.Setup(obj => obj.GetPermissionData(null, It.IsAny<string>(), 0, out dataContainer)).Returns(acl);
+
+                // Renamed directories keep their watch descriptors
+                var watchDescriptors = new Dictionary<string, int>
+                {
+                    [""] = 1,
+                    ["/dir"] = 2,
+                    ["/dir/sub"] = 3,
+                    ["/moved"] = 2,
+                    ["/moved/sub"] = 3
+                };
+                var watcherHandle = new FileWatcherHandle();
+                mockNativeLibraryInterface.Setup(obj => obj.CreateFileWatcher(false)).Returns(watcherHandle);
+                mockNativeLibraryInterface.Setup(obj => obj.AddFileWatch(watcherHandle, It.IsAny<string>()))
+                    .Returns((FileWatcherHandle watcherParam, string pathParam) => watchDescriptors[pathParam.Substring(root.Length)]);
+
+                // Each read of events signals that the previous batch was processed, and waits for the next one
+                var batches = new BlockingCollection<(int WatchDescriptor, NativeWatchEventFlags Flags, string Name)[]>();
+                var readerWaiting = new SemaphoreSlim(0);
+                mockNativeLibraryInterface.Setup(obj => obj.ReadFileWatchEvents(watcherHandle, It.IsAny<NativeWatchEvent[]>(), It.IsAny<byte[]>()))
+                    .Returns((FileWatcherHandle watcherParam, NativeWatchEvent[] eventsParam, byte[] namesParam) =>
+                    {
+                        readerWaiting.Release();
+                        if(!batches.TryTake(out var batch, Timeout.Infinite))
+                            return 0;
+                        int nameOffset = 0;
+                        for(int i = 0; i < batch.Length; ++i)
+                        {
+                            eventsParam[i] = new NativeWatchEvent { WatchDescriptor = batch[i].WatchDescriptor, Flags = batch[i].Flags, NameOffset = batch[i].Name == null ? -1 : nameOffset };
+                            if(batch[i].Name != null)
+                            {
+                                nameOffset += Encoding.UTF8.GetBytes(batch[i].Name, 0, batch[i].Name.Length, namesParam, nameOffset);
+                                namesParam[nameOffset++] = 0;
+                            }
+                        }
+                        return batch.Length;
+                    });
+                mockNativeLibraryInterface.Setup(obj => obj.CancelFileWatcher(watcherHandle)).Callback(() => batches.CompleteAdding());
+                void Deliver(params (int WatchDescriptor, NativeWatchEventFlags Flags, string Name)[] batch)
+                {
+                    readerWaiting.Wait();
+                    batches.Add(batch);
+                }
+                void WaitForProcessing()
+                {
+                    readerWaiting.Wait();
+                    readerWaiting.Release();
+                }
+
+                var provider = new CachingPosixPermissionsProvider(new PosixPermissionsProvider(mockNativeLibraryInterface.Object), mockNativeLibraryInterface.Object, new PermissionCacheOptions { Validation = PermissionCacheValidation.Invalidation });
+                using var watcher = new PermissionChangeWatcher(mockNativeLibraryInterface.Object, provider, false);
+                watcher.Watch(root);
+                mockNativeLibraryInterface.Verify(obj => obj.AddFileWatch(watcherHandle, It.IsAny<string>()), Times.Exactly(3));
+
+                // A renamed directory moves its watches and the cached entries of its subtree
+                provider.GetPosixPermissionInfo(new FileInfo(root + "/dir/sub/file"));
+                provider.GetPosixPermissionInfo(new FileInfo(root + "/file"));
+                Directory.Move(root + "/dir", root + "/moved");
+                Deliver((1, NativeWatchEventFlags.Deleted | NativeWatchEventFlags.Moved | NativeWatchEventFlags.Directory, "dir"), (1, NativeWatchEventFlags.Created | NativeWatchEventFlags.Moved | NativeWatchEventFlags.Directory, "moved"));
+                WaitForProcessing();
+                Assert.Equal(1, provider.Count);
+                mockNativeLibraryInterface.Verify(obj => obj.AddFileWatch(watcherHandle, root + "/moved/sub"), Times.Once);
+
+                // Events of the renamed subdirectory resolve to the new path
+                provider.GetPosixPermissionInfo(new FileInfo(root + "/moved/sub/file"));
+                Assert.Equal(2, provider.Count);
+                Deliver((3, NativeWatchEventFlags.Attributes, "file"));
+                WaitForProcessing();
+                Assert.Equal(1, provider.Count);
+
+                // A deleted directory forgets the watches of its subtree
+                provider.GetPosixPermissionInfo(new FileInfo(root + "/moved/sub/file"));
+                Directory.Delete(root + "/moved/sub");
+                Deliver((2, NativeWatchEventFlags.Deleted | NativeWatchEventFlags.Directory, "sub"));
+                WaitForProcessing();
+                Assert.Equal(1, provider.Count);
+                provider.GetPosixPermissionInfo(new FileInfo(root + "/moved/sub/file"));
+                Deliver((3, NativeWatchEventFlags.Attributes, "file"));
+                WaitForProcessing();
+                Assert.Equal(2, provider.Count);
+
+                // An overflow clears the cache and adds the watches again
+                Deliver((-1, NativeWatchEventFlags.Overflow, null));
+                WaitForProcessing();
+                Assert.Equal(0, provider.Count);
+                Assert.Equal(1, watcher.OverflowCount);
+                mockNativeLibraryInterface.Verify(obj => obj.AddFileWatch(watcherHandle, root), Times.Exactly(2));
+            }
+            finally
+            {
+                Directory.Delete(root, true);
+            }
+        }
+
+        private static AccessControlListEntry[] CreateMinimalAcl(FilePermissions ownerPermissions, FilePermissions groupPermissions, FilePermissions otherPermissions)
+        {
+            return new[]
+            {
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.UserObj, TagQualifier = 0, Permissions = ownerPermissions },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.GroupObj, TagQualifier = 0, Permissions = groupPermissions },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Other, TagQualifier = 0, Permissions = otherPermissions }
+            };
+        }
+
+        [Fact]
+        public void PermissionIndexQueries()
+        {
+            FilePermissions r = FilePermissions.Read;
+            FilePermissions rw = FilePermissions.Read | FilePermissions.Write;
+            FilePermissions rx = FilePermissions.Read | FilePermissions.Execute;
+            FilePermissions rwx = FilePermissions.Read | FilePermissions.Write | FilePermissions.Execute;
+
+            // Some full vectors and a shorter tail; equal ACLs are separate arrays
+            int fileCount = 2 * Vector<int>.Count + Vector<int>.Count / 2 + 1;
+            var records = new List<PermissionScanRecord> { new PermissionScanRecord("", 0, 1, 2, 0, 0, 0x41ED, CreateMinimalAcl(rwx, rx, rx), Array.Empty<AccessControlListEntry>()) };
+            for(int i = 1; i <= fileCount; ++i)
+            {
+                bool isShared = i % 2 == 0;
+                uint mode = 0x8000 | (isShared ? 0x1A4u : 0x180u) | (i == fileCount ? 0x800u : 0);
+                var acl = isShared ? CreateMinimalAcl(rw, r, r) : CreateMinimalAcl(rw, FilePermissions.None, FilePermissions.None);
+                records.Add(new PermissionScanRecord("file" + i, 1, 1, (ulong)(100 + i), i % 3 == 0 ? 1000 : 2000, isShared ? 3000 : 4000, mode, acl, Array.Empty<AccessControlListEntry>()));
+            }
+
+            var index = new PermissionIndex(records);
+            Assert.Equal(fileCount + 1, index.Count);
+            Assert.Equal(3, index.AclCount);
+            Assert.Equal(index.GetAccessAclId(2), index.GetAccessAclId(fileCount - fileCount % 2));
+            Assert.Equal("file3", index.GetPath(3));
+
+            // Results of the vectorized queries match a scalar scan
+            var fileIndices = Enumerable.Range(1, fileCount).ToArray();
+            Assert.Equal(fileIndices.Where(i => i % 3 == 0).ToArray(), index.FindByOwner(1000));
+            Assert.Equal(fileIndices.Where(i => i % 2 == 1).ToArray(), index.FindByGroup(4000));
+            Assert.Equal(fileIndices.Where(i => i % 2 == 0).ToArray(), index.FindByAccessAcl(index.GetAccessAclId(2)));
+            Assert.Equal(new[] { fileCount }, index.FindByMode(0x800, 0x800));
+            Assert.Equal(fileIndices.Where(i => i % 2 == 0).ToArray(), index.FindByMode(0x1FF, 0x1A4));
+
+            // The root directory grants read to others, shared files to their group, and private files to their owner
+            Assert.Equal(new[] { 0 }.Concat(fileIndices.Where(i => i % 2 == 0)).ToArray(), index.FindWithPermissions(new AccessPrincipal(5000, new[] { 3000 }), r));
+            Assert.Equal(fileIndices.Where(i => i % 3 == 0).ToArray(), index.FindWithPermissions(new AccessPrincipal(1000, new[] { 1000 }), rw));
+
+            // An index shorter than a vector is searched by the scalar loop only
+            var smallIndex = new PermissionIndex(records.Take(2));
+            Assert.Equal(new[] { 1 }, smallIndex.FindByOwner(2000));
+            Assert.Equal(new[] { 1 }, smallIndex.FindByMode(0xF000, 0x8000));
+            Assert.Equal(new[] { 0 }, smallIndex.FindWithPermissions(new AccessPrincipal(5000, new[] { 5000 }), r));
+        }
+
+        [Fact]
+        public void PermissionSnapshotRoundTrip()
+        {
+            FilePermissions r = FilePermissions.Read;
+            FilePermissions rw = FilePermissions.Read | FilePermissions.Write;
+            FilePermissions rx = FilePermissions.Read | FilePermissions.Execute;
+            FilePermissions rwx = FilePermissions.Read | FilePermissions.Write | FilePermissions.Execute;
+            var extendedAcl = new[]
+            {
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.UserObj, TagQualifier = 0, Permissions = rwx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.User, TagQualifier = 2000, Permissions = rw },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.GroupObj, TagQualifier = 0, Permissions = rx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Mask, TagQualifier = 0, Permissions = rwx },
+                new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Other, TagQualifier = 0, Permissions = FilePermissions.None }
+            };
+            var index = new PermissionIndex(new[]
+            {
+                new PermissionScanRecord("", 0, 1, 10, 0, 0, 0x41ED, CreateMinimalAcl(rwx, rx, rx), extendedAcl),
+                new PermissionScanRecord("dir", 1, 1, 12, 1000, 3000, 0x45F8, extendedAcl, extendedAcl),
+                new PermissionScanRecord("dir/f\u00fcle", 2, 1, 11, 1000, 3000, 0x81B0, CreateMinimalAcl(rw, r, FilePermissions.None), Array.Empty<AccessControlListEntry>()),
+                new PermissionScanRecord("other", 1, 2, 5, 2000, 2000, 0x81A4, CreateMinimalAcl(rw, r, r), Array.Empty<AccessControlListEntry>())
+            });
+
+            var path = Path.GetTempFileName();
+            try
+            {
+                // Records, paths, ACLs and the inode order survive the round trip
+                PermissionSnapshot.Write(index, path);
+                Assert.False(File.Exists(path + ".tmp"));
+                using(var snapshot = new PermissionSnapshot(path))
+                {
+                    Assert.Equal(index.Count, snapshot.Count);
+                    Assert.Equal(index.AclCount, snapshot.AclCount);
+                    for(int i = 0; i < index.Count; ++i)
+                    {
+                        Assert.Equal(index.GetPath(i), snapshot.GetPath(i));
+                        Assert.Equal(index.GetDevice(i), snapshot.GetDevice(i));
+                        Assert.Equal(index.GetInode(i), snapshot.GetInode(i));
+                        Assert.Equal(index.GetParent(i), snapshot.GetParent(i));
+                        Assert.Equal(index.GetOwnerId(i), snapshot.GetOwnerId(i));
+                        Assert.Equal(index.GetGroupId(i), snapshot.GetGroupId(i));
+                        Assert.Equal(index.GetMode(i), snapshot.GetMode(i));
+                        Assert.Equal(index.GetAccessAclId(i), snapshot.GetAccessAclId(i));
+                        Assert.Equal(index.GetDefaultAclId(i), snapshot.GetDefaultAclId(i));
+                    }
+                    for(int aclId = 0; aclId < index.AclCount; ++aclId)
+                        Assert.Equal(index.GetAcl(aclId).ToArray(), snapshot.GetAcl(aclId));
+                    Assert.Equal("dir/f\u00fcle", snapshot.GetPath(2));
+                    Assert.Equal(new[] { 0, 2, 1, 3 }, Enumerable.Range(0, snapshot.Count).Select(snapshot.GetIndexInInodeOrder).ToArray());
+                }
+
+                // Truncated files and files with a wrong magic number are rejected
+                var data = File.ReadAllBytes(path);
+                File.WriteAllBytes(path, data.AsSpan(0, data.Length - 1).ToArray());
+                Assert.Throws<InvalidDataException>(() => new PermissionSnapshot(path));
+                File.WriteAllBytes(path, data.AsSpan(0, 32).ToArray());
+                Assert.Throws<InvalidDataException>(() => new PermissionSnapshot(path));
+                var corruptData = (byte[])data.Clone();
+                corruptData[0] ^= 0xFF;
+                File.WriteAllBytes(path, corruptData);
+                Assert.Throws<InvalidDataException>(() => new PermissionSnapshot(path));
+
+                // Records with parent cycles or references outside their sections are rejected
+                void AssertCorruptRecordRejected(int recordIndex, int fieldOffset, int value)
+                {
+                    var corruptRecordData = (byte[])data.Clone();
+                    BitConverter.TryWriteBytes(corruptRecordData.AsSpan(64 + 48 * recordIndex + fieldOffset), value);
+                    File.WriteAllBytes(path, corruptRecordData);
+                    Assert.Throws<InvalidDataException>(() => new PermissionSnapshot(path));
+                }
+                AssertCorruptRecordRejected(1, 16, 1);
+                AssertCorruptRecordRejected(1, 16, 3);
+                AssertCorruptRecordRejected(2, 20, 1000);
+                AssertCorruptRecordRejected(2, 24, -1);
+                AssertCorruptRecordRejected(3, 40, index.AclCount);
+                AssertCorruptRecordRejected(3, 44, -2);
+            }
+            finally
+            {
+                File.Delete(path);
+            }
+        }
+
+        private static string[] CompareSnapshots(IEnumerable<PermissionScanRecord> oldRecords, IEnumerable<PermissionScanRecord> newRecords)
+        {
+            var oldPath = Path.GetTempFileName();
+            var newPath = Path.GetTempFileName();
+            try
+            {
+                PermissionSnapshot.Write(new PermissionIndex(oldRecords), oldPath);
+                PermissionSnapshot.Write(new PermissionIndex(newRecords), newPath);
+                using var oldSnapshot = new PermissionSnapshot(oldPath);
+                using var newSnapshot = new PermissionSnapshot(newPath);
+                return PermissionSnapshotDiff.Compare(oldSnapshot, newSnapshot).Select(change => change.ToString()).ToArray();
+            }
+            finally
+            {
+                File.Delete(oldPath);
+                File.Delete(newPath);
+            }
+        }
+
+        [Fact]
+        public void PermissionSnapshotDiffs()
+        {
+            FilePermissions r = FilePermissions.Read;
+            FilePermissions rw = FilePermissions.Read | FilePermissions.Write;
+            FilePermissions rx = FilePermissions.Read | FilePermissions.Execute;
+            FilePermissions rwx = FilePermissions.Read | FilePermissions.Write | FilePermissions.Execute;
+            PermissionScanRecord CreateRecord(string relativePath, ulong inode, uint mode)
+            {
+                var acl = (mode & 0xF000) == 0x4000 ? CreateMinimalAcl(rwx, rx, rx) : CreateMinimalAcl(rw, r, (FilePermissions)(mode & 7));
+                return new PermissionScanRecord(relativePath, relativePath.Length == 0 ? 0 : relativePath.Split('/').Length, 1, inode, 1000, 1000, mode, acl, Array.Empty<AccessControlListEntry>());
+            }
+
+            // dir/link1 and dir/link2 are hard links
+            var oldRecords = new[]
+            {
+                CreateRecord("", 10, 0x41ED),
+                CreateRecord("dir", 11, 0x41ED),
+                CreateRecord("dir/a", 12, 0x81A4),
+                CreateRecord("dir/link1", 13, 0x81A4),
+                CreateRecord("dir/link2", 13, 0x81A4),
+                CreateRecord("b", 14, 0x81A4)
+            };
+
+            // Identical trees have no changes, even if the hard links are scanned in a different order
+            Assert.Empty(CompareSnapshots(oldRecords, new[] { oldRecords[0], oldRecords[1], oldRecords[2], oldRecords[4], oldRecords[3], oldRecords[5] }));
+
+            // Changed mode
+            Assert.Equal(new[] { "ModeChanged dir/a" }, CompareSnapshots(oldRecords, new[] { oldRecords[0], oldRecords[1], CreateRecord("dir/a", 12, 0x81A0), oldRecords[3], oldRecords[4], oldRecords[5] }));
+
+            // Renamed file and renamed hard link
+            Assert.Equal(new[] { "Moved c" }, CompareSnapshots(oldRecords, new[] { oldRecords[0], oldRecords[1], oldRecords[2], oldRecords[3], oldRecords[4], CreateRecord("c", 14, 0x81A4) }));
+            Assert.Equal(new[] { "Moved dir/link3" }, CompareSnapshots(oldRecords, new[] { oldRecords[0], oldRecords[1], oldRecords[2], CreateRecord("dir/link3", 13, 0x81A4), oldRecords[3], oldRecords[5] }));
+
+            // Files matched by path are not moved, even if their parent directory was recreated
+            Assert.Empty(CompareSnapshots(
+                new[] { oldRecords[0], oldRecords[1], oldRecords[2] },
+                new[] { oldRecords[0], CreateRecord("dir", 20, 0x41ED), CreateRecord("dir/a", 21, 0x81A4) }));
+
+            // Added and removed files
+            Assert.Equal(new[] { "Added dir/new", "Removed b" }, CompareSnapshots(oldRecords, new[] { oldRecords[0], oldRecords[1], oldRecords[2], oldRecords[3], oldRecords[4], CreateRecord("dir/new", 15, 0x81A4) }));
+        }
+
+        [Fact]
+        public void RestoreSnapshotWithoutFollowingLinks()
+        {
+            var mockNativeLibraryInterface = new Mock<INativeLibraryInterface>(MockBehavior.Strict);
+            FilePermissions r = FilePermissions.Read;
+            FilePermissions rw = FilePermissions.Read | FilePermissions.Write;
+            FilePermissions rx = FilePermissions.Read | FilePermissions.Execute;
+            FilePermissions rwx = FilePermissions.Read | FilePermissions.Write | FilePermissions.Execute;
+            var directoryAcl = CreateMinimalAcl(rwx, rx, rx);
+            var fileAcl = CreateMinimalAcl(rw, r, r);
+            var records = new[]
+            {
+                new PermissionScanRecord("", 0, 1, 10, 1000, 1000, 0x41ED, directoryAcl, Array.Empty<AccessControlListEntry>()),
+                new PermissionScanRecord("dir", 1, 1, 11, 1000, 1000, 0x41ED, directoryAcl, Array.Empty<AccessControlListEntry>()),
+                new PermissionScanRecord("dir/file", 2, 1, 12, 1000, 1000, 0x81A4, fileAcl, Array.Empty<AccessControlListEntry>()),
+                new PermissionScanRecord("file2", 1, 1, 13, 1000, 1000, 0x81A4, fileAcl, Array.Empty<AccessControlListEntry>())
+            };
+
+            // The restorer must request both options
+            mockNativeLibraryInterface.Setup(obj => obj.WithContextOptions(NativeContextOptions.NoFollow | NativeContextOptions.SkipUnchanged)).Returns(mockNativeLibraryInterface.Object);
+
+            // "dir" was replaced by a symbolic link to a directory containing "file", so opening it fails
+            var rootHandle = new PosixDirectoryHandle();
+            var rootContentsHandle = new PosixDirectoryHandle();
+            mockNativeLibraryInterface.Setup(obj => obj.OpenDirectory("/base")).Returns(rootHandle);
+            mockNativeLibraryInterface.Setup(obj => obj.OpenDirectory(rootHandle, ".")).Returns(rootContentsHandle);
+            mockNativeLibraryInterface.Setup(obj => obj.OpenDirectory(rootHandle, "dir")).Throws(new IOException("Too many levels of symbolic links"));
+
+            // The live permissions match the snapshot, except for "file2", which was replaced by a symbolic link
+            mockNativeLibraryInterface.Setup(obj => obj.GetPermissionDataBatch(It.IsAny<PosixDirectoryHandle>(), It.IsAny<IReadOnlyList<string>>(), It.IsAny<int>()))
+                .Returns((PosixDirectoryHandle directoryParam, IReadOnlyList<string> fileNamesParam, int loadDefaultAclParam) =>
+                {
+                    var results = new NativeBatchReadResult[fileNamesParam.Count];
+                    var entries = new List<AccessControlListEntry>();
+                    for(int i = 0; i < results.Length; ++i)
+                    {
+                        bool isFile = fileNamesParam[i] == "file2";
+                        var acl = loadDefaultAclParam != 0 ? Array.Empty<AccessControlListEntry>() : isFile ? fileAcl : directoryAcl;
+                        results[i].DataContainer = new NativePermissionDataContainer
+                        {
+                            OwnerId = isFile ? 2000 : 1000,
+                            OwnerPermissions = isFile ? rw : rwx,
+                            GroupId = 1000,
+                            GroupPermissions = isFile ? r : rx,
+                            OtherPermissions = isFile ? r : rx,
+                            AclSize = acl.Length
+                        };
+                        results[i].EntriesOffset = entries.Count;
+                        entries.AddRange(acl);
+                    }
+                    return new PermissionDataBatch(results, entries.ToArray());
+                });
+            mockNativeLibraryInterface.Setup(obj => obj.SetPermissionData(rootContentsHandle, "file2", 0, ref It.Ref<NativePermissionDataContainer>.IsAny, It.IsAny<AccessControlListEntry[]>(), out It.Ref<NativePermissionChanges>.IsAny))
+                .Throws(new NativeException("SetPermissionData", NativeErrorCodes.NATIVE_ERROR_CHMOD_FAILED, 95, "Operation not supported"));
+
+            var path = Path.GetTempFileName();
+            try
+            {
+                PermissionSnapshot.Write(new PermissionIndex(records), path);
+                using var snapshot = new PermissionSnapshot(path);
+                var report = new PermissionSnapshotRestorer(mockNativeLibraryInterface.Object).Restore(snapshot, "/base", 1, null);
+
+                // Nothing is written through the links
+                Assert.Equal(2, report.FailedCount);
+                Assert.Equal(new[] { "dir", "file2" }, report.Failures.Select(failure => failure.Key).OrderBy(failurePath => failurePath, StringComparer.Ordinal).ToArray());
+                Assert.Equal(2, report.ProcessedCount);
+                Assert.Equal(0, report.ChangedCount);
+                mockNativeLibraryInterface.Verify(obj => obj.WithContextOptions(NativeContextOptions.NoFollow | NativeContextOptions.SkipUnchanged), Times.Once);
+                mockNativeLibraryInterface.Verify(obj => obj.OpenDirectory(It.IsAny<string>()), Times.Once);
+                mockNativeLibraryInterface.Verify(obj => obj.SetPermissionData(It.IsAny<PosixDirectoryHandle>(), "file", It.IsAny<int>(), ref It.Ref<NativePermissionDataContainer>.IsAny, It.IsAny<AccessControlListEntry[]>(), out It.Ref<NativePermissionChanges>.IsAny), Times.Never);
+                mockNativeLibraryInterface.Verify(obj => obj.SetPermissionData(It.IsAny<PosixDirectoryHandle>(), It.IsAny<string>(), It.IsAny<int>(), ref It.Ref<NativePermissionDataContainer>.IsAny, It.IsAny<AccessControlListEntry[]>(), out It.Ref<NativePermissionChanges>.IsAny), Times.Once);
+                mockNativeLibraryInterface.Verify(obj => obj.SetDirectoryPermissionData(It.IsAny<PosixDirectoryHandle>(), It.IsAny<string>(), ref It.Ref<NativePermissionDataContainer>.IsAny, It.IsAny<AccessControlListEntry[]>(), It.IsAny<AccessControlListEntry[]>()), Times.Never);
+            }
+            finally
+            {
+                File.Delete(path);
+            }
+        }
     }
 }
@@ -0,0 +1,344 @@
+﻿using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.Threading;
+using Mono.Unix.Native;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Checks whether users can access files, by evaluating the ACLs of the file and of all directories on its path.
+    /// The groups of each user and the permissions of the directories are cached, so repeated checks usually only need to read the permissions of the file itself.
+    /// </summary>
+    /// <remarks>
+    /// Paths are checked component by component as given, so "." and ".." are handled like by the kernel. Symbolic links in the path are followed when reading permissions, but the directories on the path to the link target are not checked.
+    /// Like the kernel, root may read and write everything and search all directories, but can only execute files with at least one execute bit.
+    /// </remarks>
+    public class AccessChecker
+    {
+        /// <summary>
+        /// The group database. When it is modified, the cached groups are discarded.
+        /// </summary>
+        private const string GroupDatabasePath = "/etc/group";
+
+        /// <summary>
+        /// Default maximum number of cached principals and of cached directories.
+        /// </summary>
+        public const int DefaultCacheCapacity = 10000;
+
+        /// <summary>
+        /// Object for native operations.
+        /// </summary>
+        private readonly INativeLibraryInterface _nativeLibraryInterface;
+
+        /// <summary>
+        /// Lifetime of cache entries, in <see cref="Stopwatch"/> ticks.
+        /// </summary>
+        private readonly long _cacheLifetime;
+
+        /// <summary>
+        /// Interval between checks of the group database modification time, in <see cref="Stopwatch"/> ticks.
+        /// </summary>
+        private readonly long _groupDatabaseCheckInterval = Stopwatch.Frequency;
+
+        /// <summary>
+        /// Maximum number of entries of each cache.
+        /// </summary>
+        private readonly int _cacheCapacity;
+
+        /// <summary>
+        /// Set while a cache is being trimmed, so concurrent inserts do not trim it again.
+        /// </summary>
+        private int _trimming;
+
+        /// <summary>
+        /// Cached principals, indexed by UID.
+        /// </summary>
+        private readonly ConcurrentDictionary<int, CacheEntry<AccessPrincipal>> _principals = new ConcurrentDictionary<int, CacheEntry<AccessPrincipal>>();
+
+        /// <summary>
+        /// Cached directory permissions, indexed by full path.
+        /// </summary>
+        private readonly ConcurrentDictionary<string, CacheEntry<DirectoryPermissions>> _directories = new ConcurrentDictionary<string, CacheEntry<DirectoryPermissions>>(StringComparer.Ordinal);
+
+        /// <summary>
+        /// Time of the next check of the group database.
+        /// </summary>
+        private long _nextGroupDatabaseCheck;
+
+        /// <summary>
+        /// The last known modification time of the group database.
+        /// </summary>
+        private long _groupDatabaseWriteTime;
+
+        /// <summary>
+        /// Creates a new access checker.
+        /// </summary>
+        /// <param name="nativeLibraryInterface">Object for native operations.</param>
+        /// <param name="cacheLifetime">Specifies how long the groups of a user and the permissions of a directory are cached.</param>
+        /// <param name="cacheCapacity">Maximum number of cached principals, and of cached directories. When a cache is full, expired entries are removed first, then arbitrary ones.</param>
+        public AccessChecker(INativeLibraryInterface nativeLibraryInterface, TimeSpan cacheLifetime, int cacheCapacity = DefaultCacheCapacity)
+        {
+            _nativeLibraryInterface = nativeLibraryInterface ?? throw new ArgumentNullException(nameof(nativeLibraryInterface));
+            if(cacheLifetime < TimeSpan.Zero)
+                throw new ArgumentOutOfRangeException(nameof(cacheLifetime));
+            if(cacheCapacity < 1)
+                throw new ArgumentOutOfRangeException(nameof(cacheCapacity));
+            _cacheLifetime = (long)(cacheLifetime.TotalSeconds * Stopwatch.Frequency);
+            _cacheCapacity = cacheCapacity;
+        }
+
+        /// <summary>
+        /// Number of cached principals.
+        /// </summary>
+        public int CachedPrincipalCount => _principals.Count;
+
+        /// <summary>
+        /// Number of cached directories.
+        /// </summary>
+        public int CachedDirectoryCount => _directories.Count;
+
+        /// <summary>
+        /// Returns whether the given user is granted the requested permissions on the given file or directory. This includes search permission on all directories on its path.
+        /// Returns false if the path does not exist.
+        /// </summary>
+        /// <param name="userId">The UID of the user.</param>
+        /// <param name="path">Absolute path to the file or directory.</param>
+        /// <param name="requestedPermissions">The requested permissions.</param>
+        /// <exception cref="ArgumentException">Thrown when the path is not absolute.</exception>
+        public bool CanAccess(int userId, string path, FilePermissions requestedPermissions)
+        {
+            if(path == null)
+                throw new ArgumentNullException(nameof(path));
+            if(!Path.IsPathRooted(path))
+                throw new ArgumentException("The path must be absolute.", nameof(path));
+
+            var principal = GetPrincipal(userId);
+            long now = Stopwatch.GetTimestamp();
+
+            // Check search permission on each directory of the path, starting at the root directory
+            int separatorIndex = 0;
+            while(separatorIndex >= 0 && separatorIndex < path.Length - 1)
+            {
+                var directoryPath = separatorIndex == 0 ? "/" : path.Substring(0, separatorIndex);
+                var directory = GetDirectoryPermissions(directoryPath, now);
+                if(directory == null || !CheckAccess(principal, directory.Entries, directory.DataContainer, FilePermissions.Execute, true))
+                    return false;
+
+                separatorIndex = path.IndexOf('/', separatorIndex + 1);
+            }
+
+            // The permissions of the file itself are not cached
+            if(!TryGetPermissionData(path, out var dataContainer, out var entries))
+                return false;
+
+            // The file type is only relevant for root, which can search directories without execute bits
+            bool isDirectory = principal.UserId == 0 && (requestedPermissions & FilePermissions.Execute) != 0 && Directory.Exists(path);
+            return CheckAccess(principal, entries, dataContainer, requestedPermissions, isDirectory);
+        }
+
+        /// <summary>
+        /// Returns the given user together with its groups. The groups are cached.
+        /// Users which do not exist in the user database are not a member of any group.
+        /// </summary>
+        /// <param name="userId">The UID of the user.</param>
+        public AccessPrincipal GetPrincipal(int userId)
+        {
+            long now = Stopwatch.GetTimestamp();
+            CheckGroupDatabase(now);
+
+            if(_principals.TryGetValue(userId, out var cacheEntry) && cacheEntry.ExpirationTime > now)
+                return cacheEntry.Value;
+
+            int[] groupIds;
+            try
+            {
+                groupIds = _nativeLibraryInterface.GetUserGroups(userId);
+            }
+            catch(KeyNotFoundException)
+            {
+                groupIds = Array.Empty<int>();
+            }
+            var principal = new AccessPrincipal(userId, groupIds);
+            Store(_principals, userId, new CacheEntry<AccessPrincipal>(principal, now + _cacheLifetime), now);
+            return principal;
+        }
+
+        /// <summary>
+        /// Discards all cached groups and directory permissions.
+        /// </summary>
+        public void Clear()
+        {
+            _principals.Clear();
+            _directories.Clear();
+        }
+
+        /// <summary>
+        /// Discards the cached groups if the group database was modified since the last check. The modification time is checked at most once per second.
+        /// </summary>
+        /// <param name="now">The current time.</param>
+        private void CheckGroupDatabase(long now)
+        {
+            long nextCheck = Interlocked.Read(ref _nextGroupDatabaseCheck);
+            if(now < nextCheck || Interlocked.CompareExchange(ref _nextGroupDatabaseCheck, now + _groupDatabaseCheckInterval, nextCheck) != nextCheck)
+                return;
+
+            long writeTime = File.GetLastWriteTimeUtc(GroupDatabasePath).Ticks;
+            if(Interlocked.Exchange(ref _groupDatabaseWriteTime, writeTime) != writeTime)
+                _principals.Clear();
+        }
+
+        /// <summary>
+        /// Returns the permissions of the given directory, or null if it does not exist.
+        /// </summary>
+        /// <param name="path">Path to the directory.</param>
+        /// <param name="now">The current time.</param>
+        private DirectoryPermissions GetDirectoryPermissions(string path, long now)
+        {
+            if(_directories.TryGetValue(path, out var cacheEntry) && cacheEntry.ExpirationTime > now)
+                return cacheEntry.Value;
+
+            if(!TryGetPermissionData(path, out var dataContainer, out var entries))
+                return null;
+            var directory = new DirectoryPermissions(dataContainer, entries);
+            Store(_directories, path, new CacheEntry<DirectoryPermissions>(directory, now + _cacheLifetime), now);
+            return directory;
+        }
+
+        /// <summary>
+        /// Adds or replaces the given cache entry. If the cache exceeds its capacity, expired entries are removed; if this does not free enough space, arbitrary entries are removed until the cache is a quarter below its capacity.
+        /// Trimming walks the entire cache, but only happens after a quarter of the capacity was inserted, so inserts take amortized constant time.
+        /// </summary>
+        /// <typeparam name="TKey">The type of the cache keys.</typeparam>
+        /// <typeparam name="TValue">The type of the cached values.</typeparam>
+        /// <param name="cache">The cache.</param>
+        /// <param name="key">The key of the new entry.</param>
+        /// <param name="entry">The new entry.</param>
+        /// <param name="now">The current time.</param>
+        private void Store<TKey, TValue>(ConcurrentDictionary<TKey, CacheEntry<TValue>> cache, TKey key, CacheEntry<TValue> entry, long now)
+        {
+            cache[key] = entry;
+            if(cache.Count <= _cacheCapacity || Interlocked.Exchange(ref _trimming, 1) != 0)
+                return;
+
+            try
+            {
+                foreach(var cachedEntry in cache)
+                {
+                    if(cachedEntry.Value.ExpirationTime <= now)
+                        cache.TryRemove(cachedEntry.Key, out _);
+                }
+
+                int targetCount = _cacheCapacity - _cacheCapacity / 4;
+                foreach(var cachedEntry in cache)
+                {
+                    if(cache.Count <= targetCount)
+                        break;
+                    cache.TryRemove(cachedEntry.Key, out _);
+                }
+            }
+            finally
+            {
+                Volatile.Write(ref _trimming, 0);
+            }
+        }
+
+        /// <summary>
+        /// Reads the permissions of the given file. Returns false if the file or a part of its path does not exist.
+        /// </summary>
+        /// <param name="path">Path to the file.</param>
+        /// <param name="dataContainer">Receives the permission data of the file.</param>
+        /// <param name="entries">Receives the access ACL of the file.</param>
+        private bool TryGetPermissionData(string path, out NativePermissionDataContainer dataContainer, out AccessControlListEntry[] entries)
+        {
+            try
+            {
+                entries = _nativeLibraryInterface.GetPermissionData(path, 0, out dataContainer);
+                return true;
+            }
+            catch(Exception ex) when (ex is FileNotFoundException || (ex is NativeException nativeException && nativeException.ErrorCode == NativeErrorCodes.NATIVE_ERROR_OPEN_FAILED && nativeException.Errno == (long)Errno.ENOTDIR))
+            {
+                dataContainer = default;
+                entries = null;
+                return false;
+            }
+        }
+
+        /// <summary>
+        /// Returns whether the given principal is granted the requested permissions, taking into account the privileges of root.
+        /// </summary>
+        /// <param name="principal">The principal accessing the file.</param>
+        /// <param name="entries">The access ACL of the file.</param>
+        /// <param name="dataContainer">The permission data of the file.</param>
+        /// <param name="requestedPermissions">The requested permissions.</param>
+        /// <param name="isDirectory">Specifies whether the file is known to be a directory.</param>
+        private static bool CheckAccess(AccessPrincipal principal, AccessControlListEntry[] entries, in NativePermissionDataContainer dataContainer, FilePermissions requestedPermissions, bool isDirectory)
+        {
+            if(principal.UserId == 0)
+            {
+                if((requestedPermissions & FilePermissions.Execute) == 0 || isDirectory)
+                    return true;
+                return ((dataContainer.OwnerPermissions | dataContainer.GroupPermissions | dataContainer.OtherPermissions) & FilePermissions.Execute) != 0;
+            }
+
+            return PermissionEvaluator.CheckAccess(entries, dataContainer.OwnerId, dataContainer.GroupId, principal, requestedPermissions);
+        }
+
+        /// <summary>
+        /// A cached value.
+        /// </summary>
+        /// <typeparam name="T">The type of the cached value.</typeparam>
+        private class CacheEntry<T>
+        {
+            /// <summary>
+            /// The cached value.
+            /// </summary>
+            public T Value { get; }
+
+            /// <summary>
+            /// The time when the value expires, in <see cref="Stopwatch"/> ticks.
+            /// </summary>
+            public long ExpirationTime { get; }
+
+            /// <summary>
+            /// Creates a new cache entry.
+            /// </summary>
+            /// <param name="value">The cached value.</param>
+            /// <param name="expirationTime">The time when the value expires.</param>
+            public CacheEntry(T value, long expirationTime)
+            {
+                Value = value;
+                ExpirationTime = expirationTime;
+            }
+        }
+
+        /// <summary>
+        /// The permissions of a directory.
+        /// </summary>
+        private class DirectoryPermissions
+        {
+            /// <summary>
+            /// Owner, group and UNIX permissions of the directory.
+            /// </summary>
+            public NativePermissionDataContainer DataContainer { get; }
+
+            /// <summary>
+            /// The access ACL of the directory.
+            /// </summary>
+            public AccessControlListEntry[] Entries { get; }
+
+            /// <summary>
+            /// Creates a new object.
+            /// </summary>
+            /// <param name="dataContainer">Owner, group and UNIX permissions of the directory.</param>
+            /// <param name="entries">The access ACL of the directory.</param>
+            public DirectoryPermissions(NativePermissionDataContainer dataContainer, AccessControlListEntry[] entries)
+            {
+                DataContainer = dataContainer;
+                Entries = entries;
+            }
+        }
+    }
+}
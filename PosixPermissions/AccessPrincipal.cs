@@ -0,0 +1,49 @@
+﻿using System;
+using System.Collections.Generic;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// A user and its group memberships, for which access checks are done.
+    /// </summary>
+    public class AccessPrincipal
+    {
+        /// <summary>
+        /// The sorted and deduplicated GIDs of the groups the user is a member of.
+        /// </summary>
+        private readonly int[] _groupIds;
+
+        /// <summary>
+        /// The UID of the user.
+        /// </summary>
+        public int UserId { get; }
+
+        /// <summary>
+        /// The sorted GIDs of the groups the user is a member of, including its primary group.
+        /// </summary>
+        public ReadOnlySpan<int> GroupIds => _groupIds;
+
+        /// <summary>
+        /// Creates a new principal.
+        /// </summary>
+        /// <param name="userId">The UID of the user.</param>
+        /// <param name="groupIds">The GIDs of the groups the user is a member of, including its primary group.</param>
+        public AccessPrincipal(int userId, IEnumerable<int> groupIds)
+        {
+            if(groupIds == null)
+                throw new ArgumentNullException(nameof(groupIds));
+
+            UserId = userId;
+            var groupIdSet = new SortedSet<int>(groupIds);
+            _groupIds = new int[groupIdSet.Count];
+            groupIdSet.CopyTo(_groupIds);
+        }
+
+        /// <summary>
+        /// Returns whether the user is a member of the given group.
+        /// </summary>
+        /// <param name="groupId">The GID of the group.</param>
+        public bool IsMemberOf(int groupId)
+            => Array.BinarySearch(_groupIds, groupId) >= 0;
+    }
+}
@@ -0,0 +1,409 @@
+﻿using System;
+using System.Buffers.Text;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Writes the permissions of a directory tree in the text format of "getfacl -R", which can be restored with "setfacl --restore" or <see cref="AclTextImporter"/>.
+    /// The output is encoded directly into a byte buffer; user and group names are looked up once and cached.
+    /// </summary>
+    /// <remarks>
+    /// Like getfacl, leading slashes are removed from the paths, and symbolic links below the root directory are skipped.
+    /// </remarks>
+    public class AclTextExporter
+    {
+        /// <summary>
+        /// Size of the output buffer.
+        /// </summary>
+        private const int BufferLength = 1 << 16;
+
+        /// <summary>
+        /// Column where "#effective:" comments start, if the entry is short enough.
+        /// </summary>
+        private const int EffectiveCommentColumn = 32;
+
+        /// <summary>
+        /// Space reserved in the output buffer for an ACL entry line.
+        /// </summary>
+        private const int MaximumLineLength = 128;
+
+        /// <summary>
+        /// Object for native operations.
+        /// </summary>
+        private readonly INativeLibraryInterface _nativeLibraryInterface;
+
+        /// <summary>
+        /// Determines whether user and group IDs are written instead of names.
+        /// </summary>
+        private readonly bool _numeric;
+
+        /// <summary>
+        /// Quoted UTF-8 encoded user names by UID.
+        /// </summary>
+        private readonly Dictionary<int, byte[]> _userNames = new Dictionary<int, byte[]>();
+
+        /// <summary>
+        /// Quoted UTF-8 encoded group names by GID.
+        /// </summary>
+        private readonly Dictionary<int, byte[]> _groupNames = new Dictionary<int, byte[]>();
+
+        /// <summary>
+        /// The output buffer.
+        /// </summary>
+        private byte[] _buffer;
+
+        /// <summary>
+        /// The number of used bytes in <see cref="_buffer"/>.
+        /// </summary>
+        private int _position;
+
+        /// <summary>
+        /// The output stream.
+        /// </summary>
+        private Stream _output;
+
+        /// <summary>
+        /// Creates a new exporter.
+        /// </summary>
+        /// <param name="nativeLibraryInterface">Object for native operations.</param>
+        /// <param name="numeric">Specifies whether user and group IDs are written instead of names, like "getfacl -n".</param>
+        public AclTextExporter(INativeLibraryInterface nativeLibraryInterface, bool numeric)
+        {
+            _nativeLibraryInterface = nativeLibraryInterface ?? throw new ArgumentNullException(nameof(nativeLibraryInterface));
+            _numeric = numeric;
+        }
+
+        /// <summary>
+        /// Writes the permissions of the given directory and all files below it to the given stream. Instances are not thread-safe.
+        /// </summary>
+        /// <param name="directory">The directory to export.</param>
+        /// <param name="output">The stream to write to.</param>
+        /// <param name="errorHandler">Optional. Called for each file whose permissions could not be read, with its path relative to <paramref name="directory"/>. Returns false to cancel the operation. If this is null, the first error is thrown.</param>
+        /// <returns>The number of exported files and directories.</returns>
+        public long Export(DirectoryInfo directory, Stream output, Func<string, NativeException, bool> errorHandler = null)
+            => Export(directory.FullName.TrimEnd('/'), output, errorHandler);
+
+        /// <summary>
+        /// Writes the permissions of the given directory and all files below it to the given stream.
+        /// </summary>
+        /// <param name="rootPath">The directory to export.</param>
+        /// <param name="output">The stream to write to.</param>
+        /// <param name="errorHandler">Called for each file whose permissions could not be read, or null to throw the first error.</param>
+        internal long Export(string rootPath, Stream output, Func<string, NativeException, bool> errorHandler)
+        {
+            _output = output;
+            _buffer = new byte[BufferLength];
+            _position = 0;
+            try
+            {
+                var pathPrefix = rootPath.TrimStart('/');
+                long count = 0;
+                foreach(var record in _nativeLibraryInterface.ScanTree(rootPath))
+                {
+                    if(record.Depth > 0 && (record.Mode & 0xF000) == 0xA000)
+                        continue;
+                    if(record.Status != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+                    {
+                        var exception = NativeException.FromErrno(nameof(INativeLibraryInterface.ScanTree), record.Status, record.Errno);
+                        if(errorHandler == null)
+                            throw exception;
+                        if(!errorHandler(record.RelativePath, exception))
+                            break;
+                        continue;
+                    }
+
+                    WriteRecord(pathPrefix, record);
+                    ++count;
+                }
+                Flush();
+                return count;
+            }
+            finally
+            {
+                _output = null;
+                _buffer = null;
+            }
+        }
+
+        /// <summary>
+        /// Writes the permissions of the given file.
+        /// </summary>
+        /// <param name="pathPrefix">The path of the root directory, without leading slashes.</param>
+        /// <param name="record">The scan record of the file.</param>
+        private void WriteRecord(string pathPrefix, PermissionScanRecord record)
+        {
+            // Header
+            WriteAscii("# file: ");
+            if(record.RelativePath.Length == 0)
+                WriteQuoted(pathPrefix.Length == 0 ? "." : pathPrefix);
+            else
+            {
+                if(pathPrefix.Length > 0)
+                {
+                    WriteQuoted(pathPrefix);
+                    WriteByte((byte)'/');
+                }
+                WriteQuoted(record.RelativePath);
+            }
+            WriteAscii("\n# owner: ");
+            WriteName(record.OwnerId, false);
+            WriteAscii("\n# group: ");
+            WriteName(record.GroupId, true);
+            WriteByte((byte)'\n');
+            uint mode = record.Mode;
+            if((mode & 0xE00) != 0)
+            {
+                WriteAscii("# flags: ");
+                WriteByte((mode & 0x800) != 0 ? (byte)'s' : (byte)'-');
+                WriteByte((mode & 0x400) != 0 ? (byte)'s' : (byte)'-');
+                WriteByte((mode & 0x200) != 0 ? (byte)'t' : (byte)'-');
+                WriteByte((byte)'\n');
+            }
+
+            // Entries
+            WriteEntries(record.AccessAcl, false);
+            WriteEntries(record.DefaultAcl, true);
+            WriteByte((byte)'\n');
+        }
+
+        /// <summary>
+        /// Writes the given ACL entries, one per line.
+        /// </summary>
+        /// <param name="entries">The ACL entries.</param>
+        /// <param name="isDefaultAcl">Determines whether the entries are prefixed with "default:".</param>
+        private void WriteEntries(AccessControlListEntry[] entries, bool isDefaultAcl)
+        {
+            // Entries with more permissions than the mask get a comment
+            FilePermissions mask = PermissionEvaluator.ReadWriteExecute;
+            foreach(var entry in entries)
+            {
+                if(entry.TagType == AccessControlListEntryTagTypes.Mask)
+                    mask = entry.Permissions & PermissionEvaluator.ReadWriteExecute;
+            }
+
+            foreach(var entry in entries)
+            {
+                // Keep the line in the buffer, so its length can be measured
+                EnsureSpace(MaximumLineLength);
+                int lineStart = _position;
+                if(isDefaultAcl)
+                    WriteAscii("default:");
+                switch(entry.TagType)
+                {
+                    case AccessControlListEntryTagTypes.UserObj:
+                        WriteAscii("user::");
+                        break;
+                    case AccessControlListEntryTagTypes.User:
+                        WriteAscii("user:");
+                        WriteName(entry.TagQualifier, false);
+                        WriteByte((byte)':');
+                        break;
+                    case AccessControlListEntryTagTypes.GroupObj:
+                        WriteAscii("group::");
+                        break;
+                    case AccessControlListEntryTagTypes.Group:
+                        WriteAscii("group:");
+                        WriteName(entry.TagQualifier, true);
+                        WriteByte((byte)':');
+                        break;
+                    case AccessControlListEntryTagTypes.Mask:
+                        WriteAscii("mask::");
+                        break;
+                    default:
+                        WriteAscii("other::");
+                        break;
+                }
+                WritePermissions(entry.Permissions);
+
+                bool isMasked = entry.TagType == AccessControlListEntryTagTypes.User || entry.TagType == AccessControlListEntryTagTypes.GroupObj || entry.TagType == AccessControlListEntryTagTypes.Group;
+                if(isMasked && (entry.Permissions & PermissionEvaluator.ReadWriteExecute & ~mask) != 0)
+                {
+                    // With very long names the line may have been flushed in between; this only affects the alignment
+                    int column = Math.Max(_position - lineStart, 0);
+                    do
+                    {
+                        WriteByte((byte)'\t');
+                        column = (column + 8) & ~7;
+                    }
+                    while(column < EffectiveCommentColumn);
+                    WriteAscii("#effective:");
+                    WritePermissions(entry.Permissions & mask);
+                }
+                WriteByte((byte)'\n');
+            }
+        }
+
+        /// <summary>
+        /// Writes the given permissions in "rwx" notation.
+        /// </summary>
+        /// <param name="permissions">The permissions.</param>
+        private void WritePermissions(FilePermissions permissions)
+        {
+            EnsureSpace(3);
+            _buffer[_position++] = (permissions & FilePermissions.Read) != 0 ? (byte)'r' : (byte)'-';
+            _buffer[_position++] = (permissions & FilePermissions.Write) != 0 ? (byte)'w' : (byte)'-';
+            _buffer[_position++] = (permissions & FilePermissions.Execute) != 0 ? (byte)'x' : (byte)'-';
+        }
+
+        /// <summary>
+        /// Writes the name of the given user or group, or its ID if the name is unknown or numeric output was requested.
+        /// </summary>
+        /// <param name="id">The UID or GID.</param>
+        /// <param name="isGroup">Determines whether the ID is a GID.</param>
+        private void WriteName(int id, bool isGroup)
+        {
+            if(!_numeric)
+            {
+                var names = isGroup ? _groupNames : _userNames;
+                if(!names.TryGetValue(id, out var name))
+                {
+                    try
+                    {
+                        name = Quote(isGroup ? _nativeLibraryInterface.GetGroupName(id) : _nativeLibraryInterface.GetUserName(id));
+                    }
+                    catch(KeyNotFoundException)
+                    {
+                        name = null;
+                    }
+                    names.Add(id, name);
+                }
+                if(name != null)
+                {
+                    Write(name);
+                    return;
+                }
+            }
+
+            EnsureSpace(11);
+            Utf8Formatter.TryFormat((uint)id, _buffer.AsSpan(_position), out int bytesWritten);
+            _position += bytesWritten;
+        }
+
+        /// <summary>
+        /// Writes the given string in UTF-8 encoding, escaping whitespace, control characters and backslashes as octal sequences like getfacl.
+        /// </summary>
+        /// <param name="value">The string to write.</param>
+        private void WriteQuoted(string value)
+        {
+            // Each character takes at most 3 bytes, each of which may be escaped to 4 bytes
+            EnsureSpace(12 * value.Length);
+            int start = _position;
+            int length = Encoding.UTF8.GetBytes(value.AsSpan(), _buffer.AsSpan(start));
+            int quotedLength = length;
+            for(int i = start; i < start + length; ++i)
+            {
+                if(NeedsQuoting(_buffer[i]))
+                    quotedLength += 3;
+            }
+            if(quotedLength == length)
+            {
+                _position += length;
+                return;
+            }
+
+            // Escape from the back, so the encoded bytes are not overwritten before being read
+            int target = start + quotedLength;
+            for(int i = start + length - 1; i >= start; --i)
+            {
+                byte b = _buffer[i];
+                if(NeedsQuoting(b))
+                {
+                    _buffer[--target] = (byte)('0' + (b & 7));
+                    _buffer[--target] = (byte)('0' + ((b >> 3) & 7));
+                    _buffer[--target] = (byte)('0' + (b >> 6));
+                    _buffer[--target] = (byte)'\\';
+                }
+                else
+                    _buffer[--target] = b;
+            }
+            _position = start + quotedLength;
+        }
+
+        /// <summary>
+        /// Returns the quoted UTF-8 representation of the given string.
+        /// </summary>
+        /// <param name="value">The string.</param>
+        private static byte[] Quote(string value)
+        {
+            var quoted = new List<byte>(value.Length);
+            foreach(byte b in Encoding.UTF8.GetBytes(value))
+            {
+                if(NeedsQuoting(b))
+                {
+                    quoted.Add((byte)'\\');
+                    quoted.Add((byte)('0' + (b >> 6)));
+                    quoted.Add((byte)('0' + ((b >> 3) & 7)));
+                    quoted.Add((byte)('0' + (b & 7)));
+                }
+                else
+                    quoted.Add(b);
+            }
+            return quoted.ToArray();
+        }
+
+        /// <summary>
+        /// Returns whether the given byte is escaped in quoted strings.
+        /// Like getfacl in the C locale, this escapes whitespace, control characters, backslashes and all bytes outside of printable ASCII.
+        /// </summary>
+        /// <param name="b">The byte.</param>
+        private static bool NeedsQuoting(byte b)
+            => b <= (byte)' ' || b >= 0x7F || b == (byte)'\\';
+
+        /// <summary>
+        /// Writes the given ASCII string.
+        /// </summary>
+        /// <param name="value">The string.</param>
+        private void WriteAscii(string value)
+        {
+            EnsureSpace(value.Length);
+            foreach(char c in value)
+                _buffer[_position++] = (byte)c;
+        }
+
+        /// <summary>
+        /// Writes the given bytes.
+        /// </summary>
+        /// <param name="value">The bytes.</param>
+        private void Write(byte[] value)
+        {
+            EnsureSpace(value.Length);
+            value.CopyTo(_buffer, _position);
+            _position += value.Length;
+        }
+
+        /// <summary>
+        /// Writes the given byte.
+        /// </summary>
+        /// <param name="value">The byte.</param>
+        private void WriteByte(byte value)
+        {
+            EnsureSpace(1);
+            _buffer[_position++] = value;
+        }
+
+        /// <summary>
+        /// Makes sure that the output buffer has room for the given number of bytes, by flushing or enlarging it.
+        /// </summary>
+        /// <param name="length">The number of bytes.</param>
+        private void EnsureSpace(int length)
+        {
+            if(_buffer.Length - _position >= length)
+                return;
+            Flush();
+            if(_buffer.Length < length)
+                _buffer = new byte[length];
+        }
+
+        /// <summary>
+        /// Writes the contents of the output buffer to the output stream.
+        /// </summary>
+        private void Flush()
+        {
+            _output.Write(_buffer, 0, _position);
+            _position = 0;
+        }
+    }
+}
@@ -0,0 +1,854 @@
+﻿using System;
+using System.Buffers.Text;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Applies permissions given in the text format of "getfacl -R", like "setfacl --restore".
+    /// The input is parsed directly from a byte buffer; user and group names are looked up once and cached.
+    /// </summary>
+    /// <remarks>
+    /// For each file, the owner, group, special mode bits ("# flags:") and access ACL are set. The default ACL of a directory is only changed if the dump lists default entries for it.
+    /// Paths containing "..", "." or empty components or NUL bytes are rejected, except for "." denoting the base directory itself. Files are opened relative to their parent directory, which is reached from the base directory one component at a time, and symbolic links are never followed.
+    /// </remarks>
+    public class AclTextImporter
+    {
+        /// <summary>
+        /// Initial size of the input buffer. The buffer grows if a single line does not fit.
+        /// </summary>
+        private const int BufferLength = 1 << 16;
+
+        /// <summary>
+        /// ID of names which could not be resolved.
+        /// </summary>
+        private const int UnknownId = -1;
+
+        /// <summary>
+        /// Object for native operations, configured with <see cref="NativeContextOptions.NoFollow"/>.
+        /// </summary>
+        private readonly INativeLibraryInterface _nativeLibraryInterface;
+
+        /// <summary>
+        /// Determines whether user and group qualifiers must be numeric.
+        /// </summary>
+        private readonly bool _numeric;
+
+        /// <summary>
+        /// UIDs by user name.
+        /// </summary>
+        private readonly NameCache _userIds = new NameCache();
+
+        /// <summary>
+        /// GIDs by group name.
+        /// </summary>
+        private readonly NameCache _groupIds = new NameCache();
+
+        /// <summary>
+        /// Reusable ACL entry arrays, indexed by their length.
+        /// </summary>
+        private readonly AccessControlListEntry[][] _entryArrays = new AccessControlListEntry[64][];
+
+        /// <summary>
+        /// The input stream.
+        /// </summary>
+        private Stream _input;
+
+        /// <summary>
+        /// The input buffer.
+        /// </summary>
+        private byte[] _buffer;
+
+        /// <summary>
+        /// Offset of the first unprocessed byte in <see cref="_buffer"/>.
+        /// </summary>
+        private int _bufferStart;
+
+        /// <summary>
+        /// The number of valid bytes in <see cref="_buffer"/>.
+        /// </summary>
+        private int _bufferEnd;
+
+        /// <summary>
+        /// Determines whether the input stream is exhausted.
+        /// </summary>
+        private bool _endOfInput;
+
+        /// <summary>
+        /// The number of the current line.
+        /// </summary>
+        private long _lineNumber;
+
+        /// <summary>
+        /// The UTF-8 encoded base directory, followed by a slash and the unquoted path of the current file.
+        /// </summary>
+        private byte[] _path = new byte[256];
+
+        /// <summary>
+        /// The length of the base directory in <see cref="_path"/>, including the trailing slash.
+        /// </summary>
+        private int _basePathLength;
+
+        /// <summary>
+        /// The base directory.
+        /// </summary>
+        private string _basePath;
+
+        /// <summary>
+        /// Handle of the base directory, or null if it was not opened yet.
+        /// </summary>
+        private PosixDirectoryHandle _baseDirectoryHandle;
+
+        /// <summary>
+        /// Handle of the parent directory of the last updated file, if it is not the base directory, or null.
+        /// </summary>
+        private PosixDirectoryHandle _directoryHandle;
+
+        /// <summary>
+        /// The UTF-8 encoded path of <see cref="_directoryHandle"/> relative to the base directory.
+        /// </summary>
+        private byte[] _directoryPath = new byte[256];
+
+        /// <summary>
+        /// The length of the path in <see cref="_directoryPath"/>.
+        /// </summary>
+        private int _directoryPathLength;
+
+        /// <summary>
+        /// The length of the current path in <see cref="_path"/>, or 0 if there is no current file.
+        /// </summary>
+        private int _pathLength;
+
+        /// <summary>
+        /// The UID of the owner of the current file, or -1 if it was not specified.
+        /// </summary>
+        private int _ownerId;
+
+        /// <summary>
+        /// The GID of the group of the current file, or -1 if it was not specified.
+        /// </summary>
+        private int _groupId;
+
+        /// <summary>
+        /// The special mode bits of the current file.
+        /// </summary>
+        private uint _specialBits;
+
+        /// <summary>
+        /// The access ACL entries of the current file.
+        /// </summary>
+        private AccessControlListEntry[] _entries = new AccessControlListEntry[16];
+
+        /// <summary>
+        /// The number of valid entries in <see cref="_entries"/>.
+        /// </summary>
+        private int _entryCount;
+
+        /// <summary>
+        /// The default ACL entries of the current file.
+        /// </summary>
+        private AccessControlListEntry[] _defaultEntries = new AccessControlListEntry[16];
+
+        /// <summary>
+        /// The number of valid entries in <see cref="_defaultEntries"/>.
+        /// </summary>
+        private int _defaultEntryCount;
+
+        /// <summary>
+        /// The first error found while parsing the current file, or null.
+        /// </summary>
+        private Exception _fileError;
+
+        /// <summary>
+        /// Creates a new importer.
+        /// </summary>
+        /// <param name="nativeLibraryInterface">Object for native operations. The importer adds <see cref="NativeContextOptions.NoFollow"/> to its options.</param>
+        /// <param name="numeric">Specifies whether user and group qualifiers must be numeric IDs. Otherwise, names are resolved, and qualifiers consisting only of digits are still used as IDs.</param>
+        public AclTextImporter(INativeLibraryInterface nativeLibraryInterface, bool numeric)
+        {
+            if(nativeLibraryInterface == null)
+                throw new ArgumentNullException(nameof(nativeLibraryInterface));
+            _nativeLibraryInterface = nativeLibraryInterface.WithContextOptions(NativeContextOptions.NoFollow);
+            _numeric = numeric;
+        }
+
+        /// <summary>
+        /// Applies the permissions listed in the given input. Instances are not thread-safe.
+        /// </summary>
+        /// <param name="input">The output of "getfacl -R".</param>
+        /// <param name="baseDirectory">The directory the listed paths are relative to. getfacl strips leading slashes, so this is the root directory for dumps of absolute paths.</param>
+        /// <param name="errorHandler">Optional. Called for each file that is malformed in the input or could not be updated, with its listed path. Returns false to cancel the operation. If this is null, the first error is thrown.</param>
+        /// <returns>The number of updated files and directories.</returns>
+        public long Import(Stream input, DirectoryInfo baseDirectory, Func<string, Exception, bool> errorHandler = null)
+            => Import(input, baseDirectory.FullName, errorHandler);
+
+        /// <summary>
+        /// Applies the permissions listed in the given input.
+        /// </summary>
+        /// <param name="input">The output of "getfacl -R".</param>
+        /// <param name="basePath">The directory the listed paths are relative to.</param>
+        /// <param name="errorHandler">Called for each file that is malformed or could not be updated, or null to throw the first error.</param>
+        internal long Import(Stream input, string basePath, Func<string, Exception, bool> errorHandler)
+        {
+            _input = input;
+            _buffer = new byte[BufferLength];
+            _bufferStart = 0;
+            _bufferEnd = 0;
+            _endOfInput = false;
+            _lineNumber = 0;
+            _pathLength = 0;
+            _basePath = basePath;
+            AppendPath(Encoding.UTF8.GetBytes(basePath.TrimEnd('/') + "/"));
+            _basePathLength = _pathLength;
+            ResetFile();
+            try
+            {
+                long count = 0;
+                while(ReadLine(out int lineOffset, out int lineLength))
+                {
+                    var line = Trim(new ReadOnlySpan<byte>(_buffer, lineOffset, lineLength));
+                    bool startsNewFile = StartsWith(line, "# file:");
+                    if((line.Length == 0 || startsNewFile) && _pathLength > 0)
+                    {
+                        if(!ApplyFile(errorHandler, ref count))
+                            return count;
+                    }
+
+                    if(line.Length == 0)
+                        continue;
+                    if(line[0] == (byte)'#')
+                        ParseComment(line);
+                    else if(_pathLength > 0 && _fileError == null)
+                        ParseEntry(line);
+                }
+                if(_pathLength > 0)
+                    ApplyFile(errorHandler, ref count);
+                return count;
+            }
+            finally
+            {
+                _input = null;
+                _buffer = null;
+                _directoryHandle?.Dispose();
+                _directoryHandle = null;
+                _baseDirectoryHandle?.Dispose();
+                _baseDirectoryHandle = null;
+            }
+        }
+
+        /// <summary>
+        /// Clears the state of the current file.
+        /// </summary>
+        private void ResetFile()
+        {
+            _pathLength = 0;
+            _ownerId = -1;
+            _groupId = -1;
+            _specialBits = 0;
+            _entryCount = 0;
+            _defaultEntryCount = 0;
+            _fileError = null;
+        }
+
+        /// <summary>
+        /// Applies the permissions of the current file, or reports its error.
+        /// </summary>
+        /// <param name="errorHandler">The error handler, or null to throw errors.</param>
+        /// <param name="count">The number of updated files, which is incremented on success.</param>
+        /// <returns>False if the operation was canceled by the error handler.</returns>
+        private bool ApplyFile(Func<string, Exception, bool> errorHandler, ref long count)
+        {
+            var error = _fileError;
+            if(error == null)
+            {
+                try
+                {
+                    SetPermissions();
+                    ++count;
+                }
+                catch(Exception ex)
+                {
+                    error = ex;
+                }
+            }
+            var path = error == null ? null : Encoding.UTF8.GetString(_path, _basePathLength, _pathLength - _basePathLength);
+            ResetFile();
+
+            if(error == null)
+                return true;
+            if(errorHandler == null)
+                throw error;
+            return errorHandler(path, error);
+        }
+
+        /// <summary>
+        /// Writes the parsed permissions to the current file.
+        /// </summary>
+        private void SetPermissions()
+        {
+            // Base entries
+            FilePermissions? ownerPermissions = null;
+            FilePermissions? groupPermissions = null;
+            FilePermissions? otherPermissions = null;
+            FilePermissions? mask = null;
+            for(int i = 0; i < _entryCount; ++i)
+            {
+                switch(_entries[i].TagType)
+                {
+                    case AccessControlListEntryTagTypes.UserObj:
+                        ownerPermissions = _entries[i].Permissions;
+                        break;
+                    case AccessControlListEntryTagTypes.GroupObj:
+                        groupPermissions = _entries[i].Permissions;
+                        break;
+                    case AccessControlListEntryTagTypes.Mask:
+                        mask = _entries[i].Permissions;
+                        break;
+                    case AccessControlListEntryTagTypes.Other:
+                        otherPermissions = _entries[i].Permissions;
+                        break;
+                }
+            }
+            if(ownerPermissions == null || groupPermissions == null || otherPermissions == null)
+                throw new FormatException($"The ACL of \"{Encoding.UTF8.GetString(_path, _basePathLength, _pathLength - _basePathLength)}\" misses a user::, group:: or other:: entry.");
+
+            // Locate the file. The path is validated, so its components are separated by single slashes.
+            // The base directory itself is accessed by its path
+            var relativePath = new ReadOnlySpan<byte>(_path, _basePathLength, _pathLength - _basePathLength);
+            PosixDirectoryHandle directory = null;
+            string fileName = _basePath;
+            if(relativePath.Length != 1 || relativePath[0] != (byte)'.')
+            {
+                int separator = relativePath.LastIndexOf((byte)'/');
+                directory = OpenDirectory(Math.Max(separator, 0));
+                fileName = Encoding.UTF8.GetString(relativePath.Slice(separator + 1));
+            }
+
+            // Keep the current owner and group if they are not listed
+            int ownerId = _ownerId;
+            int groupId = _groupId;
+            if(ownerId < 0 || groupId < 0)
+            {
+                _nativeLibraryInterface.GetPermissionData(directory, fileName, 0, out var currentDataContainer);
+                if(ownerId < 0)
+                    ownerId = currentDataContainer.OwnerId;
+                if(groupId < 0)
+                    groupId = currentDataContainer.GroupId;
+            }
+
+            var dataContainer = new NativePermissionDataContainer
+            {
+                OwnerId = ownerId,
+                OwnerPermissions = ownerPermissions.Value
+                                   | ((_specialBits & 0x800) != 0 ? FilePermissions.SetId : FilePermissions.None)
+                                   | ((_specialBits & 0x200) != 0 ? FilePermissions.Sticky : FilePermissions.None),
+                GroupId = groupId,
+                GroupPermissions = (mask ?? groupPermissions.Value)
+                                   | ((_specialBits & 0x400) != 0 ? FilePermissions.SetId : FilePermissions.None),
+                OtherPermissions = otherPermissions.Value
+            };
+            var entries = GetEntryArray(_entries, _entryCount, 0);
+            if(_defaultEntryCount > 0)
+                _nativeLibraryInterface.SetDirectoryPermissionData(directory, fileName, ref dataContainer, entries, GetEntryArray(_defaultEntries, _defaultEntryCount, 1));
+            else
+                _nativeLibraryInterface.SetPermissionData(directory, fileName, 0, ref dataContainer, entries, out var _);
+        }
+
+        /// <summary>
+        /// Returns a handle of the parent directory of the current file, which is opened by walking down from the base directory without following symbolic links.
+        /// The handle of the last parent directory is kept, since dumps list the contents of a directory together.
+        /// </summary>
+        /// <param name="directoryPathLength">The length of the parent directory path at the start of the current path, or 0 for the base directory.</param>
+        private PosixDirectoryHandle OpenDirectory(int directoryPathLength)
+        {
+            _baseDirectoryHandle ??= _nativeLibraryInterface.OpenDirectory(_basePath);
+            if(directoryPathLength == 0)
+                return _baseDirectoryHandle;
+
+            var directoryPath = new ReadOnlySpan<byte>(_path, _basePathLength, directoryPathLength);
+            if(_directoryHandle != null && directoryPath.SequenceEqual(new ReadOnlySpan<byte>(_directoryPath, 0, _directoryPathLength)))
+                return _directoryHandle;
+            _directoryHandle?.Dispose();
+            _directoryHandle = null;
+
+            var directoryHandle = _baseDirectoryHandle;
+            try
+            {
+                var remainingPath = directoryPath;
+                while(remainingPath.Length > 0)
+                {
+                    int separator = remainingPath.IndexOf((byte)'/');
+                    var component = separator < 0 ? remainingPath : remainingPath.Slice(0, separator);
+                    var childHandle = _nativeLibraryInterface.OpenDirectory(directoryHandle, Encoding.UTF8.GetString(component));
+                    if(directoryHandle != _baseDirectoryHandle)
+                        directoryHandle.Dispose();
+                    directoryHandle = childHandle;
+                    remainingPath = separator < 0 ? ReadOnlySpan<byte>.Empty : remainingPath.Slice(separator + 1);
+                }
+            }
+            catch
+            {
+                if(directoryHandle != _baseDirectoryHandle)
+                    directoryHandle.Dispose();
+                throw;
+            }
+            _directoryHandle = directoryHandle;
+            if(_directoryPath.Length < directoryPathLength)
+                Array.Resize(ref _directoryPath, Math.Max(2 * _directoryPath.Length, directoryPathLength));
+            directoryPath.CopyTo(_directoryPath);
+            _directoryPathLength = directoryPathLength;
+            return directoryHandle;
+        }
+
+        /// <summary>
+        /// Copies the given entries into a reusable array of matching length.
+        /// </summary>
+        /// <param name="entries">The entries.</param>
+        /// <param name="count">The number of entries.</param>
+        /// <param name="slot">Selects one of two arrays of the same length, so the access and default ACL can be passed together.</param>
+        private AccessControlListEntry[] GetEntryArray(AccessControlListEntry[] entries, int count, int slot)
+        {
+            int index = 2 * count + slot;
+            AccessControlListEntry[] array;
+            if(index < _entryArrays.Length)
+                array = _entryArrays[index] ??= new AccessControlListEntry[count];
+            else
+                array = new AccessControlListEntry[count];
+            Array.Copy(entries, array, count);
+            return array;
+        }
+
+        /// <summary>
+        /// Parses a comment line, which may contain the path, owner, group or flags of a file.
+        /// </summary>
+        /// <param name="line">The trimmed line.</param>
+        private void ParseComment(ReadOnlySpan<byte> line)
+        {
+            if(StartsWith(line, "# file:"))
+            {
+                _pathLength = _basePathLength;
+                if(!Unquote(Trim(line.Slice(7)), true) || _pathLength == _basePathLength)
+                    SetFileError("Invalid path.");
+                else
+                    ValidatePath();
+            }
+            else if(_pathLength == 0)
+            {
+                // Comments outside of file blocks are ignored
+            }
+            else if(StartsWith(line, "# owner:"))
+                _ownerId = ParseQualifier(Trim(line.Slice(8)), false);
+            else if(StartsWith(line, "# group:"))
+                _groupId = ParseQualifier(Trim(line.Slice(8)), true);
+            else if(StartsWith(line, "# flags:"))
+            {
+                var flags = Trim(line.Slice(8));
+                if(flags.Length != 3)
+                    SetFileError("Invalid flags.");
+                else
+                    _specialBits = (flags[0] == (byte)'s' ? 0x800u : 0) | (flags[1] == (byte)'s' ? 0x400u : 0) | (flags[2] == (byte)'t' ? 0x200u : 0);
+            }
+        }
+
+        /// <summary>
+        /// Parses an ACL entry line.
+        /// </summary>
+        /// <param name="line">The trimmed line.</param>
+        private void ParseEntry(ReadOnlySpan<byte> line)
+        {
+            // Remove trailing comment
+            int commentStart = line.IndexOf((byte)'#');
+            if(commentStart >= 0)
+                line = Trim(line.Slice(0, commentStart));
+
+            bool isDefault = false;
+            if(StartsWith(line, "default:"))
+            {
+                isDefault = true;
+                line = line.Slice(8);
+            }
+            else if(StartsWith(line, "d:"))
+            {
+                isDefault = true;
+                line = line.Slice(2);
+            }
+
+            // Split "tag:qualifier:permissions"
+            int firstColon = line.IndexOf((byte)':');
+            int lastColon = line.LastIndexOf((byte)':');
+            if(firstColon < 0)
+            {
+                SetFileError("Invalid ACL entry.");
+                return;
+            }
+            var tag = line.Slice(0, firstColon);
+            var qualifier = lastColon > firstColon ? line.Slice(firstColon + 1, lastColon - firstColon - 1) : ReadOnlySpan<byte>.Empty;
+            var permissionString = line.Slice(lastColon + 1);
+
+            var entry = new AccessControlListEntry();
+            if(Equals(tag, "user") || Equals(tag, "u"))
+            {
+                entry.TagType = qualifier.Length == 0 ? AccessControlListEntryTagTypes.UserObj : AccessControlListEntryTagTypes.User;
+                entry.TagQualifier = qualifier.Length == 0 ? 0 : ParseQualifier(qualifier, false);
+            }
+            else if(Equals(tag, "group") || Equals(tag, "g"))
+            {
+                entry.TagType = qualifier.Length == 0 ? AccessControlListEntryTagTypes.GroupObj : AccessControlListEntryTagTypes.Group;
+                entry.TagQualifier = qualifier.Length == 0 ? 0 : ParseQualifier(qualifier, true);
+            }
+            else if((Equals(tag, "mask") || Equals(tag, "m")) && qualifier.Length == 0)
+                entry.TagType = AccessControlListEntryTagTypes.Mask;
+            else if((Equals(tag, "other") || Equals(tag, "o")) && qualifier.Length == 0)
+                entry.TagType = AccessControlListEntryTagTypes.Other;
+            else
+            {
+                SetFileError("Invalid ACL entry tag.");
+                return;
+            }
+
+            foreach(byte c in permissionString)
+            {
+                if(c == (byte)'r')
+                    entry.Permissions |= FilePermissions.Read;
+                else if(c == (byte)'w')
+                    entry.Permissions |= FilePermissions.Write;
+                else if(c == (byte)'x')
+                    entry.Permissions |= FilePermissions.Execute;
+                else if(c != (byte)'-')
+                {
+                    SetFileError("Invalid ACL entry permissions.");
+                    return;
+                }
+            }
+
+            if(isDefault)
+                AddEntry(ref _defaultEntries, ref _defaultEntryCount, entry);
+            else
+                AddEntry(ref _entries, ref _entryCount, entry);
+        }
+
+        /// <summary>
+        /// Appends the given entry to the given list.
+        /// </summary>
+        /// <param name="entries">The entry array.</param>
+        /// <param name="count">The number of entries in the array.</param>
+        /// <param name="entry">The entry to add.</param>
+        private static void AddEntry(ref AccessControlListEntry[] entries, ref int count, AccessControlListEntry entry)
+        {
+            if(count == entries.Length)
+                Array.Resize(ref entries, 2 * entries.Length);
+            entries[count++] = entry;
+        }
+
+        /// <summary>
+        /// Parses a user or group given by name or numeric ID. On failure, the error of the current file is set.
+        /// </summary>
+        /// <param name="value">The quoted name or ID.</param>
+        /// <param name="isGroup">Determines whether a group is parsed.</param>
+        private int ParseQualifier(ReadOnlySpan<byte> value, bool isGroup)
+        {
+            if(Utf8Parser.TryParse(value, out uint id, out int bytesConsumed) && bytesConsumed == value.Length)
+                return (int)id;
+            if(_numeric)
+            {
+                SetFileError($"Expected a numeric {(isGroup ? "GID" : "UID")}.");
+                return 0;
+            }
+
+            var names = isGroup ? _groupIds : _userIds;
+            if(!names.TryGetValue(value, out int nameId))
+            {
+                // Names are usually not quoted, so unquoting is only done on cache misses
+                var nameBytes = UnquoteToArray(value);
+                if(Array.IndexOf(nameBytes, (byte)0) >= 0)
+                {
+                    SetUnsafeNameError($"The {(isGroup ? "group" : "user")} name contains a NUL byte.");
+                    return 0;
+                }
+                var name = Encoding.UTF8.GetString(nameBytes);
+                try
+                {
+                    nameId = isGroup ? _nativeLibraryInterface.GetGroupId(name) : _nativeLibraryInterface.GetUserId(name);
+                }
+                catch(KeyNotFoundException)
+                {
+                    nameId = UnknownId;
+                }
+                names.Add(value, nameId);
+            }
+            if(nameId == UnknownId)
+                SetFileError($"Unknown {(isGroup ? "group" : "user")} name.");
+            return nameId;
+        }
+
+        /// <summary>
+        /// Records the given parsing error for the current file, unless it already has one.
+        /// </summary>
+        /// <param name="message">The error message.</param>
+        private void SetFileError(string message)
+        {
+            _fileError ??= new FormatException($"Line {_lineNumber}: {message}");
+        }
+
+        /// <summary>
+        /// Records an error for a path or name of the current file which must not be passed to native code, unless the file already has an error.
+        /// </summary>
+        /// <param name="message">The error message.</param>
+        private void SetUnsafeNameError(string message)
+        {
+            _fileError ??= new InvalidDataException($"Line {_lineNumber}: {message}");
+        }
+
+        /// <summary>
+        /// Appends the given bytes to <see cref="_path"/>.
+        /// </summary>
+        /// <param name="value">The bytes to append.</param>
+        private void AppendPath(ReadOnlySpan<byte> value)
+        {
+            if(_path.Length - _pathLength < value.Length)
+                Array.Resize(ref _path, Math.Max(2 * _path.Length, _pathLength + value.Length));
+            value.CopyTo(_path.AsSpan(_pathLength));
+            _pathLength += value.Length;
+        }
+
+        /// <summary>
+        /// Appends the given byte to <see cref="_path"/>.
+        /// </summary>
+        /// <param name="value">The byte to append.</param>
+        private void AppendPath(byte value)
+        {
+            if(_pathLength == _path.Length)
+                Array.Resize(ref _path, 2 * _path.Length);
+            _path[_pathLength++] = value;
+        }
+
+        /// <summary>
+        /// Decodes the octal escape sequences in the given string and appends the result to <see cref="_path"/>.
+        /// </summary>
+        /// <param name="value">The quoted string.</param>
+        /// <param name="stripLeadingSlashes">Determines whether leading slashes are removed, so the result stays relative.</param>
+        /// <returns>False if the string contains an invalid escape sequence.</returns>
+        private bool Unquote(ReadOnlySpan<byte> value, bool stripLeadingSlashes)
+        {
+            if(stripLeadingSlashes)
+            {
+                while(value.Length > 0 && value[0] == (byte)'/')
+                    value = value.Slice(1);
+            }
+
+            while(value.Length > 0)
+            {
+                int escape = value.IndexOf((byte)'\\');
+                if(escape < 0)
+                {
+                    AppendPath(value);
+                    break;
+                }
+                AppendPath(value.Slice(0, escape));
+                if(escape + 3 >= value.Length || !IsOctalDigit(value[escape + 1]) || !IsOctalDigit(value[escape + 2]) || !IsOctalDigit(value[escape + 3]))
+                    return false;
+                byte b = (byte)(((value[escape + 1] - '0') << 6) | ((value[escape + 2] - '0') << 3) | (value[escape + 3] - '0'));
+                AppendPath(b);
+                value = value.Slice(escape + 4);
+            }
+            return true;
+        }
+
+        /// <summary>
+        /// Checks that the current path stays inside the base directory and reaches native code unchanged. On failure, the error of the current file is set.
+        /// Escape sequences are already decoded at this point, so a NUL byte would truncate the component it is in.
+        /// </summary>
+        private void ValidatePath()
+        {
+            var path = new ReadOnlySpan<byte>(_path, _basePathLength, _pathLength - _basePathLength);
+            if(path.IndexOf((byte)0) >= 0)
+            {
+                SetUnsafeNameError("The path contains a NUL byte.");
+                return;
+            }
+            if(path.Length == 1 && path[0] == (byte)'.')
+                return;
+
+            while(true)
+            {
+                int separator = path.IndexOf((byte)'/');
+                var component = separator < 0 ? path : path.Slice(0, separator);
+                if(component.Length == 0 || (component.Length == 1 && component[0] == (byte)'.'))
+                {
+                    SetUnsafeNameError("The path contains an empty or \".\" component.");
+                    return;
+                }
+                if(component.Length == 2 && component[0] == (byte)'.' && component[1] == (byte)'.')
+                {
+                    SetUnsafeNameError("The path leaves the base directory.");
+                    return;
+                }
+                if(separator < 0)
+                    return;
+                path = path.Slice(separator + 1);
+            }
+        }
+
+        /// <summary>
+        /// Decodes the octal escape sequences in the given string.
+        /// </summary>
+        /// <param name="value">The quoted string.</param>
+        private byte[] UnquoteToArray(ReadOnlySpan<byte> value)
+        {
+            int pathLength = _pathLength;
+            Unquote(value, false);
+            var result = _path.AsSpan(pathLength, _pathLength - pathLength).ToArray();
+            _pathLength = pathLength;
+            return result;
+        }
+
+        /// <summary>
+        /// Returns whether the given byte is an octal digit.
+        /// </summary>
+        /// <param name="b">The byte.</param>
+        private static bool IsOctalDigit(byte b)
+            => b >= (byte)'0' && b <= (byte)'7';
+
+        /// <summary>
+        /// Returns the given span without leading and trailing whitespace.
+        /// </summary>
+        /// <param name="value">The span.</param>
+        private static ReadOnlySpan<byte> Trim(ReadOnlySpan<byte> value)
+        {
+            int start = 0;
+            while(start < value.Length && (value[start] == (byte)' ' || value[start] == (byte)'\t'))
+                ++start;
+            int end = value.Length;
+            while(end > start && (value[end - 1] == (byte)' ' || value[end - 1] == (byte)'\t' || value[end - 1] == (byte)'\r'))
+                --end;
+            return value.Slice(start, end - start);
+        }
+
+        /// <summary>
+        /// Returns whether the given span starts with the given ASCII string.
+        /// </summary>
+        /// <param name="value">The span.</param>
+        /// <param name="prefix">The ASCII string.</param>
+        private static bool StartsWith(ReadOnlySpan<byte> value, string prefix)
+        {
+            if(value.Length < prefix.Length)
+                return false;
+            for(int i = 0; i < prefix.Length; ++i)
+            {
+                if(value[i] != (byte)prefix[i])
+                    return false;
+            }
+            return true;
+        }
+
+        /// <summary>
+        /// Returns whether the given span equals the given ASCII string.
+        /// </summary>
+        /// <param name="value">The span.</param>
+        /// <param name="other">The ASCII string.</param>
+        private static bool Equals(ReadOnlySpan<byte> value, string other)
+            => value.Length == other.Length && StartsWith(value, other);
+
+        /// <summary>
+        /// Returns the next line of the input, without the line break.
+        /// </summary>
+        /// <param name="lineOffset">Receives the offset of the line in <see cref="_buffer"/>.</param>
+        /// <param name="lineLength">Receives the length of the line.</param>
+        /// <returns>False if the end of the input was reached.</returns>
+        private bool ReadLine(out int lineOffset, out int lineLength)
+        {
+            while(true)
+            {
+                int lineBreak = _buffer.AsSpan(_bufferStart, _bufferEnd - _bufferStart).IndexOf((byte)'\n');
+                if(lineBreak >= 0 || (_endOfInput && _bufferStart < _bufferEnd))
+                {
+                    lineOffset = _bufferStart;
+                    lineLength = lineBreak >= 0 ? lineBreak : _bufferEnd - _bufferStart;
+                    _bufferStart += lineLength + 1;
+                    ++_lineNumber;
+                    return true;
+                }
+                if(_endOfInput)
+                {
+                    lineOffset = 0;
+                    lineLength = 0;
+                    return false;
+                }
+
+                // Move the incomplete line to the front and read more data
+                if(_bufferStart > 0)
+                {
+                    Buffer.BlockCopy(_buffer, _bufferStart, _buffer, 0, _bufferEnd - _bufferStart);
+                    _bufferEnd -= _bufferStart;
+                    _bufferStart = 0;
+                }
+                if(_bufferEnd == _buffer.Length)
+                    Array.Resize(ref _buffer, 2 * _buffer.Length);
+                int bytesRead = _input.Read(_buffer, _bufferEnd, _buffer.Length - _bufferEnd);
+                if(bytesRead == 0)
+                    _endOfInput = true;
+                _bufferEnd += bytesRead;
+            }
+        }
+
+        /// <summary>
+        /// Maps UTF-8 encoded names to IDs, without allocating on lookups.
+        /// </summary>
+        private class NameCache
+        {
+            /// <summary>
+            /// The names and IDs, grouped by the hash codes of the names.
+            /// </summary>
+            private readonly Dictionary<int, List<KeyValuePair<byte[], int>>> _entries = new Dictionary<int, List<KeyValuePair<byte[], int>>>();
+
+            /// <summary>
+            /// Looks up the given name.
+            /// </summary>
+            /// <param name="name">The name.</param>
+            /// <param name="id">Receives the ID.</param>
+            public bool TryGetValue(ReadOnlySpan<byte> name, out int id)
+            {
+                if(_entries.TryGetValue(GetHashCode(name), out var candidates))
+                {
+                    foreach(var candidate in candidates)
+                    {
+                        if(name.SequenceEqual(candidate.Key))
+                        {
+                            id = candidate.Value;
+                            return true;
+                        }
+                    }
+                }
+                id = 0;
+                return false;
+            }
+
+            /// <summary>
+            /// Stores the given name.
+            /// </summary>
+            /// <param name="name">The name.</param>
+            /// <param name="id">The ID.</param>
+            public void Add(ReadOnlySpan<byte> name, int id)
+            {
+                int hash = GetHashCode(name);
+                if(!_entries.TryGetValue(hash, out var candidates))
+                    _entries.Add(hash, candidates = new List<KeyValuePair<byte[], int>>(1));
+                candidates.Add(new KeyValuePair<byte[], int>(name.ToArray(), id));
+            }
+
+            /// <summary>
+            /// Computes the FNV-1a hash of the given name.
+            /// </summary>
+            /// <param name="name">The name.</param>
+            private static int GetHashCode(ReadOnlySpan<byte> name)
+            {
+                uint hash = 2166136261;
+                foreach(byte b in name)
+                    hash = (hash ^ b) * 16777619;
+                return (int)hash;
+            }
+        }
+    }
+}
@@ -0,0 +1,501 @@
+﻿using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.Threading;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Wraps another <see cref="IPosixPermissionsProvider"/> and caches the permissions it loads from files and directories, so repeated requests for the same paths do not need to read ACLs again.
+    /// The number of entries is bounded; when the cache is full, entries are evicted with the CLOCK algorithm, which approximates LRU but does not need any locking on cache hits.
+    /// </summary>
+    /// <remarks>
+    /// Each call returns a new <see cref="PosixPermissionInfo"/> object, so modifying it does not affect the cache. All other methods are passed to the wrapped provider.
+    /// Entries keyed by path can be removed with <see cref="Invalidate"/>; a <see cref="PermissionChangeWatcher"/> does this automatically when files change.
+    /// Instances are thread-safe.
+    /// </remarks>
+    public class CachingPosixPermissionsProvider : IPosixPermissionsProvider
+    {
+        /// <summary>
+        /// Cache key kind for directories with both ACLs. Files and single ACLs use the loadDefaultAcl flag passed to the native library.
+        /// </summary>
+        private const int DirectoryWithDefaultAclKind = 2;
+
+        /// <summary>
+        /// The wrapped provider.
+        /// </summary>
+        private readonly IPosixPermissionsProvider _innerProvider;
+
+        /// <summary>
+        /// Object for native operations.
+        /// </summary>
+        private readonly INativeLibraryInterface _nativeLibraryInterface;
+
+        /// <summary>
+        /// Determines how cached entries are validated.
+        /// </summary>
+        private readonly PermissionCacheValidation _validation;
+
+        /// <summary>
+        /// Lifetime of cache entries in <see cref="PermissionCacheValidation.TimeToLive"/> mode, in <see cref="Stopwatch"/> ticks.
+        /// </summary>
+        private readonly long _timeToLive;
+
+        /// <summary>
+        /// The cached entries, for lookups.
+        /// </summary>
+        private readonly ConcurrentDictionary<CacheKey, CacheEntry> _entries = new ConcurrentDictionary<CacheKey, CacheEntry>();
+
+        /// <summary>
+        /// The cached entries in the order of the clock. Slots freed by invalidations are null. Only accessed while holding <see cref="_clockLock"/>.
+        /// </summary>
+        private readonly CacheEntry[] _slots;
+
+        /// <summary>
+        /// Lock for modifying <see cref="_entries"/> and <see cref="_slots"/>.
+        /// </summary>
+        private readonly object _clockLock = new object();
+
+        /// <summary>
+        /// Slots below <see cref="_slotCount"/> which were freed by invalidations.
+        /// </summary>
+        private readonly Stack<int> _freeSlots = new Stack<int>();
+
+        /// <summary>
+        /// Number of used slots.
+        /// </summary>
+        private int _slotCount;
+
+        /// <summary>
+        /// Incremented by every invalidation, so permissions which were read concurrently are not added to the cache afterwards.
+        /// </summary>
+        private long _invalidationVersion;
+
+        /// <summary>
+        /// The slot that is checked next when an entry needs to be evicted.
+        /// </summary>
+        private int _clockHand;
+
+        /// <summary>
+        /// Number of requests answered from the cache.
+        /// </summary>
+        private long _hitCount;
+
+        /// <summary>
+        /// Number of requests that had to read the permissions.
+        /// </summary>
+        private long _missCount;
+
+        /// <summary>
+        /// Number of entries evicted to make room for new ones.
+        /// </summary>
+        private long _evictionCount;
+
+        /// <summary>
+        /// Number of requests answered from the cache.
+        /// </summary>
+        public long HitCount => Interlocked.Read(ref _hitCount);
+
+        /// <summary>
+        /// Number of requests that had to read the permissions, because they were not cached or the cached ones were outdated.
+        /// </summary>
+        public long MissCount => Interlocked.Read(ref _missCount);
+
+        /// <summary>
+        /// Number of entries evicted to make room for new ones. Outdated entries which are replaced by newer permissions of the same file are not counted.
+        /// </summary>
+        public long EvictionCount => Interlocked.Read(ref _evictionCount);
+
+        /// <summary>
+        /// Number of cached entries.
+        /// </summary>
+        public int Count => _entries.Count;
+
+        /// <summary>
+        /// Determines how cached entries are validated.
+        /// </summary>
+        public PermissionCacheValidation Validation => _validation;
+
+        /// <summary>
+        /// Creates a new caching provider.
+        /// </summary>
+        /// <param name="innerProvider">The provider handling all requests that are not cached.</param>
+        /// <param name="nativeLibraryInterface">Object for native operations.</param>
+        /// <param name="options">Cache size and validation policy.</param>
+        public CachingPosixPermissionsProvider(IPosixPermissionsProvider innerProvider, INativeLibraryInterface nativeLibraryInterface, PermissionCacheOptions options)
+        {
+            _innerProvider = innerProvider ?? throw new ArgumentNullException(nameof(innerProvider));
+            _nativeLibraryInterface = nativeLibraryInterface ?? throw new ArgumentNullException(nameof(nativeLibraryInterface));
+            if(options == null)
+                throw new ArgumentNullException(nameof(options));
+            if(options.Capacity <= 0)
+                throw new ArgumentOutOfRangeException(nameof(options), "The cache capacity must be positive.");
+            if(options.TimeToLive < TimeSpan.Zero)
+                throw new ArgumentOutOfRangeException(nameof(options), "The time to live must not be negative.");
+
+            _validation = options.Validation;
+            _timeToLive = (long)(options.TimeToLive.TotalSeconds * Stopwatch.Frequency);
+            _slots = new CacheEntry[options.Capacity];
+        }
+
+        /// <inheritdoc />
+        public PosixPermissionInfo CreateEmptyPosixPermissionInfo(int ownerId, int groupId)
+            => _innerProvider.CreateEmptyPosixPermissionInfo(ownerId, groupId);
+
+        /// <inheritdoc />
+        public PosixPermissionInfo GetPosixPermissionInfo(FileInfo file)
+        {
+            var entry = GetEntry(file.FullName, 0);
+            return new PosixPermissionInfo(_nativeLibraryInterface, entry.DataContainer, entry.Acl);
+        }
+
+        /// <inheritdoc />
+        public PosixPermissionInfo GetPosixPermissionInfo(DirectoryInfo directory, bool loadDefaultAcl)
+        {
+            // Same ACL selection as PosixPermissionInfo(INativeLibraryInterface, DirectoryInfo, bool)
+            var entry = GetEntry(directory.FullName, loadDefaultAcl ? 0 : 1);
+            return new PosixPermissionInfo(_nativeLibraryInterface, entry.DataContainer, entry.Acl);
+        }
+
+        /// <inheritdoc />
+        public PosixDirectoryPermissionInfo GetPosixDirectoryPermissionInfo(DirectoryInfo directory)
+        {
+            var entry = GetEntry(directory.FullName, DirectoryWithDefaultAclKind);
+            return new PosixDirectoryPermissionInfo(_nativeLibraryInterface, entry.DataContainer, entry.Acl, entry.DefaultAcl);
+        }
+
+        /// <inheritdoc />
+        public DefaultAclInheritanceCalculator CreateDefaultAclInheritanceCalculator(int ownerId, int groupId)
+            => _innerProvider.CreateDefaultAclInheritanceCalculator(ownerId, groupId);
+
+        /// <inheritdoc />
+        public AccessChecker CreateAccessChecker(TimeSpan cacheLifetime)
+            => _innerProvider.CreateAccessChecker(cacheLifetime);
+
+        /// <inheritdoc />
+        public PermissionSnapshotRestorer CreatePermissionSnapshotRestorer()
+            => _innerProvider.CreatePermissionSnapshotRestorer();
+
+        /// <inheritdoc />
+        public AclTextExporter CreateAclTextExporter(bool numeric)
+            => _innerProvider.CreateAclTextExporter(numeric);
+
+        /// <inheritdoc />
+        public AclTextImporter CreateAclTextImporter(bool numeric)
+            => _innerProvider.CreateAclTextImporter(numeric);
+
+        /// <summary>
+        /// Removes all cached entries. The counters are not reset.
+        /// </summary>
+        public void Clear()
+        {
+            lock(_clockLock)
+            {
+                _entries.Clear();
+                Array.Clear(_slots, 0, _slotCount);
+                _freeSlots.Clear();
+                _slotCount = 0;
+                _clockHand = 0;
+                ++_invalidationVersion;
+            }
+        }
+
+        /// <summary>
+        /// Removes the cached permissions of the given file or directory. Only supported for caches keyed by path.
+        /// </summary>
+        /// <param name="fullPath">Full path to the file or directory.</param>
+        public void Invalidate(string fullPath)
+        {
+            if(_validation == PermissionCacheValidation.ChangeTime)
+                throw new InvalidOperationException("Caches validated by change time are keyed by inode and cannot be invalidated by path.");
+            fullPath = NormalizePath(fullPath);
+
+            lock(_clockLock)
+            {
+                for(int kind = 0; kind <= DirectoryWithDefaultAclKind; ++kind)
+                {
+                    if(_entries.TryRemove(new CacheKey(0, 0, fullPath, kind), out var entry))
+                        FreeSlot(entry.Slot);
+                }
+                ++_invalidationVersion;
+            }
+        }
+
+        /// <summary>
+        /// Removes the cached permissions of the given directory and of all files and directories below it. Only supported for caches keyed by path.
+        /// This iterates over all cached entries, so it should only be used for rare events like moved directories.
+        /// </summary>
+        /// <param name="fullPath">Full path to the directory.</param>
+        public void InvalidateTree(string fullPath)
+        {
+            if(_validation == PermissionCacheValidation.ChangeTime)
+                throw new InvalidOperationException("Caches validated by change time are keyed by inode and cannot be invalidated by path.");
+            fullPath = NormalizePath(fullPath);
+            if(fullPath == "/")
+            {
+                Clear();
+                return;
+            }
+
+            lock(_clockLock)
+            {
+                for(int slot = 0; slot < _slotCount; ++slot)
+                {
+                    var entry = _slots[slot];
+                    if(entry == null)
+                        continue;
+                    var path = entry.Key.Path;
+                    if(path.StartsWith(fullPath, StringComparison.Ordinal) && (path.Length == fullPath.Length || path[fullPath.Length] == '/'))
+                    {
+                        _entries.TryRemove(entry.Key, out _);
+                        FreeSlot(slot);
+                    }
+                }
+                ++_invalidationVersion;
+            }
+        }
+
+        /// <summary>
+        /// Clears the given slot and makes it available for new entries. Must be called while holding <see cref="_clockLock"/>.
+        /// </summary>
+        /// <param name="slot">The slot to free.</param>
+        private void FreeSlot(int slot)
+        {
+            _slots[slot] = null;
+            _freeSlots.Push(slot);
+        }
+
+        /// <summary>
+        /// Removes a trailing slash from the given path, as returned by <see cref="DirectoryInfo.FullName"/> for some directories.
+        /// </summary>
+        /// <param name="fullPath">Full path to a file or directory.</param>
+        private static string NormalizePath(string fullPath)
+            => fullPath.Length > 1 && fullPath[fullPath.Length - 1] == '/' ? fullPath.TrimEnd('/') : fullPath;
+
+        /// <summary>
+        /// Returns the up to date cache entry for the given path, and reads it if necessary.
+        /// </summary>
+        /// <param name="fullPath">Full path to the file or directory.</param>
+        /// <param name="kind">The loadDefaultAcl flag, or <see cref="DirectoryWithDefaultAclKind"/>.</param>
+        private CacheEntry GetEntry(string fullPath, int kind)
+        {
+            // Look up cached entry
+            long now = 0;
+            NativeFileIdentity identity = default;
+            CacheKey key;
+            if(_validation == PermissionCacheValidation.ChangeTime)
+            {
+                identity = _nativeLibraryInterface.GetFileIdentity(null, fullPath);
+                key = new CacheKey(identity.Device, identity.Inode, null, kind);
+            }
+            else
+            {
+                now = Stopwatch.GetTimestamp();
+                key = new CacheKey(0, 0, NormalizePath(fullPath), kind);
+            }
+            if(_entries.TryGetValue(key, out var entry) && IsValid(entry, identity, now))
+            {
+                // Give the entry another round on the clock
+                entry.Referenced = true;
+                Interlocked.Increment(ref _hitCount);
+                return entry;
+            }
+            Interlocked.Increment(ref _missCount);
+            long invalidationVersion = Interlocked.Read(ref _invalidationVersion);
+
+            // Read permissions. In change time mode the identity was queried before, so a concurrent change leaves an entry with an older change time, which is replaced on the next access
+            entry = new CacheEntry(key, identity, now + _timeToLive);
+            if(kind == DirectoryWithDefaultAclKind)
+                entry.Acl = _nativeLibraryInterface.GetDirectoryPermissionData(null, fullPath, out entry.DataContainer, out entry.DefaultAcl);
+            else
+                entry.Acl = _nativeLibraryInterface.GetPermissionData(null, fullPath, kind, out entry.DataContainer);
+
+            // File systems without inode numbers do not allow caching by identity
+            if(_validation != PermissionCacheValidation.ChangeTime || identity.Inode != 0)
+                Insert(entry, invalidationVersion);
+            return entry;
+        }
+
+        /// <summary>
+        /// Checks whether the given cache entry is still up to date.
+        /// </summary>
+        /// <param name="entry">The cache entry.</param>
+        /// <param name="identity">The current identity of the file, in <see cref="PermissionCacheValidation.ChangeTime"/> mode.</param>
+        /// <param name="now">The current <see cref="Stopwatch"/> timestamp, in <see cref="PermissionCacheValidation.TimeToLive"/> mode.</param>
+        private bool IsValid(CacheEntry entry, in NativeFileIdentity identity, long now)
+        {
+            if(_validation == PermissionCacheValidation.ChangeTime)
+                return entry.ChangeTimeSeconds == identity.ChangeTimeSeconds && entry.ChangeTimeNanoseconds == identity.ChangeTimeNanoseconds;
+            if(_validation == PermissionCacheValidation.TimeToLive)
+                return now < entry.ExpirationTime;
+            return true;
+        }
+
+        /// <summary>
+        /// Adds the given entry to the cache, replacing an outdated entry with the same key or evicting another one if the cache is full.
+        /// </summary>
+        /// <param name="entry">The new entry.</param>
+        /// <param name="invalidationVersion">The value of <see cref="_invalidationVersion"/> before the permissions were read. If there was an invalidation since, the entry is not added.</param>
+        private void Insert(CacheEntry entry, long invalidationVersion)
+        {
+            lock(_clockLock)
+            {
+                if(invalidationVersion != _invalidationVersion)
+                    return;
+
+                int slot;
+                if(_entries.TryGetValue(entry.Key, out var existingEntry))
+                {
+                    // Replace outdated entry in place
+                    slot = existingEntry.Slot;
+                }
+                else if(_freeSlots.Count > 0)
+                {
+                    slot = _freeSlots.Pop();
+                }
+                else if(_slotCount < _slots.Length)
+                {
+                    slot = _slotCount++;
+                }
+                else
+                {
+                    // Advance the clock hand until an entry is found that was not used since the hand last passed it
+                    while(_slots[_clockHand].Referenced)
+                    {
+                        _slots[_clockHand].Referenced = false;
+                        _clockHand = (_clockHand + 1) % _slots.Length;
+                    }
+                    slot = _clockHand;
+                    _clockHand = (_clockHand + 1) % _slots.Length;
+
+                    _entries.TryRemove(_slots[slot].Key, out _);
+                    Interlocked.Increment(ref _evictionCount);
+                }
+
+                entry.Slot = slot;
+                _slots[slot] = entry;
+                _entries[entry.Key] = entry;
+            }
+        }
+
+        /// <summary>
+        /// Identifies a cache entry.
+        /// </summary>
+        internal readonly struct CacheKey : IEquatable<CacheKey>
+        {
+            /// <summary>
+            /// The device containing the file, in <see cref="PermissionCacheValidation.ChangeTime"/> mode.
+            /// </summary>
+            public readonly ulong Device;
+
+            /// <summary>
+            /// The inode number of the file, in <see cref="PermissionCacheValidation.ChangeTime"/> mode.
+            /// </summary>
+            public readonly ulong Inode;
+
+            /// <summary>
+            /// The full path of the file without trailing slash, in <see cref="PermissionCacheValidation.TimeToLive"/> and <see cref="PermissionCacheValidation.Invalidation"/> mode.
+            /// </summary>
+            public readonly string Path;
+
+            /// <summary>
+            /// The loadDefaultAcl flag, or <see cref="DirectoryWithDefaultAclKind"/>.
+            /// </summary>
+            public readonly int Kind;
+
+            /// <summary>
+            /// Creates a new cache key.
+            /// </summary>
+            /// <param name="device">The device containing the file.</param>
+            /// <param name="inode">The inode number of the file.</param>
+            /// <param name="path">The full path of the file.</param>
+            /// <param name="kind">The loadDefaultAcl flag, or <see cref="DirectoryWithDefaultAclKind"/>.</param>
+            public CacheKey(ulong device, ulong inode, string path, int kind)
+            {
+                Device = device;
+                Inode = inode;
+                Path = path;
+                Kind = kind;
+            }
+
+            /// <inheritdoc />
+            public bool Equals(CacheKey other)
+                => Device == other.Device && Inode == other.Inode && Kind == other.Kind && string.Equals(Path, other.Path, StringComparison.Ordinal);
+
+            /// <inheritdoc />
+            public override bool Equals(object obj)
+                => obj is CacheKey other && Equals(other);
+
+            /// <inheritdoc />
+            public override int GetHashCode()
+                => HashCode.Combine(Device, Inode, Path == null ? 0 : StringComparer.Ordinal.GetHashCode(Path), Kind);
+        }
+
+        /// <summary>
+        /// Cached permissions of a file or directory. Only <see cref="Referenced"/> and <see cref="Slot"/> are modified after the entry was added to the cache.
+        /// </summary>
+        internal sealed class CacheEntry
+        {
+            /// <summary>
+            /// The key of this entry.
+            /// </summary>
+            public readonly CacheKey Key;
+
+            /// <summary>
+            /// Seconds part of the change time the file had before its permissions were read.
+            /// </summary>
+            public readonly long ChangeTimeSeconds;
+
+            /// <summary>
+            /// Nanoseconds part of the change time the file had before its permissions were read.
+            /// </summary>
+            public readonly uint ChangeTimeNanoseconds;
+
+            /// <summary>
+            /// The <see cref="Stopwatch"/> timestamp when this entry expires in <see cref="PermissionCacheValidation.TimeToLive"/> mode.
+            /// </summary>
+            public readonly long ExpirationTime;
+
+            /// <summary>
+            /// Owner, group and permission bits.
+            /// </summary>
+            public NativePermissionDataContainer DataContainer;
+
+            /// <summary>
+            /// The access ACL, or the default ACL if this entry was created with loadDefaultAcl set.
+            /// </summary>
+            public AccessControlListEntry[] Acl;
+
+            /// <summary>
+            /// The default ACL, for entries of kind <see cref="DirectoryWithDefaultAclKind"/>.
+            /// </summary>
+            public AccessControlListEntry[] DefaultAcl;
+
+            /// <summary>
+            /// Set when the entry is used, and cleared when the clock hand passes it.
+            /// </summary>
+            public volatile bool Referenced;
+
+            /// <summary>
+            /// The index of this entry in <see cref="_slots"/>.
+            /// </summary>
+            public int Slot;
+
+            /// <summary>
+            /// Creates a new cache entry.
+            /// </summary>
+            /// <param name="key">The key of this entry.</param>
+            /// <param name="identity">The identity of the file before its permissions were read.</param>
+            /// <param name="expirationTime">The <see cref="Stopwatch"/> timestamp when this entry expires.</param>
+            public CacheEntry(CacheKey key, in NativeFileIdentity identity, long expirationTime)
+            {
+                Key = key;
+                ChangeTimeSeconds = identity.ChangeTimeSeconds;
+                ChangeTimeNanoseconds = identity.ChangeTimeNanoseconds;
+                ExpirationTime = expirationTime;
+            }
+        }
+    }
+}
@@ -0,0 +1,36 @@
+﻿using System;
+using System.Runtime.InteropServices;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Wraps permission data and an ACL, which were validated and converted into their native representation once, so they can be assigned to many files without rebuilding them.
+    /// Instances are created by <see cref="INativeLibraryInterface.CompilePermissionData"/> or <see cref="PosixPermissionInfo.Compile"/>.
+    /// </summary>
+    public sealed class CompiledPermissionsHandle : SafeHandle
+    {
+        /// <summary>
+        /// Creates an invalid handle. Used by the P/Invoke marshaller.
+        /// </summary>
+        public CompiledPermissionsHandle()
+            : base(IntPtr.Zero, true)
+        { }
+
+        /// <inheritdoc />
+        public override bool IsInvalid => handle == IntPtr.Zero;
+
+        /// <summary>
+        /// Releases the given compiled permissions.
+        /// </summary>
+        /// <param name="compiledPermissions">The compiled permissions to release.</param>
+        [DllImport(NativeLibraryInterface.NativeLibraryPath, EntryPoint = "FreeCompiledPermissions")]
+        private static extern void FreeCompiledPermissions(IntPtr compiledPermissions);
+
+        /// <inheritdoc />
+        protected override bool ReleaseHandle()
+        {
+            FreeCompiledPermissions(handle);
+            return true;
+        }
+    }
+}
@@ -0,0 +1,259 @@
+﻿using System;
+using System.Collections.Concurrent;
+using System.IO;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Predicts the permissions of new files and directories from the default ACL of their parent directory, following the rules the kernel applies on creation.
+    /// The default ACL of each directory is read once and cached together with the computed results, so further predictions for the same directory do not need any system calls.
+    /// Cached data is not refreshed automatically; use <see cref="Invalidate(DirectoryInfo)"/> when a directory's permissions change.
+    /// </summary>
+    /// <remarks>
+    /// Modes are passed like to open(2) and mkdir(2), so octal values are expected, e.g. <c>Convert.ToInt32("644", 8)</c>.
+    /// The prediction assumes that the creating process is a member of the new object's group or privileged, so the kernel does not clear the SGID bit of new files.
+    /// </remarks>
+    public class DefaultAclInheritanceCalculator
+    {
+        /// <summary>
+        /// Set user ID bit (04000).
+        /// </summary>
+        private const int SetUserIdBit = 0x800;
+
+        /// <summary>
+        /// Set group ID bit (02000).
+        /// </summary>
+        private const int SetGroupIdBit = 0x400;
+
+        /// <summary>
+        /// Sticky bit (01000).
+        /// </summary>
+        private const int StickyBit = 0x200;
+
+        /// <summary>
+        /// Read, write and execute bits for owner, group and others (0777).
+        /// </summary>
+        private const int PermissionBits = 0x1FF;
+
+        /// <summary>
+        /// Object for native operations.
+        /// </summary>
+        private readonly INativeLibraryInterface _nativeLibraryInterface;
+
+        /// <summary>
+        /// The UID of the process creating the new objects.
+        /// </summary>
+        private readonly int _ownerId;
+
+        /// <summary>
+        /// The GID of the process creating the new objects.
+        /// </summary>
+        private readonly int _groupId;
+
+        /// <summary>
+        /// Cached default ACLs and results, indexed by the full path of the parent directory without trailing separator.
+        /// </summary>
+        private readonly ConcurrentDictionary<string, DirectoryCacheEntry> _directories = new ConcurrentDictionary<string, DirectoryCacheEntry>(StringComparer.Ordinal);
+
+        /// <summary>
+        /// Creates a new calculator for objects created by the given user and group.
+        /// </summary>
+        /// <param name="nativeLibraryInterface">Object for native operations.</param>
+        /// <param name="ownerId">The UID of the process creating the new objects. This becomes the owner of the new objects.</param>
+        /// <param name="groupId">The GID of the process creating the new objects. This becomes the group of the new objects, unless the parent directory has the SGID bit set.</param>
+        public DefaultAclInheritanceCalculator(INativeLibraryInterface nativeLibraryInterface, int ownerId, int groupId)
+        {
+            _nativeLibraryInterface = nativeLibraryInterface ?? throw new ArgumentNullException(nameof(nativeLibraryInterface));
+            _ownerId = ownerId;
+            _groupId = groupId;
+        }
+
+        /// <summary>
+        /// Returns the permissions a new file or directory in the given directory receives.
+        /// </summary>
+        /// <param name="directory">The parent directory of the new object.</param>
+        /// <param name="mode">The mode passed to open(2) or mkdir(2).</param>
+        /// <param name="umask">The umask of the creating process. This is ignored if the directory has a default ACL.</param>
+        /// <param name="isDirectory">Specifies whether the new object is a directory.</param>
+        public InheritedPermissions GetInheritedPermissions(DirectoryInfo directory, int mode, int umask, bool isDirectory)
+            => GetInheritedPermissions(directory.FullName, mode, umask, isDirectory);
+
+        /// <summary>
+        /// Returns the permissions a new file or directory in the given directory receives.
+        /// </summary>
+        /// <param name="fullPath">Full path to the parent directory of the new object.</param>
+        /// <param name="mode">The mode passed to open(2) or mkdir(2).</param>
+        /// <param name="umask">The umask of the creating process. This is ignored if the directory has a default ACL.</param>
+        /// <param name="isDirectory">Specifies whether the new object is a directory.</param>
+        internal InheritedPermissions GetInheritedPermissions(string fullPath, int mode, int umask, bool isDirectory)
+        {
+            // Read default ACL of the directory, if it is not cached yet
+            var cacheEntry = _directories.GetOrAdd(NormalizePath(fullPath), path =>
+            {
+                var defaultAcl = _nativeLibraryInterface.GetPermissionData(path, 1, out var dataContainer);
+                return new DirectoryCacheEntry(dataContainer, defaultAcl);
+            });
+
+            // Unused bits are dropped, so equivalent requests share their result
+            mode &= 0xFFF;
+            umask &= PermissionBits;
+            int resultKey = mode | (umask << 12) | (isDirectory ? 1 << 21 : 0);
+            return cacheEntry.Results.GetOrAdd(resultKey, _ => Compute(cacheEntry.DataContainer, cacheEntry.DefaultAcl, mode, umask, isDirectory, _ownerId, _groupId));
+        }
+
+        /// <summary>
+        /// Removes the cached data of the given directory, so it is read again on the next request.
+        /// </summary>
+        /// <param name="directory">The directory.</param>
+        public void Invalidate(DirectoryInfo directory)
+            => _directories.TryRemove(NormalizePath(directory.FullName), out _);
+
+        /// <summary>
+        /// Removes a trailing separator from the given directory path, so both spellings share their cache entry.
+        /// </summary>
+        /// <param name="fullPath">Full path to a directory.</param>
+        private static string NormalizePath(string fullPath)
+            => fullPath.Length > 1 && fullPath[fullPath.Length - 1] == '/' ? fullPath.TrimEnd('/') : fullPath;
+
+        /// <summary>
+        /// Removes the cached data of all directories.
+        /// </summary>
+        public void Clear()
+            => _directories.Clear();
+
+        /// <summary>
+        /// Computes the permissions a new file or directory receives, without accessing the file system.
+        /// </summary>
+        /// <param name="parentDataContainer">The permission data of the parent directory.</param>
+        /// <param name="parentDefaultAcl">The default ACL of the parent directory, as returned by <see cref="INativeLibraryInterface.GetPermissionData(string, int, out NativePermissionDataContainer)"/> with <c>loadDefaultAcl</c> set. Empty if the directory has no default ACL.</param>
+        /// <param name="mode">The mode passed to open(2) or mkdir(2).</param>
+        /// <param name="umask">The umask of the creating process. This is ignored if the directory has a default ACL.</param>
+        /// <param name="isDirectory">Specifies whether the new object is a directory.</param>
+        /// <param name="ownerId">The UID of the creating process.</param>
+        /// <param name="groupId">The GID of the creating process.</param>
+        public static InheritedPermissions Compute(in NativePermissionDataContainer parentDataContainer, ReadOnlySpan<AccessControlListEntry> parentDefaultAcl, int mode, int umask, bool isDirectory, int ownerId, int groupId)
+        {
+            // mkdir(2) ignores the SUID and SGID bits of the requested mode
+            mode &= isDirectory ? (StickyBit | PermissionBits) : 0xFFF;
+
+            // If the parent directory has the SGID bit set, new objects belong to its group, and new directories inherit the bit
+            if((parentDataContainer.GroupPermissions & FilePermissions.SetId) != 0)
+            {
+                groupId = parentDataContainer.GroupId;
+                if(isDirectory)
+                    mode |= SetGroupIdBit;
+            }
+
+            // Without a default ACL, only the umask is applied
+            if(parentDefaultAcl.Length == 0)
+            {
+                mode &= ~(umask & PermissionBits);
+                var minimalDataContainer = CreateDataContainer(mode, ownerId, groupId, 3);
+                AccessControlListEntry[] minimalAcl =
+                {
+                    new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.UserObj, TagQualifier = 0, Permissions = (FilePermissions)((mode >> 6) & 7) },
+                    new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.GroupObj, TagQualifier = 0, Permissions = (FilePermissions)((mode >> 3) & 7) },
+                    new AccessControlListEntry { TagType = AccessControlListEntryTagTypes.Other, TagQualifier = 0, Permissions = (FilePermissions)(mode & 7) }
+                };
+                return new InheritedPermissions(minimalDataContainer, minimalAcl, Array.Empty<AccessControlListEntry>());
+            }
+
+            // The default ACL becomes the access ACL, restricted by the requested mode. The permission bits are restricted in turn, so both stay equivalent.
+            // The mask takes the role of the owning group entry, if it exists.
+            // If the default ACL only has the three base entries, the result matches the minimal ACL of the new permission bits.
+            var accessAcl = parentDefaultAcl.ToArray();
+            int groupEntryIndex = -1;
+            for(int i = 0; i < accessAcl.Length; ++i)
+            {
+                ref var entry = ref accessAcl[i];
+                switch(entry.TagType)
+                {
+                    case AccessControlListEntryTagTypes.UserObj:
+                        entry.Permissions &= (FilePermissions)((mode >> 6) & 7);
+                        mode &= ((int)entry.Permissions << 6) | ~0x1C0;
+                        break;
+
+                    case AccessControlListEntryTagTypes.GroupObj:
+                        if(groupEntryIndex < 0)
+                            groupEntryIndex = i;
+                        break;
+
+                    case AccessControlListEntryTagTypes.Mask:
+                        groupEntryIndex = i;
+                        break;
+
+                    case AccessControlListEntryTagTypes.Other:
+                        entry.Permissions &= (FilePermissions)(mode & 7);
+                        mode &= (int)entry.Permissions | ~0x7;
+                        break;
+                }
+            }
+            if(groupEntryIndex >= 0)
+            {
+                ref var groupEntry = ref accessAcl[groupEntryIndex];
+                groupEntry.Permissions &= (FilePermissions)((mode >> 3) & 7);
+                mode &= ((int)groupEntry.Permissions << 3) | ~0x38;
+            }
+
+            // New directories also inherit the default ACL itself
+            var defaultAcl = isDirectory ? parentDefaultAcl.ToArray() : Array.Empty<AccessControlListEntry>();
+
+            return new InheritedPermissions(CreateDataContainer(mode, ownerId, groupId, accessAcl.Length), accessAcl, defaultAcl);
+        }
+
+        /// <summary>
+        /// Creates a data container holding the given mode.
+        /// </summary>
+        /// <param name="mode">The permission bits, including the SUID, SGID and sticky bits.</param>
+        /// <param name="ownerId">The UID of the owner.</param>
+        /// <param name="groupId">The GID of the group.</param>
+        /// <param name="aclSize">The size of the access ACL.</param>
+        private static NativePermissionDataContainer CreateDataContainer(int mode, int ownerId, int groupId, int aclSize)
+        {
+            return new NativePermissionDataContainer
+            {
+                OwnerId = ownerId,
+                OwnerPermissions = (FilePermissions)((mode >> 6) & 7)
+                                   | ((mode & SetUserIdBit) != 0 ? FilePermissions.SetId : FilePermissions.None)
+                                   | ((mode & StickyBit) != 0 ? FilePermissions.Sticky : FilePermissions.None),
+                GroupId = groupId,
+                GroupPermissions = (FilePermissions)((mode >> 3) & 7)
+                                   | ((mode & SetGroupIdBit) != 0 ? FilePermissions.SetId : FilePermissions.None),
+                OtherPermissions = (FilePermissions)(mode & 7),
+                AclSize = aclSize
+            };
+        }
+
+        /// <summary>
+        /// Cached default ACL and computed results of one directory.
+        /// </summary>
+        private class DirectoryCacheEntry
+        {
+            /// <summary>
+            /// The permission data of the directory.
+            /// </summary>
+            public NativePermissionDataContainer DataContainer { get; }
+
+            /// <summary>
+            /// The default ACL of the directory.
+            /// </summary>
+            public AccessControlListEntry[] DefaultAcl { get; }
+
+            /// <summary>
+            /// Computed results, indexed by mode, umask and object type.
+            /// </summary>
+            public ConcurrentDictionary<int, InheritedPermissions> Results { get; } = new ConcurrentDictionary<int, InheritedPermissions>();
+
+            /// <summary>
+            /// Creates a new cache entry.
+            /// </summary>
+            /// <param name="dataContainer">The permission data of the directory.</param>
+            /// <param name="defaultAcl">The default ACL of the directory.</param>
+            public DirectoryCacheEntry(NativePermissionDataContainer dataContainer, AccessControlListEntry[] defaultAcl)
+            {
+                DataContainer = dataContainer;
+                DefaultAcl = defaultAcl;
+            }
+        }
+    }
+}
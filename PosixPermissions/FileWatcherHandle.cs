@@ -0,0 +1,36 @@
+﻿using System;
+using System.Runtime.InteropServices;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Wraps a native inotify or fanotify file watcher.
+    /// Instances are created by <see cref="INativeLibraryInterface.CreateFileWatcher"/>.
+    /// </summary>
+    public sealed class FileWatcherHandle : SafeHandle
+    {
+        /// <summary>
+        /// Creates an invalid handle. Used by the P/Invoke marshaller.
+        /// </summary>
+        public FileWatcherHandle()
+            : base(IntPtr.Zero, true)
+        { }
+
+        /// <inheritdoc />
+        public override bool IsInvalid => handle == IntPtr.Zero;
+
+        /// <summary>
+        /// Releases the given watcher and removes its watches.
+        /// </summary>
+        /// <param name="watcher">The watcher to release.</param>
+        [DllImport(NativeLibraryInterface.NativeLibraryPath, EntryPoint = "FreeFileWatcher")]
+        private static extern void FreeFileWatcher(IntPtr watcher);
+
+        /// <inheritdoc />
+        protected override bool ReleaseHandle()
+        {
+            FreeFileWatcher(handle);
+            return true;
+        }
+    }
+}
@@ -1,4 +1,7 @@
-﻿namespace PosixPermissions
+﻿using System;
+using System.Collections.Generic;
+
+namespace PosixPermissions
 {
     /// <summary>
     /// Interface for communication with the underlying native library.
@@ -13,6 +16,14 @@
         /// <param name="dataContainer">Pointer to container object to store retrieved permissions and assoiated meta data.</param>
         AccessControlListEntry[] GetPermissionData(string fileName, int loadDefaultAcl, out NativePermissionDataContainer dataContainer);
 
+        /// <summary>
+        /// Queries the permission data and ACLs of several files or directories with a single native call. Failing items do not abort the batch; check their status in the returned object.
+        /// </summary>
+        /// <param name="directory">The directory the names are relative to, or null to resolve them against the working directory.</param>
+        /// <param name="fileNames">The files or directories to query.</param>
+        /// <param name="loadDefaultAcl">Specifies whether to load the directories' default ACLs (1) or not (0). This must be 0 for files.</param>
+        PermissionDataBatch GetPermissionDataBatch(PosixDirectoryHandle directory, IReadOnlyList<string> fileNames, int loadDefaultAcl);
+
         /// <summary>
         /// Sets the permission data and ACL of the given file or directory.
         /// </summary>
@@ -21,5 +32,198 @@
         /// <param name="dataContainer">Pointer to container object with permissions and meta data.</param>
         /// <param name="entries">Entries of the object' new access control list.</param>
         void SetPermissionData(string fileName, int setDefaultAcl, ref NativePermissionDataContainer dataContainer, AccessControlListEntry[] entries);
+
+        /// <summary>
+        /// Builds and validates the given permission data and ACL once, so it can be assigned to many files using <see cref="ApplyCompiledPermissionsBatch"/>.
+        /// </summary>
+        /// <param name="setDefaultAcl">Specifies whether the ACL is assigned as a directory's default ACL (1) or not (0). Owner, group and UNIX permissions are not applied to default ACLs.</param>
+        /// <param name="dataContainer">Pointer to container object with permissions and meta data.</param>
+        /// <param name="entries">Entries of the new access control list.</param>
+        CompiledPermissionsHandle CompilePermissionData(int setDefaultAcl, ref NativePermissionDataContainer dataContainer, AccessControlListEntry[] entries);
+
+        /// <summary>
+        /// Assigns compiled permissions to several files or directories with a single native call. Failing items do not abort the batch; check their status in the returned array.
+        /// </summary>
+        /// <param name="compiledPermissions">The permissions to assign, as returned by <see cref="CompilePermissionData"/>.</param>
+        /// <param name="directory">The directory the names are relative to, or null to resolve them against the working directory.</param>
+        /// <param name="fileNames">The files or directories to update.</param>
+        NativeBatchStatus[] ApplyCompiledPermissionsBatch(CompiledPermissionsHandle compiledPermissions, PosixDirectoryHandle directory, IReadOnlyList<string> fileNames);
+
+        /// <summary>
+        /// Opens the given directory, so the files contained in it can be accessed by their relative names.
+        /// </summary>
+        /// <param name="directoryName">The directory to open.</param>
+        PosixDirectoryHandle OpenDirectory(string directoryName);
+
+        /// <summary>
+        /// Opens a subdirectory of an already open directory.
+        /// </summary>
+        /// <param name="parentDirectory">The parent directory.</param>
+        /// <param name="directoryName">The directory to open, relative to <paramref name="parentDirectory"/>.</param>
+        PosixDirectoryHandle OpenDirectory(PosixDirectoryHandle parentDirectory, string directoryName);
+
+        /// <summary>
+        /// Recursively scans the given directory and returns the permission data of all contained files and directories, including the root directory itself.
+        /// Each directory is returned before its contents. Symbolic links are returned, but not followed.
+        /// The records are read in chunks; the native scan state is released when the enumeration is finished or disposed.
+        /// </summary>
+        /// <param name="rootPath">The directory to scan.</param>
+        IEnumerable<PermissionScanRecord> ScanTree(string rootPath);
+
+        /// <summary>
+        /// Recursively assigns compiled permissions to the given directory and all files and directories below it, using a pool of native worker threads. Each directory is updated before its contents.
+        /// Symbolic links below the root directory are neither followed nor modified.
+        /// </summary>
+        /// <param name="rootPath">The directory to update.</param>
+        /// <param name="filePermissions">The permissions to assign to files other than directories, or null to leave them unchanged.</param>
+        /// <param name="directoryPermissions">The permissions to assign to directories, or null to leave their access ACLs unchanged.</param>
+        /// <param name="directoryDefaultPermissions">The default ACL to assign to directories, compiled as default ACL, or null to leave their default ACLs unchanged.</param>
+        /// <param name="threadCount">Number of worker threads. If this is 0, one thread per CPU is used.</param>
+        /// <param name="errorHandler">Called for each file that could not be updated, with its path relative to <paramref name="rootPath"/>. Returns false to cancel the operation. May be null. Calls are serialized, but come from the worker threads.</param>
+        /// <returns>The counters of the operation.</returns>
+        NativeRecursiveApplyStatistics ApplyPermissionsRecursive(string rootPath, CompiledPermissionsHandle filePermissions, CompiledPermissionsHandle directoryPermissions, CompiledPermissionsHandle directoryDefaultPermissions, int threadCount, Func<string, NativeException, bool> errorHandler);
+
+        /// <summary>
+        /// Returns the GIDs of the groups the given user is a member of, as listed in the user and group databases. The primary group of the user is included.
+        /// </summary>
+        /// <param name="userId">The UID of the user.</param>
+        int[] GetUserGroups(int userId);
+
+        /// <summary>
+        /// Looks up the name of the given user.
+        /// </summary>
+        /// <param name="userId">The UID of the user.</param>
+        string GetUserName(int userId);
+
+        /// <summary>
+        /// Looks up the name of the given group.
+        /// </summary>
+        /// <param name="groupId">The GID of the group.</param>
+        string GetGroupName(int groupId);
+
+        /// <summary>
+        /// Looks up the UID of the given user.
+        /// </summary>
+        /// <param name="userName">The name of the user.</param>
+        int GetUserId(string userName);
+
+        /// <summary>
+        /// Looks up the GID of the given group.
+        /// </summary>
+        /// <param name="groupName">The name of the group.</param>
+        int GetGroupId(string groupName);
+
+        /// <summary>
+        /// Creates a watcher for changes of file metadata.
+        /// inotify watchers report changes of the files in explicitly watched directories. fanotify watchers need CAP_SYS_ADMIN and CAP_DAC_READ_SEARCH, and report changes on entire file systems, identified by absolute paths.
+        /// </summary>
+        /// <param name="useFanotify">Specifies whether to use fanotify instead of inotify.</param>
+        FileWatcherHandle CreateFileWatcher(bool useFanotify);
+
+        /// <summary>
+        /// Starts watching the given directory. inotify watchers watch the directory and its direct children; subdirectories need their own watches. Watching a directory again returns the same watch descriptor.
+        /// fanotify watchers watch the entire file system containing the given directory.
+        /// </summary>
+        /// <param name="watcher">The watcher.</param>
+        /// <param name="path">The directory to watch. Symbolic links are not followed.</param>
+        /// <returns>The watch descriptor, or -1 for fanotify watchers.</returns>
+        int AddFileWatch(FileWatcherHandle watcher, string path);
+
+        /// <summary>
+        /// Stops watching the directory with the given watch descriptor. Does nothing for fanotify watchers.
+        /// </summary>
+        /// <param name="watcher">The watcher.</param>
+        /// <param name="watchDescriptor">The watch descriptor returned by <see cref="AddFileWatch"/>.</param>
+        void RemoveFileWatch(FileWatcherHandle watcher, int watchDescriptor);
+
+        /// <summary>
+        /// Waits until events are available, and fills the given buffers with as many events as fit. Events which do not fit are kept for the next call.
+        /// </summary>
+        /// <param name="watcher">The watcher.</param>
+        /// <param name="events">Buffer to be filled with events.</param>
+        /// <param name="names">Buffer to be filled with the null-terminated UTF-8 names of the events. Should hold at least 4096 bytes.</param>
+        /// <returns>The number of events, or 0 if the watcher was canceled by <see cref="CancelFileWatcher"/>.</returns>
+        int ReadFileWatchEvents(FileWatcherHandle watcher, NativeWatchEvent[] events, byte[] names);
+
+        /// <summary>
+        /// Makes all running and future calls of <see cref="ReadFileWatchEvents"/> on the given watcher return 0. May be called from any thread.
+        /// </summary>
+        /// <param name="watcher">The watcher.</param>
+        void CancelFileWatcher(FileWatcherHandle watcher);
+
+        /// <summary>
+        /// Queries the permission data and ACL of the given file or directory, which is resolved relative to an open directory.
+        /// </summary>
+        /// <param name="directory">The directory containing the file.</param>
+        /// <param name="fileName">The file or directory to query, relative to <paramref name="directory"/>.</param>
+        /// <param name="loadDefaultAcl">Specifies whether to load a directory's default ACL (1) or not (0). This must be 0 for files.</param>
+        /// <param name="dataContainer">Pointer to container object to store retrieved permissions and assoiated meta data.</param>
+        AccessControlListEntry[] GetPermissionData(PosixDirectoryHandle directory, string fileName, int loadDefaultAcl, out NativePermissionDataContainer dataContainer);
+
+        /// <summary>
+        /// Sets the permission data and ACL of the given file or directory, which is resolved relative to an open directory.
+        /// </summary>
+        /// <param name="directory">The directory containing the file.</param>
+        /// <param name="fileName">The file or directory to set permissions for, relative to <paramref name="directory"/>.</param>
+        /// <param name="setDefaultAcl">Specifies whether to load a directory's default ACL (1) or not (0). This must be 0 for files.</param>
+        /// <param name="dataContainer">Pointer to container object with permissions and meta data.</param>
+        /// <param name="entries">Entries of the object' new access control list.</param>
+        void SetPermissionData(PosixDirectoryHandle directory, string fileName, int setDefaultAcl, ref NativePermissionDataContainer dataContainer, AccessControlListEntry[] entries);
+
+        /// <summary>
+        /// Sets the permission data and ACL of the given file or directory, and reports which parts were modified.
+        /// With <see cref="NativeContextOptions.SkipUnchanged"/>, parts that already have the requested state are not written.
+        /// </summary>
+        /// <param name="directory">The directory containing the file, or null to resolve the name against the working directory.</param>
+        /// <param name="fileName">The file or directory to set permissions for.</param>
+        /// <param name="setDefaultAcl">Specifies whether to set a directory's default ACL (1) or not (0). This must be 0 for files.</param>
+        /// <param name="dataContainer">Pointer to container object with permissions and meta data.</param>
+        /// <param name="entries">Entries of the object' new access control list.</param>
+        /// <param name="changes">Receives the parts of the file's permissions that were modified.</param>
+        void SetPermissionData(PosixDirectoryHandle directory, string fileName, int setDefaultAcl, ref NativePermissionDataContainer dataContainer, AccessControlListEntry[] entries, out NativePermissionChanges changes);
+
+        /// <summary>
+        /// Queries the permission data and ACL of the given file or directory, and additionally its identity and change time, which can be used to validate cached permission data.
+        /// </summary>
+        /// <param name="directory">The directory containing the file, or null to resolve the name against the working directory.</param>
+        /// <param name="fileName">The file or directory to query.</param>
+        /// <param name="loadDefaultAcl">Specifies whether to load a directory's default ACL (1) or not (0). This must be 0 for files.</param>
+        /// <param name="dataContainer">Pointer to container object to store retrieved permissions and assoiated meta data.</param>
+        /// <param name="identity">Receives the identity and change time of the file.</param>
+        AccessControlListEntry[] GetPermissionData(PosixDirectoryHandle directory, string fileName, int loadDefaultAcl, out NativePermissionDataContainer dataContainer, out NativeFileIdentity identity);
+
+        /// <summary>
+        /// Returns the identity and change time of the given file or directory. This only needs a single statx() call, the file is neither opened nor is its ACL read.
+        /// </summary>
+        /// <param name="directory">The directory containing the file, or null to resolve the name against the working directory.</param>
+        /// <param name="fileName">The file or directory to query.</param>
+        NativeFileIdentity GetFileIdentity(PosixDirectoryHandle directory, string fileName);
+
+        /// <summary>
+        /// Queries the permission data, the access ACL and the default ACL of the given directory, opening it only once.
+        /// </summary>
+        /// <param name="directory">The directory containing the directory, or null to resolve the name against the working directory.</param>
+        /// <param name="directoryName">The directory to query.</param>
+        /// <param name="dataContainer">Pointer to container object to store retrieved permissions and assoiated meta data.</param>
+        /// <param name="defaultEntries">Receives the entries of the default ACL. This is empty if the directory has no default ACL.</param>
+        /// <returns>The entries of the access ACL.</returns>
+        AccessControlListEntry[] GetDirectoryPermissionData(PosixDirectoryHandle directory, string directoryName, out NativePermissionDataContainer dataContainer, out AccessControlListEntry[] defaultEntries);
+
+        /// <summary>
+        /// Sets the permission data, the access ACL and the default ACL of the given directory, opening it only once.
+        /// </summary>
+        /// <param name="directory">The directory containing the directory, or null to resolve the name against the working directory.</param>
+        /// <param name="directoryName">The directory to update.</param>
+        /// <param name="dataContainer">Pointer to container object with permissions and meta data.</param>
+        /// <param name="entries">Entries of the directory's new access ACL.</param>
+        /// <param name="defaultEntries">Entries of the directory's new default ACL. If this is empty, the default ACL is removed.</param>
+        /// <returns>The parts of the directory's permissions that were modified.</returns>
+        NativePermissionChanges SetDirectoryPermissionData(PosixDirectoryHandle directory, string directoryName, ref NativePermissionDataContainer dataContainer, AccessControlListEntry[] entries, AccessControlListEntry[] defaultEntries);
+
+        /// <summary>
+        /// Returns an interface whose native calls additionally use the given context options. This object is not modified.
+        /// </summary>
+        /// <param name="options">The options to add.</param>
+        INativeLibraryInterface WithContextOptions(NativeContextOptions options);
     }
 }
\ No newline at end of file
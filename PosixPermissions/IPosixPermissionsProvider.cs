@@ -29,5 +29,41 @@ namespace PosixPermissions
         /// <param name="directory">The directory to load the permissions for.</param>
         /// <param name="loadDefaultAcl">Specifies whether the directory's own or default ACL should be loaded.</param>
         PosixPermissionInfo GetPosixPermissionInfo(DirectoryInfo directory, bool loadDefaultAcl);
+
+        /// <summary>
+        /// Creates a new <see cref="PosixDirectoryPermissionInfo"/> object holding the access and default permissions of the given directory.
+        /// </summary>
+        /// <param name="directory">The directory to load the permissions for.</param>
+        PosixDirectoryPermissionInfo GetPosixDirectoryPermissionInfo(DirectoryInfo directory);
+
+        /// <summary>
+        /// Creates a new <see cref="DefaultAclInheritanceCalculator"/> object predicting the permissions of objects created by the given user and group.
+        /// </summary>
+        /// <param name="ownerId">The UID of the process creating the new objects.</param>
+        /// <param name="groupId">The GID of the process creating the new objects.</param>
+        DefaultAclInheritanceCalculator CreateDefaultAclInheritanceCalculator(int ownerId, int groupId);
+
+        /// <summary>
+        /// Creates a new <see cref="AccessChecker"/> object, which caches groups and directory permissions for the given time.
+        /// </summary>
+        /// <param name="cacheLifetime">Specifies how long the groups of a user and the permissions of a directory are cached.</param>
+        AccessChecker CreateAccessChecker(TimeSpan cacheLifetime);
+
+        /// <summary>
+        /// Creates a new <see cref="PermissionSnapshotRestorer"/> object, which restores the permissions recorded in a snapshot.
+        /// </summary>
+        PermissionSnapshotRestorer CreatePermissionSnapshotRestorer();
+
+        /// <summary>
+        /// Creates a new <see cref="AclTextExporter"/> object, which writes permissions in the format of "getfacl -R".
+        /// </summary>
+        /// <param name="numeric">Specifies whether users and groups are written as numeric IDs instead of names.</param>
+        AclTextExporter CreateAclTextExporter(bool numeric);
+
+        /// <summary>
+        /// Creates a new <see cref="AclTextImporter"/> object, which applies permissions in the format of "getfacl -R".
+        /// </summary>
+        /// <param name="numeric">Specifies whether users and groups must be given as numeric IDs.</param>
+        AclTextImporter CreateAclTextImporter(bool numeric);
     }
 }
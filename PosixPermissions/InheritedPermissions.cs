@@ -0,0 +1,80 @@
+﻿using System;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// The permissions a new file or directory receives when it is created, as predicted by <see cref="DefaultAclInheritanceCalculator"/>.
+    /// The layout matches what <see cref="INativeLibraryInterface.GetPermissionData(string, int, out NativePermissionDataContainer)"/> returns after the object was created, so both can be compared directly.
+    /// </summary>
+    public class InheritedPermissions
+    {
+        /// <summary>
+        /// The access ACL entries. Shared between all callers requesting the same permissions.
+        /// </summary>
+        private readonly AccessControlListEntry[] _accessAcl;
+
+        /// <summary>
+        /// The default ACL entries. Shared between all callers requesting the same permissions.
+        /// </summary>
+        private readonly AccessControlListEntry[] _defaultAcl;
+
+        /// <summary>
+        /// Owner, group and UNIX permissions of the new object. <see cref="NativePermissionDataContainer.AclSize"/> holds the length of <see cref="AccessAcl"/>.
+        /// </summary>
+        public NativePermissionDataContainer DataContainer { get; }
+
+        /// <summary>
+        /// The access ACL of the new object. If the object does not get an extended ACL, this is the minimal ACL derived from the permission bits.
+        /// </summary>
+        public ReadOnlySpan<AccessControlListEntry> AccessAcl => _accessAcl;
+
+        /// <summary>
+        /// The default ACL of the new object. This is only non-empty for directories created in a directory with a default ACL.
+        /// </summary>
+        public ReadOnlySpan<AccessControlListEntry> DefaultAcl => _defaultAcl;
+
+        /// <summary>
+        /// Returns whether the new object gets an extended access ACL, i.e., one that is not equivalent to its permission bits.
+        /// </summary>
+        public bool HasExtendedAcl => _accessAcl.Length > 3;
+
+        /// <summary>
+        /// Creates a new result object.
+        /// </summary>
+        /// <param name="dataContainer">Owner, group and UNIX permissions.</param>
+        /// <param name="accessAcl">The access ACL entries.</param>
+        /// <param name="defaultAcl">The default ACL entries.</param>
+        internal InheritedPermissions(NativePermissionDataContainer dataContainer, AccessControlListEntry[] accessAcl, AccessControlListEntry[] defaultAcl)
+        {
+            DataContainer = dataContainer;
+            _accessAcl = accessAcl;
+            _defaultAcl = defaultAcl;
+        }
+
+        /// <summary>
+        /// Checks whether the given permission data, as read from an existing object, matches the prediction.
+        /// </summary>
+        /// <param name="dataContainer">Owner, group and UNIX permissions of the object.</param>
+        /// <param name="accessAcl">The access ACL of the object.</param>
+        public bool Matches(in NativePermissionDataContainer dataContainer, ReadOnlySpan<AccessControlListEntry> accessAcl)
+        {
+            var expected = DataContainer;
+            if(dataContainer.OwnerId != expected.OwnerId
+               || dataContainer.GroupId != expected.GroupId
+               || dataContainer.OwnerPermissions != expected.OwnerPermissions
+               || dataContainer.GroupPermissions != expected.GroupPermissions
+               || dataContainer.OtherPermissions != expected.OtherPermissions
+               || accessAcl.Length != _accessAcl.Length)
+                return false;
+
+            for(int i = 0; i < accessAcl.Length; ++i)
+            {
+                if(accessAcl[i].TagType != _accessAcl[i].TagType
+                   || accessAcl[i].TagQualifier != _accessAcl[i].TagQualifier
+                   || accessAcl[i].Permissions != _accessAcl[i].Permissions)
+                    return false;
+            }
+            return true;
+        }
+    }
+}
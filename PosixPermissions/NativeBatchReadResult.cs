@@ -0,0 +1,35 @@
+﻿using System.Runtime.InteropServices;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Result of one item of a batch read.
+    /// </summary>
+    [StructLayout(LayoutKind.Explicit, Size = 9 * 4)]
+    public struct NativeBatchReadResult
+    {
+        /// <summary>
+        /// Permission data of the item. <see cref="NativePermissionDataContainer.AclSize"/> holds the number of ACL entries.
+        /// </summary>
+        [FieldOffset(0 * 4)]
+        public NativePermissionDataContainer DataContainer;
+
+        /// <summary>
+        /// Index of the item's first ACL entry in <see cref="PermissionDataBatch.Entries"/>.
+        /// </summary>
+        [FieldOffset(6 * 4)]
+        public int EntriesOffset;
+
+        /// <summary>
+        /// Result of reading the item.
+        /// </summary>
+        [FieldOffset(7 * 4)]
+        public NativeErrorCodes Status;
+
+        /// <summary>
+        /// The errno value belonging to <see cref="Status"/>, or 0.
+        /// </summary>
+        [FieldOffset(8 * 4)]
+        public int Errno;
+    }
+}
@@ -0,0 +1,37 @@
+﻿using System.Runtime.InteropServices;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Status of one item of a batch operation.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct NativeBatchStatus
+    {
+        /// <summary>
+        /// Result of processing the item.
+        /// </summary>
+        public NativeErrorCodes Status;
+
+        /// <summary>
+        /// The errno value belonging to <see cref="Status"/>, or 0.
+        /// </summary>
+        public int Errno;
+
+        /// <summary>
+        /// The parts of the item's permissions that were modified. Also set for failed items, if a part was modified before the failure.
+        /// </summary>
+        public NativePermissionChanges Changes;
+
+        /// <summary>
+        /// Returns whether the item was processed successfully.
+        /// </summary>
+        public bool IsSuccess => Status == NativeErrorCodes.NATIVE_ERROR_SUCCESS;
+
+        /// <summary>
+        /// Creates a <see cref="NativeException"/> describing the failure of this item, or returns null if it was processed successfully.
+        /// </summary>
+        public NativeException GetException()
+            => IsSuccess ? null : NativeException.FromErrno("ApplyCompiledPermissionsBatchCtx", Status, Errno);
+    }
+}
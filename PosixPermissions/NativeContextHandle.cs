@@ -0,0 +1,54 @@
+﻿using System;
+using System.Runtime.InteropServices;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Wraps a native context, which holds the state (open file, ACL and errno) of native operations.
+    /// Operations using different contexts may run in parallel.
+    /// </summary>
+    internal sealed class NativeContextHandle : SafeHandle
+    {
+        /// <summary>
+        /// Creates an invalid handle. Used by the P/Invoke marshaller.
+        /// </summary>
+        public NativeContextHandle()
+            : base(IntPtr.Zero, true)
+        { }
+
+        /// <inheritdoc />
+        public override bool IsInvalid => handle == IntPtr.Zero;
+
+        /// <summary>
+        /// Allocates a new native context.
+        /// </summary>
+        [DllImport(NativeLibraryInterface.NativeLibraryPath, EntryPoint = "CreateNativeContext")]
+        private static extern NativeContextHandle CreateNativeContext();
+
+        /// <summary>
+        /// Releases the given native context, including any file and ACL that are still open.
+        /// </summary>
+        /// <param name="context">The context to release.</param>
+        [DllImport(NativeLibraryInterface.NativeLibraryPath, EntryPoint = "FreeNativeContext")]
+        private static extern void FreeNativeContext(IntPtr context);
+
+        /// <summary>
+        /// Allocates a new native context.
+        /// </summary>
+        /// <exception cref="OutOfMemoryException">Thrown when the native context could not be allocated.</exception>
+        public static NativeContextHandle Create()
+        {
+            var context = CreateNativeContext();
+            if(context.IsInvalid)
+                throw new OutOfMemoryException("Could not allocate native context.");
+            return context;
+        }
+
+        /// <inheritdoc />
+        protected override bool ReleaseHandle()
+        {
+            FreeNativeContext(handle);
+            return true;
+        }
+    }
+}
@@ -0,0 +1,46 @@
+﻿using System;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Options controlling the behavior of the native implementation.
+    /// </summary>
+    [Flags]
+    public enum NativeContextOptions : int
+    {
+        /// <summary>
+        /// Default behavior.
+        /// </summary>
+        None = 0,
+
+        /// <summary>
+        /// Read and write ACLs through libacl instead of accessing the "system.posix_acl_*" extended attributes directly.
+        /// Native libraries built without ACLNATIVE_RAW_XATTR always use libacl.
+        /// </summary>
+        UseLibAcl = 1,
+
+        /// <summary>
+        /// Do not follow a symbolic link in the last path component, but operate on the link itself.
+        /// Symbolic links report their permission bits with a minimal ACL; changing their permissions fails.
+        /// </summary>
+        NoFollow = 2,
+
+        /// <summary>
+        /// Batch operations submit their statx, getxattr and setxattr calls to an io_uring instance, keeping up to <see cref="NativeLibraryInterface.IoUringQueueDepth"/> operations in flight.
+        /// If the kernel or the native library do not support this, large batches are split and processed on the thread pool instead. Ignored for reads with <see cref="UseLibAcl"/> or <see cref="NoFollow"/>, since io_uring can only read ACLs through paths that follow symbolic links.
+        /// </summary>
+        IoUring = 4,
+
+        /// <summary>
+        /// Read metadata with AT_STATX_DONT_SYNC, so network file systems may answer from cached attributes instead of asking the server.
+        /// Owner, group and permission bits may then be slightly stale. Writes always check against synchronized metadata.
+        /// </summary>
+        DontSync = 8,
+
+        /// <summary>
+        /// Before writing, compare the requested permission bits and ACL with the current ones, and only issue the calls that change something.
+        /// This costs one ACL read per write, and leaves the change time of unchanged files untouched. Batch writes do not use io_uring in this mode.
+        /// </summary>
+        SkipUnchanged = 16
+    }
+}
@@ -28,5 +28,17 @@ namespace PosixPermissions
         NATIVE_ERROR_ADD_ACL_ENTRY_PERM_FAILED = 17,
         NATIVE_ERROR_VALIDATE_ACL_FAILED = 18,
         NATIVE_ERROR_SET_ACL_FAILED = 19,
+        NATIVE_ERROR_BUFFER_TOO_SMALL = 20,
+        NATIVE_ERROR_GET_XATTR_FAILED = 21,
+        NATIVE_ERROR_INVALID_XATTR = 22,
+        NATIVE_ERROR_SET_XATTR_FAILED = 23,
+        NATIVE_ERROR_OUT_OF_MEMORY = 24,
+        NATIVE_ERROR_READ_DIRECTORY_FAILED = 25,
+        NATIVE_ERROR_CANCELED = 26,
+        NATIVE_ERROR_USER_NOT_FOUND = 27,
+        NATIVE_ERROR_GROUP_NOT_FOUND = 28,
+        NATIVE_ERROR_WATCH_INIT_FAILED = 29,
+        NATIVE_ERROR_WATCH_FAILED = 30,
+        NATIVE_ERROR_READ_EVENTS_FAILED = 31,
     };
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
-﻿using System;
+﻿using Mono.Unix.Native;
+using System;
 using System.Collections.Generic;
 using System.Text;
 
@@ -57,6 +58,21 @@ namespace PosixPermissions
             ErrnoString = errnoString;
         }
 
+        /// <summary>
+        /// Creates a new exception from an error code and errno value reported without an error string, e.g. by the items of a batch operation.
+        /// </summary>
+        /// <param name="nativeMethodName">Name of the native API method which returned the error code.</param>
+        /// <param name="errorCode">Native error code of this exception.</param>
+        /// <param name="errno">Value of errno (or 0, if not applicable).</param>
+        internal static NativeException FromErrno(string nativeMethodName, NativeErrorCodes errorCode, long errno)
+        {
+            // Try to resolve to symbolic representation
+            string errnoString = "";
+            if(errno != 0 && NativeConvert.TryToErrno((int)errno, out var errnoSymbolic))
+                errnoString = errnoSymbolic.ToString() + ", " + Syscall.strerror(errnoSymbolic);
+            return new NativeException(nativeMethodName, errorCode, errno, errnoString);
+        }
+
         /// <summary>
         /// Combines the exception data into a single generic message string.
         /// </summary>
@@ -71,15 +87,15 @@ namespace PosixPermissions
             return prefix + errorCode switch
             {
                 NativeErrorCodes.NATIVE_ERROR_OPEN_FAILED => prefix + "open" + functionErrnoSuffix,
-                NativeErrorCodes.NATIVE_ERROR_FSTAT_FAILED => prefix + "fstat" + functionErrnoSuffix,
-                NativeErrorCodes.NATIVE_ERROR_GET_ACL_FAILED => prefix + "acl_get_fd" + functionErrnoSuffix,
+                NativeErrorCodes.NATIVE_ERROR_FSTAT_FAILED => prefix + "statx" + functionErrnoSuffix,
+                NativeErrorCodes.NATIVE_ERROR_GET_ACL_FAILED => prefix + "acl_get_file" + functionErrnoSuffix,
                 NativeErrorCodes.NATIVE_ERROR_GET_ACL_ENTRY_FAILED => prefix + "acl_get_entry" + functionErrnoSuffix,
                 NativeErrorCodes.NATIVE_ERROR_GET_ACL_ENTRY_TAG_TYPE_FAILED => prefix + "acl_get_tag_type" + functionErrnoSuffix,
                 NativeErrorCodes.NATIVE_ERROR_GET_ACL_ENTRY_QUALIFIER_FAILED => prefix + "acl_get_qualifier" + functionErrnoSuffix,
                 NativeErrorCodes.NATIVE_ERROR_GET_ACL_ENTRY_PERMSET_FAILED => prefix + "acl_get_permset" + functionErrnoSuffix,
                 NativeErrorCodes.NATIVE_ERROR_GET_ACL_ENTRY_PERM_FAILED => prefix + "acl_get_perm" + functionErrnoSuffix,
-                NativeErrorCodes.NATIVE_ERROR_CHOWN_FAILED => prefix + "fchown" + functionErrnoSuffix,
-                NativeErrorCodes.NATIVE_ERROR_CHMOD_FAILED => prefix + "fchmod" + functionErrnoSuffix,
+                NativeErrorCodes.NATIVE_ERROR_CHOWN_FAILED => prefix + "fchownat" + functionErrnoSuffix,
+                NativeErrorCodes.NATIVE_ERROR_CHMOD_FAILED => prefix + "chmod" + functionErrnoSuffix,
                 NativeErrorCodes.NATIVE_ERROR_INIT_ACL_FAILED => prefix + "acl_init" + functionErrnoSuffix,
                 NativeErrorCodes.NATIVE_ERROR_CREATE_ACL_ENTRY_FAILED => prefix + "acl_create_entry" + functionErrnoSuffix,
                 NativeErrorCodes.NATIVE_ERROR_INVALID_TAG_TYPE => prefix + "The given entry tag type was invalid.",
@@ -89,6 +105,18 @@ namespace PosixPermissions
                 NativeErrorCodes.NATIVE_ERROR_ADD_ACL_ENTRY_PERM_FAILED => prefix + "acl_add_perm" + functionErrnoSuffix,
                 NativeErrorCodes.NATIVE_ERROR_VALIDATE_ACL_FAILED => prefix + "acl_valid" + functionErrnoSuffix,
                 NativeErrorCodes.NATIVE_ERROR_SET_ACL_FAILED => prefix + "acl_set_file" + functionErrnoSuffix,
+                NativeErrorCodes.NATIVE_ERROR_BUFFER_TOO_SMALL => prefix + "The supplied ACL entry buffer was too small.",
+                NativeErrorCodes.NATIVE_ERROR_GET_XATTR_FAILED => prefix + "getxattr" + functionErrnoSuffix,
+                NativeErrorCodes.NATIVE_ERROR_INVALID_XATTR => prefix + "The ACL extended attribute has an invalid format.",
+                NativeErrorCodes.NATIVE_ERROR_SET_XATTR_FAILED => prefix + "setxattr" + functionErrnoSuffix,
+                NativeErrorCodes.NATIVE_ERROR_OUT_OF_MEMORY => prefix + "Could not allocate memory.",
+                NativeErrorCodes.NATIVE_ERROR_READ_DIRECTORY_FAILED => prefix + "getdents64" + functionErrnoSuffix,
+                NativeErrorCodes.NATIVE_ERROR_CANCELED => prefix + "The operation was canceled.",
+                NativeErrorCodes.NATIVE_ERROR_USER_NOT_FOUND => prefix + "The user does not exist.",
+                NativeErrorCodes.NATIVE_ERROR_GROUP_NOT_FOUND => prefix + "The group does not exist.",
+                NativeErrorCodes.NATIVE_ERROR_WATCH_INIT_FAILED => prefix + "inotify_init1/fanotify_init" + functionErrnoSuffix,
+                NativeErrorCodes.NATIVE_ERROR_WATCH_FAILED => prefix + "inotify_add_watch/fanotify_mark" + functionErrnoSuffix,
+                NativeErrorCodes.NATIVE_ERROR_READ_EVENTS_FAILED => prefix + "read" + functionErrnoSuffix,
                 _ => "Unknown native error.",
             };
         }
@@ -0,0 +1,36 @@
+﻿using System.Runtime.InteropServices;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Identity and change time of a file. Owner, group, permission bits and ACLs of a file can only change together with its change time, so this can be used as a cache key.
+    /// Fields not provided by the file system are 0.
+    /// </summary>
+    [StructLayout(LayoutKind.Explicit, Size = 8 * 4)]
+    public struct NativeFileIdentity
+    {
+        /// <summary>
+        /// The device containing the file.
+        /// </summary>
+        [FieldOffset(0 * 8)]
+        public ulong Device;
+
+        /// <summary>
+        /// The inode number of the file.
+        /// </summary>
+        [FieldOffset(1 * 8)]
+        public ulong Inode;
+
+        /// <summary>
+        /// Seconds part of the last status change time.
+        /// </summary>
+        [FieldOffset(2 * 8)]
+        public long ChangeTimeSeconds;
+
+        /// <summary>
+        /// Nanoseconds part of the last status change time.
+        /// </summary>
+        [FieldOffset(3 * 8)]
+        public uint ChangeTimeNanoseconds;
+    }
+}
@@ -1,9 +1,12 @@
 ﻿using Mono.Unix.Native;
 using System;
+using System.Buffers;
 using System.Collections.Generic;
 using System.IO;
+using System.Runtime.ExceptionServices;
 using System.Runtime.InteropServices;
 using System.Text;
+using System.Threading.Tasks;
 
 namespace PosixPermissions
 {
@@ -15,61 +18,520 @@ namespace PosixPermissions
         /// <summary>
         /// Path to the underlying native library, which is invoked from here.
         /// </summary>
-        private const string NativeLibraryPath = "acl_native.so";
+        internal const string NativeLibraryPath = "acl_native.so";
 
         /// <summary>
-        /// Used for locking access to native functions (native library isn't thread safe).
+        /// The native context of the current thread. Each thread uses its own context, so native calls from different threads run in parallel.
         /// </summary>
-        private readonly object _nativeFunctionsLock = new object();
+        [ThreadStatic]
+        private static NativeContextHandle _threadContext;
 
         /// <summary>
-        /// <para>Opens the ACL of the given file or directory, and reads its permission data.</para>
-        /// <para>The file is kept open and must be closed using <see cref="ReadFileAclAndClose(AccessControlListEntry[])"/>.</para>
+        /// The options currently set on <see cref="_threadContext"/>.
         /// </summary>
-        /// <param name="fileName">The file or directory to query.</param>
+        [ThreadStatic]
+        private static NativeContextOptions _threadContextOptions;
+
+        /// <summary>
+        /// The io_uring queue depth currently set on <see cref="_threadContext"/>.
+        /// </summary>
+        [ThreadStatic]
+        private static int _threadContextQueueDepth;
+
+        /// <summary>
+        /// Gets or sets the options of the native contexts used by this object.
+        /// </summary>
+        public NativeContextOptions ContextOptions { get; set; } = NativeContextOptions.None;
+
+        /// <summary>
+        /// Gets or sets the number of operations kept in flight by batch operations with <see cref="NativeContextOptions.IoUring"/>. 0 selects the native default.
+        /// </summary>
+        public int IoUringQueueDepth { get; set; } = 0;
+
+        /// <inheritdoc />
+        /// <remarks>
+        /// The returned object copies the current settings; later changes of <see cref="ContextOptions"/> and <see cref="IoUringQueueDepth"/> do not affect it.
+        /// </remarks>
+        public INativeLibraryInterface WithContextOptions(NativeContextOptions options)
+        {
+            return new NativeLibraryInterface
+            {
+                ContextOptions = ContextOptions | options,
+                IoUringQueueDepth = IoUringQueueDepth
+            };
+        }
+
+        /// <summary>
+        /// Initial size of the pooled ACL entry buffers. Most ACLs fit into this without a retry.
+        /// </summary>
+        private const int InitialEntryBufferLength = 32;
+
+        /// <summary>
+        /// Initial length of the buffer for the groups of a user.
+        /// </summary>
+        private const int InitialGroupBufferLength = 32;
+
+        /// <summary>
+        /// Initial length of the buffer for user and group names.
+        /// </summary>
+        private const int InitialNameBufferLength = 64;
+
+        /// <summary>
+        /// Number of ACL entries per item initially reserved by batch reads. ACLs with a few named entries fit into this.
+        /// </summary>
+        private const int InitialBatchEntriesPerItem = 8;
+
+        /// <summary>
+        /// Value of the native AT_FDCWD constant, which makes relative names resolve against the working directory.
+        /// </summary>
+        private const int AtFdCwd = -100;
+
+        /// <summary>
+        /// Size of one native ACL entry.
+        /// </summary>
+        private static readonly int AccessControlListEntrySize = Marshal.SizeOf<AccessControlListEntry>();
+
+        /// <summary>
+        /// Size of the pooled buffer receiving the records of a tree scan. Each native call fills it with as many records as fit.
+        /// </summary>
+        private const int ScanBufferLength = 1024 * 1024;
+
+        /// <summary>
+        /// Minimum number of items per partition, when batches are spread over the thread pool because io_uring is not available.
+        /// </summary>
+        private const int MinimumBatchPartitionLength = 64;
+
+        /// <summary>
+        /// Invalid handle passed to native functions in place of optional compiled permissions.
+        /// </summary>
+        private static readonly CompiledPermissionsHandle NoCompiledPermissions = new CompiledPermissionsHandle();
+
+        /// <summary>
+        /// <para>Reads the permission data and the ACL entries of the given file or directory in a single pass, and optionally its identity. The file is not kept open.</para>
+        /// <para>If the ACL has more than <paramref name="entriesLength"/> entries, <see cref="NativeErrorCodes.NATIVE_ERROR_BUFFER_TOO_SMALL"/> is returned and the required size is stored in <see cref="NativePermissionDataContainer.AclSize"/>.</para>
+        /// </summary>
+        /// <param name="context">The context to store errno.</param>
+        /// <param name="directory">Descriptor of the directory containing the file, or <see cref="AtFdCwd"/>.</param>
+        /// <param name="fileName">The file or directory to query, relative to <paramref name="directory"/>.</param>
         /// <param name="loadDefaultAcl">Specifies whether to load a directory's default ACL (1) or not (0). This must be 0 for files.</param>
         /// <param name="dataContainer">Pointer to container object to store retrieved permissions and assoiated meta data.</param>
-        [DllImport(NativeLibraryPath, EntryPoint = "OpenFileAndReadPermissionData")]
-        private static extern NativeErrorCodes OpenFileAndReadPermissionData([In, MarshalAs(UnmanagedType.LPUTF8Str)] string fileName, [In] int loadDefaultAcl, [Out] out NativePermissionDataContainer dataContainer);
+        /// <param name="entries">Buffer to be filled with the ACL entries.</param>
+        /// <param name="entriesLength">Number of entries the buffer can hold.</param>
+        /// <param name="identity">Single-element array receiving the identity of the file, or null if it is not needed.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "ReadPermissionDataWithIdentityAtCtx")]
+        private static extern NativeErrorCodes ReadPermissionDataWithIdentityAtCtx([In] NativeContextHandle context, [In] IntPtr directory, [In, MarshalAs(UnmanagedType.LPUTF8Str)] string fileName, [In] int loadDefaultAcl, [Out] out NativePermissionDataContainer dataContainer, [Out] AccessControlListEntry[] entries, [In] int entriesLength, [Out] NativeFileIdentity[] identity);
+
+        /// <summary>
+        /// Returns the identity and change time of the given file or directory with a single statx() call, without opening it or reading its ACL.
+        /// </summary>
+        /// <param name="context">The context to store errno.</param>
+        /// <param name="directory">Descriptor of the directory containing the file, or <see cref="AtFdCwd"/>.</param>
+        /// <param name="fileName">The file or directory to query, relative to <paramref name="directory"/>.</param>
+        /// <param name="identity">Receives the identity of the file.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "ReadFileIdentityAtCtx")]
+        private static extern NativeErrorCodes ReadFileIdentityAtCtx([In] NativeContextHandle context, [In] IntPtr directory, [In, MarshalAs(UnmanagedType.LPUTF8Str)] string fileName, [Out] out NativeFileIdentity identity);
+
+        /// <summary>
+        /// <para>Reads the permission data and ACL entries of several files or directories in one call. The ACL entries of all items are stored consecutively in the given entry buffer.</para>
+        /// <para>Items whose ACL does not fit into the remaining buffer get <see cref="NativeErrorCodes.NATIVE_ERROR_BUFFER_TOO_SMALL"/> and consume no entries. Returns the number of items that failed.</para>
+        /// </summary>
+        /// <param name="context">The context used for reading the items.</param>
+        /// <param name="directory">Descriptor of the directory the names are relative to, or <see cref="AtFdCwd"/>.</param>
+        /// <param name="fileNames">Pointers to the null-terminated UTF-8 names of the files or directories to query.</param>
+        /// <param name="fileCount">Number of items in <paramref name="fileNames"/> and <paramref name="results"/>.</param>
+        /// <param name="loadDefaultAcl">Specifies whether to load the directories' default ACLs (1) or not (0). This must be 0 for files.</param>
+        /// <param name="results">Buffer to be filled with the results of the individual items.</param>
+        /// <param name="entries">Pointer to the buffer to be filled with the ACL entries of all items.</param>
+        /// <param name="entriesLength">Number of entries the buffer can hold.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "ReadPermissionDataBatchCtx")]
+        private static extern int ReadPermissionDataBatchCtx([In] NativeContextHandle context, [In] IntPtr directory, [In] IntPtr[] fileNames, [In] int fileCount, [In] int loadDefaultAcl, [Out] NativeBatchReadResult[] results, [In] IntPtr entries, [In] int entriesLength);
+
+        /// <summary>
+        /// Builds and validates the given permission data and ACL entries once, so they can be assigned to many files.
+        /// </summary>
+        /// <param name="context">The context to store errno.</param>
+        /// <param name="setDefaultAcl">Specifies whether the ACL is assigned as a directory's default ACL (1) or not (0).</param>
+        /// <param name="dataContainer">Pointer to container object with permissions and assoiated meta data.</param>
+        /// <param name="entries">Array with ACL entries, in any order.</param>
+        /// <param name="compiledPermissions">Receives the compiled permissions.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "CompilePermissionDataCtx")]
+        private static extern NativeErrorCodes CompilePermissionDataCtx([In] NativeContextHandle context, [In] int setDefaultAcl, [In] ref NativePermissionDataContainer dataContainer, [In] AccessControlListEntry[] entries, [Out] out CompiledPermissionsHandle compiledPermissions);
+
+        /// <summary>
+        /// Assigns the given compiled permissions to several files or directories. Returns the number of items that failed.
+        /// </summary>
+        /// <param name="context">The context used for updating the items.</param>
+        /// <param name="compiledPermissions">The permissions to assign.</param>
+        /// <param name="directory">Descriptor of the directory the names are relative to, or <see cref="AtFdCwd"/>.</param>
+        /// <param name="fileNames">Pointers to the null-terminated UTF-8 names of the files or directories to update.</param>
+        /// <param name="fileCount">Number of items in <paramref name="fileNames"/> and <paramref name="results"/>.</param>
+        /// <param name="results">Buffer to be filled with the status of the individual items.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "ApplyCompiledPermissionsBatchCtx")]
+        private static extern int ApplyCompiledPermissionsBatchCtx([In] NativeContextHandle context, [In] CompiledPermissionsHandle compiledPermissions, [In] IntPtr directory, [In] IntPtr[] fileNames, [In] int fileCount, [Out] NativeBatchStatus[] results);
+
+        /// <summary>
+        /// Sets the options of the given native context.
+        /// </summary>
+        /// <param name="context">The context to configure.</param>
+        /// <param name="options">The new options.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "SetNativeContextOptions")]
+        private static extern void SetNativeContextOptions([In] NativeContextHandle context, [In] NativeContextOptions options);
 
         /// <summary>
-        /// Retrieves the ACL entries from the previously opened file. The file is automatically closed afterwards.
+        /// Sets the number of operations the io_uring instance of the given context keeps in flight.
         /// </summary>
-        /// <param name="entries">Array with empty ACL entries to be filled by the native implementation.</param>
-        [DllImport(NativeLibraryPath, EntryPoint = "ReadFileAclAndClose")]
-        private static extern NativeErrorCodes ReadFileAclAndClose([Out] AccessControlListEntry[] entries);
+        /// <param name="context">The context to configure.</param>
+        /// <param name="queueDepth">The queue depth, or 0 for the default.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "SetNativeContextQueueDepth")]
+        private static extern void SetNativeContextQueueDepth([In] NativeContextHandle context, [In] int queueDepth);
 
         /// <summary>
-        /// Sets the permission data and ACL entries of the given file.
+        /// Returns whether the batch functions can use io_uring with the given context (1) or not (0).
         /// </summary>
-        /// <param name="fileName">The file or directory to update.</param>
+        /// <param name="context">The context to check.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "IsIoUringAvailableCtx")]
+        private static extern int IsIoUringAvailableCtx([In] NativeContextHandle context);
+
+        /// <summary>
+        /// Sets the permission data and ACL entries of the given file, and reports which parts of its permissions were modified.
+        /// With <see cref="NativeContextOptions.SkipUnchanged"/>, parts that already have the requested state are not written.
+        /// </summary>
+        /// <param name="context">The context to store errno.</param>
+        /// <param name="directory">Descriptor of the directory containing the file, or <see cref="AtFdCwd"/>.</param>
+        /// <param name="fileName">The file or directory to update, relative to <paramref name="directory"/>.</param>
         /// <param name="setDefaultAcl">Specifies whether to set a directory's default ACL (1) or not (0). This must be 0 for files.</param>
         /// <param name="dataContainer">Pointer to container object with permissions and assoiated meta data.</param>
         /// <param name="entries">Array with ACL entries to be written.</param>
-        [DllImport(NativeLibraryPath, EntryPoint = "SetFilePermissionDataAndAcl")]
-        private static extern NativeErrorCodes SetFilePermissionDataAndAcl([In, MarshalAs(UnmanagedType.LPUTF8Str)] string fileName, [In] int setDefaultAcl, [In] ref NativePermissionDataContainer dataContainer, [In] AccessControlListEntry[] entries);
+        /// <param name="changes">Receives the modified parts, also on failure.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "SetFilePermissionDataAndAclWithChangesAtCtx")]
+        private static extern NativeErrorCodes SetFilePermissionDataAndAclWithChangesAtCtx([In] NativeContextHandle context, [In] IntPtr directory, [In, MarshalAs(UnmanagedType.LPUTF8Str)] string fileName, [In] int setDefaultAcl, [In] ref NativePermissionDataContainer dataContainer, [In] AccessControlListEntry[] entries, [Out] out NativePermissionChanges changes);
+
+        /// <summary>
+        /// <para>Reads the permission data, the access ACL and the default ACL of the given directory, opening it only once. The default ACL entries are stored directly behind the access ACL entries.</para>
+        /// <para>If both ACLs together have more than <paramref name="entriesLength"/> entries, <see cref="NativeErrorCodes.NATIVE_ERROR_BUFFER_TOO_SMALL"/> is returned and both sizes are stored.</para>
+        /// </summary>
+        /// <param name="context">The context to store errno.</param>
+        /// <param name="directory">Descriptor of the directory containing the directory, or <see cref="AtFdCwd"/>.</param>
+        /// <param name="directoryName">The directory to query, relative to <paramref name="directory"/>.</param>
+        /// <param name="dataContainer">Pointer to container object to store retrieved permissions and assoiated meta data. <see cref="NativePermissionDataContainer.AclSize"/> receives the size of the access ACL.</param>
+        /// <param name="entries">Buffer to be filled with the ACL entries.</param>
+        /// <param name="entriesLength">Number of entries the buffer can hold.</param>
+        /// <param name="defaultAclSize">Receives the size of the default ACL.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "ReadDirectoryPermissionDataAtCtx")]
+        private static extern NativeErrorCodes ReadDirectoryPermissionDataAtCtx([In] NativeContextHandle context, [In] IntPtr directory, [In, MarshalAs(UnmanagedType.LPUTF8Str)] string directoryName, [Out] out NativePermissionDataContainer dataContainer, [Out] AccessControlListEntry[] entries, [In] int entriesLength, [Out] out int defaultAclSize);
+
+        /// <summary>
+        /// Sets the permission data, the access ACL and the default ACL of the given directory, opening it only once.
+        /// </summary>
+        /// <param name="context">The context to store errno.</param>
+        /// <param name="directory">Descriptor of the directory containing the directory, or <see cref="AtFdCwd"/>.</param>
+        /// <param name="directoryName">The directory to update, relative to <paramref name="directory"/>.</param>
+        /// <param name="dataContainer">Pointer to container object with permissions and assoiated meta data. <see cref="NativePermissionDataContainer.AclSize"/> holds the size of the access ACL.</param>
+        /// <param name="entries">Array with the access ACL entries, directly followed by the default ACL entries.</param>
+        /// <param name="defaultAclSize">Number of default ACL entries. If this is 0, the default ACL is removed.</param>
+        /// <param name="changes">Receives the modified parts, also on failure.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "SetDirectoryPermissionDataAtCtx")]
+        private static extern NativeErrorCodes SetDirectoryPermissionDataAtCtx([In] NativeContextHandle context, [In] IntPtr directory, [In, MarshalAs(UnmanagedType.LPUTF8Str)] string directoryName, [In] ref NativePermissionDataContainer dataContainer, [In] AccessControlListEntry[] entries, [In] int defaultAclSize, [Out] out NativePermissionChanges changes);
+
+        /// <summary>
+        /// Called by the native library for each file a recursive apply fails on.
+        /// </summary>
+        /// <param name="path">Pointer to the UTF-8 path of the failed file, relative to the root directory.</param>
+        /// <param name="status">The error code of the failed operation.</param>
+        /// <param name="errno">The errno value belonging to <paramref name="status"/>, or 0.</param>
+        /// <param name="userData">Unused.</param>
+        /// <returns>0 to continue, or 1 to cancel the operation.</returns>
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        private delegate int RecursiveApplyErrorCallback(IntPtr path, NativeErrorCodes status, int errno, IntPtr userData);
+
+        /// <summary>
+        /// Recursively assigns compiled permissions to the given directory and its contents, using a pool of worker threads.
+        /// </summary>
+        /// <param name="context">The context to store errno.</param>
+        /// <param name="rootPath">The directory to update.</param>
+        /// <param name="filePermissions">The permissions to assign to files other than directories, or an invalid handle.</param>
+        /// <param name="directoryPermissions">The permissions to assign to directories, or an invalid handle.</param>
+        /// <param name="directoryDefaultPermissions">The default ACL to assign to directories, or an invalid handle.</param>
+        /// <param name="threadCount">Number of worker threads, or 0 for one thread per CPU.</param>
+        /// <param name="errorCallback">Function to call for each failure, or null.</param>
+        /// <param name="userData">Value passed to <paramref name="errorCallback"/>.</param>
+        /// <param name="statistics">Receives the counters of the operation.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "ApplyPermissionsRecursiveCtx")]
+        private static extern NativeErrorCodes ApplyPermissionsRecursiveCtx([In] NativeContextHandle context, [In, MarshalAs(UnmanagedType.LPUTF8Str)] string rootPath, [In] CompiledPermissionsHandle filePermissions, [In] CompiledPermissionsHandle directoryPermissions, [In] CompiledPermissionsHandle directoryDefaultPermissions, [In] int threadCount, [In] RecursiveApplyErrorCallback errorCallback, [In] IntPtr userData, [Out] out NativeRecursiveApplyStatistics statistics);
+
+        /// <summary>
+        /// Determines the groups the given user is a member of.
+        /// </summary>
+        /// <param name="context">The context to store errno.</param>
+        /// <param name="userId">The UID of the user.</param>
+        /// <param name="groupIds">Array to store the GIDs of the groups.</param>
+        /// <param name="groupIdsLength">Length of the groupIds array.</param>
+        /// <param name="groupCount">Receives the number of groups.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "GetUserGroupsCtx")]
+        private static extern NativeErrorCodes GetUserGroupsCtx([In] NativeContextHandle context, [In] int userId, [Out] int[] groupIds, [In] int groupIdsLength, [Out] out int groupCount);
+
+        /// <summary>
+        /// Looks up the name of the given user.
+        /// </summary>
+        /// <param name="context">The context to store errno.</param>
+        /// <param name="userId">The UID of the user.</param>
+        /// <param name="name">Buffer to store the null-terminated name.</param>
+        /// <param name="nameLength">Length of the name buffer.</param>
+        /// <param name="requiredLength">Receives the length of the name including the terminating null byte.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "GetUserNameCtx")]
+        private static extern NativeErrorCodes GetUserNameCtx([In] NativeContextHandle context, [In] int userId, [Out] byte[] name, [In] int nameLength, [Out] out int requiredLength);
+
+        /// <summary>
+        /// Looks up the name of the given group.
+        /// </summary>
+        /// <param name="context">The context to store errno.</param>
+        /// <param name="groupId">The GID of the group.</param>
+        /// <param name="name">Buffer to store the null-terminated name.</param>
+        /// <param name="nameLength">Length of the name buffer.</param>
+        /// <param name="requiredLength">Receives the length of the name including the terminating null byte.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "GetGroupNameCtx")]
+        private static extern NativeErrorCodes GetGroupNameCtx([In] NativeContextHandle context, [In] int groupId, [Out] byte[] name, [In] int nameLength, [Out] out int requiredLength);
+
+        /// <summary>
+        /// Looks up the UID of the given user.
+        /// </summary>
+        /// <param name="context">The context to store errno.</param>
+        /// <param name="name">The name of the user.</param>
+        /// <param name="userId">Receives the UID of the user.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "GetUserIdCtx")]
+        private static extern NativeErrorCodes GetUserIdCtx([In] NativeContextHandle context, [In, MarshalAs(UnmanagedType.LPUTF8Str)] string name, [Out] out int userId);
+
+        /// <summary>
+        /// Looks up the GID of the given group.
+        /// </summary>
+        /// <param name="context">The context to store errno.</param>
+        /// <param name="name">The name of the group.</param>
+        /// <param name="groupId">Receives the GID of the group.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "GetGroupIdCtx")]
+        private static extern NativeErrorCodes GetGroupIdCtx([In] NativeContextHandle context, [In, MarshalAs(UnmanagedType.LPUTF8Str)] string name, [Out] out int groupId);
+
+        /// <summary>
+        /// Creates a watcher for changes of file metadata. The watcher must be released using "FreeFileWatcher".
+        /// </summary>
+        /// <param name="context">The context to store errno.</param>
+        /// <param name="useFanotify">Specifies whether to use fanotify (1) or inotify (0).</param>
+        /// <param name="watcher">Receives the watcher.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "CreateFileWatcherCtx")]
+        private static extern NativeErrorCodes CreateFileWatcherCtx([In] NativeContextHandle context, [In] int useFanotify, [Out] out FileWatcherHandle watcher);
+
+        /// <summary>
+        /// Starts watching the given directory.
+        /// </summary>
+        /// <param name="context">The context to store errno.</param>
+        /// <param name="watcher">The watcher.</param>
+        /// <param name="path">The directory to watch.</param>
+        /// <param name="watchDescriptor">Receives the watch descriptor, or -1 for fanotify watchers.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "AddFileWatchCtx")]
+        private static extern NativeErrorCodes AddFileWatchCtx([In] NativeContextHandle context, [In] FileWatcherHandle watcher, [In, MarshalAs(UnmanagedType.LPUTF8Str)] string path, [Out] out int watchDescriptor);
+
+        /// <summary>
+        /// Stops watching the directory with the given watch descriptor.
+        /// </summary>
+        /// <param name="context">The context to store errno.</param>
+        /// <param name="watcher">The watcher.</param>
+        /// <param name="watchDescriptor">The watch descriptor.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "RemoveFileWatchCtx")]
+        private static extern NativeErrorCodes RemoveFileWatchCtx([In] NativeContextHandle context, [In] FileWatcherHandle watcher, [In] int watchDescriptor);
+
+        /// <summary>
+        /// Waits until events are available, and fills the given buffers with as many events as fit.
+        /// </summary>
+        /// <param name="context">The context to store errno.</param>
+        /// <param name="watcher">The watcher.</param>
+        /// <param name="events">Buffer to be filled with events.</param>
+        /// <param name="eventsLength">Number of events the buffer can hold.</param>
+        /// <param name="names">Buffer to be filled with the null-terminated names of the events.</param>
+        /// <param name="namesLength">Size of the name buffer in bytes.</param>
+        /// <param name="eventCount">Receives the number of events.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "ReadFileWatchEventsCtx")]
+        private static extern NativeErrorCodes ReadFileWatchEventsCtx([In] NativeContextHandle context, [In] FileWatcherHandle watcher, [Out] NativeWatchEvent[] events, [In] int eventsLength, [Out] byte[] names, [In] int namesLength, [Out] out int eventCount);
+
+        /// <summary>
+        /// Makes all running and future reads of the given watcher return NATIVE_ERROR_CANCELED.
+        /// </summary>
+        /// <param name="watcher">The watcher.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "CancelFileWatcher")]
+        private static extern void CancelFileWatcherNative([In] FileWatcherHandle watcher);
+
+        /// <summary>
+        /// Opens the given directory.
+        /// </summary>
+        /// <param name="context">The context to store errno.</param>
+        /// <param name="directoryName">The directory to open.</param>
+        /// <param name="directory">Receives the directory handle.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "OpenDirectoryCtx")]
+        private static extern NativeErrorCodes OpenDirectoryCtx([In] NativeContextHandle context, [In, MarshalAs(UnmanagedType.LPUTF8Str)] string directoryName, [Out] out PosixDirectoryHandle directory);
+
+        /// <summary>
+        /// Opens a directory relative to an already open directory.
+        /// </summary>
+        /// <param name="context">The context to store errno.</param>
+        /// <param name="parentDirectory">The parent directory.</param>
+        /// <param name="directoryName">The directory to open, relative to <paramref name="parentDirectory"/>.</param>
+        /// <param name="directory">Receives the directory handle.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "OpenDirectoryAtCtx")]
+        private static extern NativeErrorCodes OpenDirectoryAtCtx([In] NativeContextHandle context, [In] PosixDirectoryHandle parentDirectory, [In, MarshalAs(UnmanagedType.LPUTF8Str)] string directoryName, [Out] out PosixDirectoryHandle directory);
+
+        /// <summary>
+        /// Opens the given root directory for a recursive scan.
+        /// </summary>
+        /// <param name="context">The context to store errno.</param>
+        /// <param name="rootPath">The directory to scan.</param>
+        /// <param name="scanner">Receives the scanner.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "CreateTreeScannerCtx")]
+        private static extern NativeErrorCodes CreateTreeScannerCtx([In] NativeContextHandle context, [In, MarshalAs(UnmanagedType.LPUTF8Str)] string rootPath, [Out] out TreeScannerHandle scanner);
+
+        /// <summary>
+        /// <para>Continues the given scan and fills the buffer with as many records as fit. The scan is complete when no records are returned.</para>
+        /// <para>If not even a single record fits, <see cref="NativeErrorCodes.NATIVE_ERROR_BUFFER_TOO_SMALL"/> is returned and the required size is stored in <paramref name="bytesWritten"/>.</para>
+        /// </summary>
+        /// <param name="context">The context used for reading the files.</param>
+        /// <param name="scanner">The scanner.</param>
+        /// <param name="buffer">Buffer to be filled with records.</param>
+        /// <param name="bufferLength">Size of the buffer in bytes.</param>
+        /// <param name="bytesWritten">Receives the number of bytes written.</param>
+        /// <param name="recordCount">Receives the number of records written.</param>
+        [DllImport(NativeLibraryPath, EntryPoint = "ReadTreeScannerRecordsCtx")]
+        private static extern NativeErrorCodes ReadTreeScannerRecordsCtx([In] NativeContextHandle context, [In] TreeScannerHandle scanner, [Out] byte[] buffer, [In] int bufferLength, [Out] out int bytesWritten, [Out] out int recordCount);
 
         /// <summary>
-        /// <para>Returns the last value of "errno" and its string representation.</para>
-        /// <para>This function will return 0 and an empty error string if called without an error actually having occured in the last P/Invoke function call.</para>
+        /// <para>Returns the last value of "errno" stored in the given context and its string representation.</para>
+        /// <para>This function will return 0 and an empty error string if called without an error actually having occured in the last P/Invoke function call using this context.</para>
         /// </summary>
+        /// <param name="context">The context passed to the failed function.</param>
         /// <param name="errnoString">Pointer to <see cref="StringBuilder"/> object to return the last value of strerror().</param>
         /// <param name="errnoStringBufferLength">Length of the error string buffer passed in <paramref name="errnoString"/>.</param>
-        [DllImport(NativeLibraryPath, EntryPoint = "GetLastErrnoValue")]
-        private static extern long GetLastErrnoValue([Out, MarshalAs(UnmanagedType.LPUTF8Str)] StringBuilder errnoString, [In] int errnoStringBufferLength);
+        [DllImport(NativeLibraryPath, EntryPoint = "GetContextErrnoValue")]
+        private static extern long GetContextErrnoValue([In] NativeContextHandle context, [Out, MarshalAs(UnmanagedType.LPUTF8Str)] StringBuilder errnoString, [In] int errnoStringBufferLength);
 
         /// <summary>
-        /// Retrieves the error information from the native implementation and constructs a new <see cref="NativeException"/> object, that can be thrown afterwards.
+        /// Returns the native context of the current thread, and allocates it on first use. The context is configured with <see cref="ContextOptions"/>.
         /// </summary>
+        private NativeContextHandle GetThreadContext()
+        {
+            var context = _threadContext ??= NativeContextHandle.Create();
+            if(_threadContextOptions != ContextOptions)
+            {
+                SetNativeContextOptions(context, ContextOptions);
+                _threadContextOptions = ContextOptions;
+            }
+            if(_threadContextQueueDepth != IoUringQueueDepth)
+            {
+                SetNativeContextQueueDepth(context, IoUringQueueDepth);
+                _threadContextQueueDepth = IoUringQueueDepth;
+            }
+            return context;
+        }
+
+        /// <summary>
+        /// Returns whether a batch of the given size should be spread over the thread pool, because io_uring was requested but is not available.
+        /// </summary>
+        /// <param name="count">The number of items in the batch.</param>
+        private bool UseThreadPoolForBatch(int count)
+            => (ContextOptions & NativeContextOptions.IoUring) != 0
+               && count >= 2 * MinimumBatchPartitionLength
+               && IsIoUringAvailableCtx(GetThreadContext()) == 0;
+
+        /// <summary>
+        /// Splits the given names into consecutive partitions, one per processor.
+        /// </summary>
+        /// <param name="fileNames">The names to split.</param>
+        private static string[][] PartitionFileNames(IReadOnlyList<string> fileNames)
+        {
+            int count = fileNames.Count;
+            int partitionCount = Math.Max(1, Math.Min(Environment.ProcessorCount, count / MinimumBatchPartitionLength));
+            int partitionLength = (count + partitionCount - 1) / partitionCount;
+            var partitions = new string[partitionCount][];
+            for(int p = 0; p < partitionCount; ++p)
+            {
+                int start = p * partitionLength;
+                var partition = new string[Math.Min(partitionLength, count - start)];
+                for(int i = 0; i < partition.Length; ++i)
+                    partition[i] = fileNames[start + i];
+                partitions[p] = partition;
+            }
+            return partitions;
+        }
+
+        /// <summary>
+        /// Encodes a list of names as null-terminated UTF-8 strings into a single pinned buffer, so they can be passed to the native batch functions without further marshalling.
+        /// </summary>
+        private readonly struct PinnedFileNames : IDisposable
+        {
+            /// <summary>
+            /// Pooled buffer holding the encoded names.
+            /// </summary>
+            private readonly byte[] _buffer;
+
+            /// <summary>
+            /// Pins <see cref="_buffer"/>.
+            /// </summary>
+            private readonly GCHandle _bufferHandle;
+
+            /// <summary>
+            /// Pooled array with pointers to the individual names. It may be longer than the name list, and may be reordered by the caller.
+            /// </summary>
+            public IntPtr[] Pointers { get; }
+
+            /// <summary>
+            /// Encodes and pins the given names.
+            /// </summary>
+            /// <param name="fileNames">The names to encode.</param>
+            public PinnedFileNames(IReadOnlyList<string> fileNames)
+            {
+                // Encode all names into a single buffer, so only one object needs to be pinned
+                int count = fileNames.Count;
+                int bufferLength = 0;
+                for(int i = 0; i < count; ++i)
+                    bufferLength += Encoding.UTF8.GetByteCount(fileNames[i]) + 1;
+                _buffer = ArrayPool<byte>.Shared.Rent(bufferLength);
+                var offsets = ArrayPool<int>.Shared.Rent(count);
+                int position = 0;
+                for(int i = 0; i < count; ++i)
+                {
+                    offsets[i] = position;
+                    position += Encoding.UTF8.GetBytes(fileNames[i], 0, fileNames[i].Length, _buffer, position);
+                    _buffer[position++] = 0;
+                }
+
+                // Pin buffer and compute name addresses
+                _bufferHandle = GCHandle.Alloc(_buffer, GCHandleType.Pinned);
+                IntPtr bufferAddress = _bufferHandle.AddrOfPinnedObject();
+                Pointers = ArrayPool<IntPtr>.Shared.Rent(count);
+                for(int i = 0; i < count; ++i)
+                    Pointers[i] = bufferAddress + offsets[i];
+                ArrayPool<int>.Shared.Return(offsets);
+            }
+
+            /// <summary>
+            /// Unpins the buffer and returns the pooled arrays.
+            /// </summary>
+            public void Dispose()
+            {
+                _bufferHandle.Free();
+                ArrayPool<byte>.Shared.Return(_buffer);
+                ArrayPool<IntPtr>.Shared.Return(Pointers);
+            }
+        }
+
+        /// <summary>
+        /// Retrieves the error information from the given native context and constructs a new <see cref="NativeException"/> object, that can be thrown afterwards.
+        /// </summary>
+        /// <param name="context">The context passed to the failed native API method.</param>
         /// <param name="nativeMethodName">Name of the native API method which returned the error code.</param>
         /// <param name="errorCode">The error code returned by the native API method.</param>
         /// <param name="errnoResolvable">This will tell whether the retrieved errno could be resolved into a symbolic representation.</param>
         /// <param name="errnoSymbolic">This will hold the symbolic value of the retrieved errno; check the <paramref name="errnoResolvable"/> parameter beforehand!</param>
-        private NativeException RetrieveErrnoAndBuildException(string nativeMethodName, NativeErrorCodes errorCode, out bool errnoResolvable, out Errno errnoSymbolic)
+        private static NativeException RetrieveErrnoAndBuildException(NativeContextHandle context, string nativeMethodName, NativeErrorCodes errorCode, out bool errnoResolvable, out Errno errnoSymbolic)
         {
             // Retrieve errno
             var errnoStringBuffer = new StringBuilder(256);
-            long errno = GetLastErrnoValue(errnoStringBuffer, errnoStringBuffer.Capacity);
+            long errno = GetContextErrnoValue(context, errnoStringBuffer, errnoStringBuffer.Capacity);
 
             // Try to resolve to symbolic representation
             errnoResolvable = NativeConvert.TryToErrno((int)errno, out errnoSymbolic);
@@ -83,37 +545,350 @@ namespace PosixPermissions
         /// <exception cref="FileNotFoundException">Thrown when a file/directory or parts of its path cannot be found.</exception>
         /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions. This exception is also always included as the <see cref="Exception.InnerException"/>.</exception>
         public AccessControlListEntry[] GetPermissionData(string fileName, int loadDefaultAcl, out NativePermissionDataContainer dataContainer)
+            => GetPermissionData(null, fileName, loadDefaultAcl, out dataContainer);
+
+        /// <inheritdoc />
+        /// <exception cref="UnauthorizedAccessException">Thrown when trying to open a file/directory without having sufficient access permissions.</exception>
+        /// <exception cref="FileNotFoundException">Thrown when a file/directory or parts of its path cannot be found.</exception>
+        /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions. This exception is also always included as the <see cref="Exception.InnerException"/>.</exception>
+        public AccessControlListEntry[] GetPermissionData(PosixDirectoryHandle directory, string fileName, int loadDefaultAcl, out NativePermissionDataContainer dataContainer)
+            => ReadPermissionData(directory, fileName, loadDefaultAcl, out dataContainer, null);
+
+        /// <inheritdoc />
+        /// <exception cref="UnauthorizedAccessException">Thrown when trying to open a file/directory without having sufficient access permissions.</exception>
+        /// <exception cref="FileNotFoundException">Thrown when a file/directory or parts of its path cannot be found.</exception>
+        /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions. This exception is also always included as the <see cref="Exception.InnerException"/>.</exception>
+        public AccessControlListEntry[] GetPermissionData(PosixDirectoryHandle directory, string fileName, int loadDefaultAcl, out NativePermissionDataContainer dataContainer, out NativeFileIdentity identity)
+        {
+            var identityBuffer = new NativeFileIdentity[1];
+            var acl = ReadPermissionData(directory, fileName, loadDefaultAcl, out dataContainer, identityBuffer);
+            identity = identityBuffer[0];
+            return acl;
+        }
+
+        /// <inheritdoc />
+        /// <exception cref="UnauthorizedAccessException">Thrown when a directory on the path cannot be searched.</exception>
+        /// <exception cref="FileNotFoundException">Thrown when a file/directory or parts of its path cannot be found.</exception>
+        /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions. This exception is also always included as the <see cref="Exception.InnerException"/>.</exception>
+        public NativeFileIdentity GetFileIdentity(PosixDirectoryHandle directory, string fileName)
         {
-            // Ensure exclusive access to native functions
-            lock(_nativeFunctionsLock)
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
+
+            bool directoryRefAdded = false;
+            try
             {
-                // Read permission data and retrieve ACL size
-                NativeErrorCodes err = OpenFileAndReadPermissionData(fileName, loadDefaultAcl, out dataContainer);
+                directory?.DangerousAddRef(ref directoryRefAdded);
+                IntPtr directoryFd = directory?.DangerousGetHandle() ?? new IntPtr(AtFdCwd);
+
+                var err = ReadFileIdentityAtCtx(context, directoryFd, fileName, out var identity);
                 if(err != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+                    throw BuildReadException(context, nameof(ReadFileIdentityAtCtx), err, fileName);
+                return identity;
+            }
+            finally
+            {
+                if(directoryRefAdded)
+                    directory.DangerousRelease();
+            }
+        }
+
+        /// <summary>
+        /// Queries the permission data and ACL of the given file or directory, and optionally its identity.
+        /// </summary>
+        /// <param name="directory">The directory containing the file, or null to resolve the name against the working directory.</param>
+        /// <param name="fileName">The file or directory to query.</param>
+        /// <param name="loadDefaultAcl">Specifies whether to load a directory's default ACL (1) or not (0). This must be 0 for files.</param>
+        /// <param name="dataContainer">Pointer to container object to store retrieved permissions and assoiated meta data.</param>
+        /// <param name="identity">Single-element array receiving the identity of the file, or null if it is not needed.</param>
+        private AccessControlListEntry[] ReadPermissionData(PosixDirectoryHandle directory, string fileName, int loadDefaultAcl, out NativePermissionDataContainer dataContainer, NativeFileIdentity[] identity)
+        {
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
+
+            // Read permission data and ACL into a pooled buffer, and retry with a larger one if the ACL does not fit
+            var entryBuffer = ArrayPool<AccessControlListEntry>.Shared.Rent(InitialEntryBufferLength);
+            bool directoryRefAdded = false;
+            try
+            {
+                directory?.DangerousAddRef(ref directoryRefAdded);
+                IntPtr directoryFd = directory?.DangerousGetHandle() ?? new IntPtr(AtFdCwd);
+
+                NativeErrorCodes err;
+                while((err = ReadPermissionDataWithIdentityAtCtx(context, directoryFd, fileName, loadDefaultAcl, out dataContainer, entryBuffer, entryBuffer.Length, identity)) == NativeErrorCodes.NATIVE_ERROR_BUFFER_TOO_SMALL)
                 {
-                    // Throw suitable exceptions
-                    var nativeException = RetrieveErrnoAndBuildException(nameof(OpenFileAndReadPermissionData), err, out var _, out var errnoSymbolic);
-                    switch(err)
-                    {
-                        // Handle certain special exception cases
-                        case NativeErrorCodes.NATIVE_ERROR_OPEN_FAILED when errnoSymbolic == Errno.EACCES:
-                            throw new UnauthorizedAccessException($"Could not open \"{fileName}\" for reading.", nativeException);
-                        case NativeErrorCodes.NATIVE_ERROR_OPEN_FAILED when errnoSymbolic == Errno.ENOENT:
-                            throw new FileNotFoundException($"Could not open \"{fileName}\" for reading.", nativeException);
-
-                        // Unhandled case, just throw generic exception directly
-                        default:
-                            throw nativeException;
-                    }
+                    ArrayPool<AccessControlListEntry>.Shared.Return(entryBuffer);
+                    entryBuffer = ArrayPool<AccessControlListEntry>.Shared.Rent(dataContainer.AclSize);
                 }
+                if(err != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+                    throw BuildReadException(context, nameof(ReadPermissionDataWithIdentityAtCtx), err, fileName);
 
-                // Read ACL
+                // Copy ACL
                 AccessControlListEntry[] acl = new AccessControlListEntry[dataContainer.AclSize];
-                err = ReadFileAclAndClose(acl);
+                Array.Copy(entryBuffer, acl, acl.Length);
+                return acl;
+            }
+            finally
+            {
+                if(directoryRefAdded)
+                    directory.DangerousRelease();
+                ArrayPool<AccessControlListEntry>.Shared.Return(entryBuffer);
+            }
+        }
+
+        /// <summary>
+        /// Retrieves errno and builds a suitable exception for a failed read of permission data.
+        /// </summary>
+        /// <param name="context">The context containing errno.</param>
+        /// <param name="nativeMethodName">The name of the failed native method.</param>
+        /// <param name="errorCode">The error code returned by the native method.</param>
+        /// <param name="fileName">The file or directory that was read.</param>
+        private static Exception BuildReadException(NativeContextHandle context, string nativeMethodName, NativeErrorCodes errorCode, string fileName)
+        {
+            var nativeException = RetrieveErrnoAndBuildException(context, nativeMethodName, errorCode, out var _, out var errnoSymbolic);
+            switch(errorCode)
+            {
+                // Handle certain special exception cases
+                case NativeErrorCodes.NATIVE_ERROR_OPEN_FAILED when errnoSymbolic == Errno.EACCES:
+                    return new UnauthorizedAccessException($"Could not open \"{fileName}\" for reading.", nativeException);
+                case NativeErrorCodes.NATIVE_ERROR_OPEN_FAILED when errnoSymbolic == Errno.ENOENT:
+                    return new FileNotFoundException($"Could not open \"{fileName}\" for reading.", nativeException);
+                case NativeErrorCodes.NATIVE_ERROR_FSTAT_FAILED when errnoSymbolic == Errno.EACCES:
+                    return new UnauthorizedAccessException($"Could not query \"{fileName}\".", nativeException);
+                case NativeErrorCodes.NATIVE_ERROR_FSTAT_FAILED when errnoSymbolic == Errno.ENOENT:
+                    return new FileNotFoundException($"Could not query \"{fileName}\".", nativeException);
+
+                // Unhandled case, just return generic exception directly
+                default:
+                    return nativeException;
+            }
+        }
+
+        /// <inheritdoc />
+        /// <exception cref="UnauthorizedAccessException">Thrown when trying to open a directory without having sufficient access permissions.</exception>
+        /// <exception cref="FileNotFoundException">Thrown when a directory or parts of its path cannot be found.</exception>
+        /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions. This exception is also always included as the <see cref="Exception.InnerException"/>.</exception>
+        public AccessControlListEntry[] GetDirectoryPermissionData(PosixDirectoryHandle directory, string directoryName, out NativePermissionDataContainer dataContainer, out AccessControlListEntry[] defaultEntries)
+        {
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
+
+            // Read permission data and both ACLs into a pooled buffer, and retry with a larger one if they do not fit
+            var entryBuffer = ArrayPool<AccessControlListEntry>.Shared.Rent(2 * InitialEntryBufferLength);
+            bool directoryRefAdded = false;
+            try
+            {
+                directory?.DangerousAddRef(ref directoryRefAdded);
+                IntPtr directoryFd = directory?.DangerousGetHandle() ?? new IntPtr(AtFdCwd);
+
+                NativeErrorCodes err;
+                int defaultAclSize;
+                while((err = ReadDirectoryPermissionDataAtCtx(context, directoryFd, directoryName, out dataContainer, entryBuffer, entryBuffer.Length, out defaultAclSize)) == NativeErrorCodes.NATIVE_ERROR_BUFFER_TOO_SMALL)
+                {
+                    ArrayPool<AccessControlListEntry>.Shared.Return(entryBuffer);
+                    entryBuffer = ArrayPool<AccessControlListEntry>.Shared.Rent(dataContainer.AclSize + defaultAclSize);
+                }
                 if(err != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
-                    throw RetrieveErrnoAndBuildException(nameof(ReadFileAclAndClose), err, out var _, out var _);
+                    throw BuildReadException(context, nameof(ReadDirectoryPermissionDataAtCtx), err, directoryName);
+
+                // Copy ACLs
+                AccessControlListEntry[] acl = new AccessControlListEntry[dataContainer.AclSize];
+                Array.Copy(entryBuffer, acl, acl.Length);
+                defaultEntries = new AccessControlListEntry[defaultAclSize];
+                Array.Copy(entryBuffer, acl.Length, defaultEntries, 0, defaultAclSize);
                 return acl;
             }
+            finally
+            {
+                if(directoryRefAdded)
+                    directory.DangerousRelease();
+                ArrayPool<AccessControlListEntry>.Shared.Return(entryBuffer);
+            }
+        }
+
+        /// <inheritdoc />
+        public PermissionDataBatch GetPermissionDataBatch(PosixDirectoryHandle directory, IReadOnlyList<string> fileNames, int loadDefaultAcl)
+        {
+            if(!UseThreadPoolForBatch(fileNames.Count))
+                return ReadBatch(directory, fileNames, loadDefaultAcl);
+
+            // io_uring is not available, read partitions in parallel instead; each thread uses its own context
+            var partitions = PartitionFileNames(fileNames);
+            var batches = new PermissionDataBatch[partitions.Length];
+            Parallel.For(0, partitions.Length, p => batches[p] = ReadBatch(directory, partitions[p], loadDefaultAcl));
+            return PermissionDataBatch.Concat(batches);
+        }
+
+        /// <summary>
+        /// Reads the permission data of the given files in a single native call, and retries items whose ACL did not fit into the entry buffer.
+        /// </summary>
+        /// <param name="directory">The directory the names are relative to, or null to resolve them against the working directory.</param>
+        /// <param name="fileNames">The files or directories to query.</param>
+        /// <param name="loadDefaultAcl">Specifies whether to load the directories' default ACLs (1) or not (0).</param>
+        private PermissionDataBatch ReadBatch(PosixDirectoryHandle directory, IReadOnlyList<string> fileNames, int loadDefaultAcl)
+        {
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
+
+            int count = fileNames.Count;
+            var results = new NativeBatchReadResult[count];
+            var entries = new AccessControlListEntry[count * InitialBatchEntriesPerItem];
+            var pendingIndices = ArrayPool<int>.Shared.Rent(count);
+            var pendingResults = ArrayPool<NativeBatchReadResult>.Shared.Rent(count);
+            var names = new PinnedFileNames(fileNames);
+            bool directoryRefAdded = false;
+            try
+            {
+                directory?.DangerousAddRef(ref directoryRefAdded);
+                IntPtr directoryFd = directory?.DangerousGetHandle() ?? new IntPtr(AtFdCwd);
+
+                // Initially all items are pending
+                var pendingNames = names.Pointers;
+                for(int i = 0; i < count; ++i)
+                    pendingIndices[i] = i;
+
+                // Read pending items; those whose ACL did not fit are read again with a larger buffer
+                int pendingCount = count;
+                int entriesUsed = 0;
+                while(pendingCount > 0)
+                {
+                    var entriesHandle = GCHandle.Alloc(entries, GCHandleType.Pinned);
+                    try
+                    {
+                        ReadPermissionDataBatchCtx(context, directoryFd, pendingNames, pendingCount, loadDefaultAcl, pendingResults,
+                            entriesHandle.AddrOfPinnedObject() + entriesUsed * AccessControlListEntrySize, entries.Length - entriesUsed);
+                    }
+                    finally
+                    {
+                        entriesHandle.Free();
+                    }
+
+                    // Store results and collect items which need to be retried
+                    int retryCount = 0;
+                    int retryEntriesLength = 0;
+                    int callEntriesUsed = 0;
+                    for(int j = 0; j < pendingCount; ++j)
+                    {
+                        ref var result = ref pendingResults[j];
+                        if(result.Status == NativeErrorCodes.NATIVE_ERROR_BUFFER_TOO_SMALL)
+                        {
+                            pendingNames[retryCount] = pendingNames[j];
+                            pendingIndices[retryCount] = pendingIndices[j];
+                            ++retryCount;
+                            retryEntriesLength += result.DataContainer.AclSize;
+                            continue;
+                        }
+
+                        // With io_uring, items may complete in any order
+                        if(result.Status == NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+                            callEntriesUsed = Math.Max(callEntriesUsed, result.EntriesOffset + result.DataContainer.AclSize);
+                        result.EntriesOffset += entriesUsed;
+                        results[pendingIndices[j]] = result;
+                    }
+                    entriesUsed += callEntriesUsed;
+                    pendingCount = retryCount;
+                    if(entries.Length - entriesUsed < retryEntriesLength)
+                        Array.Resize(ref entries, entriesUsed + retryEntriesLength);
+                }
+
+                // Trim unused buffer space
+                if(entries.Length != entriesUsed)
+                    Array.Resize(ref entries, entriesUsed);
+            }
+            finally
+            {
+                if(directoryRefAdded)
+                    directory.DangerousRelease();
+                names.Dispose();
+                ArrayPool<int>.Shared.Return(pendingIndices);
+                ArrayPool<NativeBatchReadResult>.Shared.Return(pendingResults);
+            }
+
+            return new PermissionDataBatch(results, entries);
+        }
+
+        /// <inheritdoc />
+        /// <exception cref="ArgumentException">Thrown when the provided ACL is invalid.</exception>
+        /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions. This exception is also always included as the <see cref="Exception.InnerException"/>.</exception>
+        public CompiledPermissionsHandle CompilePermissionData(int setDefaultAcl, ref NativePermissionDataContainer dataContainer, AccessControlListEntry[] entries)
+        {
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
+
+            // Make sure the meta data object is valid
+            dataContainer.AclSize = entries.Length;
+
+            // Build and validate ACL
+            NativeErrorCodes err = CompilePermissionDataCtx(context, setDefaultAcl, ref dataContainer, entries, out var compiledPermissions);
+            if(err != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+            {
+                compiledPermissions.Dispose();
+
+                // Throw suitable exceptions
+                var nativeException = RetrieveErrnoAndBuildException(context, nameof(CompilePermissionDataCtx), err, out var _, out var errnoSymbolic);
+                switch(err)
+                {
+                    // Handle certain special exception cases
+                    case NativeErrorCodes.NATIVE_ERROR_VALIDATE_ACL_FAILED when errnoSymbolic == Errno.EINVAL:
+                    case NativeErrorCodes.NATIVE_ERROR_INVALID_TAG_TYPE:
+                        throw new ArgumentException($"The given ACL is invalid.", nativeException);
+
+                    // Unhandled case, just throw generic exception directly
+                    default:
+                        throw nativeException;
+                }
+            }
+            return compiledPermissions;
+        }
+
+        /// <inheritdoc />
+        public NativeBatchStatus[] ApplyCompiledPermissionsBatch(CompiledPermissionsHandle compiledPermissions, PosixDirectoryHandle directory, IReadOnlyList<string> fileNames)
+        {
+            if(!UseThreadPoolForBatch(fileNames.Count))
+                return ApplyBatch(compiledPermissions, directory, fileNames);
+
+            // io_uring is not available, update partitions in parallel instead; each thread uses its own context
+            var partitions = PartitionFileNames(fileNames);
+            var partitionResults = new NativeBatchStatus[partitions.Length][];
+            Parallel.For(0, partitions.Length, p => partitionResults[p] = ApplyBatch(compiledPermissions, directory, partitions[p]));
+            var results = new NativeBatchStatus[fileNames.Count];
+            int position = 0;
+            foreach(var partitionResult in partitionResults)
+            {
+                partitionResult.CopyTo(results, position);
+                position += partitionResult.Length;
+            }
+            return results;
+        }
+
+        /// <summary>
+        /// Assigns compiled permissions to the given files in a single native call.
+        /// </summary>
+        /// <param name="compiledPermissions">The permissions to assign.</param>
+        /// <param name="directory">The directory the names are relative to, or null to resolve them against the working directory.</param>
+        /// <param name="fileNames">The files or directories to update.</param>
+        private NativeBatchStatus[] ApplyBatch(CompiledPermissionsHandle compiledPermissions, PosixDirectoryHandle directory, IReadOnlyList<string> fileNames)
+        {
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
+
+            var results = new NativeBatchStatus[fileNames.Count];
+            var names = new PinnedFileNames(fileNames);
+            bool directoryRefAdded = false;
+            try
+            {
+                directory?.DangerousAddRef(ref directoryRefAdded);
+                IntPtr directoryFd = directory?.DangerousGetHandle() ?? new IntPtr(AtFdCwd);
+
+                ApplyCompiledPermissionsBatchCtx(context, compiledPermissions, directoryFd, names.Pointers, results.Length, results);
+            }
+            finally
+            {
+                if(directoryRefAdded)
+                    directory.DangerousRelease();
+                names.Dispose();
+            }
+            return results;
         }
 
         /// <inheritdoc />
@@ -122,84 +897,547 @@ namespace PosixPermissions
         /// <exception cref="ArgumentException">Thrown when the provided ACL is invalid.</exception>
         /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions. This exception is also always included as the <see cref="Exception.InnerException"/>.</exception>
         public void SetPermissionData(string fileName, int setDefaultAcl, ref NativePermissionDataContainer dataContainer, AccessControlListEntry[] entries)
+            => SetPermissionData(null, fileName, setDefaultAcl, ref dataContainer, entries);
+
+        /// <inheritdoc />
+        /// <exception cref="UnauthorizedAccessException">Thrown when trying to open or modify a file/directory without having sufficient access permissions.</exception>
+        /// <exception cref="FileNotFoundException">Thrown when a file/directory or parts of its path cannot be found.</exception>
+        /// <exception cref="ArgumentException">Thrown when the provided ACL is invalid.</exception>
+        /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions. This exception is also always included as the <see cref="Exception.InnerException"/>.</exception>
+        public void SetPermissionData(PosixDirectoryHandle directory, string fileName, int setDefaultAcl, ref NativePermissionDataContainer dataContainer, AccessControlListEntry[] entries)
+            => SetPermissionData(directory, fileName, setDefaultAcl, ref dataContainer, entries, out _);
+
+        /// <inheritdoc />
+        /// <exception cref="UnauthorizedAccessException">Thrown when trying to open or modify a file/directory without having sufficient access permissions.</exception>
+        /// <exception cref="FileNotFoundException">Thrown when a file/directory or parts of its path cannot be found.</exception>
+        /// <exception cref="ArgumentException">Thrown when the provided ACL is invalid.</exception>
+        /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions. This exception is also always included as the <see cref="Exception.InnerException"/>.</exception>
+        public void SetPermissionData(PosixDirectoryHandle directory, string fileName, int setDefaultAcl, ref NativePermissionDataContainer dataContainer, AccessControlListEntry[] entries, out NativePermissionChanges changes)
         {
-            // Ensure exclusive access to native functions
-            lock(_nativeFunctionsLock)
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
+
+            // Make sure the meta data object is valid
+            dataContainer.AclSize = entries.Length;
+
+            bool directoryRefAdded = false;
+            try
             {
-                // Make sure the meta data object is valid
-                dataContainer.AclSize = entries.Length;
+                directory?.DangerousAddRef(ref directoryRefAdded);
+                IntPtr directoryFd = directory?.DangerousGetHandle() ?? new IntPtr(AtFdCwd);
 
                 // Set permissions and ACL
-                NativeErrorCodes err = SetFilePermissionDataAndAcl(fileName, setDefaultAcl, ref dataContainer, entries);
+                var err = SetFilePermissionDataAndAclWithChangesAtCtx(context, directoryFd, fileName, setDefaultAcl, ref dataContainer, entries, out changes);
                 if(err != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+                    throw BuildWriteException(context, nameof(SetFilePermissionDataAndAclWithChangesAtCtx), err, fileName);
+            }
+            finally
+            {
+                if(directoryRefAdded)
+                    directory.DangerousRelease();
+            }
+        }
+
+        /// <summary>
+        /// Retrieves errno and builds a suitable exception for a failed write of permission data.
+        /// </summary>
+        /// <param name="context">The context containing errno.</param>
+        /// <param name="nativeMethodName">The name of the failed native method.</param>
+        /// <param name="errorCode">The error code returned by the native method.</param>
+        /// <param name="fileName">The file or directory that was updated.</param>
+        private static Exception BuildWriteException(NativeContextHandle context, string nativeMethodName, NativeErrorCodes errorCode, string fileName)
+        {
+            var nativeException = RetrieveErrnoAndBuildException(context, nativeMethodName, errorCode, out var _, out var errnoSymbolic);
+            switch(errorCode)
+            {
+                // Handle certain special exception cases
+                case NativeErrorCodes.NATIVE_ERROR_OPEN_FAILED when errnoSymbolic == Errno.EACCES:
+                    return new UnauthorizedAccessException($"Could not open \"{fileName}\" for reading.", nativeException);
+                case NativeErrorCodes.NATIVE_ERROR_OPEN_FAILED when errnoSymbolic == Errno.ENOENT:
+                    return new FileNotFoundException($"Could not open \"{fileName}\" for reading.", nativeException);
+
+                case NativeErrorCodes.NATIVE_ERROR_CHOWN_FAILED when errnoSymbolic == Errno.EPERM:
+                    return new UnauthorizedAccessException($"Permission denied when using fchownat() on \"{fileName}\".", nativeException);
+
+                case NativeErrorCodes.NATIVE_ERROR_CHMOD_FAILED when errnoSymbolic == Errno.EPERM:
+                    return new UnauthorizedAccessException($"Permission denied when using chmod() on \"{fileName}\".", nativeException);
+
+                case NativeErrorCodes.NATIVE_ERROR_VALIDATE_ACL_FAILED when errnoSymbolic == Errno.EINVAL:
+                    return new ArgumentException($"The given ACL is invalid.", nativeException);
+
+                case NativeErrorCodes.NATIVE_ERROR_SET_ACL_FAILED when errnoSymbolic == Errno.EINVAL:
+                    return new ArgumentException($"Could not assign ACL to file \"{fileName}\" using acl_set_file().", nativeException);
+                case NativeErrorCodes.NATIVE_ERROR_SET_ACL_FAILED when errnoSymbolic == Errno.EPERM:
+                    return new UnauthorizedAccessException($"Permission denied when assigning ACL using acl_set_file() on \"{fileName}\".", nativeException);
+                case NativeErrorCodes.NATIVE_ERROR_SET_XATTR_FAILED when errnoSymbolic == Errno.EINVAL:
+                    return new ArgumentException($"Could not assign ACL to file \"{fileName}\" using setxattr().", nativeException);
+                case NativeErrorCodes.NATIVE_ERROR_SET_XATTR_FAILED when errnoSymbolic == Errno.EPERM:
+                    return new UnauthorizedAccessException($"Permission denied when assigning ACL using setxattr() on \"{fileName}\".", nativeException);
+
+                // Unhandled case, just return generic exception directly
+                default:
+                    return nativeException;
+            }
+        }
+
+        /// <inheritdoc />
+        /// <exception cref="UnauthorizedAccessException">Thrown when trying to open or modify a directory without having sufficient access permissions.</exception>
+        /// <exception cref="FileNotFoundException">Thrown when a directory or parts of its path cannot be found.</exception>
+        /// <exception cref="ArgumentException">Thrown when one of the provided ACLs is invalid.</exception>
+        /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions. This exception is also always included as the <see cref="Exception.InnerException"/>.</exception>
+        public NativePermissionChanges SetDirectoryPermissionData(PosixDirectoryHandle directory, string directoryName, ref NativePermissionDataContainer dataContainer, AccessControlListEntry[] entries, AccessControlListEntry[] defaultEntries)
+        {
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
+
+            // Make sure the meta data object is valid, and pass both ACLs in one buffer
+            dataContainer.AclSize = entries.Length;
+            var entryBuffer = ArrayPool<AccessControlListEntry>.Shared.Rent(entries.Length + defaultEntries.Length);
+            bool directoryRefAdded = false;
+            try
+            {
+                entries.CopyTo(entryBuffer, 0);
+                defaultEntries.CopyTo(entryBuffer, entries.Length);
+
+                directory?.DangerousAddRef(ref directoryRefAdded);
+                IntPtr directoryFd = directory?.DangerousGetHandle() ?? new IntPtr(AtFdCwd);
+
+                // Set permissions and ACLs
+                var err = SetDirectoryPermissionDataAtCtx(context, directoryFd, directoryName, ref dataContainer, entryBuffer, defaultEntries.Length, out var changes);
+                if(err != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+                    throw BuildWriteException(context, nameof(SetDirectoryPermissionDataAtCtx), err, directoryName);
+                return changes;
+            }
+            finally
+            {
+                if(directoryRefAdded)
+                    directory.DangerousRelease();
+                ArrayPool<AccessControlListEntry>.Shared.Return(entryBuffer);
+            }
+        }
+
+        /// <inheritdoc />
+        /// <exception cref="UnauthorizedAccessException">Thrown when trying to open a directory without having sufficient access permissions.</exception>
+        /// <exception cref="DirectoryNotFoundException">Thrown when the directory or parts of its path cannot be found.</exception>
+        /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions. This exception is also always included as the <see cref="Exception.InnerException"/>.</exception>
+        public PosixDirectoryHandle OpenDirectory(string directoryName)
+            => OpenDirectory(null, directoryName);
+
+        /// <inheritdoc />
+        /// <exception cref="UnauthorizedAccessException">Thrown when trying to open a directory without having sufficient access permissions.</exception>
+        /// <exception cref="DirectoryNotFoundException">Thrown when the directory or parts of its path cannot be found.</exception>
+        /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions. This exception is also always included as the <see cref="Exception.InnerException"/>.</exception>
+        public PosixDirectoryHandle OpenDirectory(PosixDirectoryHandle parentDirectory, string directoryName)
+        {
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
+
+            // Open directory
+            PosixDirectoryHandle directory;
+            NativeErrorCodes err = parentDirectory == null
+                ? OpenDirectoryCtx(context, directoryName, out directory)
+                : OpenDirectoryAtCtx(context, parentDirectory, directoryName, out directory);
+            if(err != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+            {
+                directory.Dispose();
+
+                // Throw suitable exceptions
+                var nativeException = RetrieveErrnoAndBuildException(context, parentDirectory == null ? nameof(OpenDirectoryCtx) : nameof(OpenDirectoryAtCtx), err, out var _, out var errnoSymbolic);
+                switch(err)
                 {
-                    // Throw suitable exceptions
-                    var nativeException = RetrieveErrnoAndBuildException(nameof(SetFilePermissionDataAndAcl), err, out var _, out var errnoSymbolic);
-                    switch(err)
+                    // Handle certain special exception cases
+                    case NativeErrorCodes.NATIVE_ERROR_OPEN_FAILED when errnoSymbolic == Errno.EACCES:
+                        throw new UnauthorizedAccessException($"Could not open directory \"{directoryName}\".", nativeException);
+                    case NativeErrorCodes.NATIVE_ERROR_OPEN_FAILED when errnoSymbolic == Errno.ENOENT || errnoSymbolic == Errno.ENOTDIR:
+                        throw new DirectoryNotFoundException($"Could not open directory \"{directoryName}\".", nativeException);
+
+                    // Unhandled case, just throw generic exception directly
+                    default:
+                        throw nativeException;
+                }
+            }
+            return directory;
+        }
+
+        /// <inheritdoc />
+        /// <exception cref="UnauthorizedAccessException">Thrown when trying to open the root directory without having sufficient access permissions.</exception>
+        /// <exception cref="DirectoryNotFoundException">Thrown when the root directory or parts of its path cannot be found.</exception>
+        /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions. This exception is also always included as the <see cref="Exception.InnerException"/>.
+        /// During enumeration, this is thrown after the records read so far, if a directory cannot be enumerated.</exception>
+        public IEnumerable<PermissionScanRecord> ScanTree(string rootPath)
+        {
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
+
+            // Open root directory right away, so errors are reported by this call and not by the first enumeration step
+            NativeErrorCodes err = CreateTreeScannerCtx(context, rootPath, out var scanner);
+            if(err != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+            {
+                scanner.Dispose();
+
+                // Throw suitable exceptions
+                var nativeException = RetrieveErrnoAndBuildException(context, nameof(CreateTreeScannerCtx), err, out var _, out var errnoSymbolic);
+                switch(err)
+                {
+                    // Handle certain special exception cases
+                    case NativeErrorCodes.NATIVE_ERROR_OPEN_FAILED when errnoSymbolic == Errno.EACCES:
+                        throw new UnauthorizedAccessException($"Could not open directory \"{rootPath}\".", nativeException);
+                    case NativeErrorCodes.NATIVE_ERROR_OPEN_FAILED when errnoSymbolic == Errno.ENOENT || errnoSymbolic == Errno.ENOTDIR:
+                        throw new DirectoryNotFoundException($"Could not open directory \"{rootPath}\".", nativeException);
+
+                    // Unhandled case, just throw generic exception directly
+                    default:
+                        throw nativeException;
+                }
+            }
+            return ReadScanRecords(scanner);
+        }
+
+        /// <inheritdoc />
+        /// <exception cref="UnauthorizedAccessException">Thrown when trying to open the root directory without having sufficient access permissions.</exception>
+        /// <exception cref="DirectoryNotFoundException">Thrown when the root directory or parts of its path cannot be found.</exception>
+        /// <exception cref="OperationCanceledException">Thrown when <paramref name="errorHandler"/> canceled the operation.</exception>
+        /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions. This exception is also always included as the <see cref="Exception.InnerException"/>.</exception>
+        public NativeRecursiveApplyStatistics ApplyPermissionsRecursive(string rootPath, CompiledPermissionsHandle filePermissions, CompiledPermissionsHandle directoryPermissions, CompiledPermissionsHandle directoryDefaultPermissions, int threadCount, Func<string, NativeException, bool> errorHandler)
+        {
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
+
+            // The handler runs on native worker threads, where exceptions must not escape; they cancel the operation and are rethrown here
+            ExceptionDispatchInfo handlerException = null;
+            RecursiveApplyErrorCallback errorCallback = null;
+            if(errorHandler != null)
+            {
+                errorCallback = (path, status, errno, userData) =>
+                {
+                    try
+                    {
+                        return errorHandler(Marshal.PtrToStringUTF8(path), NativeException.FromErrno(nameof(ApplyPermissionsRecursiveCtx), status, errno)) ? 0 : 1;
+                    }
+                    catch(Exception ex)
                     {
-                        // Handle certain special exception cases
-                        case NativeErrorCodes.NATIVE_ERROR_OPEN_FAILED when errnoSymbolic == Errno.EACCES:
-                            throw new UnauthorizedAccessException($"Could not open \"{fileName}\" for reading.", nativeException);
-                        case NativeErrorCodes.NATIVE_ERROR_OPEN_FAILED when errnoSymbolic == Errno.ENOENT:
-                            throw new FileNotFoundException($"Could not open \"{fileName}\" for reading.", nativeException);
+                        handlerException = ExceptionDispatchInfo.Capture(ex);
+                        return 1;
+                    }
+                };
+            }
+
+            // Missing permissions are passed as invalid handles, which the native side receives as NULL
+            NativeErrorCodes err = ApplyPermissionsRecursiveCtx(context, rootPath, filePermissions ?? NoCompiledPermissions, directoryPermissions ?? NoCompiledPermissions, directoryDefaultPermissions ?? NoCompiledPermissions,
+                threadCount, errorCallback, IntPtr.Zero, out var statistics);
+            GC.KeepAlive(errorCallback);
+            handlerException?.Throw();
+            if(err != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+            {
+                // Throw suitable exceptions
+                var nativeException = RetrieveErrnoAndBuildException(context, nameof(ApplyPermissionsRecursiveCtx), err, out var _, out var errnoSymbolic);
+                switch(err)
+                {
+                    // Handle certain special exception cases
+                    case NativeErrorCodes.NATIVE_ERROR_OPEN_FAILED when errnoSymbolic == Errno.EACCES:
+                        throw new UnauthorizedAccessException($"Could not open directory \"{rootPath}\".", nativeException);
+                    case NativeErrorCodes.NATIVE_ERROR_OPEN_FAILED when errnoSymbolic == Errno.ENOENT || errnoSymbolic == Errno.ENOTDIR:
+                        throw new DirectoryNotFoundException($"Could not open directory \"{rootPath}\".", nativeException);
+                    case NativeErrorCodes.NATIVE_ERROR_CANCELED:
+                        throw new OperationCanceledException($"Applying permissions to \"{rootPath}\" was canceled.", nativeException);
+
+                    // Unhandled case, just throw generic exception directly
+                    default:
+                        throw nativeException;
+                }
+            }
+            return statistics;
+        }
+
+        /// <inheritdoc />
+        /// <exception cref="KeyNotFoundException">Thrown when the user does not exist.</exception>
+        /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions. This exception is also always included as the <see cref="Exception.InnerException"/>.</exception>
+        public int[] GetUserGroups(int userId)
+        {
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
+
+            // Most users are members of only a few groups; retry with the reported size otherwise
+            var groupIds = new int[InitialGroupBufferLength];
+            while(true)
+            {
+                NativeErrorCodes err = GetUserGroupsCtx(context, userId, groupIds, groupIds.Length, out int groupCount);
+                if(err == NativeErrorCodes.NATIVE_ERROR_BUFFER_TOO_SMALL)
+                {
+                    groupIds = new int[groupCount];
+                    continue;
+                }
+                if(err != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+                {
+                    // Throw suitable exceptions
+                    var nativeException = RetrieveErrnoAndBuildException(context, nameof(GetUserGroupsCtx), err, out var _, out var _);
+                    if(err == NativeErrorCodes.NATIVE_ERROR_USER_NOT_FOUND && nativeException.Errno == 0)
+                        throw new KeyNotFoundException($"The user {userId} does not exist.", nativeException);
+                    throw nativeException;
+                }
+
+                if(groupCount < groupIds.Length)
+                    Array.Resize(ref groupIds, groupCount);
+                return groupIds;
+            }
+        }
+
+        /// <inheritdoc />
+        /// <exception cref="KeyNotFoundException">Thrown when the user does not exist.</exception>
+        /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions. This exception is also always included as the <see cref="Exception.InnerException"/>.</exception>
+        public string GetUserName(int userId)
+        {
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
+
+            var name = new byte[InitialNameBufferLength];
+            while(true)
+            {
+                NativeErrorCodes err = GetUserNameCtx(context, userId, name, name.Length, out int requiredLength);
+                if(err == NativeErrorCodes.NATIVE_ERROR_BUFFER_TOO_SMALL)
+                {
+                    name = new byte[requiredLength];
+                    continue;
+                }
+                if(err != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+                    throw BuildLookupException(context, nameof(GetUserNameCtx), err, $"The user {userId} does not exist.");
+
+                return Encoding.UTF8.GetString(name, 0, requiredLength - 1);
+            }
+        }
+
+        /// <inheritdoc />
+        /// <exception cref="KeyNotFoundException">Thrown when the group does not exist.</exception>
+        /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions. This exception is also always included as the <see cref="Exception.InnerException"/>.</exception>
+        public string GetGroupName(int groupId)
+        {
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
+
+            var name = new byte[InitialNameBufferLength];
+            while(true)
+            {
+                NativeErrorCodes err = GetGroupNameCtx(context, groupId, name, name.Length, out int requiredLength);
+                if(err == NativeErrorCodes.NATIVE_ERROR_BUFFER_TOO_SMALL)
+                {
+                    name = new byte[requiredLength];
+                    continue;
+                }
+                if(err != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+                    throw BuildLookupException(context, nameof(GetGroupNameCtx), err, $"The group {groupId} does not exist.");
 
-                        case NativeErrorCodes.NATIVE_ERROR_CHOWN_FAILED when errnoSymbolic == Errno.EPERM:
-                            throw new UnauthorizedAccessException($"Permission denied when using fchown() on \"{fileName}\".", nativeException);
+                return Encoding.UTF8.GetString(name, 0, requiredLength - 1);
+            }
+        }
 
-                        case NativeErrorCodes.NATIVE_ERROR_CHMOD_FAILED when errnoSymbolic == Errno.EPERM:
-                            throw new UnauthorizedAccessException($"Permission denied when using fchmod() on \"{fileName}\".", nativeException);
+        /// <inheritdoc />
+        /// <exception cref="KeyNotFoundException">Thrown when the user does not exist.</exception>
+        /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions. This exception is also always included as the <see cref="Exception.InnerException"/>.</exception>
+        public int GetUserId(string userName)
+        {
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
 
-                        case NativeErrorCodes.NATIVE_ERROR_VALIDATE_ACL_FAILED when errnoSymbolic == Errno.EINVAL:
-                            throw new ArgumentException($"The given ACL is invalid.", nativeException);
+            NativeErrorCodes err = GetUserIdCtx(context, userName, out int userId);
+            if(err != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+                throw BuildLookupException(context, nameof(GetUserIdCtx), err, $"The user \"{userName}\" does not exist.");
+            return userId;
+        }
 
-                        case NativeErrorCodes.NATIVE_ERROR_SET_ACL_FAILED when errnoSymbolic == Errno.EINVAL:
-                            throw new ArgumentException($"Could not assign ACL to file \"{fileName}\" using acl_set_fd().", nativeException);
-                        case NativeErrorCodes.NATIVE_ERROR_SET_ACL_FAILED when errnoSymbolic == Errno.EPERM:
-                            throw new UnauthorizedAccessException($"Permission denied when assigning ACL using acl_set_fd() on \"{fileName}\".", nativeException);
+        /// <inheritdoc />
+        /// <exception cref="KeyNotFoundException">Thrown when the group does not exist.</exception>
+        /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions. This exception is also always included as the <see cref="Exception.InnerException"/>.</exception>
+        public int GetGroupId(string groupName)
+        {
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
+
+            NativeErrorCodes err = GetGroupIdCtx(context, groupName, out int groupId);
+            if(err != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+                throw BuildLookupException(context, nameof(GetGroupIdCtx), err, $"The group \"{groupName}\" does not exist.");
+            return groupId;
+        }
 
-                        // Unhandled case, just throw generic exception directly
-                        default:
-                            throw nativeException;
+        /// <inheritdoc />
+        /// <exception cref="NativeException">Thrown when the watcher could not be created, e.g. because fanotify is not supported or the process lacks the needed capabilities.</exception>
+        public FileWatcherHandle CreateFileWatcher(bool useFanotify)
+        {
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
+
+            NativeErrorCodes err = CreateFileWatcherCtx(context, useFanotify ? 1 : 0, out var watcher);
+            if(err != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+            {
+                watcher.Dispose();
+                throw RetrieveErrnoAndBuildException(context, nameof(CreateFileWatcherCtx), err, out var _, out var _);
+            }
+            return watcher;
+        }
+
+        /// <inheritdoc />
+        /// <exception cref="DirectoryNotFoundException">Thrown when the directory or parts of its path cannot be found.</exception>
+        /// <exception cref="NativeException">Generic exception thrown when a native method fails, and the error was not covered by one of the other possible exceptions, e.g. when the inotify watch limit is reached. This exception is also always included as the <see cref="Exception.InnerException"/>.</exception>
+        public int AddFileWatch(FileWatcherHandle watcher, string path)
+        {
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
+
+            NativeErrorCodes err = AddFileWatchCtx(context, watcher, path, out int watchDescriptor);
+            if(err != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+            {
+                var nativeException = RetrieveErrnoAndBuildException(context, nameof(AddFileWatchCtx), err, out var _, out var errnoSymbolic);
+                if(errnoSymbolic == Errno.ENOENT || errnoSymbolic == Errno.ENOTDIR)
+                    throw new DirectoryNotFoundException($"Could not watch directory \"{path}\".", nativeException);
+                throw nativeException;
+            }
+            return watchDescriptor;
+        }
+
+        /// <inheritdoc />
+        /// <exception cref="NativeException">Thrown when the watch descriptor is invalid.</exception>
+        public void RemoveFileWatch(FileWatcherHandle watcher, int watchDescriptor)
+        {
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
+
+            NativeErrorCodes err = RemoveFileWatchCtx(context, watcher, watchDescriptor);
+            if(err != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+                throw RetrieveErrnoAndBuildException(context, nameof(RemoveFileWatchCtx), err, out var _, out var _);
+        }
+
+        /// <inheritdoc />
+        /// <exception cref="NativeException">Thrown when reading the events failed, or the name buffer is too small for the next event.</exception>
+        public int ReadFileWatchEvents(FileWatcherHandle watcher, NativeWatchEvent[] events, byte[] names)
+        {
+            // Each thread has its own native context, so no locking is needed
+            var context = GetThreadContext();
+
+            NativeErrorCodes err = ReadFileWatchEventsCtx(context, watcher, events, events.Length, names, names.Length, out int eventCount);
+            if(err == NativeErrorCodes.NATIVE_ERROR_CANCELED)
+                return 0;
+            if(err != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+                throw RetrieveErrnoAndBuildException(context, nameof(ReadFileWatchEventsCtx), err, out var _, out var _);
+            return eventCount;
+        }
+
+        /// <inheritdoc />
+        public void CancelFileWatcher(FileWatcherHandle watcher)
+            => CancelFileWatcherNative(watcher);
+
+        /// <summary>
+        /// Builds the exception for a failed user or group lookup. Missing entries are reported as <see cref="KeyNotFoundException"/>.
+        /// </summary>
+        /// <param name="context">The context holding the errno value.</param>
+        /// <param name="functionName">The name of the failed native function.</param>
+        /// <param name="err">The returned error code.</param>
+        /// <param name="notFoundMessage">The message for a missing entry.</param>
+        private Exception BuildLookupException(NativeContextHandle context, string functionName, NativeErrorCodes err, string notFoundMessage)
+        {
+            var nativeException = RetrieveErrnoAndBuildException(context, functionName, err, out var _, out var _);
+            if((err == NativeErrorCodes.NATIVE_ERROR_USER_NOT_FOUND || err == NativeErrorCodes.NATIVE_ERROR_GROUP_NOT_FOUND) && nativeException.Errno == 0)
+                return new KeyNotFoundException(notFoundMessage, nativeException);
+            return nativeException;
+        }
+
+        /// <summary>
+        /// Reads the records of the given scan chunk by chunk, and releases the scanner when done.
+        /// </summary>
+        /// <param name="scanner">The scanner.</param>
+        private IEnumerable<PermissionScanRecord> ReadScanRecords(TreeScannerHandle scanner)
+        {
+            var buffer = ArrayPool<byte>.Shared.Rent(ScanBufferLength);
+            try
+            {
+                while(true)
+                {
+                    // The enumeration may be continued on a different thread, so the context is retrieved for each chunk
+                    var context = GetThreadContext();
+                    NativeErrorCodes err = ReadTreeScannerRecordsCtx(context, scanner, buffer, buffer.Length, out int bytesWritten, out int recordCount);
+                    if(err == NativeErrorCodes.NATIVE_ERROR_BUFFER_TOO_SMALL)
+                    {
+                        // A single record did not fit, retry with the required size
+                        ArrayPool<byte>.Shared.Return(buffer);
+                        buffer = null;
+                        buffer = ArrayPool<byte>.Shared.Rent(bytesWritten);
+                        continue;
+                    }
+
+                    // A directory which cannot be enumerated is reported after the records preceding it
+                    NativeException directoryException = null;
+                    if(err != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+                    {
+                        directoryException = RetrieveErrnoAndBuildException(context, nameof(ReadTreeScannerRecordsCtx), err, out var _, out var _);
+                        if(err != NativeErrorCodes.NATIVE_ERROR_READ_DIRECTORY_FAILED)
+                            throw directoryException;
+                    }
+                    else if(recordCount == 0)
+                        yield break;
+
+                    // Parse records
+                    int offset = 0;
+                    for(int i = 0; i < recordCount; ++i)
+                    {
+                        var record = new PermissionScanRecord(new ReadOnlySpan<byte>(buffer, offset, bytesWritten - offset), out int recordLength);
+                        offset += recordLength;
+                        yield return record;
                     }
+
+                    if(directoryException != null)
+                        throw directoryException;
                 }
             }
+            finally
+            {
+                if(buffer != null)
+                    ArrayPool<byte>.Shared.Return(buffer);
+                scanner.Dispose();
+            }
         }
     }
 
     /// <summary>
     /// Container object to pass permission data between C# and native code, to avoid a large amount of function parameters.
     /// </summary>
-    [StructLayout(LayoutKind.Sequential, Pack = 4)]
+    /// <remarks>
+    /// The native fields are 4 bytes each, so explicit offsets are needed: a sequential layout would pack the adjacent <see cref="FilePermissions"/> bytes together.
+    /// </remarks>
+    [StructLayout(LayoutKind.Explicit, Size = 6 * 4)]
     public struct NativePermissionDataContainer
     {
         /// <summary>
         /// The UID of the object's owner.
         /// </summary>
+        [FieldOffset(0 * 4)]
         public int OwnerId;
 
         /// <summary>
         /// The permissions of the object's owner.
         /// </summary>
+        [FieldOffset(1 * 4)]
         public FilePermissions OwnerPermissions;
 
         /// <summary>
         /// The GID of the object's associated group.
         /// </summary>
+        [FieldOffset(2 * 4)]
         public int GroupId;
 
         /// <summary>
         /// The permissions of the object's associated group.
         /// </summary>
+        [FieldOffset(3 * 4)]
         public FilePermissions GroupPermissions;
 
         /// <summary>
         /// The permissions of "others".
         /// </summary>
+        [FieldOffset(4 * 4)]
         public FilePermissions OtherPermissions;
 
         /// <summary>
         /// The size of the file's associated ACL.
         /// </summary>
+        [FieldOffset(5 * 4)]
         public int AclSize;
     }
 }
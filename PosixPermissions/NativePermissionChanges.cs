@@ -0,0 +1,41 @@
+﻿using System;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Parts of a file's permissions that were modified by a write.
+    /// </summary>
+    [Flags]
+    public enum NativePermissionChanges : int
+    {
+        /// <summary>
+        /// Nothing was modified.
+        /// </summary>
+        None = 0,
+
+        /// <summary>
+        /// The owner was changed.
+        /// </summary>
+        Owner = 1,
+
+        /// <summary>
+        /// The group was changed.
+        /// </summary>
+        Group = 2,
+
+        /// <summary>
+        /// The permission bits were changed.
+        /// </summary>
+        Mode = 4,
+
+        /// <summary>
+        /// The access ACL was written.
+        /// </summary>
+        AccessAcl = 8,
+
+        /// <summary>
+        /// The default ACL was written or removed.
+        /// </summary>
+        DefaultAcl = 16
+    }
+}
@@ -0,0 +1,41 @@
+﻿using System.Runtime.InteropServices;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Counters of a recursive apply.
+    /// </summary>
+    [StructLayout(LayoutKind.Explicit, Size = 10 * 4)]
+    public struct NativeRecursiveApplyStatistics
+    {
+        /// <summary>
+        /// Number of directories that were processed, including the root directory.
+        /// </summary>
+        [FieldOffset(0 * 8)]
+        public long DirectoryCount;
+
+        /// <summary>
+        /// Number of other files that were processed.
+        /// </summary>
+        [FieldOffset(1 * 8)]
+        public long FileCount;
+
+        /// <summary>
+        /// Number of processed files and directories whose permissions were modified.
+        /// </summary>
+        [FieldOffset(2 * 8)]
+        public long ChangedCount;
+
+        /// <summary>
+        /// Number of symbolic links, which are neither followed nor modified.
+        /// </summary>
+        [FieldOffset(3 * 8)]
+        public long SkippedCount;
+
+        /// <summary>
+        /// Number of failures reported to the error handler.
+        /// </summary>
+        [FieldOffset(4 * 8)]
+        public long FailedCount;
+    }
+}
@@ -0,0 +1,35 @@
+﻿using System.Runtime.InteropServices;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// An event reported by a file watcher.
+    /// </summary>
+    [StructLayout(LayoutKind.Explicit, Size = 4 * 4)]
+    public struct NativeWatchEvent
+    {
+        /// <summary>
+        /// The watch descriptor of the directory containing the file, as returned by <see cref="INativeLibraryInterface.AddFileWatch"/>. -1 for overflow events and for fanotify watchers.
+        /// </summary>
+        [FieldOffset(0 * 4)]
+        public int WatchDescriptor;
+
+        /// <summary>
+        /// The kind of change.
+        /// </summary>
+        [FieldOffset(1 * 4)]
+        public NativeWatchEventFlags Flags;
+
+        /// <summary>
+        /// Links the two events of a rename with inotify, or 0.
+        /// </summary>
+        [FieldOffset(2 * 4)]
+        public uint Cookie;
+
+        /// <summary>
+        /// Offset of the null-terminated UTF-8 name in the name buffer, or -1 if the event concerns the watched directory itself. For fanotify watchers, this is the absolute path of the file.
+        /// </summary>
+        [FieldOffset(3 * 4)]
+        public int NameOffset;
+    }
+}
@@ -0,0 +1,51 @@
+﻿using System;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Kinds of changes reported by a file watcher.
+    /// </summary>
+    [Flags]
+    public enum NativeWatchEventFlags : uint
+    {
+        /// <summary>
+        /// No change.
+        /// </summary>
+        None = 0,
+
+        /// <summary>
+        /// Owner, group, permission bits, ACLs or other metadata of the file changed.
+        /// </summary>
+        Attributes = 1,
+
+        /// <summary>
+        /// The file was created, or moved to this name.
+        /// </summary>
+        Created = 2,
+
+        /// <summary>
+        /// The file was deleted, or moved away from this name.
+        /// </summary>
+        Deleted = 4,
+
+        /// <summary>
+        /// The file was moved. Combined with <see cref="Created"/> or <see cref="Deleted"/>.
+        /// </summary>
+        Moved = 8,
+
+        /// <summary>
+        /// The file is a directory.
+        /// </summary>
+        Directory = 16,
+
+        /// <summary>
+        /// The inotify watch was removed, because the directory was deleted, its file system was unmounted or the watch was removed explicitly.
+        /// </summary>
+        WatchRemoved = 32,
+
+        /// <summary>
+        /// Events were lost, because the event queue overflowed or an event could not be resolved to a path. All watched files must be revalidated.
+        /// </summary>
+        Overflow = 64
+    }
+}
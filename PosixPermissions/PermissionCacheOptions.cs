@@ -0,0 +1,25 @@
+﻿using System;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Configures a <see cref="CachingPosixPermissionsProvider"/>.
+    /// </summary>
+    public class PermissionCacheOptions
+    {
+        /// <summary>
+        /// The maximum number of cached entries. Each entry holds the permissions of one file, or of one ACL of a directory. Default is 100000.
+        /// </summary>
+        public int Capacity { get; set; } = 100000;
+
+        /// <summary>
+        /// Determines how cached entries are validated. Default is <see cref="PermissionCacheValidation.ChangeTime"/>.
+        /// </summary>
+        public PermissionCacheValidation Validation { get; set; } = PermissionCacheValidation.ChangeTime;
+
+        /// <summary>
+        /// Specifies how long entries are used when <see cref="Validation"/> is <see cref="PermissionCacheValidation.TimeToLive"/>. Default is 10 seconds.
+        /// </summary>
+        public TimeSpan TimeToLive { get; set; } = TimeSpan.FromSeconds(10);
+    }
+}
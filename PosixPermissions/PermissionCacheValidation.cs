@@ -0,0 +1,26 @@
+﻿namespace PosixPermissions
+{
+    /// <summary>
+    /// Determines how <see cref="CachingPosixPermissionsProvider"/> checks whether cached permissions are still up to date.
+    /// </summary>
+    public enum PermissionCacheValidation
+    {
+        /// <summary>
+        /// Entries are keyed by device and inode number, and each access compares the change time of the file with the cached one.
+        /// This needs a single statx() call per access, but never returns outdated permissions, as long as the file system updates the change time with sufficient resolution.
+        /// </summary>
+        ChangeTime = 0,
+
+        /// <summary>
+        /// Entries are keyed by path and are used without any file system access until <see cref="PermissionCacheOptions.TimeToLive"/> has passed.
+        /// Changes made during that time are not noticed, and paths which are replaced by other files return the permissions of the old ones.
+        /// </summary>
+        TimeToLive = 1,
+
+        /// <summary>
+        /// Entries are keyed by path and are used without any file system access until they are removed by <see cref="CachingPosixPermissionsProvider.Invalidate"/>, usually called by a <see cref="PermissionChangeWatcher"/>.
+        /// Changes are noticed with the small delay of the change notifications. Paths must not contain symbolic links, since the notifications are reported for the link targets.
+        /// </summary>
+        Invalidation = 2
+    }
+}
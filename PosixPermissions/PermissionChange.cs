@@ -0,0 +1,67 @@
+﻿namespace PosixPermissions
+{
+    /// <summary>
+    /// Describes one permission change between two snapshots, as reported by <see cref="PermissionSnapshotDiff.Compare(PermissionSnapshot, PermissionSnapshot)"/>.
+    /// </summary>
+    public class PermissionChange
+    {
+        /// <summary>
+        /// The type of the change.
+        /// </summary>
+        public PermissionChangeTypes Type { get; }
+
+        /// <summary>
+        /// The path of the file relative to the scanned root directory. For removed files this is the old path, else the new one.
+        /// </summary>
+        public string Path { get; }
+
+        /// <summary>
+        /// The index of the file in the old snapshot, or -1 for added files.
+        /// </summary>
+        public int OldIndex { get; }
+
+        /// <summary>
+        /// The index of the file in the new snapshot, or -1 for removed files.
+        /// </summary>
+        public int NewIndex { get; }
+
+        /// <summary>
+        /// For ACL entry changes, determines whether the entry belongs to the default ACL instead of the access ACL.
+        /// </summary>
+        public bool IsDefaultAcl { get; }
+
+        /// <summary>
+        /// For removed and modified ACL entries, the old entry.
+        /// </summary>
+        public AccessControlListEntry OldEntry { get; }
+
+        /// <summary>
+        /// For added and modified ACL entries, the new entry.
+        /// </summary>
+        public AccessControlListEntry NewEntry { get; }
+
+        /// <summary>
+        /// Creates a new change description.
+        /// </summary>
+        /// <param name="type">The type of the change.</param>
+        /// <param name="path">The path of the file.</param>
+        /// <param name="oldIndex">The index of the file in the old snapshot, or -1.</param>
+        /// <param name="newIndex">The index of the file in the new snapshot, or -1.</param>
+        /// <param name="isDefaultAcl">Determines whether a changed ACL entry belongs to the default ACL.</param>
+        /// <param name="oldEntry">The old ACL entry.</param>
+        /// <param name="newEntry">The new ACL entry.</param>
+        internal PermissionChange(PermissionChangeTypes type, string path, int oldIndex, int newIndex, bool isDefaultAcl = false, AccessControlListEntry oldEntry = default, AccessControlListEntry newEntry = default)
+        {
+            Type = type;
+            Path = path;
+            OldIndex = oldIndex;
+            NewIndex = newIndex;
+            IsDefaultAcl = isDefaultAcl;
+            OldEntry = oldEntry;
+            NewEntry = newEntry;
+        }
+
+        /// <inheritdoc />
+        public override string ToString() => $"{Type} {Path}";
+    }
+}
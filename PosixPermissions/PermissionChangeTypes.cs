@@ -0,0 +1,53 @@
+﻿namespace PosixPermissions
+{
+    /// <summary>
+    /// Types of permission changes between two snapshots.
+    /// </summary>
+    public enum PermissionChangeTypes : int
+    {
+        /// <summary>
+        /// The file only exists in the new snapshot.
+        /// </summary>
+        Added = 1,
+
+        /// <summary>
+        /// The file only exists in the old snapshot.
+        /// </summary>
+        Removed = 2,
+
+        /// <summary>
+        /// The file was renamed or moved to another directory. This is also reported when an inode was reused for a new file.
+        /// </summary>
+        Moved = 3,
+
+        /// <summary>
+        /// The file type or mode bits have changed.
+        /// </summary>
+        ModeChanged = 4,
+
+        /// <summary>
+        /// The owner has changed.
+        /// </summary>
+        OwnerChanged = 5,
+
+        /// <summary>
+        /// The group has changed.
+        /// </summary>
+        GroupChanged = 6,
+
+        /// <summary>
+        /// An ACL entry was added.
+        /// </summary>
+        AclEntryAdded = 7,
+
+        /// <summary>
+        /// An ACL entry was removed.
+        /// </summary>
+        AclEntryRemoved = 8,
+
+        /// <summary>
+        /// The permissions of an ACL entry have changed.
+        /// </summary>
+        AclEntryModified = 9
+    }
+}
@@ -0,0 +1,356 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+using System.Threading;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Watches directory trees with inotify or fanotify and removes the cached permissions of changed files from a <see cref="CachingPosixPermissionsProvider"/>.
+    /// </summary>
+    /// <remarks>
+    /// The cache must use <see cref="PermissionCacheValidation.Invalidation"/> or <see cref="PermissionCacheValidation.TimeToLive"/> validation. Changes become visible after the notification has been processed, which usually takes less than a millisecond.
+    /// If the kernel drops notifications, the entire cache is cleared.
+    /// inotify watchers need one watch per directory, which is limited by /proc/sys/fs/inotify/max_user_watches. fanotify watchers mark whole file systems and need CAP_SYS_ADMIN.
+    /// Watched paths must not contain symbolic links.
+    /// </remarks>
+    public sealed class PermissionChangeWatcher : IDisposable
+    {
+        /// <summary>
+        /// Number of events read at once.
+        /// </summary>
+        private const int EventBufferLength = 256;
+
+        /// <summary>
+        /// Size of the buffer receiving the file names of the events.
+        /// </summary>
+        private const int NameBufferSize = 64 * 1024;
+
+        /// <summary>
+        /// Native library interface.
+        /// </summary>
+        private readonly INativeLibraryInterface _nativeLibraryInterface;
+
+        /// <summary>
+        /// The cache being invalidated.
+        /// </summary>
+        private readonly CachingPosixPermissionsProvider _cache;
+
+        /// <summary>
+        /// Specifies whether fanotify is used instead of inotify.
+        /// </summary>
+        private readonly bool _useFanotify;
+
+        /// <summary>
+        /// Called with exceptions that stopped the watcher. May be null.
+        /// </summary>
+        private readonly Action<Exception> _errorHandler;
+
+        /// <summary>
+        /// The native watcher.
+        /// </summary>
+        private readonly FileWatcherHandle _watcher;
+
+        /// <summary>
+        /// The thread reading the events.
+        /// </summary>
+        private readonly Thread _thread;
+
+        /// <summary>
+        /// Protects <see cref="_roots"/>, <see cref="_watchPaths"/> and <see cref="_pathWatches"/>.
+        /// </summary>
+        private readonly object _watchLock = new object();
+
+        /// <summary>
+        /// The watched directory trees.
+        /// </summary>
+        private readonly List<string> _roots = new List<string>();
+
+        /// <summary>
+        /// Maps inotify watch descriptors to the paths of the watched directories.
+        /// </summary>
+        private readonly Dictionary<int, string> _watchPaths = new Dictionary<int, string>();
+
+        /// <summary>
+        /// Maps the paths of the watched directories to their inotify watch descriptors.
+        /// </summary>
+        private readonly Dictionary<string, int> _pathWatches = new Dictionary<string, int>(StringComparer.Ordinal);
+
+        /// <summary>
+        /// Number of times the kernel dropped events, so the whole cache had to be cleared.
+        /// </summary>
+        private long _overflowCount;
+
+        /// <summary>
+        /// Specifies whether this object has been disposed.
+        /// </summary>
+        private bool _disposed;
+
+        /// <summary>
+        /// Number of times the kernel dropped events, so the whole cache had to be cleared.
+        /// </summary>
+        public long OverflowCount => Interlocked.Read(ref _overflowCount);
+
+        /// <summary>
+        /// Creates a new watcher for the given cache, and starts processing events in the background.
+        /// </summary>
+        /// <param name="nativeLibraryInterface">Native library interface.</param>
+        /// <param name="cache">The cache being invalidated.</param>
+        /// <param name="useFanotify">Specifies whether to use fanotify instead of inotify. fanotify needs CAP_SYS_ADMIN, but does not need a watch for every directory.</param>
+        /// <param name="errorHandler">Called on the background thread with an exception that stopped the watcher. The cache is cleared and not invalidated anymore afterwards.</param>
+        public PermissionChangeWatcher(INativeLibraryInterface nativeLibraryInterface, CachingPosixPermissionsProvider cache, bool useFanotify, Action<Exception> errorHandler = null)
+        {
+            if(cache.Validation == PermissionCacheValidation.ChangeTime)
+                throw new ArgumentException("Caches validated by change time do not support invalidation by path.", nameof(cache));
+
+            _nativeLibraryInterface = nativeLibraryInterface;
+            _cache = cache;
+            _useFanotify = useFanotify;
+            _errorHandler = errorHandler;
+            _watcher = nativeLibraryInterface.CreateFileWatcher(useFanotify);
+
+            _thread = new Thread(ProcessEvents)
+            {
+                IsBackground = true,
+                Name = nameof(PermissionChangeWatcher)
+            };
+            _thread.Start();
+        }
+
+        /// <summary>
+        /// Starts watching the given directory and all directories below it. The cached permissions of the tree are removed, as they may have changed before the watch was added.
+        /// </summary>
+        /// <param name="directory">The directory to watch.</param>
+        public void Watch(DirectoryInfo directory)
+            => Watch(directory.FullName);
+
+        /// <summary>
+        /// Starts watching the given directory and all directories below it. The cached permissions of the tree are removed, as they may have changed before the watch was added.
+        /// </summary>
+        /// <param name="fullPath">Full path to the directory.</param>
+        internal void Watch(string fullPath)
+        {
+            if(fullPath.Length > 1)
+                fullPath = fullPath.TrimEnd('/');
+
+            lock(_watchLock)
+            {
+                if(_disposed)
+                    throw new ObjectDisposedException(nameof(PermissionChangeWatcher));
+
+                if(_useFanotify)
+                    _nativeLibraryInterface.AddFileWatch(_watcher, fullPath);
+                else
+                    AddWatchesRecursively(fullPath);
+                _roots.Add(fullPath);
+            }
+            _cache.InvalidateTree(fullPath);
+        }
+
+        /// <summary>
+        /// Adds inotify watches for the given directory and all directories below it. Directories which vanish in the meantime are skipped. Must be called while holding <see cref="_watchLock"/>.
+        /// </summary>
+        /// <param name="fullPath">Full path to the directory.</param>
+        private void AddWatchesRecursively(string fullPath)
+        {
+            var pendingDirectories = new Stack<string>();
+            pendingDirectories.Push(fullPath);
+            while(pendingDirectories.Count > 0)
+            {
+                string path = pendingDirectories.Pop();
+                try
+                {
+                    // Add the watch before listing the subdirectories, so new subdirectories are not missed
+                    int watchDescriptor = _nativeLibraryInterface.AddFileWatch(_watcher, path);
+
+                    // A directory which was renamed keeps its watch descriptor
+                    if(_watchPaths.TryGetValue(watchDescriptor, out var oldPath))
+                        _pathWatches.Remove(oldPath);
+                    _watchPaths[watchDescriptor] = path;
+                    _pathWatches[path] = watchDescriptor;
+
+                    foreach(var subDirectory in Directory.EnumerateDirectories(path))
+                    {
+                        if(!new FileInfo(subDirectory).Attributes.HasFlag(FileAttributes.ReparsePoint))
+                            pendingDirectories.Push(subDirectory);
+                    }
+                }
+                catch(DirectoryNotFoundException) when(path != fullPath)
+                {
+                }
+            }
+        }
+
+        /// <summary>
+        /// Forgets the inotify watches of the given directory and all directories below it. Must be called while holding <see cref="_watchLock"/>.
+        /// The kernel removes the watches of deleted directories by itself.
+        /// </summary>
+        /// <param name="fullPath">Full path to the directory.</param>
+        private void ForgetWatchesRecursively(string fullPath)
+        {
+            var removedPaths = new List<string>();
+            foreach(var path in _pathWatches.Keys)
+            {
+                if(IsInTree(path, fullPath))
+                    removedPaths.Add(path);
+            }
+            foreach(var path in removedPaths)
+            {
+                _watchPaths.Remove(_pathWatches[path]);
+                _pathWatches.Remove(path);
+            }
+        }
+
+        /// <summary>
+        /// Returns whether the given path equals the given root path or lies below it.
+        /// </summary>
+        /// <param name="path">The path to check.</param>
+        /// <param name="rootPath">The root path, without trailing slash.</param>
+        private static bool IsInTree(string path, string rootPath)
+        {
+            if(rootPath == "/")
+                return path.StartsWith("/", StringComparison.Ordinal);
+            return path.StartsWith(rootPath, StringComparison.Ordinal) && (path.Length == rootPath.Length || path[rootPath.Length] == '/');
+        }
+
+        /// <summary>
+        /// Reads and processes events until the watcher is canceled.
+        /// </summary>
+        private void ProcessEvents()
+        {
+            var events = new NativeWatchEvent[EventBufferLength];
+            var names = new byte[NameBufferSize];
+            try
+            {
+                while(true)
+                {
+                    int eventCount = _nativeLibraryInterface.ReadFileWatchEvents(_watcher, events, names);
+                    if(eventCount == 0)
+                        return;
+
+                    for(int i = 0; i < eventCount; ++i)
+                        ProcessEvent(in events[i], names);
+                }
+            }
+            catch(Exception ex)
+            {
+                // We do not know what we missed
+                _cache.Clear();
+                _errorHandler?.Invoke(ex);
+            }
+        }
+
+        /// <summary>
+        /// Removes the cache entries affected by the given event.
+        /// </summary>
+        /// <param name="watchEvent">The event.</param>
+        /// <param name="names">The name buffer of the event.</param>
+        private void ProcessEvent(in NativeWatchEvent watchEvent, byte[] names)
+        {
+            var flags = watchEvent.Flags;
+            if(flags.HasFlag(NativeWatchEventFlags.Overflow))
+            {
+                HandleOverflow();
+                return;
+            }
+
+            // Build path
+            string name = watchEvent.NameOffset < 0 ? null : ReadName(names, watchEvent.NameOffset);
+            string path;
+            lock(_watchLock)
+            {
+                if(_useFanotify)
+                {
+                    path = name;
+                    if(path == null || !_roots.Exists(r => IsInTree(path, r)))
+                        return;
+                }
+                else
+                {
+                    if(!_watchPaths.TryGetValue(watchEvent.WatchDescriptor, out var directoryPath))
+                        return;
+                    if(flags.HasFlag(NativeWatchEventFlags.WatchRemoved))
+                    {
+                        _watchPaths.Remove(watchEvent.WatchDescriptor);
+                        if(_pathWatches.TryGetValue(directoryPath, out var watchDescriptor) && watchDescriptor == watchEvent.WatchDescriptor)
+                            _pathWatches.Remove(directoryPath);
+                        return;
+                    }
+                    path = name == null ? directoryPath : (directoryPath == "/" ? "/" + name : directoryPath + "/" + name);
+                }
+
+                if(!_useFanotify && flags.HasFlag(NativeWatchEventFlags.Directory))
+                {
+                    // Keep watches in sync with the directory tree
+                    if(flags.HasFlag(NativeWatchEventFlags.Deleted))
+                        ForgetWatchesRecursively(path);
+                    if(flags.HasFlag(NativeWatchEventFlags.Created) && name != null)
+                        AddWatchesRecursively(path);
+                }
+            }
+
+            // A moved, created or deleted directory changes the paths of the entire subtree
+            if(flags.HasFlag(NativeWatchEventFlags.Directory) && (flags & (NativeWatchEventFlags.Created | NativeWatchEventFlags.Deleted | NativeWatchEventFlags.Moved)) != 0)
+                _cache.InvalidateTree(path);
+            else
+                _cache.Invalidate(path);
+        }
+
+        /// <summary>
+        /// Clears the cache after the kernel dropped events. inotify watches of directories created in the meantime are added.
+        /// </summary>
+        private void HandleOverflow()
+        {
+            Interlocked.Increment(ref _overflowCount);
+            _cache.Clear();
+            if(_useFanotify)
+                return;
+
+            lock(_watchLock)
+            {
+                foreach(var root in _roots)
+                {
+                    try
+                    {
+                        AddWatchesRecursively(root);
+                    }
+                    catch(DirectoryNotFoundException)
+                    {
+                    }
+                }
+            }
+
+            // Permissions may have been cached while the watches were added
+            _cache.Clear();
+        }
+
+        /// <summary>
+        /// Decodes the null-terminated UTF-8 name at the given offset.
+        /// </summary>
+        /// <param name="names">The name buffer.</param>
+        /// <param name="offset">The offset of the name.</param>
+        private static string ReadName(byte[] names, int offset)
+        {
+            int length = Array.IndexOf(names, (byte)0, offset) - offset;
+            return Encoding.UTF8.GetString(names, offset, length);
+        }
+
+        /// <summary>
+        /// Stops processing events and closes the native watcher. The cache keeps its current entries.
+        /// </summary>
+        public void Dispose()
+        {
+            lock(_watchLock)
+            {
+                if(_disposed)
+                    return;
+                _disposed = true;
+            }
+
+            _nativeLibraryInterface.CancelFileWatcher(_watcher);
+            _thread.Join();
+            _watcher.Dispose();
+        }
+    }
+}
@@ -0,0 +1,96 @@
+﻿using System;
+using System.Collections.Generic;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Holds the permission data of several files or directories, which were read in a single native call.
+    /// </summary>
+    public class PermissionDataBatch
+    {
+        /// <summary>
+        /// The results of the individual items, in the order of the requested names.
+        /// </summary>
+        public NativeBatchReadResult[] Results { get; }
+
+        /// <summary>
+        /// The ACL entries of all items. The entries of an item start at <see cref="NativeBatchReadResult.EntriesOffset"/>.
+        /// </summary>
+        public AccessControlListEntry[] Entries { get; }
+
+        /// <summary>
+        /// Creates a new batch from the given native results.
+        /// </summary>
+        /// <param name="results">The results of the individual items.</param>
+        /// <param name="entries">The ACL entries of all items.</param>
+        internal PermissionDataBatch(NativeBatchReadResult[] results, AccessControlListEntry[] entries)
+        {
+            Results = results;
+            Entries = entries;
+        }
+
+        /// <summary>
+        /// Combines the given batches into one, in the given order.
+        /// </summary>
+        /// <param name="batches">The batches to combine.</param>
+        internal static PermissionDataBatch Concat(IReadOnlyList<PermissionDataBatch> batches)
+        {
+            int resultCount = 0;
+            int entryCount = 0;
+            foreach(var batch in batches)
+            {
+                resultCount += batch.Results.Length;
+                entryCount += batch.Entries.Length;
+            }
+
+            // Copy results and entries, and shift the entry offsets accordingly
+            var results = new NativeBatchReadResult[resultCount];
+            var entries = new AccessControlListEntry[entryCount];
+            int resultPosition = 0;
+            int entryPosition = 0;
+            foreach(var batch in batches)
+            {
+                for(int i = 0; i < batch.Results.Length; ++i)
+                {
+                    results[resultPosition + i] = batch.Results[i];
+                    results[resultPosition + i].EntriesOffset += entryPosition;
+                }
+                batch.Entries.CopyTo(entries, entryPosition);
+                resultPosition += batch.Results.Length;
+                entryPosition += batch.Entries.Length;
+            }
+            return new PermissionDataBatch(results, entries);
+        }
+
+        /// <summary>
+        /// Returns whether the given item was read successfully.
+        /// </summary>
+        /// <param name="index">The index of the item.</param>
+        public bool IsSuccess(int index)
+            => Results[index].Status == NativeErrorCodes.NATIVE_ERROR_SUCCESS;
+
+        /// <summary>
+        /// Returns the ACL entries of the given item. The span is empty for failed items.
+        /// </summary>
+        /// <param name="index">The index of the item.</param>
+        public ReadOnlySpan<AccessControlListEntry> GetEntries(int index)
+        {
+            ref var result = ref Results[index];
+            if(result.Status != NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+                return ReadOnlySpan<AccessControlListEntry>.Empty;
+            return new ReadOnlySpan<AccessControlListEntry>(Entries, result.EntriesOffset, result.DataContainer.AclSize);
+        }
+
+        /// <summary>
+        /// Creates a <see cref="NativeException"/> describing the failure of the given item, or returns null if it was read successfully.
+        /// </summary>
+        /// <param name="index">The index of the item.</param>
+        public NativeException GetException(int index)
+        {
+            ref var result = ref Results[index];
+            if(result.Status == NativeErrorCodes.NATIVE_ERROR_SUCCESS)
+                return null;
+            return NativeException.FromErrno("ReadPermissionDataBatchCtx", result.Status, result.Errno);
+        }
+    }
+}
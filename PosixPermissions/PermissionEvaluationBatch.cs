@@ -0,0 +1,249 @@
+﻿using System;
+using System.Buffers;
+using System.Collections.Generic;
+using System.Numerics;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Holds many ACLs in a layout that allows checking the permissions of one principal against all of them at once.
+    /// The owner, owning group and other entries of all ACLs are stored in columns, which are compared with SIMD instructions. ACLs with named user or group entries are evaluated separately.
+    /// </summary>
+    public class PermissionEvaluationBatch
+    {
+        /// <summary>
+        /// UIDs of the file owners.
+        /// </summary>
+        private readonly int[] _ownerIds;
+
+        /// <summary>
+        /// GIDs of the file groups.
+        /// </summary>
+        private readonly int[] _groupIds;
+
+        /// <summary>
+        /// Permissions of the owners.
+        /// </summary>
+        private readonly int[] _ownerPermissions;
+
+        /// <summary>
+        /// Permissions of the owning groups, limited by the masks.
+        /// </summary>
+        private readonly int[] _groupPermissions;
+
+        /// <summary>
+        /// Permissions of others.
+        /// </summary>
+        private readonly int[] _otherPermissions;
+
+        /// <summary>
+        /// Indices of the ACLs with named user or group entries.
+        /// </summary>
+        private readonly List<int> _namedEntryIndices = new List<int>();
+
+        /// <summary>
+        /// The entries of the ACLs in <see cref="_namedEntryIndices"/>.
+        /// </summary>
+        private readonly List<AccessControlListEntry[]> _namedEntryAcls = new List<AccessControlListEntry[]>();
+
+        /// <summary>
+        /// The number of ACLs.
+        /// </summary>
+        public int Count { get; }
+
+        /// <summary>
+        /// Creates a new batch with the given number of ACLs.
+        /// </summary>
+        /// <param name="count">The number of ACLs.</param>
+        private PermissionEvaluationBatch(int count)
+        {
+            Count = count;
+            _ownerIds = new int[count];
+            _groupIds = new int[count];
+            _ownerPermissions = new int[count];
+            _groupPermissions = new int[count];
+            _otherPermissions = new int[count];
+        }
+
+        /// <summary>
+        /// Creates a new batch from the ACLs of the given batch read. Items which could not be read do not grant any permissions.
+        /// </summary>
+        /// <param name="batch">The read permission data.</param>
+        public PermissionEvaluationBatch(PermissionDataBatch batch)
+            : this(batch.Results.Length)
+        {
+            for(int i = 0; i < Count; ++i)
+            {
+                ref var dataContainer = ref batch.Results[i].DataContainer;
+                Set(i, dataContainer.OwnerId, dataContainer.GroupId, batch.GetEntries(i));
+            }
+        }
+
+        /// <summary>
+        /// Creates a new batch from the access ACLs of the given scan records. Records which could not be read do not grant any permissions.
+        /// </summary>
+        /// <param name="records">The scan records.</param>
+        public PermissionEvaluationBatch(IReadOnlyList<PermissionScanRecord> records)
+            : this(records.Count)
+        {
+            for(int i = 0; i < Count; ++i)
+            {
+                var record = records[i];
+                Set(i, record.OwnerId, record.GroupId, record.Status == NativeErrorCodes.NATIVE_ERROR_SUCCESS ? record.AccessAcl : Array.Empty<AccessControlListEntry>());
+            }
+        }
+
+        /// <summary>
+        /// Stores the given ACL at the given index.
+        /// </summary>
+        /// <param name="index">The index of the ACL.</param>
+        /// <param name="ownerId">The UID of the file's owner.</param>
+        /// <param name="groupId">The GID of the file's group.</param>
+        /// <param name="entries">The access ACL.</param>
+        private void Set(int index, int ownerId, int groupId, ReadOnlySpan<AccessControlListEntry> entries)
+        {
+            FilePermissions groupPermissions = FilePermissions.None;
+            FilePermissions mask = PermissionEvaluator.ReadWriteExecute;
+            bool hasNamedEntries = false;
+            foreach(var entry in entries)
+            {
+                switch(entry.TagType)
+                {
+                    case AccessControlListEntryTagTypes.UserObj:
+                        _ownerPermissions[index] = (int)(entry.Permissions & PermissionEvaluator.ReadWriteExecute);
+                        break;
+
+                    case AccessControlListEntryTagTypes.GroupObj:
+                        groupPermissions = entry.Permissions;
+                        break;
+
+                    case AccessControlListEntryTagTypes.Mask:
+                        mask = entry.Permissions;
+                        break;
+
+                    case AccessControlListEntryTagTypes.Other:
+                        _otherPermissions[index] = (int)(entry.Permissions & PermissionEvaluator.ReadWriteExecute);
+                        break;
+
+                    default:
+                        hasNamedEntries = true;
+                        break;
+                }
+            }
+            _ownerIds[index] = ownerId;
+            _groupIds[index] = groupId;
+            _groupPermissions[index] = (int)(groupPermissions & mask & PermissionEvaluator.ReadWriteExecute);
+
+            if(hasNamedEntries)
+            {
+                _namedEntryIndices.Add(index);
+                _namedEntryAcls.Add(entries.ToArray());
+            }
+        }
+
+        /// <summary>
+        /// Computes the permissions the given principal has through each ACL, as described in <see cref="PermissionEvaluator.Evaluate"/>.
+        /// </summary>
+        /// <param name="principal">The principal accessing the files.</param>
+        /// <param name="results">Receives the permissions for each ACL. Must hold at least <see cref="Count"/> elements.</param>
+        public void Evaluate(AccessPrincipal principal, Span<FilePermissions> results)
+        {
+            if(results.Length < Count)
+                throw new ArgumentException("The result buffer is too small.", nameof(results));
+
+            var permissions = ArrayPool<int>.Shared.Rent(Count);
+            try
+            {
+                EvaluateWithoutNamedEntries(principal, permissions);
+                for(int i = 0; i < Count; ++i)
+                    results[i] = (FilePermissions)permissions[i];
+            }
+            finally
+            {
+                ArrayPool<int>.Shared.Return(permissions);
+            }
+
+            for(int i = 0; i < _namedEntryIndices.Count; ++i)
+            {
+                int index = _namedEntryIndices[i];
+                results[index] = PermissionEvaluator.Evaluate(_namedEntryAcls[i], _ownerIds[index], _groupIds[index], principal);
+            }
+        }
+
+        /// <summary>
+        /// Checks for each ACL whether the given principal is granted all requested permissions, as described in <see cref="PermissionEvaluator.CheckAccess"/>.
+        /// </summary>
+        /// <param name="principal">The principal accessing the files.</param>
+        /// <param name="requestedPermissions">The requested permissions.</param>
+        /// <param name="results">Receives the results for each ACL. Must hold at least <see cref="Count"/> elements.</param>
+        public void CheckAccess(AccessPrincipal principal, FilePermissions requestedPermissions, Span<bool> results)
+        {
+            if(results.Length < Count)
+                throw new ArgumentException("The result buffer is too small.", nameof(results));
+
+            requestedPermissions &= PermissionEvaluator.ReadWriteExecute;
+            int requested = (int)requestedPermissions;
+            var permissions = ArrayPool<int>.Shared.Rent(Count);
+            try
+            {
+                EvaluateWithoutNamedEntries(principal, permissions);
+                for(int i = 0; i < Count; ++i)
+                    results[i] = (permissions[i] & requested) == requested;
+            }
+            finally
+            {
+                ArrayPool<int>.Shared.Return(permissions);
+            }
+
+            for(int i = 0; i < _namedEntryIndices.Count; ++i)
+            {
+                int index = _namedEntryIndices[i];
+                results[index] = PermissionEvaluator.CheckAccess(_namedEntryAcls[i], _ownerIds[index], _groupIds[index], principal, requestedPermissions);
+            }
+        }
+
+        /// <summary>
+        /// Computes the permissions of the given principal, only taking into account the owner, owning group and other entries of each ACL.
+        /// </summary>
+        /// <param name="principal">The principal accessing the files.</param>
+        /// <param name="results">Receives the permissions for each ACL.</param>
+        private void EvaluateWithoutNamedEntries(AccessPrincipal principal, int[] results)
+        {
+            int i = 0;
+            var groupIds = principal.GroupIds;
+            if(Vector.IsHardwareAccelerated && Count >= Vector<int>.Count)
+            {
+                // The group vectors are the same for all iterations
+                var userIdVector = new Vector<int>(principal.UserId);
+                var groupIdVectors = new Vector<int>[groupIds.Length];
+                for(int g = 0; g < groupIds.Length; ++g)
+                    groupIdVectors[g] = new Vector<int>(groupIds[g]);
+
+                for(; i <= Count - Vector<int>.Count; i += Vector<int>.Count)
+                {
+                    var groupIdsVector = new Vector<int>(_groupIds, i);
+                    var isGroupMember = Vector<int>.Zero;
+                    foreach(var groupIdVector in groupIdVectors)
+                        isGroupMember |= Vector.Equals(groupIdsVector, groupIdVector);
+
+                    var isOwner = Vector.Equals(new Vector<int>(_ownerIds, i), userIdVector);
+                    var result = Vector.ConditionalSelect(isOwner,
+                        new Vector<int>(_ownerPermissions, i),
+                        Vector.ConditionalSelect(isGroupMember, new Vector<int>(_groupPermissions, i), new Vector<int>(_otherPermissions, i)));
+                    result.CopyTo(results, i);
+                }
+            }
+
+            // Remaining ACLs
+            for(; i < Count; ++i)
+            {
+                if(_ownerIds[i] == principal.UserId)
+                    results[i] = _ownerPermissions[i];
+                else if(principal.IsMemberOf(_groupIds[i]))
+                    results[i] = _groupPermissions[i];
+                else
+                    results[i] = _otherPermissions[i];
+            }
+        }
+    }
+}
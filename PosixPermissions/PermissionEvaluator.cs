@@ -0,0 +1,191 @@
+﻿using System;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Evaluates ACLs for a given principal, like the kernel does when checking access to a file.
+    /// </summary>
+    /// <remarks>
+    /// Only the ACL is taken into account: capabilities (e.g. of root), read-only mounts and other security modules are not.
+    /// </remarks>
+    public static class PermissionEvaluator
+    {
+        /// <summary>
+        /// Read, write and execute permissions.
+        /// </summary>
+        internal const FilePermissions ReadWriteExecute = FilePermissions.Read | FilePermissions.Write | FilePermissions.Execute;
+
+        /// <summary>
+        /// Returns the permissions the given principal has through the given ACL.
+        /// If the principal matches several group entries, the union of their permissions is returned; note that the kernel only grants an access if a single one of these entries allows all requested permissions (see <see cref="CheckAccess"/>).
+        /// </summary>
+        /// <param name="entries">The access ACL of the file, as returned by <see cref="INativeLibraryInterface.GetPermissionData(string, int, out NativePermissionDataContainer)"/>.</param>
+        /// <param name="ownerId">The UID of the file's owner.</param>
+        /// <param name="groupId">The GID of the file's group.</param>
+        /// <param name="principal">The principal accessing the file.</param>
+        public static FilePermissions Evaluate(ReadOnlySpan<AccessControlListEntry> entries, int ownerId, int groupId, AccessPrincipal principal)
+            => Evaluate(entries, principal.UserId == ownerId, principal.IsMemberOf(groupId), principal);
+
+        /// <summary>
+        /// Returns the permissions the given principal has through the given ACL, when its relation to the file's owner and group is already known.
+        /// </summary>
+        /// <param name="entries">The access ACL of the file.</param>
+        /// <param name="isOwner">Specifies whether the principal owns the file.</param>
+        /// <param name="isGroupMember">Specifies whether the principal is a member of the file's group.</param>
+        /// <param name="principal">The principal accessing the file.</param>
+        internal static FilePermissions Evaluate(ReadOnlySpan<AccessControlListEntry> entries, bool isOwner, bool isGroupMember, AccessPrincipal principal)
+        {
+            FilePermissions ownerPermissions = FilePermissions.None;
+            FilePermissions namedUserPermissions = FilePermissions.None;
+            FilePermissions groupPermissions = FilePermissions.None;
+            FilePermissions otherPermissions = FilePermissions.None;
+            FilePermissions mask = ReadWriteExecute;
+            bool namedUserFound = false;
+            bool groupFound = false;
+            foreach(var entry in entries)
+            {
+                switch(entry.TagType)
+                {
+                    case AccessControlListEntryTagTypes.UserObj:
+                        ownerPermissions = entry.Permissions;
+                        break;
+
+                    case AccessControlListEntryTagTypes.User:
+                        if(entry.TagQualifier == principal.UserId)
+                        {
+                            namedUserFound = true;
+                            namedUserPermissions = entry.Permissions;
+                        }
+                        break;
+
+                    case AccessControlListEntryTagTypes.GroupObj:
+                        if(isGroupMember)
+                        {
+                            groupFound = true;
+                            groupPermissions |= entry.Permissions;
+                        }
+                        break;
+
+                    case AccessControlListEntryTagTypes.Group:
+                        if(principal.IsMemberOf(entry.TagQualifier))
+                        {
+                            groupFound = true;
+                            groupPermissions |= entry.Permissions;
+                        }
+                        break;
+
+                    case AccessControlListEntryTagTypes.Mask:
+                        mask = entry.Permissions;
+                        break;
+
+                    case AccessControlListEntryTagTypes.Other:
+                        otherPermissions = entry.Permissions;
+                        break;
+                }
+            }
+
+            // The kernel only looks at the ACL if the group permission bits, i.e. the mask, are not empty. Otherwise, named entries are ignored.
+            if((mask & ReadWriteExecute) == FilePermissions.None)
+            {
+                namedUserFound = false;
+                groupFound = isGroupMember;
+            }
+
+            // The first matching class decides; the mask limits everything but the owner and others
+            if(isOwner)
+                return ownerPermissions & ReadWriteExecute;
+            if(namedUserFound)
+                return namedUserPermissions & mask & ReadWriteExecute;
+            if(groupFound)
+                return groupPermissions & mask & ReadWriteExecute;
+            return otherPermissions & ReadWriteExecute;
+        }
+
+        /// <summary>
+        /// Returns whether the given principal is granted all requested permissions by the given ACL.
+        /// </summary>
+        /// <param name="entries">The access ACL of the file, as returned by <see cref="INativeLibraryInterface.GetPermissionData(string, int, out NativePermissionDataContainer)"/>.</param>
+        /// <param name="ownerId">The UID of the file's owner.</param>
+        /// <param name="groupId">The GID of the file's group.</param>
+        /// <param name="principal">The principal accessing the file.</param>
+        /// <param name="requestedPermissions">The requested permissions.</param>
+        public static bool CheckAccess(ReadOnlySpan<AccessControlListEntry> entries, int ownerId, int groupId, AccessPrincipal principal, FilePermissions requestedPermissions)
+            => CheckAccess(entries, principal.UserId == ownerId, principal.IsMemberOf(groupId), principal, requestedPermissions);
+
+        /// <summary>
+        /// Returns whether the given principal is granted all requested permissions by the given ACL, when its relation to the file's owner and group is already known.
+        /// </summary>
+        /// <param name="entries">The access ACL of the file.</param>
+        /// <param name="isOwner">Specifies whether the principal owns the file.</param>
+        /// <param name="isGroupMember">Specifies whether the principal is a member of the file's group.</param>
+        /// <param name="principal">The principal accessing the file.</param>
+        /// <param name="requestedPermissions">The requested permissions.</param>
+        internal static bool CheckAccess(ReadOnlySpan<AccessControlListEntry> entries, bool isOwner, bool isGroupMember, AccessPrincipal principal, FilePermissions requestedPermissions)
+        {
+            requestedPermissions &= ReadWriteExecute;
+
+            // The union of the group entries is only relevant if several entries match, so only this case needs special handling
+            if(isOwner)
+                return (Evaluate(entries, true, isGroupMember, principal) & requestedPermissions) == requestedPermissions;
+
+            FilePermissions mask = ReadWriteExecute;
+            bool namedUserFound = false;
+            bool namedUserGranted = false;
+            bool groupFound = false;
+            bool groupGranted = false;
+            bool otherGranted = false;
+            foreach(var entry in entries)
+            {
+                bool granted = (entry.Permissions & requestedPermissions) == requestedPermissions;
+                switch(entry.TagType)
+                {
+                    case AccessControlListEntryTagTypes.User:
+                        if(entry.TagQualifier == principal.UserId)
+                        {
+                            namedUserFound = true;
+                            namedUserGranted = granted;
+                        }
+                        break;
+
+                    case AccessControlListEntryTagTypes.GroupObj:
+                        if(isGroupMember)
+                        {
+                            groupFound = true;
+                            groupGranted |= granted;
+                        }
+                        break;
+
+                    case AccessControlListEntryTagTypes.Group:
+                        if(principal.IsMemberOf(entry.TagQualifier))
+                        {
+                            groupFound = true;
+                            groupGranted |= granted;
+                        }
+                        break;
+
+                    case AccessControlListEntryTagTypes.Mask:
+                        mask = entry.Permissions;
+                        break;
+
+                    case AccessControlListEntryTagTypes.Other:
+                        otherGranted = granted;
+                        break;
+                }
+            }
+
+            // Named entries are ignored if the mask is empty, like in Evaluate()
+            if((mask & ReadWriteExecute) == FilePermissions.None)
+            {
+                namedUserFound = false;
+                groupFound = isGroupMember;
+            }
+
+            bool maskGranted = (mask & requestedPermissions) == requestedPermissions;
+            if(namedUserFound)
+                return namedUserGranted && maskGranted;
+            if(groupFound)
+                return groupGranted && maskGranted;
+            return otherGranted;
+        }
+    }
+}
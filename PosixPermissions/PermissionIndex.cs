@@ -0,0 +1,477 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Numerics;
+using System.Text;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Compact in-memory index over the results of a recursive scan, for fast queries over all scanned files.
+    /// The properties of the files are stored in columns, which are searched with SIMD instructions. Identical ACLs are only stored once and referenced by an ID.
+    /// </summary>
+    /// <remarks>
+    /// Files are identified by their position in the scan; the root directory has index 0. Each file takes about 44 bytes plus its UTF-8 encoded name.
+    /// </remarks>
+    public class PermissionIndex
+    {
+        /// <summary>
+        /// ACL ID of files without ACL.
+        /// </summary>
+        public const int NoAcl = -1;
+
+        /// <summary>
+        /// Initial capacity of the columns.
+        /// </summary>
+        private const int InitialCapacity = 1024;
+
+        /// <summary>
+        /// The number of files.
+        /// </summary>
+        private int _count;
+
+        /// <summary>
+        /// Devices containing the files.
+        /// </summary>
+        private ulong[] _devices = new ulong[InitialCapacity];
+
+        /// <summary>
+        /// Inode numbers.
+        /// </summary>
+        private ulong[] _inodes = new ulong[InitialCapacity];
+
+        /// <summary>
+        /// Indices of the parent directories. -1 for the root directory.
+        /// </summary>
+        private int[] _parents = new int[InitialCapacity];
+
+        /// <summary>
+        /// Offsets of the names in <see cref="_names"/>. The name of a file ends where the name of the next one begins, so this has one more element than there are files.
+        /// </summary>
+        private int[] _nameOffsets = new int[InitialCapacity + 1];
+
+        /// <summary>
+        /// UTF-8 encoded names of all files.
+        /// </summary>
+        private byte[] _names = new byte[16 * InitialCapacity];
+
+        /// <summary>
+        /// UIDs of the owners.
+        /// </summary>
+        private int[] _ownerIds = new int[InitialCapacity];
+
+        /// <summary>
+        /// GIDs of the groups.
+        /// </summary>
+        private int[] _groupIds = new int[InitialCapacity];
+
+        /// <summary>
+        /// File types and mode bits (st_mode).
+        /// </summary>
+        private uint[] _modes = new uint[InitialCapacity];
+
+        /// <summary>
+        /// IDs of the access ACLs.
+        /// </summary>
+        private int[] _accessAclIds = new int[InitialCapacity];
+
+        /// <summary>
+        /// IDs of the default ACLs.
+        /// </summary>
+        private int[] _defaultAclIds = new int[InitialCapacity];
+
+        /// <summary>
+        /// Entries of all distinct ACLs.
+        /// </summary>
+        private AccessControlListEntry[] _aclEntries;
+
+        /// <summary>
+        /// Offsets of the distinct ACLs in <see cref="_aclEntries"/>. Has one more element than there are ACLs.
+        /// </summary>
+        private int[] _aclOffsets;
+
+        /// <summary>
+        /// The number of files.
+        /// </summary>
+        public int Count => _count;
+
+        /// <summary>
+        /// The number of distinct ACLs.
+        /// </summary>
+        public int AclCount => _aclOffsets.Length - 1;
+
+        /// <summary>
+        /// Creates a new index from the given scan records, which must be in the order returned by <see cref="INativeLibraryInterface.ScanTree(string)"/>.
+        /// Files whose ACLs could not be read get <see cref="NoAcl"/> as ACL IDs.
+        /// </summary>
+        /// <param name="records">The scan records.</param>
+        public PermissionIndex(IEnumerable<PermissionScanRecord> records)
+        {
+            var aclIds = new Dictionary<AccessControlListEntry[], int>(new AclEqualityComparer());
+            var aclEntries = new List<AccessControlListEntry>();
+            var aclOffsets = new List<int> { 0 };
+
+            // Each directory is emitted before its contents, so the parent of a file is the last directory seen on the previous depth
+            var lastDirectoryAtDepth = new List<int>();
+            foreach(var record in records)
+            {
+                if(_count == _inodes.Length)
+                    Grow();
+
+                int index = _count++;
+                _devices[index] = record.Device;
+                _inodes[index] = record.Inode;
+                _parents[index] = record.Depth > 0 && record.Depth - 1 < lastDirectoryAtDepth.Count ? lastDirectoryAtDepth[record.Depth - 1] : -1;
+                _ownerIds[index] = record.OwnerId;
+                _groupIds[index] = record.GroupId;
+                _modes[index] = record.Mode;
+
+                // Store name
+                var name = record.RelativePath.Substring(record.RelativePath.LastIndexOf('/') + 1);
+                int nameLength = Encoding.UTF8.GetByteCount(name);
+                int nameOffset = _nameOffsets[index];
+                if(_names.Length - nameOffset < nameLength)
+                    Array.Resize(ref _names, Math.Max(2 * _names.Length, nameOffset + nameLength));
+                Encoding.UTF8.GetBytes(name, 0, name.Length, _names, nameOffset);
+                _nameOffsets[index + 1] = nameOffset + nameLength;
+
+                // Deduplicate ACLs
+                bool aclsValid = record.Status == NativeErrorCodes.NATIVE_ERROR_SUCCESS;
+                _accessAclIds[index] = aclsValid ? GetAclId(record.AccessAcl, aclIds, aclEntries, aclOffsets) : NoAcl;
+                _defaultAclIds[index] = aclsValid && record.DefaultAcl.Length > 0 ? GetAclId(record.DefaultAcl, aclIds, aclEntries, aclOffsets) : NoAcl;
+
+                if(record.IsDirectory)
+                {
+                    if(record.Depth < lastDirectoryAtDepth.Count)
+                        lastDirectoryAtDepth[record.Depth] = index;
+                    else
+                        lastDirectoryAtDepth.Add(index);
+                }
+            }
+
+            _aclEntries = aclEntries.ToArray();
+            _aclOffsets = aclOffsets.ToArray();
+
+            // Release unused capacity
+            Array.Resize(ref _devices, _count);
+            Array.Resize(ref _inodes, _count);
+            Array.Resize(ref _parents, _count);
+            Array.Resize(ref _nameOffsets, _count + 1);
+            Array.Resize(ref _names, _nameOffsets[_count]);
+            Array.Resize(ref _ownerIds, _count);
+            Array.Resize(ref _groupIds, _count);
+            Array.Resize(ref _modes, _count);
+            Array.Resize(ref _accessAclIds, _count);
+            Array.Resize(ref _defaultAclIds, _count);
+        }
+
+        /// <summary>
+        /// Doubles the capacity of the columns.
+        /// </summary>
+        private void Grow()
+        {
+            int capacity = 2 * _inodes.Length;
+            Array.Resize(ref _devices, capacity);
+            Array.Resize(ref _inodes, capacity);
+            Array.Resize(ref _parents, capacity);
+            Array.Resize(ref _nameOffsets, capacity + 1);
+            Array.Resize(ref _ownerIds, capacity);
+            Array.Resize(ref _groupIds, capacity);
+            Array.Resize(ref _modes, capacity);
+            Array.Resize(ref _accessAclIds, capacity);
+            Array.Resize(ref _defaultAclIds, capacity);
+        }
+
+        /// <summary>
+        /// Returns the ID of the given ACL, and stores it if it was not seen before.
+        /// </summary>
+        /// <param name="entries">The ACL entries.</param>
+        /// <param name="aclIds">IDs of the ACLs stored so far.</param>
+        /// <param name="aclEntries">Entries of the ACLs stored so far.</param>
+        /// <param name="aclOffsets">Offsets of the ACLs stored so far.</param>
+        private static int GetAclId(AccessControlListEntry[] entries, Dictionary<AccessControlListEntry[], int> aclIds, List<AccessControlListEntry> aclEntries, List<int> aclOffsets)
+        {
+            if(aclIds.TryGetValue(entries, out int id))
+                return id;
+
+            id = aclOffsets.Count - 1;
+            aclIds.Add(entries, id);
+            aclEntries.AddRange(entries);
+            aclOffsets.Add(aclEntries.Count);
+            return id;
+        }
+
+        /// <summary>
+        /// Returns the device containing the given file.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public ulong GetDevice(int index) => _devices[index];
+
+        /// <summary>
+        /// Returns the inode number of the given file.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public ulong GetInode(int index) => _inodes[index];
+
+        /// <summary>
+        /// Returns the index of the parent directory of the given file, or -1 for the root directory.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public int GetParent(int index) => _parents[index];
+
+        /// <summary>
+        /// Returns the UID of the owner of the given file.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public int GetOwnerId(int index) => _ownerIds[index];
+
+        /// <summary>
+        /// Returns the GID of the group of the given file.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public int GetGroupId(int index) => _groupIds[index];
+
+        /// <summary>
+        /// Returns the file type and mode bits (st_mode) of the given file.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public uint GetMode(int index) => _modes[index];
+
+        /// <summary>
+        /// Returns the ID of the access ACL of the given file, or <see cref="NoAcl"/>.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public int GetAccessAclId(int index) => _accessAclIds[index];
+
+        /// <summary>
+        /// Returns the ID of the default ACL of the given file, or <see cref="NoAcl"/>.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public int GetDefaultAclId(int index) => _defaultAclIds[index];
+
+        /// <summary>
+        /// Returns the entries of the given ACL. The span is empty for <see cref="NoAcl"/>.
+        /// </summary>
+        /// <param name="aclId">The ID of the ACL.</param>
+        public ReadOnlySpan<AccessControlListEntry> GetAcl(int aclId)
+        {
+            if(aclId == NoAcl)
+                return ReadOnlySpan<AccessControlListEntry>.Empty;
+            return new ReadOnlySpan<AccessControlListEntry>(_aclEntries, _aclOffsets[aclId], _aclOffsets[aclId + 1] - _aclOffsets[aclId]);
+        }
+
+        /// <summary>
+        /// Returns the name of the given file. The root directory has an empty name.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public string GetName(int index)
+            => Encoding.UTF8.GetString(_names, _nameOffsets[index], _nameOffsets[index + 1] - _nameOffsets[index]);
+
+        /// <summary>
+        /// Returns the UTF-8 encoded name of the given file.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        internal ReadOnlySpan<byte> GetNameBytes(int index)
+            => new ReadOnlySpan<byte>(_names, _nameOffsets[index], _nameOffsets[index + 1] - _nameOffsets[index]);
+
+        /// <summary>
+        /// Returns the path of the given file relative to the scanned root directory, like <see cref="PermissionScanRecord.RelativePath"/>.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public string GetPath(int index)
+        {
+            // Collect names up to the root directory, which is not part of the path
+            var names = new List<string>();
+            for(int i = index; i >= 0 && _parents[i] >= 0; i = _parents[i])
+                names.Add(GetName(i));
+            names.Reverse();
+            return string.Join("/", names);
+        }
+
+        /// <summary>
+        /// Returns the indices of all files owned by the given user.
+        /// </summary>
+        /// <param name="ownerId">The UID of the owner.</param>
+        public int[] FindByOwner(int ownerId)
+            => FindEqual(_ownerIds, ownerId);
+
+        /// <summary>
+        /// Returns the indices of all files belonging to the given group.
+        /// </summary>
+        /// <param name="groupId">The GID of the group.</param>
+        public int[] FindByGroup(int groupId)
+            => FindEqual(_groupIds, groupId);
+
+        /// <summary>
+        /// Returns the indices of all files using the given access ACL.
+        /// </summary>
+        /// <param name="aclId">The ID of the ACL.</param>
+        public int[] FindByAccessAcl(int aclId)
+            => FindEqual(_accessAclIds, aclId);
+
+        /// <summary>
+        /// Returns the indices of all files whose mode matches the given value in the bits selected by the given mask.
+        /// For example, mask and value 0x800 (04000) find all setuid files.
+        /// </summary>
+        /// <param name="mask">The mode bits to compare.</param>
+        /// <param name="value">The expected value of the selected bits.</param>
+        public int[] FindByMode(uint mask, uint value)
+        {
+            var matches = new List<int>();
+            int i = 0;
+            if(Vector.IsHardwareAccelerated)
+            {
+                var maskVector = new Vector<uint>(mask);
+                var valueVector = new Vector<uint>(value & mask);
+                for(; i <= _count - Vector<uint>.Count; i += Vector<uint>.Count)
+                {
+                    var equal = Vector.Equals(new Vector<uint>(_modes, i) & maskVector, valueVector);
+                    if(equal == Vector<uint>.Zero)
+                        continue;
+                    for(int j = 0; j < Vector<uint>.Count; ++j)
+                    {
+                        if(equal[j] != 0)
+                            matches.Add(i + j);
+                    }
+                }
+            }
+
+            // Remaining files
+            for(; i < _count; ++i)
+            {
+                if((_modes[i] & mask) == (value & mask))
+                    matches.Add(i);
+            }
+            return matches.ToArray();
+        }
+
+        /// <summary>
+        /// Returns the indices of all files where the given principal is granted the requested permissions, as described in <see cref="PermissionEvaluator.CheckAccess"/>.
+        /// Access to the directories on the path is not checked.
+        /// </summary>
+        /// <param name="principal">The principal accessing the files.</param>
+        /// <param name="requestedPermissions">The requested permissions.</param>
+        public int[] FindWithPermissions(AccessPrincipal principal, FilePermissions requestedPermissions)
+        {
+            // Whether a file grants the permissions only depends on its ACL and on whether the principal is its owner and a member of its group,
+            // so each distinct ACL is evaluated once for all four cases
+            var granted = new bool[4 * AclCount];
+            for(int aclId = 0; aclId < AclCount; ++aclId)
+            {
+                var acl = GetAcl(aclId);
+                for(int relation = 0; relation < 4; ++relation)
+                    granted[4 * aclId + relation] = PermissionEvaluator.CheckAccess(acl, (relation & 2) != 0, (relation & 1) != 0, principal, requestedPermissions);
+            }
+
+            var matches = new List<int>();
+            int i = 0;
+            var groupIds = principal.GroupIds;
+            if(Vector.IsHardwareAccelerated)
+            {
+                var userIdVector = new Vector<int>(principal.UserId);
+                var groupIdVectors = new Vector<int>[groupIds.Length];
+                for(int g = 0; g < groupIds.Length; ++g)
+                    groupIdVectors[g] = new Vector<int>(groupIds[g]);
+                var ownerBit = new Vector<int>(2);
+                var groupBit = new Vector<int>(1);
+
+                var relations = new int[Vector<int>.Count];
+                for(; i <= _count - Vector<int>.Count; i += Vector<int>.Count)
+                {
+                    var fileGroupIds = new Vector<int>(_groupIds, i);
+                    var isGroupMember = Vector<int>.Zero;
+                    foreach(var groupIdVector in groupIdVectors)
+                        isGroupMember |= Vector.Equals(fileGroupIds, groupIdVector);
+                    var isOwner = Vector.Equals(new Vector<int>(_ownerIds, i), userIdVector);
+                    ((isOwner & ownerBit) | (isGroupMember & groupBit)).CopyTo(relations);
+
+                    for(int j = 0; j < relations.Length; ++j)
+                    {
+                        int aclId = _accessAclIds[i + j];
+                        if(aclId != NoAcl && granted[4 * aclId + relations[j]])
+                            matches.Add(i + j);
+                    }
+                }
+            }
+
+            // Remaining files
+            for(; i < _count; ++i)
+            {
+                int aclId = _accessAclIds[i];
+                int relation = (_ownerIds[i] == principal.UserId ? 2 : 0) | (principal.IsMemberOf(_groupIds[i]) ? 1 : 0);
+                if(aclId != NoAcl && granted[4 * aclId + relation])
+                    matches.Add(i);
+            }
+            return matches.ToArray();
+        }
+
+        /// <summary>
+        /// Returns the indices of all files which have the given value in the given column.
+        /// </summary>
+        /// <param name="column">The column to search.</param>
+        /// <param name="value">The value to search.</param>
+        private int[] FindEqual(int[] column, int value)
+        {
+            var matches = new List<int>();
+            int i = 0;
+            if(Vector.IsHardwareAccelerated)
+            {
+                var valueVector = new Vector<int>(value);
+                for(; i <= _count - Vector<int>.Count; i += Vector<int>.Count)
+                {
+                    var equal = Vector.Equals(new Vector<int>(column, i), valueVector);
+                    if(equal == Vector<int>.Zero)
+                        continue;
+                    for(int j = 0; j < Vector<int>.Count; ++j)
+                    {
+                        if(equal[j] != 0)
+                            matches.Add(i + j);
+                    }
+                }
+            }
+
+            // Remaining files
+            for(; i < _count; ++i)
+            {
+                if(column[i] == value)
+                    matches.Add(i);
+            }
+            return matches.ToArray();
+        }
+
+        /// <summary>
+        /// Compares ACLs entry by entry.
+        /// </summary>
+        internal class AclEqualityComparer : IEqualityComparer<AccessControlListEntry[]>
+        {
+            /// <inheritdoc />
+            public bool Equals(AccessControlListEntry[] x, AccessControlListEntry[] y)
+                => AclEquals(x, y);
+
+            /// <summary>
+            /// Returns whether the given ACLs have the same entries in the same order.
+            /// </summary>
+            /// <param name="x">The first ACL.</param>
+            /// <param name="y">The second ACL.</param>
+            public static bool AclEquals(ReadOnlySpan<AccessControlListEntry> x, ReadOnlySpan<AccessControlListEntry> y)
+            {
+                if(x.Length != y.Length)
+                    return false;
+                for(int i = 0; i < x.Length; ++i)
+                {
+                    if(x[i].TagType != y[i].TagType || x[i].TagQualifier != y[i].TagQualifier || x[i].Permissions != y[i].Permissions)
+                        return false;
+                }
+                return true;
+            }
+
+            /// <inheritdoc />
+            public int GetHashCode(AccessControlListEntry[] obj)
+            {
+                int hash = obj.Length;
+                foreach(var entry in obj)
+                    hash = hash * 31 + (((int)entry.TagType << 24) ^ (entry.TagQualifier << 8) ^ (int)entry.Permissions);
+                return hash;
+            }
+        }
+    }
+}
@@ -0,0 +1,88 @@
+﻿using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Threading;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Progress and failures of a <see cref="PermissionSnapshotRestorer.Restore"/> operation. The counters are updated while the restore runs, so they can be polled from another thread.
+    /// </summary>
+    public class PermissionRestoreReport
+    {
+        /// <summary>
+        /// Backing field of <see cref="ProcessedCount"/>.
+        /// </summary>
+        private long _processedCount;
+
+        /// <summary>
+        /// Backing field of <see cref="ChangedCount"/>.
+        /// </summary>
+        private long _changedCount;
+
+        /// <summary>
+        /// Backing field of <see cref="SkippedCount"/>.
+        /// </summary>
+        private long _skippedCount;
+
+        /// <summary>
+        /// Backing field of <see cref="FailedCount"/>.
+        /// </summary>
+        private long _failedCount;
+
+        /// <summary>
+        /// Backing field of <see cref="Failures"/>.
+        /// </summary>
+        private readonly ConcurrentQueue<KeyValuePair<string, Exception>> _failures = new ConcurrentQueue<KeyValuePair<string, Exception>>();
+
+        /// <summary>
+        /// Number of files and directories whose permissions were compared with the snapshot.
+        /// </summary>
+        public long ProcessedCount => Interlocked.Read(ref _processedCount);
+
+        /// <summary>
+        /// Number of processed files and directories whose permissions differed from the snapshot and were restored.
+        /// </summary>
+        public long ChangedCount => Interlocked.Read(ref _changedCount);
+
+        /// <summary>
+        /// Number of symbolic links, and of files whose permissions could not be recorded in the snapshot. These are not modified.
+        /// </summary>
+        public long SkippedCount => Interlocked.Read(ref _skippedCount);
+
+        /// <summary>
+        /// Number of files and directories that could not be restored.
+        /// </summary>
+        public long FailedCount => Interlocked.Read(ref _failedCount);
+
+        /// <summary>
+        /// The paths relative to the restored directory and the errors of all failures. If a directory cannot be opened, only the directory is listed, but all of its entries are counted as failed.
+        /// </summary>
+        public IReadOnlyCollection<KeyValuePair<string, Exception>> Failures => _failures;
+
+        /// <summary>
+        /// Records processed files.
+        /// </summary>
+        /// <param name="processedCount">The number of compared files.</param>
+        /// <param name="changedCount">The number of restored files.</param>
+        /// <param name="skippedCount">The number of skipped files.</param>
+        internal void AddProcessed(int processedCount, int changedCount, int skippedCount)
+        {
+            Interlocked.Add(ref _processedCount, processedCount);
+            Interlocked.Add(ref _changedCount, changedCount);
+            Interlocked.Add(ref _skippedCount, skippedCount);
+        }
+
+        /// <summary>
+        /// Records a failure.
+        /// </summary>
+        /// <param name="path">The path of the failed file or directory.</param>
+        /// <param name="exception">The error.</param>
+        /// <param name="failedCount">The number of files that could not be restored because of this error.</param>
+        internal void AddFailure(string path, Exception exception, int failedCount = 1)
+        {
+            _failures.Enqueue(new KeyValuePair<string, Exception>(path, exception));
+            Interlocked.Add(ref _failedCount, failedCount);
+        }
+    }
+}
@@ -0,0 +1,155 @@
+﻿using System;
+using System.Runtime.InteropServices;
+using System.Text;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Permission data of one file or directory found by a recursive scan.
+    /// </summary>
+    public class PermissionScanRecord
+    {
+        /// <summary>
+        /// The path of the file relative to the scanned root directory. The root directory itself has an empty path.
+        /// </summary>
+        public string RelativePath { get; }
+
+        /// <summary>
+        /// The depth of the file below the scanned root directory, which itself has depth 0.
+        /// </summary>
+        public int Depth { get; }
+
+        /// <summary>
+        /// The device containing the file.
+        /// </summary>
+        public ulong Device { get; }
+
+        /// <summary>
+        /// The inode number of the file.
+        /// </summary>
+        public ulong Inode { get; }
+
+        /// <summary>
+        /// The UID of the file's owner.
+        /// </summary>
+        public int OwnerId { get; }
+
+        /// <summary>
+        /// The GID of the file's associated group.
+        /// </summary>
+        public int GroupId { get; }
+
+        /// <summary>
+        /// The file type and mode bits (st_mode).
+        /// </summary>
+        public uint Mode { get; }
+
+        /// <summary>
+        /// Returns whether the file is a directory.
+        /// </summary>
+        public bool IsDirectory => (Mode & 0xF000) == 0x4000;
+
+        /// <summary>
+        /// The entries of the access ACL. For files without extended ACL, this is the ACL equivalent to the mode bits.
+        /// </summary>
+        public AccessControlListEntry[] AccessAcl { get; }
+
+        /// <summary>
+        /// The entries of the default ACL. Always empty for files other than directories.
+        /// </summary>
+        public AccessControlListEntry[] DefaultAcl { get; }
+
+        /// <summary>
+        /// Result of reading the file. Unless this is <see cref="NativeErrorCodes.NATIVE_ERROR_FSTAT_FAILED"/>, the owner, group and mode are valid; the ACLs are only valid on success.
+        /// </summary>
+        public NativeErrorCodes Status { get; }
+
+        /// <summary>
+        /// The errno value belonging to <see cref="Status"/>, or 0.
+        /// </summary>
+        public int Errno { get; }
+
+        /// <summary>
+        /// Native layout of the record header, followed by the ACL entries and the null-terminated path.
+        /// </summary>
+        [StructLayout(LayoutKind.Sequential)]
+        private struct NativeScanRecord
+        {
+            public uint RecordLength;
+            public NativeErrorCodes Status;
+            public int Errno;
+            public int Depth;
+            public ulong Device;
+            public ulong Inode;
+            public int OwnerId;
+            public int GroupId;
+            public uint Mode;
+            public int AccessAclSize;
+            public int DefaultAclSize;
+            public int PathLength;
+        }
+
+        /// <summary>
+        /// Size of the native record header.
+        /// </summary>
+        private static readonly int NativeScanRecordSize = Marshal.SizeOf<NativeScanRecord>();
+
+        /// <summary>
+        /// Creates a successfully read record with the given data.
+        /// </summary>
+        /// <param name="relativePath">The path of the file relative to the scanned root directory.</param>
+        /// <param name="depth">The depth of the file below the scanned root directory.</param>
+        /// <param name="device">The device containing the file.</param>
+        /// <param name="inode">The inode number of the file.</param>
+        /// <param name="ownerId">The UID of the file's owner.</param>
+        /// <param name="groupId">The GID of the file's associated group.</param>
+        /// <param name="mode">The file type and mode bits.</param>
+        /// <param name="accessAcl">The entries of the access ACL.</param>
+        /// <param name="defaultAcl">The entries of the default ACL.</param>
+        internal PermissionScanRecord(string relativePath, int depth, ulong device, ulong inode, int ownerId, int groupId, uint mode, AccessControlListEntry[] accessAcl, AccessControlListEntry[] defaultAcl)
+        {
+            RelativePath = relativePath;
+            Depth = depth;
+            Device = device;
+            Inode = inode;
+            OwnerId = ownerId;
+            GroupId = groupId;
+            Mode = mode;
+            AccessAcl = accessAcl;
+            DefaultAcl = defaultAcl;
+            Status = NativeErrorCodes.NATIVE_ERROR_SUCCESS;
+        }
+
+        /// <summary>
+        /// Parses a native scan record.
+        /// </summary>
+        /// <param name="record">Buffer starting with the record.</param>
+        /// <param name="recordLength">Receives the total length of the record, including padding.</param>
+        internal PermissionScanRecord(ReadOnlySpan<byte> record, out int recordLength)
+        {
+            var header = MemoryMarshal.Read<NativeScanRecord>(record);
+            recordLength = (int)header.RecordLength;
+
+            Status = header.Status;
+            Errno = header.Errno;
+            Depth = header.Depth;
+            Device = header.Device;
+            Inode = header.Inode;
+            OwnerId = header.OwnerId;
+            GroupId = header.GroupId;
+            Mode = header.Mode;
+
+            // Copy ACLs and path
+            var entries = MemoryMarshal.Cast<byte, AccessControlListEntry>(record.Slice(NativeScanRecordSize, (header.AccessAclSize + header.DefaultAclSize) * Marshal.SizeOf<AccessControlListEntry>()));
+            AccessAcl = entries.Slice(0, header.AccessAclSize).ToArray();
+            DefaultAcl = entries.Slice(header.AccessAclSize).ToArray();
+            RelativePath = Encoding.UTF8.GetString(record.Slice(NativeScanRecordSize + entries.Length * Marshal.SizeOf<AccessControlListEntry>(), header.PathLength));
+        }
+
+        /// <summary>
+        /// Creates a <see cref="NativeException"/> describing why the file could not be read completely, or returns null if it was read successfully.
+        /// </summary>
+        public NativeException GetException()
+            => Status == NativeErrorCodes.NATIVE_ERROR_SUCCESS ? null : NativeException.FromErrno("ReadTreeScannerRecordsCtx", Status, Errno);
+    }
+}
@@ -0,0 +1,421 @@
+﻿using System;
+using System.IO;
+using System.IO.MemoryMappedFiles;
+using System.Text;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Provides read access to a permission snapshot file, which stores the contents of a <see cref="PermissionIndex"/>.
+    /// The file is mapped into memory; opening validates the header and the references of all records, and records are decoded on access.
+    /// </summary>
+    /// <remarks>
+    /// File layout (version 1, all values little-endian):
+    /// <list type="bullet">
+    /// <item>Header of <see cref="HeaderSize"/> bytes: magic, version, counts and the offsets of the following sections.</item>
+    /// <item>File records of <see cref="RecordSize"/> bytes each: inode, device (8 each), parent index, name offset, name length, owner, group, mode, access ACL ID, default ACL ID (4 each).</item>
+    /// <item>Inode order table: the record indices (4 bytes each), sorted by device and inode number, and by record index for hard links.</item>
+    /// <item>String table with the UTF-8 encoded names of all files.</item>
+    /// <item>ACL offset table: for each distinct ACL the index of its first entry (4 bytes), followed by the total entry count.</item>
+    /// <item>ACL entry table: tag type, qualifier and permissions (4 bytes each) of all entries.</item>
+    /// </list>
+    /// </remarks>
+    public sealed class PermissionSnapshot : IDisposable
+    {
+        /// <summary>
+        /// Magic number at the beginning of each snapshot file ("PPSNAP" followed by two zero bytes).
+        /// </summary>
+        private const ulong Magic = 0x0000_5041_4E53_5050;
+
+        /// <summary>
+        /// The current format version.
+        /// </summary>
+        private const int Version = 1;
+
+        /// <summary>
+        /// Size of the file header.
+        /// </summary>
+        private const int HeaderSize = 64;
+
+        /// <summary>
+        /// Size of a file record.
+        /// </summary>
+        private const int RecordSize = 48;
+
+        /// <summary>
+        /// Size of an ACL entry.
+        /// </summary>
+        private const int AclEntrySize = 12;
+
+        /// <summary>
+        /// The memory mapping of the snapshot file.
+        /// </summary>
+        private readonly MemoryMappedFile _file;
+
+        /// <summary>
+        /// Accessor for the whole file.
+        /// </summary>
+        private readonly MemoryMappedViewAccessor _accessor;
+
+        /// <summary>
+        /// Offset of the first file record.
+        /// </summary>
+        private readonly long _recordsOffset;
+
+        /// <summary>
+        /// Offset of the inode order table.
+        /// </summary>
+        private readonly long _inodeOrderOffset;
+
+        /// <summary>
+        /// Offset of the string table.
+        /// </summary>
+        private readonly long _namesOffset;
+
+        /// <summary>
+        /// Offset of the ACL offset table.
+        /// </summary>
+        private readonly long _aclOffsetsOffset;
+
+        /// <summary>
+        /// Offset of the ACL entry table.
+        /// </summary>
+        private readonly long _aclEntriesOffset;
+
+        /// <summary>
+        /// The number of files.
+        /// </summary>
+        public int Count { get; }
+
+        /// <summary>
+        /// The number of distinct ACLs.
+        /// </summary>
+        public int AclCount { get; }
+
+        /// <summary>
+        /// Maps the given snapshot file and validates its header and records.
+        /// </summary>
+        /// <param name="path">Path to the snapshot file.</param>
+        /// <exception cref="InvalidDataException">Thrown when the file is not a valid snapshot, or was written with an unsupported version.</exception>
+        public PermissionSnapshot(string path)
+        {
+            long fileLength = new FileInfo(path).Length;
+            if(fileLength < HeaderSize)
+                throw new InvalidDataException("The file is too short to be a permission snapshot.");
+
+            _file = MemoryMappedFile.CreateFromFile(path, FileMode.Open, null, 0, MemoryMappedFileAccess.Read);
+            try
+            {
+                _accessor = _file.CreateViewAccessor(0, 0, MemoryMappedFileAccess.Read);
+
+                // Check header
+                if(_accessor.ReadUInt64(0) != Magic)
+                    throw new InvalidDataException("The file is not a permission snapshot.");
+                int version = _accessor.ReadInt32(8);
+                if(version != Version)
+                    throw new InvalidDataException($"Unsupported permission snapshot version {version}.");
+                Count = _accessor.ReadInt32(12);
+                AclCount = _accessor.ReadInt32(16);
+                int aclEntryCount = _accessor.ReadInt32(20);
+                _recordsOffset = _accessor.ReadInt64(24);
+                _namesOffset = _accessor.ReadInt64(32);
+                _aclOffsetsOffset = _accessor.ReadInt64(40);
+                _aclEntriesOffset = _accessor.ReadInt64(48);
+                _inodeOrderOffset = _accessor.ReadInt64(56);
+
+                // All sections must lie within the file
+                if(Count < 0 || AclCount < 0 || aclEntryCount < 0
+                   || _recordsOffset < HeaderSize || _recordsOffset + (long)Count * RecordSize > _inodeOrderOffset
+                   || _inodeOrderOffset + 4L * Count > _namesOffset
+                   || _namesOffset > _aclOffsetsOffset
+                   || _aclOffsetsOffset + 4L * (AclCount + 1) > _aclEntriesOffset
+                   || _aclEntriesOffset + (long)aclEntryCount * AclEntrySize > fileLength)
+                    throw new InvalidDataException("The permission snapshot is truncated or corrupt.");
+
+                ValidateRecords(aclEntryCount);
+            }
+            catch
+            {
+                Dispose();
+                throw;
+            }
+        }
+
+        /// <summary>
+        /// Checks that all references between the sections point into their target sections, and that parents precede their children.
+        /// The accessors can then rely on these, and walking up the parents always terminates.
+        /// </summary>
+        /// <param name="aclEntryCount">The number of entries in the ACL entry table.</param>
+        /// <exception cref="InvalidDataException">Thrown when a reference is invalid.</exception>
+        private void ValidateRecords(int aclEntryCount)
+        {
+            long namesLength = _aclOffsetsOffset - _namesOffset;
+            for(int i = 0; i < Count; ++i)
+            {
+                long recordOffset = _recordsOffset + (long)i * RecordSize;
+                int parent = _accessor.ReadInt32(recordOffset + 16);
+                int nameOffset = _accessor.ReadInt32(recordOffset + 20);
+                int nameLength = _accessor.ReadInt32(recordOffset + 24);
+                int accessAclId = _accessor.ReadInt32(recordOffset + 40);
+                int defaultAclId = _accessor.ReadInt32(recordOffset + 44);
+                int inodeOrderIndex = _accessor.ReadInt32(_inodeOrderOffset + 4L * i);
+                if(parent < -1 || parent >= i
+                   || nameOffset < 0 || nameLength < 0 || (long)nameOffset + nameLength > namesLength
+                   || accessAclId < PermissionIndex.NoAcl || accessAclId >= AclCount
+                   || defaultAclId < PermissionIndex.NoAcl || defaultAclId >= AclCount
+                   || (uint)inodeOrderIndex >= (uint)Count)
+                    throw new InvalidDataException($"Record {i} of the permission snapshot is corrupt.");
+            }
+
+            int previousAclOffset = 0;
+            for(int aclId = 0; aclId <= AclCount; ++aclId)
+            {
+                int aclOffset = _accessor.ReadInt32(_aclOffsetsOffset + 4L * aclId);
+                if(aclOffset < previousAclOffset || aclOffset > aclEntryCount)
+                    throw new InvalidDataException($"The entry offset of ACL {aclId} of the permission snapshot is corrupt.");
+                previousAclOffset = aclOffset;
+            }
+        }
+
+        /// <summary>
+        /// Writes the given index into a snapshot file. The file is written under a temporary name first, flushed to disk and then renamed, so an existing snapshot is replaced atomically.
+        /// </summary>
+        /// <param name="index">The index to store.</param>
+        /// <param name="path">Path to the snapshot file.</param>
+        public static void Write(PermissionIndex index, string path)
+        {
+            var temporaryPath = path + ".tmp";
+            using(var stream = new FileStream(temporaryPath, FileMode.Create, FileAccess.Write, FileShare.None, 1 << 16))
+            {
+                Write(index, stream);
+
+                // Otherwise a crash after the rename could leave an empty snapshot behind
+                stream.Flush(true);
+            }
+            if(File.Exists(path))
+                File.Replace(temporaryPath, path, null);
+            else
+                File.Move(temporaryPath, path);
+        }
+
+        /// <summary>
+        /// Writes the given index as a snapshot into the given stream.
+        /// </summary>
+        /// <param name="index">The index to store.</param>
+        /// <param name="stream">The stream to write to.</param>
+        public static void Write(PermissionIndex index, Stream stream)
+        {
+            // Compute section sizes
+            long namesLength = 0;
+            for(int i = 0; i < index.Count; ++i)
+                namesLength += index.GetNameBytes(i).Length;
+            int aclEntryCount = 0;
+            for(int aclId = 0; aclId < index.AclCount; ++aclId)
+                aclEntryCount += index.GetAcl(aclId).Length;
+
+            long recordsOffset = HeaderSize;
+            long inodeOrderOffset = recordsOffset + (long)index.Count * RecordSize;
+            long namesOffset = inodeOrderOffset + 4L * index.Count;
+            long aclOffsetsOffset = namesOffset + namesLength;
+            long aclEntriesOffset = aclOffsetsOffset + 4L * (index.AclCount + 1);
+
+            using var writer = new BinaryWriter(stream, Encoding.UTF8, true);
+
+            // Header
+            writer.Write(Magic);
+            writer.Write(Version);
+            writer.Write(index.Count);
+            writer.Write(index.AclCount);
+            writer.Write(aclEntryCount);
+            writer.Write(recordsOffset);
+            writer.Write(namesOffset);
+            writer.Write(aclOffsetsOffset);
+            writer.Write(aclEntriesOffset);
+            writer.Write(inodeOrderOffset);
+
+            // File records
+            int nameOffset = 0;
+            for(int i = 0; i < index.Count; ++i)
+            {
+                int nameLength = index.GetNameBytes(i).Length;
+                writer.Write(index.GetInode(i));
+                writer.Write(index.GetDevice(i));
+                writer.Write(index.GetParent(i));
+                writer.Write(nameOffset);
+                writer.Write(nameLength);
+                writer.Write(index.GetOwnerId(i));
+                writer.Write(index.GetGroupId(i));
+                writer.Write(index.GetMode(i));
+                writer.Write(index.GetAccessAclId(i));
+                writer.Write(index.GetDefaultAclId(i));
+                nameOffset += nameLength;
+            }
+
+            // Inode order
+            var inodeOrder = new int[index.Count];
+            for(int i = 0; i < inodeOrder.Length; ++i)
+                inodeOrder[i] = i;
+            Array.Sort(inodeOrder, (x, y) =>
+            {
+                // Array.Sort is unstable, so hard links are ordered by their index to keep the table deterministic
+                int result = index.GetDevice(x).CompareTo(index.GetDevice(y));
+                if(result == 0)
+                    result = index.GetInode(x).CompareTo(index.GetInode(y));
+                return result != 0 ? result : x.CompareTo(y);
+            });
+            foreach(int i in inodeOrder)
+                writer.Write(i);
+
+            // String table
+            for(int i = 0; i < index.Count; ++i)
+                writer.Write(index.GetNameBytes(i));
+
+            // ACL offsets and entries
+            int aclEntryOffset = 0;
+            for(int aclId = 0; aclId < index.AclCount; ++aclId)
+            {
+                writer.Write(aclEntryOffset);
+                aclEntryOffset += index.GetAcl(aclId).Length;
+            }
+            writer.Write(aclEntryOffset);
+            for(int aclId = 0; aclId < index.AclCount; ++aclId)
+            {
+                foreach(var entry in index.GetAcl(aclId))
+                {
+                    writer.Write((int)entry.TagType);
+                    writer.Write(entry.TagQualifier);
+                    writer.Write((int)entry.Permissions);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Returns the offset of the given field of the given file record.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        /// <param name="fieldOffset">The offset of the field within the record.</param>
+        private long GetFieldOffset(int index, int fieldOffset)
+        {
+            if((uint)index >= (uint)Count)
+                throw new ArgumentOutOfRangeException(nameof(index));
+            return _recordsOffset + (long)index * RecordSize + fieldOffset;
+        }
+
+        /// <summary>
+        /// Returns the inode number of the given file.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public ulong GetInode(int index) => _accessor.ReadUInt64(GetFieldOffset(index, 0));
+
+        /// <summary>
+        /// Returns the device containing the given file.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public ulong GetDevice(int index) => _accessor.ReadUInt64(GetFieldOffset(index, 8));
+
+        /// <summary>
+        /// Returns the index of the file at the given position, when the files are sorted by device and inode number. Hard links of the same file are sorted by index.
+        /// </summary>
+        /// <param name="position">The position in inode order.</param>
+        public int GetIndexInInodeOrder(int position)
+        {
+            if((uint)position >= (uint)Count)
+                throw new ArgumentOutOfRangeException(nameof(position));
+            return _accessor.ReadInt32(_inodeOrderOffset + 4L * position);
+        }
+
+        /// <summary>
+        /// Returns the index of the parent directory of the given file, or -1 for the root directory.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public int GetParent(int index) => _accessor.ReadInt32(GetFieldOffset(index, 16));
+
+        /// <summary>
+        /// Returns the UID of the owner of the given file.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public int GetOwnerId(int index) => _accessor.ReadInt32(GetFieldOffset(index, 28));
+
+        /// <summary>
+        /// Returns the GID of the group of the given file.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public int GetGroupId(int index) => _accessor.ReadInt32(GetFieldOffset(index, 32));
+
+        /// <summary>
+        /// Returns the file type and mode bits (st_mode) of the given file.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public uint GetMode(int index) => _accessor.ReadUInt32(GetFieldOffset(index, 36));
+
+        /// <summary>
+        /// Returns the ID of the access ACL of the given file, or <see cref="PermissionIndex.NoAcl"/>.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public int GetAccessAclId(int index) => _accessor.ReadInt32(GetFieldOffset(index, 40));
+
+        /// <summary>
+        /// Returns the ID of the default ACL of the given file, or <see cref="PermissionIndex.NoAcl"/>.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public int GetDefaultAclId(int index) => _accessor.ReadInt32(GetFieldOffset(index, 44));
+
+        /// <summary>
+        /// Returns the name of the given file. The root directory has an empty name.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public string GetName(int index)
+        {
+            int nameOffset = _accessor.ReadInt32(GetFieldOffset(index, 20));
+            int nameLength = _accessor.ReadInt32(GetFieldOffset(index, 24));
+            var name = new byte[nameLength];
+            _accessor.ReadArray(_namesOffset + nameOffset, name, 0, nameLength);
+            return Encoding.UTF8.GetString(name);
+        }
+
+        /// <summary>
+        /// Returns the path of the given file relative to the scanned root directory.
+        /// </summary>
+        /// <param name="index">The index of the file.</param>
+        public string GetPath(int index)
+        {
+            var path = new StringBuilder();
+            for(int i = index; i >= 0 && GetParent(i) >= 0; i = GetParent(i))
+                path.Insert(0, path.Length == 0 ? GetName(i) : GetName(i) + "/");
+            return path.ToString();
+        }
+
+        /// <summary>
+        /// Returns the entries of the given ACL. The array is empty for <see cref="PermissionIndex.NoAcl"/>.
+        /// </summary>
+        /// <param name="aclId">The ID of the ACL.</param>
+        public AccessControlListEntry[] GetAcl(int aclId)
+        {
+            if(aclId == PermissionIndex.NoAcl)
+                return Array.Empty<AccessControlListEntry>();
+            if((uint)aclId >= (uint)AclCount)
+                throw new ArgumentOutOfRangeException(nameof(aclId));
+
+            int firstEntry = _accessor.ReadInt32(_aclOffsetsOffset + 4L * aclId);
+            int entryCount = _accessor.ReadInt32(_aclOffsetsOffset + 4L * (aclId + 1)) - firstEntry;
+            var entries = new AccessControlListEntry[entryCount];
+            long position = _aclEntriesOffset + (long)firstEntry * AclEntrySize;
+            for(int i = 0; i < entryCount; ++i, position += AclEntrySize)
+            {
+                entries[i].TagType = (AccessControlListEntryTagTypes)_accessor.ReadInt32(position);
+                entries[i].TagQualifier = _accessor.ReadInt32(position + 4);
+                entries[i].Permissions = (FilePermissions)_accessor.ReadInt32(position + 8);
+            }
+            return entries;
+        }
+
+        /// <summary>
+        /// Unmaps the snapshot file.
+        /// </summary>
+        public void Dispose()
+        {
+            _accessor?.Dispose();
+            _file?.Dispose();
+        }
+    }
+}
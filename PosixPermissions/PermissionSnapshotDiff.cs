@@ -0,0 +1,263 @@
+﻿using System;
+using System.Collections.Generic;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Computes the permission changes between two snapshots of the same tree.
+    /// </summary>
+    /// <remarks>
+    /// Files are matched by device and inode number, using a merge join over the inode order tables of both snapshots, so the memory use only depends on the number of distinct ACLs and unmatched files.
+    /// Hard links share their device and inode number, so they are matched by path first; the remaining links of a file are paired in inode order table order and reported as moved.
+    /// Files which could not be matched that way (e.g. because they were replaced by a new file) are matched by their path afterwards.
+    /// </remarks>
+    public static class PermissionSnapshotDiff
+    {
+        /// <summary>
+        /// Enumerates the changes from the old to the new snapshot. Changes of matched files are reported in inode order, followed by those of files matched by path, and finally the added and removed files.
+        /// For files without extended ACL, the access ACL only mirrors the mode and is not compared separately.
+        /// </summary>
+        /// <param name="oldSnapshot">The old snapshot.</param>
+        /// <param name="newSnapshot">The new snapshot.</param>
+        public static IEnumerable<PermissionChange> Compare(PermissionSnapshot oldSnapshot, PermissionSnapshot newSnapshot)
+        {
+            var oldAcls = LoadAcls(oldSnapshot);
+            var newAcls = LoadAcls(newSnapshot);
+            var aclMapping = MapAcls(oldAcls, newAcls);
+
+            // Merge both snapshots in inode order
+            var changes = new List<PermissionChange>();
+            var unmatchedOld = new List<int>();
+            var unmatchedNew = new List<int>();
+            var oldLinks = new List<int>();
+            var newLinks = new List<int>();
+            int oldPosition = 0;
+            int newPosition = 0;
+            while(oldPosition < oldSnapshot.Count && newPosition < newSnapshot.Count)
+            {
+                int oldIndex = oldSnapshot.GetIndexInInodeOrder(oldPosition);
+                int newIndex = newSnapshot.GetIndexInInodeOrder(newPosition);
+                int order = CompareInodes(oldSnapshot, oldIndex, newSnapshot, newIndex);
+
+                if(order < 0)
+                {
+                    unmatchedOld.Add(oldIndex);
+                    ++oldPosition;
+                }
+                else if(order > 0)
+                {
+                    unmatchedNew.Add(newIndex);
+                    ++newPosition;
+                }
+                else
+                {
+                    // Collect all hard links of the file
+                    oldLinks.Clear();
+                    newLinks.Clear();
+                    for(; oldPosition < oldSnapshot.Count && CompareInodes(oldSnapshot, oldSnapshot.GetIndexInInodeOrder(oldPosition), newSnapshot, newIndex) == 0; ++oldPosition)
+                        oldLinks.Add(oldSnapshot.GetIndexInInodeOrder(oldPosition));
+                    for(; newPosition < newSnapshot.Count && CompareInodes(oldSnapshot, oldIndex, newSnapshot, newSnapshot.GetIndexInInodeOrder(newPosition)) == 0; ++newPosition)
+                        newLinks.Add(newSnapshot.GetIndexInInodeOrder(newPosition));
+
+                    if(oldLinks.Count == 1 && newLinks.Count == 1)
+                        CompareFiles(oldSnapshot, oldIndex, oldAcls, newSnapshot, newIndex, newAcls, aclMapping, false, changes);
+                    else
+                        MatchLinks(oldSnapshot, oldLinks, oldAcls, newSnapshot, newLinks, newAcls, aclMapping, unmatchedOld, unmatchedNew, changes);
+                    foreach(var change in changes)
+                        yield return change;
+                    changes.Clear();
+                }
+            }
+            for(; oldPosition < oldSnapshot.Count; ++oldPosition)
+                unmatchedOld.Add(oldSnapshot.GetIndexInInodeOrder(oldPosition));
+            for(; newPosition < newSnapshot.Count; ++newPosition)
+                unmatchedNew.Add(newSnapshot.GetIndexInInodeOrder(newPosition));
+
+            // Match remaining files by path
+            var oldIndicesByPath = new Dictionary<string, int>();
+            foreach(int oldIndex in unmatchedOld)
+                oldIndicesByPath[oldSnapshot.GetPath(oldIndex)] = oldIndex;
+            var added = new List<int>();
+            foreach(int newIndex in unmatchedNew)
+            {
+                if(oldIndicesByPath.Remove(newSnapshot.GetPath(newIndex), out int oldIndex))
+                {
+                    CompareFiles(oldSnapshot, oldIndex, oldAcls, newSnapshot, newIndex, newAcls, aclMapping, true, changes);
+                    foreach(var change in changes)
+                        yield return change;
+                    changes.Clear();
+                }
+                else
+                    added.Add(newIndex);
+            }
+
+            foreach(int newIndex in added)
+                yield return new PermissionChange(PermissionChangeTypes.Added, newSnapshot.GetPath(newIndex), -1, newIndex);
+            foreach(var oldFile in oldIndicesByPath)
+                yield return new PermissionChange(PermissionChangeTypes.Removed, oldFile.Key, oldFile.Value, -1);
+        }
+
+        /// <summary>
+        /// Compares the device and inode numbers of the given files.
+        /// </summary>
+        /// <param name="oldSnapshot">The old snapshot.</param>
+        /// <param name="oldIndex">The index of the file in the old snapshot.</param>
+        /// <param name="newSnapshot">The new snapshot.</param>
+        /// <param name="newIndex">The index of the file in the new snapshot.</param>
+        private static int CompareInodes(PermissionSnapshot oldSnapshot, int oldIndex, PermissionSnapshot newSnapshot, int newIndex)
+        {
+            int order = oldSnapshot.GetDevice(oldIndex).CompareTo(newSnapshot.GetDevice(newIndex));
+            return order != 0 ? order : oldSnapshot.GetInode(oldIndex).CompareTo(newSnapshot.GetInode(newIndex));
+        }
+
+        /// <summary>
+        /// Matches the hard links of one file, first by path and then in the given order, and compares the matched links.
+        /// Links without counterpart are added to the unmatched lists.
+        /// </summary>
+        /// <param name="oldSnapshot">The old snapshot.</param>
+        /// <param name="oldLinks">The indices of the links in the old snapshot.</param>
+        /// <param name="oldAcls">The ACLs of the old snapshot.</param>
+        /// <param name="newSnapshot">The new snapshot.</param>
+        /// <param name="newLinks">The indices of the links in the new snapshot.</param>
+        /// <param name="newAcls">The ACLs of the new snapshot.</param>
+        /// <param name="aclMapping">Maps old ACL IDs to the IDs of identical new ACLs.</param>
+        /// <param name="unmatchedOld">Receives the old links without counterpart.</param>
+        /// <param name="unmatchedNew">Receives the new links without counterpart.</param>
+        /// <param name="changes">Receives the differences.</param>
+        private static void MatchLinks(PermissionSnapshot oldSnapshot, List<int> oldLinks, AccessControlListEntry[][] oldAcls, PermissionSnapshot newSnapshot, List<int> newLinks, AccessControlListEntry[][] newAcls, int[] aclMapping, List<int> unmatchedOld, List<int> unmatchedNew, List<PermissionChange> changes)
+        {
+            var oldLinksByPath = new Dictionary<string, int>();
+            foreach(int oldIndex in oldLinks)
+                oldLinksByPath[oldSnapshot.GetPath(oldIndex)] = oldIndex;
+
+            var remainingNewLinks = new List<int>();
+            foreach(int newIndex in newLinks)
+            {
+                if(oldLinksByPath.Remove(newSnapshot.GetPath(newIndex), out int oldIndex))
+                    CompareFiles(oldSnapshot, oldIndex, oldAcls, newSnapshot, newIndex, newAcls, aclMapping, true, changes);
+                else
+                    remainingNewLinks.Add(newIndex);
+            }
+
+            // Pair the remaining links in inode order table order
+            int position = 0;
+            foreach(int oldIndex in oldLinks)
+            {
+                if(!oldLinksByPath.ContainsKey(oldSnapshot.GetPath(oldIndex)))
+                    continue;
+                if(position < remainingNewLinks.Count)
+                    CompareFiles(oldSnapshot, oldIndex, oldAcls, newSnapshot, remainingNewLinks[position++], newAcls, aclMapping, false, changes);
+                else
+                    unmatchedOld.Add(oldIndex);
+            }
+            for(; position < remainingNewLinks.Count; ++position)
+                unmatchedNew.Add(remainingNewLinks[position]);
+        }
+
+        /// <summary>
+        /// Reads all ACLs of the given snapshot.
+        /// </summary>
+        /// <param name="snapshot">The snapshot.</param>
+        private static AccessControlListEntry[][] LoadAcls(PermissionSnapshot snapshot)
+        {
+            var acls = new AccessControlListEntry[snapshot.AclCount][];
+            for(int aclId = 0; aclId < acls.Length; ++aclId)
+                acls[aclId] = snapshot.GetAcl(aclId);
+            return acls;
+        }
+
+        /// <summary>
+        /// Returns the ID of the identical new ACL for each old ACL, or <see cref="PermissionIndex.NoAcl"/> if there is none.
+        /// </summary>
+        /// <param name="oldAcls">The ACLs of the old snapshot.</param>
+        /// <param name="newAcls">The ACLs of the new snapshot.</param>
+        private static int[] MapAcls(AccessControlListEntry[][] oldAcls, AccessControlListEntry[][] newAcls)
+        {
+            var newAclIds = new Dictionary<AccessControlListEntry[], int>(new PermissionIndex.AclEqualityComparer());
+            for(int aclId = 0; aclId < newAcls.Length; ++aclId)
+                newAclIds[newAcls[aclId]] = aclId;
+
+            var mapping = new int[oldAcls.Length];
+            for(int aclId = 0; aclId < oldAcls.Length; ++aclId)
+                mapping[aclId] = newAclIds.TryGetValue(oldAcls[aclId], out int newAclId) ? newAclId : PermissionIndex.NoAcl;
+            return mapping;
+        }
+
+        /// <summary>
+        /// Compares the given files and adds the differences to the given change list.
+        /// </summary>
+        /// <param name="oldSnapshot">The old snapshot.</param>
+        /// <param name="oldIndex">The index of the file in the old snapshot.</param>
+        /// <param name="oldAcls">The ACLs of the old snapshot.</param>
+        /// <param name="newSnapshot">The new snapshot.</param>
+        /// <param name="newIndex">The index of the file in the new snapshot.</param>
+        /// <param name="newAcls">The ACLs of the new snapshot.</param>
+        /// <param name="aclMapping">Maps old ACL IDs to the IDs of identical new ACLs.</param>
+        /// <param name="matchedByPath">Specifies whether the files were matched by their path. Such files are never reported as moved.</param>
+        /// <param name="changes">Receives the differences.</param>
+        private static void CompareFiles(PermissionSnapshot oldSnapshot, int oldIndex, AccessControlListEntry[][] oldAcls, PermissionSnapshot newSnapshot, int newIndex, AccessControlListEntry[][] newAcls, int[] aclMapping, bool matchedByPath, List<PermissionChange> changes)
+        {
+            string path = null;
+            string GetPath() => path ??= newSnapshot.GetPath(newIndex);
+
+            // Files matched by path are at the same location anyway, even if their parent directory was recreated
+            int oldParent = oldSnapshot.GetParent(oldIndex);
+            int newParent = newSnapshot.GetParent(newIndex);
+            if(!matchedByPath && oldParent >= 0 && newParent >= 0
+               && (oldSnapshot.GetInode(oldParent) != newSnapshot.GetInode(newParent)
+                   || oldSnapshot.GetDevice(oldParent) != newSnapshot.GetDevice(newParent)
+                   || oldSnapshot.GetName(oldIndex) != newSnapshot.GetName(newIndex)))
+                changes.Add(new PermissionChange(PermissionChangeTypes.Moved, GetPath(), oldIndex, newIndex));
+            if(oldSnapshot.GetMode(oldIndex) != newSnapshot.GetMode(newIndex))
+                changes.Add(new PermissionChange(PermissionChangeTypes.ModeChanged, GetPath(), oldIndex, newIndex));
+            if(oldSnapshot.GetOwnerId(oldIndex) != newSnapshot.GetOwnerId(newIndex))
+                changes.Add(new PermissionChange(PermissionChangeTypes.OwnerChanged, GetPath(), oldIndex, newIndex));
+            if(oldSnapshot.GetGroupId(oldIndex) != newSnapshot.GetGroupId(newIndex))
+                changes.Add(new PermissionChange(PermissionChangeTypes.GroupChanged, GetPath(), oldIndex, newIndex));
+
+            for(int i = 0; i < 2; ++i)
+            {
+                bool isDefaultAcl = i == 1;
+                int oldAclId = isDefaultAcl ? oldSnapshot.GetDefaultAclId(oldIndex) : oldSnapshot.GetAccessAclId(oldIndex);
+                int newAclId = isDefaultAcl ? newSnapshot.GetDefaultAclId(newIndex) : newSnapshot.GetAccessAclId(newIndex);
+                if(oldAclId == PermissionIndex.NoAcl ? newAclId == PermissionIndex.NoAcl : aclMapping[oldAclId] == newAclId)
+                    continue;
+
+                var oldAcl = oldAclId == PermissionIndex.NoAcl ? Array.Empty<AccessControlListEntry>() : oldAcls[oldAclId];
+                var newAcl = newAclId == PermissionIndex.NoAcl ? Array.Empty<AccessControlListEntry>() : newAcls[newAclId];
+                if(!isDefaultAcl && oldAcl.Length <= 3 && newAcl.Length <= 3)
+                    continue;
+
+                // Both ACLs are sorted by tag type and qualifier
+                int oldPosition = 0;
+                int newPosition = 0;
+                while(oldPosition < oldAcl.Length || newPosition < newAcl.Length)
+                {
+                    int order;
+                    if(oldPosition == oldAcl.Length)
+                        order = 1;
+                    else if(newPosition == newAcl.Length)
+                        order = -1;
+                    else
+                    {
+                        order = oldAcl[oldPosition].TagType.CompareTo(newAcl[newPosition].TagType);
+                        if(order == 0)
+                            order = oldAcl[oldPosition].TagQualifier.CompareTo(newAcl[newPosition].TagQualifier);
+                    }
+
+                    if(order < 0)
+                        changes.Add(new PermissionChange(PermissionChangeTypes.AclEntryRemoved, GetPath(), oldIndex, newIndex, isDefaultAcl, oldAcl[oldPosition++]));
+                    else if(order > 0)
+                        changes.Add(new PermissionChange(PermissionChangeTypes.AclEntryAdded, GetPath(), oldIndex, newIndex, isDefaultAcl, default, newAcl[newPosition++]));
+                    else
+                    {
+                        if(oldAcl[oldPosition].Permissions != newAcl[newPosition].Permissions)
+                            changes.Add(new PermissionChange(PermissionChangeTypes.AclEntryModified, GetPath(), oldIndex, newIndex, isDefaultAcl, oldAcl[oldPosition], newAcl[newPosition]));
+                        ++oldPosition;
+                        ++newPosition;
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,316 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Threading.Tasks;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Restores the permissions recorded in a <see cref="PermissionSnapshot"/> to the live files, in parallel.
+    /// The live permissions are read in batches first, so only files and directories whose owner, group, mode or ACLs differ are written.
+    /// The restorer always uses <see cref="NativeContextOptions.SkipUnchanged"/>, so the writes only touch the differing parts of a file.
+    /// </summary>
+    /// <remarks>
+    /// Files are located by their recorded paths. Directories are processed from the deepest level upwards, so a directory is only restored after its contents, which keeps it accessible while they are processed.
+    /// Files may have been replaced by symbolic links since the snapshot was taken, so the restorer always uses <see cref="NativeContextOptions.NoFollow"/>, and opens each directory relative to its parent, starting at the restored directory.
+    /// Symbolic links are therefore never followed below the restored directory; writes to entries that became symbolic links fail and are reported.
+    /// </remarks>
+    public class PermissionSnapshotRestorer
+    {
+        /// <summary>
+        /// The maximum number of entries of a directory that are processed in one work item.
+        /// </summary>
+        private const int WorkItemLength = 1024;
+
+        /// <summary>
+        /// Object for native operations, configured with <see cref="NativeContextOptions.NoFollow"/> and <see cref="NativeContextOptions.SkipUnchanged"/>.
+        /// </summary>
+        private readonly INativeLibraryInterface _nativeLibraryInterface;
+
+        /// <summary>
+        /// Creates a new restorer.
+        /// </summary>
+        /// <param name="nativeLibraryInterface">Object for native operations. The restorer adds <see cref="NativeContextOptions.NoFollow"/> and <see cref="NativeContextOptions.SkipUnchanged"/> to its options.</param>
+        public PermissionSnapshotRestorer(INativeLibraryInterface nativeLibraryInterface)
+        {
+            if(nativeLibraryInterface == null)
+                throw new ArgumentNullException(nameof(nativeLibraryInterface));
+            _nativeLibraryInterface = nativeLibraryInterface.WithContextOptions(NativeContextOptions.NoFollow | NativeContextOptions.SkipUnchanged);
+        }
+
+        /// <summary>
+        /// Restores the permissions recorded in the given snapshot to the given directory and all files below it.
+        /// Files that exist only on one side are not touched; files missing on disk are reported as failures.
+        /// </summary>
+        /// <param name="snapshot">The snapshot of the directory.</param>
+        /// <param name="directory">The directory to restore.</param>
+        /// <param name="threadCount">Optional. Number of parallel workers. If this is 0, one worker per CPU is used.</param>
+        /// <param name="report">Optional. Receives progress and failures while the restore runs. If this is null, a new report is created.</param>
+        /// <returns>The report of the operation.</returns>
+        public PermissionRestoreReport Restore(PermissionSnapshot snapshot, DirectoryInfo directory, int threadCount = 0, PermissionRestoreReport report = null)
+            => Restore(snapshot, directory.FullName, threadCount, report);
+
+        /// <summary>
+        /// Restores the permissions recorded in the given snapshot to the given directory and all files below it.
+        /// </summary>
+        /// <param name="snapshot">The snapshot of the directory.</param>
+        /// <param name="rootPath">The directory to restore.</param>
+        /// <param name="threadCount">Number of parallel workers. If this is 0, one worker per CPU is used.</param>
+        /// <param name="report">Receives progress and failures, or null.</param>
+        internal PermissionRestoreReport Restore(PermissionSnapshot snapshot, string rootPath, int threadCount, PermissionRestoreReport report)
+        {
+            report ??= new PermissionRestoreReport();
+            if(snapshot.Count == 0)
+                return report;
+
+            var acls = new AccessControlListEntry[snapshot.AclCount][];
+            for(int aclId = 0; aclId < acls.Length; ++aclId)
+                acls[aclId] = snapshot.GetAcl(aclId);
+
+            // Group the entries by their parent directories. Parents always precede their entries, so the depths can be computed in one pass
+            var parents = new int[snapshot.Count];
+            var depths = new int[snapshot.Count];
+            var childOffsets = new int[snapshot.Count + 1];
+            int maxDepth = 0;
+            for(int i = 0; i < snapshot.Count; ++i)
+            {
+                int parent = parents[i] = snapshot.GetParent(i);
+                if(parent >= 0)
+                {
+                    depths[i] = depths[parent] + 1;
+                    maxDepth = Math.Max(maxDepth, depths[i]);
+                    ++childOffsets[parent + 1];
+                }
+            }
+            for(int i = 0; i < snapshot.Count; ++i)
+                childOffsets[i + 1] += childOffsets[i];
+            var children = new int[childOffsets[snapshot.Count]];
+            var childPositions = (int[])childOffsets.Clone();
+            for(int i = 0; i < snapshot.Count; ++i)
+            {
+                if(parents[i] >= 0)
+                    children[childPositions[parents[i]]++] = i;
+            }
+
+            // Split the directories into work items, sorted by depth
+            var workItemsByDepth = new List<(int Directory, int Start, int End)>[maxDepth];
+            for(int depth = 0; depth < maxDepth; ++depth)
+                workItemsByDepth[depth] = new List<(int Directory, int Start, int End)>();
+            for(int i = 0; i < snapshot.Count; ++i)
+            {
+                for(int start = childOffsets[i]; start < childOffsets[i + 1]; start += WorkItemLength)
+                    workItemsByDepth[depths[i]].Add((i, start, Math.Min(start + WorkItemLength, childOffsets[i + 1])));
+            }
+
+            // Directories below the root are only opened relative to this handle
+            PosixDirectoryHandle rootHandle = null;
+            if(maxDepth > 0)
+            {
+                try
+                {
+                    rootHandle = _nativeLibraryInterface.OpenDirectory(rootPath);
+                }
+                catch(Exception ex)
+                {
+                    report.AddFailure("", ex, childOffsets[snapshot.Count]);
+                    maxDepth = 0;
+                }
+            }
+
+            using(rootHandle)
+            {
+                var parallelOptions = new ParallelOptions { MaxDegreeOfParallelism = threadCount > 0 ? threadCount : Environment.ProcessorCount };
+                for(int depth = maxDepth - 1; depth >= 0; --depth)
+                {
+                    Parallel.ForEach(workItemsByDepth[depth], parallelOptions, workItem =>
+                    {
+                        var directoryPath = snapshot.GetPath(workItem.Directory);
+                        PosixDirectoryHandle directoryHandle;
+                        try
+                        {
+                            directoryHandle = OpenDirectory(snapshot, rootHandle, workItem.Directory);
+                        }
+                        catch(Exception ex)
+                        {
+                            report.AddFailure(directoryPath, ex, workItem.End - workItem.Start);
+                            return;
+                        }
+
+                        using(directoryHandle)
+                            RestoreEntries(snapshot, acls, directoryHandle, directoryPath, new ArraySegment<int>(children, workItem.Start, workItem.End - workItem.Start), report);
+                    });
+                }
+            }
+
+            // The root directory comes last
+            RestoreEntries(snapshot, acls, null, "", new ArraySegment<int>(new[] { 0 }), report, rootPath);
+            return report;
+        }
+
+        /// <summary>
+        /// Opens the given directory of the snapshot by walking down from the restored directory, one path component at a time.
+        /// With <see cref="NativeContextOptions.NoFollow"/>, this fails if any directory on the path was replaced by a symbolic link.
+        /// </summary>
+        /// <param name="snapshot">The snapshot.</param>
+        /// <param name="rootHandle">The restored directory.</param>
+        /// <param name="directory">The index of the directory in the snapshot.</param>
+        private PosixDirectoryHandle OpenDirectory(PermissionSnapshot snapshot, PosixDirectoryHandle rootHandle, int directory)
+        {
+            var names = new Stack<string>();
+            for(int i = directory; snapshot.GetParent(i) >= 0; i = snapshot.GetParent(i))
+                names.Push(snapshot.GetName(i));
+
+            // The root handle is shared, so the restored directory itself gets a handle of its own
+            if(names.Count == 0)
+                return _nativeLibraryInterface.OpenDirectory(rootHandle, ".");
+
+            var directoryHandle = rootHandle;
+            try
+            {
+                while(names.Count > 0)
+                {
+                    var childHandle = _nativeLibraryInterface.OpenDirectory(directoryHandle, names.Pop());
+                    if(directoryHandle != rootHandle)
+                        directoryHandle.Dispose();
+                    directoryHandle = childHandle;
+                }
+                return directoryHandle;
+            }
+            catch
+            {
+                if(directoryHandle != rootHandle)
+                    directoryHandle.Dispose();
+                throw;
+            }
+        }
+
+        /// <summary>
+        /// Restores the given entries of the given directory.
+        /// </summary>
+        /// <param name="snapshot">The snapshot.</param>
+        /// <param name="acls">The ACLs of the snapshot.</param>
+        /// <param name="directoryHandle">The directory containing the entries, or null when restoring the root directory.</param>
+        /// <param name="directoryPath">The path of the directory relative to the restored directory, for reporting.</param>
+        /// <param name="entries">The indices of the entries in the snapshot.</param>
+        /// <param name="report">Receives progress and failures.</param>
+        /// <param name="rootPath">The path of the restored directory, if <paramref name="directoryHandle"/> is null.</param>
+        private void RestoreEntries(PermissionSnapshot snapshot, AccessControlListEntry[][] acls, PosixDirectoryHandle directoryHandle, string directoryPath, ArraySegment<int> entries, PermissionRestoreReport report, string rootPath = null)
+        {
+            // Symbolic links and files without recorded ACL are not restored
+            var indices = new List<int>(entries.Count);
+            var names = new List<string>(entries.Count);
+            var directoryIndices = new List<int>();
+            var directoryNames = new List<string>();
+            foreach(int index in entries)
+            {
+                uint mode = snapshot.GetMode(index);
+                if((mode & 0xF000) == 0xA000 || snapshot.GetAccessAclId(index) == PermissionIndex.NoAcl)
+                    continue;
+
+                var name = directoryHandle == null ? rootPath : snapshot.GetName(index);
+                indices.Add(index);
+                names.Add(name);
+                if((mode & 0xF000) == 0x4000)
+                {
+                    directoryIndices.Add(indices.Count - 1);
+                    directoryNames.Add(name);
+                }
+            }
+            int skippedCount = entries.Count - indices.Count;
+
+            // Read live permissions
+            PermissionDataBatch liveData;
+            PermissionDataBatch liveDefaultData;
+            try
+            {
+                liveData = _nativeLibraryInterface.GetPermissionDataBatch(directoryHandle, names, 0);
+                liveDefaultData = directoryNames.Count > 0 ? _nativeLibraryInterface.GetPermissionDataBatch(directoryHandle, directoryNames, 1) : null;
+            }
+            catch(Exception ex)
+            {
+                report.AddProcessed(0, 0, skippedCount);
+                report.AddFailure(directoryPath, ex, indices.Count);
+                return;
+            }
+
+            int processedCount = 0;
+            int changedCount = 0;
+            int directoryPosition = 0;
+            for(int i = 0; i < indices.Count; ++i)
+            {
+                int index = indices[i];
+                bool isDirectory = directoryPosition < directoryIndices.Count && directoryIndices[directoryPosition] == i;
+                int defaultResultIndex = isDirectory ? directoryPosition++ : -1;
+                var path = directoryHandle == null ? "" : directoryPath.Length == 0 ? names[i] : directoryPath + "/" + names[i];
+
+                if(!liveData.IsSuccess(i))
+                {
+                    report.AddFailure(path, liveData.GetException(i));
+                    continue;
+                }
+                if(isDirectory && !liveDefaultData.IsSuccess(defaultResultIndex))
+                {
+                    report.AddFailure(path, liveDefaultData.GetException(defaultResultIndex));
+                    continue;
+                }
+                ++processedCount;
+
+                // Compare with recorded permissions
+                var entriesToRestore = acls[snapshot.GetAccessAclId(index)];
+                int defaultAclId = snapshot.GetDefaultAclId(index);
+                var defaultEntriesToRestore = defaultAclId == PermissionIndex.NoAcl ? Array.Empty<AccessControlListEntry>() : acls[defaultAclId];
+                var dataContainer = GetDataContainer(snapshot.GetOwnerId(index), snapshot.GetGroupId(index), snapshot.GetMode(index), entriesToRestore.Length);
+                ref var liveDataContainer = ref liveData.Results[i].DataContainer;
+                if(liveDataContainer.OwnerId == dataContainer.OwnerId
+                   && liveDataContainer.GroupId == dataContainer.GroupId
+                   && liveDataContainer.OwnerPermissions == dataContainer.OwnerPermissions
+                   && liveDataContainer.GroupPermissions == dataContainer.GroupPermissions
+                   && liveDataContainer.OtherPermissions == dataContainer.OtherPermissions
+                   && PermissionIndex.AclEqualityComparer.AclEquals(liveData.GetEntries(i), entriesToRestore)
+                   && (!isDirectory || PermissionIndex.AclEqualityComparer.AclEquals(liveDefaultData.GetEntries(defaultResultIndex), defaultEntriesToRestore)))
+                    continue;
+
+                // Write permissions
+                try
+                {
+                    var changes = NativePermissionChanges.None;
+                    if(isDirectory)
+                        changes = _nativeLibraryInterface.SetDirectoryPermissionData(directoryHandle, names[i], ref dataContainer, entriesToRestore, defaultEntriesToRestore);
+                    else
+                        _nativeLibraryInterface.SetPermissionData(directoryHandle, names[i], 0, ref dataContainer, entriesToRestore, out changes);
+                    if(changes != NativePermissionChanges.None)
+                        ++changedCount;
+                }
+                catch(Exception ex)
+                {
+                    --processedCount;
+                    report.AddFailure(path, ex);
+                }
+            }
+            report.AddProcessed(processedCount, changedCount, skippedCount);
+        }
+
+        /// <summary>
+        /// Converts the given recorded permissions into their native representation.
+        /// </summary>
+        /// <param name="ownerId">The UID of the owner.</param>
+        /// <param name="groupId">The GID of the group.</param>
+        /// <param name="mode">The file type and mode bits.</param>
+        /// <param name="aclSize">The number of access ACL entries.</param>
+        private static NativePermissionDataContainer GetDataContainer(int ownerId, int groupId, uint mode, int aclSize)
+        {
+            return new NativePermissionDataContainer
+            {
+                OwnerId = ownerId,
+                OwnerPermissions = (FilePermissions)((mode >> 6) & 7)
+                                   | ((mode & 0x800) != 0 ? FilePermissions.SetId : FilePermissions.None)
+                                   | ((mode & 0x200) != 0 ? FilePermissions.Sticky : FilePermissions.None),
+                GroupId = groupId,
+                GroupPermissions = (FilePermissions)((mode >> 3) & 7)
+                                   | ((mode & 0x400) != 0 ? FilePermissions.SetId : FilePermissions.None),
+                OtherPermissions = (FilePermissions)(mode & 7),
+                AclSize = aclSize
+            };
+        }
+    }
+}
@@ -0,0 +1,36 @@
+﻿using System;
+using System.Runtime.InteropServices;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Wraps an open directory descriptor. Files in the directory can be accessed by their relative names, so the kernel only has to look up the last path component.
+    /// Instances are created by <see cref="INativeLibraryInterface.OpenDirectory(string)"/>.
+    /// </summary>
+    public sealed class PosixDirectoryHandle : SafeHandle
+    {
+        /// <summary>
+        /// Creates an invalid handle. Used by the P/Invoke marshaller.
+        /// </summary>
+        public PosixDirectoryHandle()
+            : base(new IntPtr(-1), true)
+        { }
+
+        /// <inheritdoc />
+        public override bool IsInvalid => handle.ToInt64() < 0;
+
+        /// <summary>
+        /// Closes the given directory descriptor.
+        /// </summary>
+        /// <param name="dirFd">The descriptor to close.</param>
+        [DllImport(NativeLibraryInterface.NativeLibraryPath, EntryPoint = "CloseDirectory")]
+        private static extern void CloseDirectory(IntPtr dirFd);
+
+        /// <inheritdoc />
+        protected override bool ReleaseHandle()
+        {
+            CloseDirectory(handle);
+            return true;
+        }
+    }
+}
@@ -0,0 +1,112 @@
+﻿using System;
+using System.IO;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Holds the permissions of a directory together with its default permissions, which are inherited by newly created files and subdirectories.
+    /// Both are read and applied with a single native operation.
+    /// </summary>
+    public class PosixDirectoryPermissionInfo
+    {
+        /// <summary>
+        /// Object for native operations.
+        /// </summary>
+        private readonly INativeLibraryInterface _nativeLibraryInterface;
+
+        /// <summary>
+        /// The permissions of the directory itself.
+        /// </summary>
+        public PosixPermissionInfo AccessPermissions { get; }
+
+        /// <summary>
+        /// The default permissions of the directory. Like with <see cref="PosixPermissionInfo.ApplyPermissions(DirectoryInfo, bool)"/>, the owner, group and other permissions are assumed to match <see cref="AccessPermissions"/>.
+        /// </summary>
+        public PosixPermissionInfo DefaultPermissions { get; }
+
+        /// <summary>
+        /// Gets or sets whether the directory has a default ACL. If this is false, <see cref="DefaultPermissions"/> is ignored and an existing default ACL is removed when applying the permissions.
+        /// </summary>
+        public bool HasDefaultAcl { get; set; }
+
+        /// <summary>
+        /// Loads the access and default permissions of the given directory.
+        /// </summary>
+        /// <param name="nativeLibraryInterface">Object for native operations.</param>
+        /// <param name="fullPath">Full path to the directory.</param>
+        internal PosixDirectoryPermissionInfo(INativeLibraryInterface nativeLibraryInterface, string fullPath)
+        {
+            _nativeLibraryInterface = nativeLibraryInterface ?? throw new ArgumentNullException(nameof(nativeLibraryInterface));
+
+            // Get permission data and both ACLs
+            var acl = _nativeLibraryInterface.GetDirectoryPermissionData(null, fullPath, out var dataContainer, out var defaultAcl);
+
+            // Initialize members
+            AccessPermissions = new PosixPermissionInfo(_nativeLibraryInterface, dataContainer, acl);
+            DefaultPermissions = new PosixPermissionInfo(_nativeLibraryInterface, dataContainer, defaultAcl);
+            HasDefaultAcl = defaultAcl.Length > 0;
+        }
+
+        /// <summary>
+        /// Creates a new <see cref="PosixDirectoryPermissionInfo"/> object from the given native permission data.
+        /// </summary>
+        /// <param name="nativeLibraryInterface">Object for native operations.</param>
+        /// <param name="dataContainer">Container object with permissions and meta data.</param>
+        /// <param name="acl">The access ACL entries.</param>
+        /// <param name="defaultAcl">The default ACL entries. Empty if the directory has no default ACL.</param>
+        internal PosixDirectoryPermissionInfo(INativeLibraryInterface nativeLibraryInterface, in NativePermissionDataContainer dataContainer, ReadOnlySpan<AccessControlListEntry> acl, ReadOnlySpan<AccessControlListEntry> defaultAcl)
+        {
+            _nativeLibraryInterface = nativeLibraryInterface ?? throw new ArgumentNullException(nameof(nativeLibraryInterface));
+
+            // Initialize members
+            AccessPermissions = new PosixPermissionInfo(_nativeLibraryInterface, dataContainer, acl);
+            DefaultPermissions = new PosixPermissionInfo(_nativeLibraryInterface, dataContainer, defaultAcl);
+            HasDefaultAcl = defaultAcl.Length > 0;
+        }
+
+        /// <summary>
+        /// Creates a new <see cref="PosixDirectoryPermissionInfo"/> object from the given directory.
+        /// </summary>
+        /// <param name="nativeLibraryInterface">Object for native operations.</param>
+        /// <param name="directory">The directory to load the permissions for.</param>
+        public PosixDirectoryPermissionInfo(INativeLibraryInterface nativeLibraryInterface, DirectoryInfo directory)
+            : this(nativeLibraryInterface, directory.FullName)
+        { }
+
+        /// <summary>
+        /// Applies the contained access and default permissions to the given directory.
+        /// </summary>
+        /// <param name="directory">The directory to apply the permissions to.</param>
+        public void ApplyPermissions(DirectoryInfo directory)
+            => ApplyPermissions(directory.FullName);
+
+        /// <summary>
+        /// Applies the contained access and default permissions to the given directory, in the order described in <see cref="PosixPermissionInfo.ApplyPermissions(string, bool)"/>.
+        /// </summary>
+        /// <param name="fullPath">The directory to apply the permissions to.</param>
+        internal void ApplyPermissions(string fullPath)
+        {
+            var aclEntries = AccessPermissions.BuildNativePermissionData(out var dataContainer);
+            var defaultAclEntries = HasDefaultAcl ? DefaultPermissions.BuildNativePermissionData(out _) : Array.Empty<AccessControlListEntry>();
+            _nativeLibraryInterface.SetDirectoryPermissionData(null, fullPath, ref dataContainer, aclEntries, defaultAclEntries);
+        }
+
+        /// <summary>
+        /// Applies the contained access and default permissions to the given directory and all directories below it, and the given file permissions to all other files below it.
+        /// The work is spread over a pool of native threads; symbolic links are neither followed nor modified.
+        /// If <see cref="HasDefaultAcl"/> is false, existing default ACLs are left unchanged.
+        /// </summary>
+        /// <param name="directory">The root directory to apply the permissions to.</param>
+        /// <param name="filePermissions">The permissions to apply to files, or null to leave them unchanged.</param>
+        /// <param name="threadCount">Optional. Number of worker threads. If this is 0, one thread per CPU is used.</param>
+        /// <param name="errorHandler">Optional. Called for each file that could not be updated, with its path relative to <paramref name="directory"/>. Returns false to cancel the operation. Calls are serialized, but come from the worker threads.</param>
+        /// <returns>The counters of the operation.</returns>
+        public NativeRecursiveApplyStatistics ApplyPermissionsRecursive(DirectoryInfo directory, PosixPermissionInfo filePermissions, int threadCount = 0, Func<string, NativeException, bool> errorHandler = null)
+        {
+            using var compiledFilePermissions = filePermissions?.Compile();
+            using var compiledDirectoryPermissions = AccessPermissions.Compile();
+            using var compiledDefaultPermissions = HasDefaultAcl ? DefaultPermissions.Compile(true) : null;
+            return _nativeLibraryInterface.ApplyPermissionsRecursive(directory.FullName, compiledFilePermissions, compiledDirectoryPermissions, compiledDefaultPermissions, threadCount, errorHandler);
+        }
+    }
+}
@@ -28,6 +28,50 @@ namespace PosixPermissions
             var acl = _nativeLibraryInterface.GetPermissionData(fullPath, loadDefaultAcl, out var dataContainer);
 
             // Initialize members
+            LoadPermissionData(dataContainer, acl);
+        }
+
+        /// <summary>
+        /// Creates a new <see cref="PosixPermissionInfo"/> object from an item of a batch read.
+        /// </summary>
+        /// <param name="nativeLibraryInterface">Object for native operations.</param>
+        /// <param name="batch">The batch containing the permission data.</param>
+        /// <param name="index">The index of the item in <paramref name="batch"/>.</param>
+        /// <exception cref="NativeException">Thrown when the item could not be read.</exception>
+        public PosixPermissionInfo(INativeLibraryInterface nativeLibraryInterface, PermissionDataBatch batch, int index)
+        {
+            _nativeLibraryInterface = nativeLibraryInterface ?? throw new ArgumentNullException(nameof(nativeLibraryInterface));
+
+            // Make sure the item was read successfully
+            var exception = batch.GetException(index);
+            if(exception != null)
+                throw exception;
+
+            // Initialize members
+            LoadPermissionData(batch.Results[index].DataContainer, batch.GetEntries(index));
+        }
+
+        /// <summary>
+        /// Creates a new <see cref="PosixPermissionInfo"/> object from the given native permission data.
+        /// </summary>
+        /// <param name="nativeLibraryInterface">Object for native operations.</param>
+        /// <param name="dataContainer">Container object with permissions and meta data.</param>
+        /// <param name="acl">The ACL entries.</param>
+        internal PosixPermissionInfo(INativeLibraryInterface nativeLibraryInterface, in NativePermissionDataContainer dataContainer, ReadOnlySpan<AccessControlListEntry> acl)
+        {
+            _nativeLibraryInterface = nativeLibraryInterface ?? throw new ArgumentNullException(nameof(nativeLibraryInterface));
+
+            // Initialize members
+            LoadPermissionData(dataContainer, acl);
+        }
+
+        /// <summary>
+        /// Initializes the members from the given native permission data.
+        /// </summary>
+        /// <param name="dataContainer">Container object with permissions and meta data.</param>
+        /// <param name="acl">The ACL entries.</param>
+        private void LoadPermissionData(in NativePermissionDataContainer dataContainer, ReadOnlySpan<AccessControlListEntry> acl)
+        {
             OwnerId = dataContainer.OwnerId;
             OwnerPermissions = dataContainer.OwnerPermissions;
             GroupId = dataContainer.GroupId;
@@ -111,12 +155,37 @@ namespace PosixPermissions
         /// <param name="fullPath">The file or directory to apply the permissions to.</param>
         /// <param name="asDefault">Optional. Specifies whether to update a directory's default ACL. When using this option, the contained UNIX permissions are not applied to the file (chown/chmod), but are still assumed as consistent! This must be false for files.</param>
         internal void ApplyPermissions(string fullPath, bool asDefault)
+        {
+            // Apply permissions
+            var aclEntries = BuildNativePermissionData(out var dataContainer);
+            _nativeLibraryInterface.SetPermissionData(fullPath, asDefault ? 1 : 0, ref dataContainer, aclEntries);
+
+            // TODO handle/document exceptions
+        }
+
+        /// <summary>
+        /// Validates the contained permissions and converts them into their native representation, so they can be applied to many files or directories using <see cref="INativeLibraryInterface.ApplyCompiledPermissionsBatch"/>.
+        /// Later changes to this object do not affect the returned handle.
+        /// </summary>
+        /// <param name="asDefault">Optional. Specifies whether the permissions are applied as a directory's default ACL. When using this option, the contained UNIX permissions are not applied to the file (chown/chmod), but are still assumed as consistent!</param>
+        /// <exception cref="ArgumentException">Thrown when the resulting ACL is invalid.</exception>
+        public CompiledPermissionsHandle Compile(bool asDefault = false)
+        {
+            var aclEntries = BuildNativePermissionData(out var dataContainer);
+            return _nativeLibraryInterface.CompilePermissionData(asDefault ? 1 : 0, ref dataContainer, aclEntries);
+        }
+
+        /// <summary>
+        /// Builds the native permission data and ACL entries from the contained permissions, in the order described in <see cref="ApplyPermissions(string, bool)"/>.
+        /// </summary>
+        /// <param name="dataContainer">Receives the UNIX permissions and meta data.</param>
+        internal AccessControlListEntry[] BuildNativePermissionData(out NativePermissionDataContainer dataContainer)
         {
             // Calculate ACL size first
             int aclSize = 3 + _aclUserPermissions.Count + _aclGroupPermissions.Count + 1;
 
             // Collect base permissions
-            NativePermissionDataContainer dataContainer = new NativePermissionDataContainer()
+            dataContainer = new NativePermissionDataContainer()
             {
                 AclSize = aclSize,
 
@@ -183,10 +252,7 @@ namespace PosixPermissions
                 Permissions = aclMask
             };
 
-            // Apply permissions
-            _nativeLibraryInterface.SetPermissionData(fullPath, asDefault ? 1 : 0, ref dataContainer, aclEntries);
-
-            // TODO handle/document exceptions
+            return aclEntries;
         }
     }
 }
@@ -93,6 +93,12 @@ namespace PosixPermissions
         /// </summary>
         private readonly Dictionary<int, FilePermissions> _aclGroupPermissions = new Dictionary<int, FilePermissions>();
 
+        /// <summary>
+        /// Returns whether the ACL is trivial, i.e. it has no entries for other users and groups and is fully described by the owner, group and other permissions.
+        /// Files without an extended ACL are always read as trivial.
+        /// </summary>
+        public bool IsTrivial => _aclUserPermissions.Count == 0 && _aclGroupPermissions.Count == 0;
+
         /// <summary>
         /// Creates a new <see cref="PosixPermissionInfo"/> object with an empty access control list for the given owner and group.
         /// </summary>
@@ -33,5 +33,29 @@ namespace PosixPermissions
         /// <inheritdoc />
         public PosixPermissionInfo GetPosixPermissionInfo(DirectoryInfo directory, bool loadDefaultAcl)
             => new PosixPermissionInfo(_nativeLibraryInterface, directory, loadDefaultAcl);
+
+        /// <inheritdoc />
+        public PosixDirectoryPermissionInfo GetPosixDirectoryPermissionInfo(DirectoryInfo directory)
+            => new PosixDirectoryPermissionInfo(_nativeLibraryInterface, directory);
+
+        /// <inheritdoc />
+        public DefaultAclInheritanceCalculator CreateDefaultAclInheritanceCalculator(int ownerId, int groupId)
+            => new DefaultAclInheritanceCalculator(_nativeLibraryInterface, ownerId, groupId);
+
+        /// <inheritdoc />
+        public AccessChecker CreateAccessChecker(TimeSpan cacheLifetime)
+            => new AccessChecker(_nativeLibraryInterface, cacheLifetime);
+
+        /// <inheritdoc />
+        public PermissionSnapshotRestorer CreatePermissionSnapshotRestorer()
+            => new PermissionSnapshotRestorer(_nativeLibraryInterface);
+
+        /// <inheritdoc />
+        public AclTextExporter CreateAclTextExporter(bool numeric)
+            => new AclTextExporter(_nativeLibraryInterface, numeric);
+
+        /// <inheritdoc />
+        public AclTextImporter CreateAclTextImporter(bool numeric)
+            => new AclTextImporter(_nativeLibraryInterface, numeric);
     }
 }
\ No newline at end of file
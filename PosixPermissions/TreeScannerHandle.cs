@@ -0,0 +1,35 @@
+﻿using System;
+using System.Runtime.InteropServices;
+
+namespace PosixPermissions
+{
+    /// <summary>
+    /// Wraps the native state of a recursive directory scan, including its open directories.
+    /// </summary>
+    internal sealed class TreeScannerHandle : SafeHandle
+    {
+        /// <summary>
+        /// Creates an invalid handle. Used by the P/Invoke marshaller.
+        /// </summary>
+        public TreeScannerHandle()
+            : base(IntPtr.Zero, true)
+        { }
+
+        /// <inheritdoc />
+        public override bool IsInvalid => handle == IntPtr.Zero;
+
+        /// <summary>
+        /// Releases the given scanner and closes its open directories.
+        /// </summary>
+        /// <param name="scanner">The scanner to release.</param>
+        [DllImport(NativeLibraryInterface.NativeLibraryPath, EntryPoint = "FreeTreeScanner")]
+        private static extern void FreeTreeScanner(IntPtr scanner);
+
+        /// <inheritdoc />
+        protected override bool ReleaseHandle()
+        {
+            FreeTreeScanner(handle);
+            return true;
+        }
+    }
+}
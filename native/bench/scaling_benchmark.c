@@ -0,0 +1,145 @@
+/*
+Measures the read throughput of the native library against the number of threads.
+Usage: scaling_benchmark [-l] [-a] [-t maxThreads] [-s seconds] file...
+    -l: Serialize all calls through one global lock, like the managed wrapper did before native contexts existed.
+    -a: Read ACLs through libacl instead of decoding the extended attributes directly.
+*/
+
+/* INCLUDES */
+
+#include "acl_native.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+
+/* GLOBAL VARIABLES */
+
+// The files to read.
+static char **_files = NULL;
+
+// The number of files to read.
+static int _fileCount = 0;
+
+// Specifies whether all calls are serialized through _lock.
+static int _useLock = 0;
+
+// The options of the worker contexts.
+static native_context_options_t _contextOptions = NATIVE_CONTEXT_OPTION_NONE;
+
+// Lock emulating the former global serialization.
+static pthread_mutex_t _lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Set when the worker threads should stop.
+static atomic_int _stop;
+
+
+/* FUNCTIONS */
+
+// Returns the current monotonic time in seconds.
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Repeatedly reads the permission data of all files, until _stop is set. Stores the number of reads in the given long variable.
+static void *worker(void *arg)
+{
+	long *readCount = arg;
+	native_context_t *context = CreateNativeContext();
+	SetNativeContextOptions(context, _contextOptions);
+	native_acl_entry_t entries[64];
+	
+	long count = 0;
+	int i = 0;
+	while(!atomic_load_explicit(&_stop, memory_order_relaxed))
+	{
+		if(_useLock)
+			pthread_mutex_lock(&_lock);
+		
+		native_permission_data_container_t dataContainer;
+		ReadPermissionDataCtx(context, _files[i], 0, &dataContainer, entries, 64);
+		
+		if(_useLock)
+			pthread_mutex_unlock(&_lock);
+		
+		++count;
+		if(++i == _fileCount)
+			i = 0;
+	}
+	
+	FreeNativeContext(context);
+	*readCount = count;
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	// Parse arguments
+	int maxThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	double seconds = 2.0;
+	int opt;
+	while((opt = getopt(argc, argv, "lat:s:")) != -1)
+	{
+		switch(opt)
+		{
+			case 'l': _useLock = 1; break;
+			case 'a': _contextOptions |= NATIVE_CONTEXT_OPTION_USE_LIBACL; break;
+			case 't': maxThreads = atoi(optarg); break;
+			case 's': seconds = atof(optarg); break;
+			default:
+				fprintf(stderr, "Usage: %s [-l] [-a] [-t maxThreads] [-s seconds] file...\n", argv[0]);
+				return 1;
+		}
+	}
+	if(optind >= argc || maxThreads < 1)
+	{
+		fprintf(stderr, "Usage: %s [-l] [-a] [-t maxThreads] [-s seconds] file...\n", argv[0]);
+		return 1;
+	}
+	_files = &argv[optind];
+	_fileCount = argc - optind;
+	
+	pthread_t *threads = malloc(maxThreads * sizeof(pthread_t));
+	long *readCounts = malloc(maxThreads * sizeof(long));
+	
+	// Run with doubling thread counts
+	printf("threads\treads/s\tspeedup\n");
+	double baseline = 0;
+	for(int threadCount = 1; ; threadCount *= 2)
+	{
+		if(threadCount > maxThreads)
+			threadCount = maxThreads;
+		
+		atomic_store(&_stop, 0);
+		double start = now();
+		for(int t = 0; t < threadCount; ++t)
+			pthread_create(&threads[t], NULL, worker, &readCounts[t]);
+		
+		usleep((useconds_t)(seconds * 1e6));
+		atomic_store(&_stop, 1);
+		
+		long totalReads = 0;
+		for(int t = 0; t < threadCount; ++t)
+		{
+			pthread_join(threads[t], NULL);
+			totalReads += readCounts[t];
+		}
+		double throughput = totalReads / (now() - start);
+		if(threadCount == 1)
+			baseline = throughput;
+		printf("%d\t%.0f\t%.2f\n", threadCount, throughput, throughput / baseline);
+		
+		if(threadCount == maxThreads)
+			break;
+	}
+	
+	free(readCounts);
+	free(threads);
+	return 0;
+}
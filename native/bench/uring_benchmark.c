@@ -0,0 +1,172 @@
+/*
+Measures the batch read throughput of the native library against the io_uring queue depth.
+Usage: uring_benchmark [-w] [-d maxDepth] [-s seconds] directory
+    -w: Assign the directory's current permissions back to its files instead of reading them.
+Every file in the given directory is part of the batch; the first row shows the synchronous implementation.
+*/
+
+/* INCLUDES */
+
+#include "acl_native.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+
+/* GLOBAL VARIABLES */
+
+// The names of the files in the benchmarked directory.
+static const char **_fileNames = NULL;
+
+// The number of files.
+static int _fileCount = 0;
+
+
+/* FUNCTIONS */
+
+// Returns the current monotonic time in seconds.
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Collects the names of the files in the given directory. Returns 0 on success.
+static int load_file_names(const char *directory)
+{
+	DIR *dir = opendir(directory);
+	if(!dir)
+		return -1;
+	
+	int capacity = 1024;
+	_fileNames = malloc(capacity * sizeof(char *));
+	struct dirent *entry;
+	while((entry = readdir(dir)))
+	{
+		if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+			continue;
+		if(_fileCount == capacity)
+		{
+			capacity *= 2;
+			_fileNames = realloc(_fileNames, capacity * sizeof(char *));
+		}
+		_fileNames[_fileCount++] = strdup(entry->d_name);
+	}
+	closedir(dir);
+	return 0;
+}
+
+// Runs batches with the given context for the given time, and returns the number of processed items per second.
+static double run(native_context_t *context, intptr_t dirFd, int write, double seconds, native_compiled_permissions_t *compiledPermissions, native_batch_read_result_t *results, native_batch_status_t *statuses, native_acl_entry_t *entries, int32_t entriesLength)
+{
+	long itemCount = 0;
+	double start = now();
+	double elapsed;
+	do
+	{
+		if(write)
+			ApplyCompiledPermissionsBatchCtx(context, compiledPermissions, dirFd, _fileNames, _fileCount, statuses);
+		else
+			ReadPermissionDataBatchCtx(context, dirFd, _fileNames, _fileCount, 0, results, entries, entriesLength);
+		itemCount += _fileCount;
+		elapsed = now() - start;
+	}
+	while(elapsed < seconds);
+	return itemCount / elapsed;
+}
+
+int main(int argc, char **argv)
+{
+	// Parse arguments
+	int write = 0;
+	int maxDepth = 256;
+	double seconds = 2.0;
+	int opt;
+	while((opt = getopt(argc, argv, "wd:s:")) != -1)
+	{
+		switch(opt)
+		{
+			case 'w': write = 1; break;
+			case 'd': maxDepth = atoi(optarg); break;
+			case 's': seconds = atof(optarg); break;
+			default:
+				fprintf(stderr, "Usage: %s [-w] [-d maxDepth] [-s seconds] directory\n", argv[0]);
+				return 1;
+		}
+	}
+	if(optind != argc - 1 || maxDepth < 1)
+	{
+		fprintf(stderr, "Usage: %s [-w] [-d maxDepth] [-s seconds] directory\n", argv[0]);
+		return 1;
+	}
+	if(load_file_names(argv[optind]) < 0 || _fileCount == 0)
+	{
+		fprintf(stderr, "Could not list files in %s\n", argv[optind]);
+		return 1;
+	}
+	
+	native_context_t *context = CreateNativeContext();
+	intptr_t dirFd;
+	if(OpenDirectoryCtx(context, argv[optind], &dirFd) != NATIVE_ERROR_SUCCESS)
+	{
+		fprintf(stderr, "Could not open %s\n", argv[optind]);
+		return 1;
+	}
+	
+	// Buffers for reading
+	int32_t entriesLength = _fileCount * 16;
+	native_batch_read_result_t *results = malloc(_fileCount * sizeof(native_batch_read_result_t));
+	native_batch_status_t *statuses = malloc(_fileCount * sizeof(native_batch_status_t));
+	native_acl_entry_t *entries = malloc(entriesLength * sizeof(native_acl_entry_t));
+	
+	// When writing, the permissions of the first file are assigned to all files
+	native_compiled_permissions_t *compiledPermissions = NULL;
+	if(write)
+	{
+		native_permission_data_container_t dataContainer;
+		if(ReadPermissionDataAtCtx(context, dirFd, _fileNames[0], 0, &dataContainer, entries, entriesLength) != NATIVE_ERROR_SUCCESS
+		   || CompilePermissionDataCtx(context, 0, &dataContainer, entries, &compiledPermissions) != NATIVE_ERROR_SUCCESS)
+		{
+			fprintf(stderr, "Could not read permissions of %s\n", _fileNames[0]);
+			return 1;
+		}
+	}
+	
+	// Synchronous baseline
+	printf("%d files\n", _fileCount);
+	printf("depth\titems/s\tspeedup\n");
+	double baseline = run(context, dirFd, write, seconds, compiledPermissions, results, statuses, entries, entriesLength);
+	printf("sync\t%.0f\t1.00\n", baseline);
+	
+	// Run with doubling queue depths
+	SetNativeContextOptions(context, NATIVE_CONTEXT_OPTION_IO_URING);
+	for(int depth = 2; ; depth *= 2)
+	{
+		if(depth > maxDepth)
+			depth = maxDepth;
+		
+		SetNativeContextQueueDepth(context, depth);
+		if(!IsIoUringAvailableCtx(context))
+		{
+			fprintf(stderr, "io_uring is not available\n");
+			break;
+		}
+		double throughput = run(context, dirFd, write, seconds, compiledPermissions, results, statuses, entries, entriesLength);
+		printf("%d\t%.0f\t%.2f\n", depth, throughput, throughput / baseline);
+		
+		if(depth == maxDepth)
+			break;
+	}
+	
+	FreeCompiledPermissions(compiledPermissions);
+	CloseDirectory(dirFd);
+	FreeNativeContext(context);
+	free(entries);
+	free(statuses);
+	free(results);
+	return 0;
+}
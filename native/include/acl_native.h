@@ -107,10 +107,10 @@ typedef enum
 	// Indicates that the open() call failed. The corresponding errno value was stored.
 	NATIVE_ERROR_OPEN_FAILED = 1,
 	
-	// Indicates that the fstat() call failed. The corresponding errno value was stored.
+	// Indicates that the statx() call failed. The corresponding errno value was stored.
 	NATIVE_ERROR_FSTAT_FAILED = 2,
 	
-	// Indicates that the acl_get_fd() call failed. The corresponding errno value was stored.
+	// Indicates that the acl_get_file() call failed. The corresponding errno value was stored.
 	NATIVE_ERROR_GET_ACL_FAILED = 3,
 	
 	// Indicates that the acl_get_entry() call failed. The corresponding errno value was stored.
@@ -128,10 +128,10 @@ typedef enum
 	// Indicates that the acl_get_perm() call failed. The corresponding errno value was stored.
 	NATIVE_ERROR_GET_ACL_ENTRY_PERM_FAILED = 8,
 	
-	// Indicates that the fchown() call failed. The corresponding errno value was stored.
+	// Indicates that the fchownat() call failed. The corresponding errno value was stored.
 	NATIVE_ERROR_CHOWN_FAILED = 9,
 	
-	// Indicates that the fchmod() call failed. The corresponding errno value was stored.
+	// Indicates that the chmod() call failed. The corresponding errno value was stored.
 	NATIVE_ERROR_CHMOD_FAILED = 10,
 	
 	// Indicates that the acl_init() call failed. The corresponding errno value was stored.
@@ -160,13 +160,581 @@ typedef enum
 	
 	// Indicates that the acl_set_file() call failed. The corresponding errno value was stored.
 	NATIVE_ERROR_SET_ACL_FAILED = 19,
+	
+	// Indicates that the supplied ACL entry buffer is too small. The required number of entries was stored in the data container's "aclSize" field.
+	NATIVE_ERROR_BUFFER_TOO_SMALL = 20,
+	
+	// Indicates that the getxattr() call failed. The corresponding errno value was stored.
+	NATIVE_ERROR_GET_XATTR_FAILED = 21,
+	
+	// Indicates that an ACL extended attribute has an invalid format.
+	NATIVE_ERROR_INVALID_XATTR = 22,
+	
+	// Indicates that the setxattr() call failed. The corresponding errno value was stored.
+	NATIVE_ERROR_SET_XATTR_FAILED = 23,
+	
+	// Indicates that a memory allocation failed.
+	NATIVE_ERROR_OUT_OF_MEMORY = 24,
+	
+	// Indicates that the getdents64() call failed. The corresponding errno value was stored.
+	NATIVE_ERROR_READ_DIRECTORY_FAILED = 25,
+	
+	// Indicates that the operation was canceled by a callback.
+	NATIVE_ERROR_CANCELED = 26,
+	
+	// Indicates that the given user does not exist in the user database. If the lookup itself failed, the corresponding errno value was stored.
+	NATIVE_ERROR_USER_NOT_FOUND = 27,
+	
+	// Indicates that the given group does not exist in the group database. If the lookup itself failed, the corresponding errno value was stored.
+	NATIVE_ERROR_GROUP_NOT_FOUND = 28,
+	
+	// Indicates that the inotify_init1(), fanotify_init() or eventfd() call failed. The corresponding errno value was stored.
+	NATIVE_ERROR_WATCH_INIT_FAILED = 29,
+	
+	// Indicates that the inotify_add_watch(), inotify_rm_watch() or fanotify_mark() call failed. The corresponding errno value was stored.
+	NATIVE_ERROR_WATCH_FAILED = 30,
+	
+	// Indicates that reading file watcher events failed. The corresponding errno value was stored.
+	NATIVE_ERROR_READ_EVENTS_FAILED = 31
 
 } native_error_code_t;
 static_assert(sizeof(native_error_code_t) <= 4, "Native enum size does not match the one in C#. Check this!");
 
+// Result of one item of a batch read.
+typedef struct
+{
+	// Permission data of the item. aclSize holds the number of ACL entries, even if they did not fit into the entry buffer.
+	native_permission_data_container_t dataContainer;
+	
+	// Index of the item's first ACL entry in the shared entry buffer.
+	int32_t entriesOffset;
+	
+	// Result of reading the item.
+	native_error_code_t status;
+	
+	// The errno value belonging to status, or 0.
+	int32_t errnoValue;
+	
+} native_batch_read_result_t;
+static_assert(sizeof(native_batch_read_result_t) == 9 * 4, "Native struct size does not match the one in C#. This will cause problems during P/Invoke. Fix this!");
+
+// Parts of a file's permissions that were modified by a write. Combined as flags.
+typedef enum
+{
+	// Nothing was modified.
+	NATIVE_PERMISSION_CHANGE_NONE = 0,
+	
+	// The owner was changed.
+	NATIVE_PERMISSION_CHANGE_OWNER = 1,
+	
+	// The group was changed.
+	NATIVE_PERMISSION_CHANGE_GROUP = 2,
+	
+	// The permission bits were changed.
+	NATIVE_PERMISSION_CHANGE_MODE = 4,
+	
+	// The access ACL was written.
+	NATIVE_PERMISSION_CHANGE_ACCESS_ACL = 8,
+	
+	// The default ACL was written or removed.
+	NATIVE_PERMISSION_CHANGE_DEFAULT_ACL = 16
+	
+} native_permission_changes_t;
+static_assert(sizeof(native_permission_changes_t) <= 4, "Native enum size does not match the one in C#. This might cause problems due to different struct sizes. Fix this!");
+
+// Status of one item of a batch operation.
+typedef struct
+{
+	// Result of processing the item.
+	native_error_code_t status;
+	
+	// The errno value belonging to status, or 0.
+	int32_t errnoValue;
+	
+	// The parts of the item's permissions that were modified (native_permission_changes_t flags). Also set for failed items, if a part was modified before the failure.
+	int32_t changes;
+	
+} native_batch_status_t;
+static_assert(sizeof(native_batch_status_t) == 3 * 4, "Native struct size does not match the one in C#. This will cause problems during P/Invoke. Fix this!");
+
+// Identity and change time of a file, to be used as cache key: owner, group, permission bits and ACLs can only change together with the change time. Fields not provided by the file system are 0.
+typedef struct
+{
+	// The device containing the file.
+	uint64_t device;
+	
+	// The inode number of the file.
+	uint64_t inode;
+	
+	// Seconds part of the last status change time (st_ctime).
+	int64_t changeTimeSeconds;
+	
+	// Nanoseconds part of the last status change time.
+	uint32_t changeTimeNanoseconds;
+	
+	// Unused, for alignment.
+	uint32_t reserved;
+	
+} native_file_identity_t;
+static_assert(sizeof(native_file_identity_t) == 8 * 4, "Native struct size does not match the one in C#. This will cause problems during P/Invoke. Fix this!");
+
+// Opaque state of native operations (open file, current ACL and errno). Files are opened once with O_PATH; all further operations use that descriptor, so the path is resolved only once. Each thread or caller uses its own context, so calls with different contexts may run in parallel.
+typedef struct native_context native_context_t;
+
+// Header of a record emitted by a tree scanner. It is followed by accessAclSize access ACL entries, defaultAclSize default ACL entries and the null-terminated relative path; the total length is padded to a multiple of 8 bytes.
+typedef struct
+{
+	// Total size of this record in bytes, including the trailing data and padding.
+	uint32_t recordLength;
+	
+	// Result of reading the file. Unless this is NATIVE_ERROR_FSTAT_FAILED, the stat fields are valid; the ACLs are only valid on success.
+	native_error_code_t status;
+	
+	// The errno value belonging to status, or 0.
+	int32_t errnoValue;
+	
+	// Depth of the file below the scanned root directory, which itself has depth 0.
+	int32_t depth;
+	
+	// The device containing the file.
+	uint64_t device;
+	
+	// The inode number of the file.
+	uint64_t inode;
+	
+	// The UID of the file's owner.
+	int32_t ownerId;
+	
+	// The GID of the file's associated group.
+	int32_t groupId;
+	
+	// The file type and mode bits (st_mode).
+	uint32_t mode;
+	
+	// Number of access ACL entries following the header.
+	int32_t accessAclSize;
+	
+	// Number of default ACL entries following the access ACL entries. Always 0 for files other than directories.
+	int32_t defaultAclSize;
+	
+	// Length of the relative path in bytes, excluding the null terminator. The root directory has an empty path.
+	int32_t pathLength;
+	
+} native_scan_record_t;
+static_assert(sizeof(native_scan_record_t) == 14 * 4, "Native struct size does not match the one in C#. This will cause problems during P/Invoke. Fix this!");
+
+// Opaque state of a recursive directory scan.
+typedef struct native_tree_scanner native_tree_scanner_t;
+
+// Opaque state of an inotify or fanotify file watcher.
+typedef struct native_file_watcher native_file_watcher_t;
+
+// Kinds of changes reported by a file watcher. Combined as flags.
+typedef enum
+{
+	// Owner, group, permission bits, ACLs or other metadata of the file changed.
+	NATIVE_WATCH_EVENT_ATTRIBUTES = 1,
+	
+	// The file was created, or moved to this name.
+	NATIVE_WATCH_EVENT_CREATED = 2,
+	
+	// The file was deleted, or moved away from this name.
+	NATIVE_WATCH_EVENT_DELETED = 4,
+	
+	// The file was moved. Combined with NATIVE_WATCH_EVENT_CREATED or NATIVE_WATCH_EVENT_DELETED.
+	NATIVE_WATCH_EVENT_MOVED = 8,
+	
+	// The file is a directory.
+	NATIVE_WATCH_EVENT_DIRECTORY = 16,
+	
+	// The inotify watch was removed, because the directory was deleted, its file system was unmounted or the watch was removed explicitly.
+	NATIVE_WATCH_EVENT_WATCH_REMOVED = 32,
+	
+	// Events were lost, because the event queue overflowed or an event could not be resolved to a path. All watched files must be revalidated.
+	NATIVE_WATCH_EVENT_OVERFLOW = 64
+	
+} native_watch_event_flags_t;
+static_assert(sizeof(native_watch_event_flags_t) <= 4, "Native enum size does not match the one in C#. Check this!");
+
+// An event reported by a file watcher.
+typedef struct
+{
+	// The watch descriptor of the directory containing the file, as returned by "AddFileWatchCtx". -1 for overflow events and for fanotify watchers.
+	int32_t watchDescriptor;
+	
+	// Combination of native_watch_event_flags_t.
+	uint32_t flags;
+	
+	// Links the two events of a rename with inotify, or 0.
+	uint32_t cookie;
+	
+	// Offset of the null-terminated name in the name buffer, or -1 if the event concerns the watched directory itself. For fanotify watchers, this is the absolute path of the file.
+	int32_t nameOffset;
+	
+} native_watch_event_t;
+static_assert(sizeof(native_watch_event_t) == 4 * 4, "Native struct size does not match the one in C#. This will cause problems during P/Invoke. Fix this!");
+
+// Opaque, validated ACL together with owner, group and permission bits, ready to be assigned to many files.
+typedef struct native_compiled_permissions native_compiled_permissions_t;
+
+// Called for each file or directory a recursive apply fails on. Calls are serialized, but may come from any worker thread.
+// Returns 0 to continue, or any other value to cancel the operation; the callback is not called again then.
+//     path: Path of the failed file, relative to the root directory. The root directory has an empty path.
+//     status: The error code of the failed operation.
+//     errnoValue: The errno value belonging to status, or 0.
+//     userData: The value passed to "ApplyPermissionsRecursiveCtx".
+typedef int32_t (*native_recursive_apply_error_callback_t)(const char *path, native_error_code_t status, int32_t errnoValue, void *userData);
+
+// Counters of a recursive apply.
+typedef struct
+{
+	// Number of directories that were processed, including the root directory.
+	int64_t directoryCount;
+	
+	// Number of other files that were processed.
+	int64_t fileCount;
+	
+	// Number of processed files and directories whose permissions were modified.
+	int64_t changedCount;
+	
+	// Number of symbolic links, which are neither followed nor modified.
+	int64_t skippedCount;
+	
+	// Number of failures reported to the error callback.
+	int64_t failedCount;
+	
+} native_recursive_apply_statistics_t;
+static_assert(sizeof(native_recursive_apply_statistics_t) == 10 * 4, "Native struct size does not match the one in C#. This will cause problems during P/Invoke. Fix this!");
+
+// Options controlling the behavior of a native context.
+typedef enum
+{
+	// Default behavior.
+	NATIVE_CONTEXT_OPTION_NONE = 0,
+	
+	// Read and write ACLs through libacl instead of accessing the "system.posix_acl_*" extended attributes directly. Libraries built without ACLNATIVE_RAW_XATTR always use libacl.
+	NATIVE_CONTEXT_OPTION_USE_LIBACL = 1,
+	
+	// Do not follow a symbolic link in the last path component; operate on the link itself. Symbolic links have no ACL and cannot be chmod'ed, so writes fail with EOPNOTSUPP.
+	NATIVE_CONTEXT_OPTION_NO_FOLLOW = 2,
+	
+	// Batch functions submit their statx, getxattr and setxattr calls to an io_uring instance owned by the context, keeping up to the configured queue depth of operations in flight. Owner and permission bits are still changed synchronously.
+	// Only effective for extended attribute access; ignored with NATIVE_CONTEXT_OPTION_USE_LIBACL. Batch reads run synchronously with NATIVE_CONTEXT_OPTION_NO_FOLLOW, as io_uring can only read extended attributes through paths that follow symbolic links. If the kernel does not support the needed operations, or the library was built without ACLNATIVE_IO_URING, the batch functions run synchronously (see "IsIoUringAvailableCtx").
+	NATIVE_CONTEXT_OPTION_IO_URING = 4,
+	
+	// Read metadata with AT_STATX_DONT_SYNC, so network file systems may answer from cached attributes instead of revalidating them with the server. The returned owner, group and permission bits may be slightly stale.
+	// Writes always compare against synchronized metadata.
+	NATIVE_CONTEXT_OPTION_DONT_SYNC = 8,
+	
+	// Before writing, compare the requested permission bits and ACL with the current ones, and only issue the calls that change something. This costs one ACL read per write, and avoids updating the change time of unchanged files.
+	// Batch writes run synchronously then, even with NATIVE_CONTEXT_OPTION_IO_URING.
+	NATIVE_CONTEXT_OPTION_SKIP_UNCHANGED = 16
+	
+} native_context_options_t;
+static_assert(sizeof(native_context_options_t) <= 4, "Native enum size does not match the one in C#. Check this!");
+
 
 /* FUNCTION DECLARATIONS */
 
+// Allocates a new native context. Returns NULL if the allocation fails.
+native_context_t *CreateNativeContext(void);
+
+// Releases the given native context, including any file and ACL that are still open.
+//     context: The context to release. May be NULL.
+void FreeNativeContext(native_context_t *context);
+
+// Reads the permission data and the ACL entries of the given file or directory in a single pass. The file is not kept open.
+// If the ACL has more than entriesLength entries, NATIVE_ERROR_BUFFER_TOO_SMALL is returned and the required size is stored in dataContainer->aclSize; the call should then be repeated with a larger buffer.
+//     context: The context to store errno.
+//     fileName: The file or directory to query.
+//     loadDefaultAcl: Specifies whether to load a directory's default ACL (1) or not (0). This must be 0 for files.
+//     dataContainer: Pointer to container object to store retrieved permissions and assoiated meta data.
+//     entries: Caller-supplied buffer to be filled with the ACL entries.
+//     entriesLength: Number of entries the buffer can hold.
+native_error_code_t ReadPermissionDataCtx(native_context_t *context, const char *fileName, int32_t loadDefaultAcl, native_permission_data_container_t *dataContainer, native_acl_entry_t *entries, int32_t entriesLength);
+
+// Same as "ReadPermissionDataCtx", but resolves fileName relative to the given directory, so only the last path component is looked up.
+//     context: The context to store errno.
+//     dirFd: Descriptor of the directory containing the file, as returned by "OpenDirectoryCtx", or AT_FDCWD.
+//     fileName: The file or directory to query, relative to dirFd. Absolute names ignore dirFd.
+//     loadDefaultAcl: Specifies whether to load a directory's default ACL (1) or not (0). This must be 0 for files.
+//     dataContainer: Pointer to container object to store retrieved permissions and assoiated meta data.
+//     entries: Caller-supplied buffer to be filled with the ACL entries.
+//     entriesLength: Number of entries the buffer can hold.
+native_error_code_t ReadPermissionDataAtCtx(native_context_t *context, intptr_t dirFd, const char *fileName, int32_t loadDefaultAcl, native_permission_data_container_t *dataContainer, native_acl_entry_t *entries, int32_t entriesLength);
+
+// Same as "ReadPermissionDataAtCtx", but additionally returns the identity and change time of the file, e.g. for validating cached permission data.
+//     context: The context to store errno.
+//     dirFd: Descriptor of the directory containing the file, as returned by "OpenDirectoryCtx", or AT_FDCWD.
+//     fileName: The file or directory to query, relative to dirFd. Absolute names ignore dirFd.
+//     loadDefaultAcl: Specifies whether to load a directory's default ACL (1) or not (0). This must be 0 for files.
+//     dataContainer: Pointer to container object to store retrieved permissions and assoiated meta data.
+//     entries: Caller-supplied buffer to be filled with the ACL entries.
+//     entriesLength: Number of entries the buffer can hold.
+//     identity: Receives the identity of the file. May be NULL, then only owner, group and mode are requested from the file system.
+native_error_code_t ReadPermissionDataWithIdentityAtCtx(native_context_t *context, intptr_t dirFd, const char *fileName, int32_t loadDefaultAcl, native_permission_data_container_t *dataContainer, native_acl_entry_t *entries, int32_t entriesLength, native_file_identity_t *identity);
+
+// Returns the identity and change time of the given file or directory, without opening it or reading its ACL. This is a single statx() call, e.g. for validating cached permission data.
+//     context: The context to store errno.
+//     dirFd: Descriptor of the directory containing the file, as returned by "OpenDirectoryCtx", or AT_FDCWD.
+//     fileName: The file or directory to query, relative to dirFd. Absolute names ignore dirFd.
+//     identity: Receives the identity of the file.
+native_error_code_t ReadFileIdentityAtCtx(native_context_t *context, intptr_t dirFd, const char *fileName, native_file_identity_t *identity);
+
+// Reads the permission data and ACL entries of several files or directories in one call. The ACL entries of all items are stored consecutively in the given entry buffer.
+// Failing items do not abort the batch; their status and errno are stored in the respective result. Items whose ACL does not fit into the remaining buffer get NATIVE_ERROR_BUFFER_TOO_SMALL and consume no entries, so they can be retried separately.
+// With NATIVE_CONTEXT_OPTION_IO_URING, items complete out of order, so the entries are not necessarily stored in item order; use entriesOffset.
+// Returns the number of items that failed.
+//     context: The context used for reading the items.
+//     dirFd: Descriptor of the directory the names are relative to, as returned by "OpenDirectoryCtx", or AT_FDCWD.
+//     fileNames: The files or directories to query.
+//     fileCount: Number of items in fileNames and results.
+//     loadDefaultAcl: Specifies whether to load the directories' default ACLs (1) or not (0). This must be 0 for files.
+//     results: Buffer to be filled with the results of the individual items.
+//     entries: Caller-supplied buffer to be filled with the ACL entries of all items.
+//     entriesLength: Number of entries the buffer can hold.
+int32_t ReadPermissionDataBatchCtx(native_context_t *context, intptr_t dirFd, const char **fileNames, int32_t fileCount, int32_t loadDefaultAcl, native_batch_read_result_t *results, native_acl_entry_t *entries, int32_t entriesLength);
+
+// Sets the options of the given native context.
+//     context: The context to configure.
+//     options: Combination of native_context_options_t flags.
+void SetNativeContextOptions(native_context_t *context, native_context_options_t options);
+
+// Sets the number of operations the io_uring instance of the given context keeps in flight. An existing instance is released and recreated with the new depth on next use.
+//     context: The context to configure.
+//     queueDepth: The queue depth, or 0 for the default of 64.
+void SetNativeContextQueueDepth(native_context_t *context, int32_t queueDepth);
+
+// Returns whether the batch functions can use io_uring with the given context (1) or not (0). The io_uring instance is created if it does not exist yet.
+//     context: The context to check.
+int32_t IsIoUringAvailableCtx(native_context_t *context);
+
+// Opens the ACL of the given file or directory, and reads its permission data. The file is kept open in the given context and must be closed using "ReadFileAclAndCloseCtx".
+//     context: The context to store the open file, the ACL and errno.
+//     fileName: The file or directory to query.
+//     loadDefaultAcl: Specifies whether to load a directory's default ACL (1) or not (0). This must be 0 for files.
+//     dataContainer: Pointer to container object to store retrieved permissions and assoiated meta data.
+native_error_code_t OpenFileAndReadPermissionDataCtx(native_context_t *context, const char *fileName, int32_t loadDefaultAcl, native_permission_data_container_t *dataContainer);
+
+// Retrieves the ACL entries from the file previously opened in the given context. The file is automatically closed afterwards.
+//     context: The context passed to "OpenFileAndReadPermissionDataCtx".
+//     entries: Array with empty ACL entries to be filled by the native implementation.
+native_error_code_t ReadFileAclAndCloseCtx(native_context_t *context, native_acl_entry_t *entries);
+
+// Sets the permission data and ACL entries of the given file.
+//     context: The context to store errno.
+//     fileName: The file or directory to update.
+//     setDefaultAcl: Specifies whether to set a directory's default ACL (1) or not (0). This must be 0 for files.
+//     dataContainer: Pointer to container object with permissions and assoiated meta data.
+//     entries: Array with ACL entries to be written.
+native_error_code_t SetFilePermissionDataAndAclCtx(native_context_t *context, const char *fileName, int32_t setDefaultAcl, native_permission_data_container_t *dataContainer, native_acl_entry_t *entries);
+
+// Same as "SetFilePermissionDataAndAclCtx", but resolves fileName relative to the given directory, so only the last path component is looked up.
+//     context: The context to store errno.
+//     dirFd: Descriptor of the directory containing the file, as returned by "OpenDirectoryCtx", or AT_FDCWD.
+//     fileName: The file or directory to update, relative to dirFd. Absolute names ignore dirFd.
+//     setDefaultAcl: Specifies whether to set a directory's default ACL (1) or not (0). This must be 0 for files.
+//     dataContainer: Pointer to container object with permissions and assoiated meta data.
+//     entries: Array with ACL entries to be written.
+native_error_code_t SetFilePermissionDataAndAclAtCtx(native_context_t *context, intptr_t dirFd, const char *fileName, int32_t setDefaultAcl, native_permission_data_container_t *dataContainer, native_acl_entry_t *entries);
+
+// Same as "SetFilePermissionDataAndAclAtCtx", but additionally reports which parts of the file's permissions were modified. With NATIVE_CONTEXT_OPTION_SKIP_UNCHANGED, unchanged parts are not written.
+//     context: The context to store errno.
+//     dirFd: Descriptor of the directory containing the file, as returned by "OpenDirectoryCtx", or AT_FDCWD.
+//     fileName: The file or directory to update, relative to dirFd. Absolute names ignore dirFd.
+//     setDefaultAcl: Specifies whether to set a directory's default ACL (1) or not (0). This must be 0 for files.
+//     dataContainer: Pointer to container object with permissions and assoiated meta data.
+//     entries: Array with ACL entries to be written.
+//     changes: Receives the modified parts (native_permission_changes_t flags), also on failure. May be NULL.
+native_error_code_t SetFilePermissionDataAndAclWithChangesAtCtx(native_context_t *context, intptr_t dirFd, const char *fileName, int32_t setDefaultAcl, native_permission_data_container_t *dataContainer, native_acl_entry_t *entries, int32_t *changes);
+
+// Reads the permission data, the access ACL and the default ACL of the given directory, opening it only once. The file is not kept open.
+// The default ACL entries are stored directly behind the access ACL entries. If both ACLs together have more than entriesLength entries, NATIVE_ERROR_BUFFER_TOO_SMALL is returned and both sizes are stored; the call should then be repeated with a larger buffer.
+//     context: The context to store errno.
+//     dirFd: Descriptor of the directory containing the directory, as returned by "OpenDirectoryCtx", or AT_FDCWD.
+//     dirName: The directory to query, relative to dirFd. Absolute names ignore dirFd.
+//     dataContainer: Pointer to container object to store retrieved permissions and assoiated meta data. The aclSize field receives the size of the access ACL.
+//     entries: Caller-supplied buffer to be filled with the ACL entries.
+//     entriesLength: Number of entries the buffer can hold.
+//     defaultAclSize: Receives the size of the default ACL. 0 means that the directory has no default ACL.
+native_error_code_t ReadDirectoryPermissionDataAtCtx(native_context_t *context, intptr_t dirFd, const char *dirName, native_permission_data_container_t *dataContainer, native_acl_entry_t *entries, int32_t entriesLength, int32_t *defaultAclSize);
+
+// Sets the permission data, the access ACL and the default ACL of the given directory, opening it only once. Nothing is changed if the given file is not a directory.
+//     context: The context to store errno.
+//     dirFd: Descriptor of the directory containing the directory, as returned by "OpenDirectoryCtx", or AT_FDCWD.
+//     dirName: The directory to update, relative to dirFd. Absolute names ignore dirFd.
+//     dataContainer: Pointer to container object with permissions and assoiated meta data. The aclSize field holds the size of the access ACL.
+//     entries: Array with the access ACL entries, directly followed by the default ACL entries.
+//     defaultAclSize: Number of default ACL entries. If this is 0, the directory's default ACL is removed.
+//     changes: Receives the modified parts (native_permission_changes_t flags), also on failure. With NATIVE_CONTEXT_OPTION_SKIP_UNCHANGED, unchanged parts are not written. May be NULL.
+native_error_code_t SetDirectoryPermissionDataAtCtx(native_context_t *context, intptr_t dirFd, const char *dirName, native_permission_data_container_t *dataContainer, native_acl_entry_t *entries, int32_t defaultAclSize, int32_t *changes);
+
+// Opens the given directory, to be passed to the "*AtCtx" functions. The descriptor must be released using "CloseDirectory".
+//     context: The context to store errno.
+//     dirName: The directory to open.
+//     dirFd: Receives the directory descriptor, or -1 on failure.
+native_error_code_t OpenDirectoryCtx(native_context_t *context, const char *dirName, intptr_t *dirFd);
+
+// Opens a directory relative to an already open directory, to be passed to the "*AtCtx" functions. The descriptor must be released using "CloseDirectory".
+//     context: The context to store errno.
+//     parentDirFd: Descriptor of the parent directory, as returned by "OpenDirectoryCtx", or AT_FDCWD.
+//     dirName: The directory to open, relative to parentDirFd.
+//     dirFd: Receives the directory descriptor, or -1 on failure.
+native_error_code_t OpenDirectoryAtCtx(native_context_t *context, intptr_t parentDirFd, const char *dirName, intptr_t *dirFd);
+
+// Closes a directory descriptor returned by "OpenDirectoryCtx" or "OpenDirectoryAtCtx".
+//     dirFd: The descriptor to close. Negative values are ignored.
+void CloseDirectory(intptr_t dirFd);
+
+// Builds and validates the given permission data and ACL entries once, so they can be assigned to many files with "ApplyCompiledPermissionsBatchCtx". The result must be released using "FreeCompiledPermissions".
+// The ACL is stored in the representation selected by the context options (libacl or posix_acl_xattr blob).
+//     context: The context to store errno.
+//     setDefaultAcl: Specifies whether the ACL is assigned as a directory's default ACL (1) or not (0). Owner, group and permission bits are not applied to default ACLs.
+//     dataContainer: Pointer to container object with permissions and assoiated meta data.
+//     entries: Array with ACL entries, in any order.
+//     compiledPermissions: Receives the compiled permissions, or NULL on failure.
+native_error_code_t CompilePermissionDataCtx(native_context_t *context, int32_t setDefaultAcl, const native_permission_data_container_t *dataContainer, const native_acl_entry_t *entries, native_compiled_permissions_t **compiledPermissions);
+
+// Assigns the given compiled permissions to several files or directories. Failing items do not abort the batch; their status and errno are stored in the respective result.
+// With NATIVE_CONTEXT_OPTION_IO_URING, the extended attributes of several items are written concurrently.
+// Returns the number of items that failed.
+//     context: The context used for updating the items.
+//     compiledPermissions: The permissions to assign, as returned by "CompilePermissionDataCtx".
+//     dirFd: Descriptor of the directory the names are relative to, as returned by "OpenDirectoryCtx", or AT_FDCWD.
+//     fileNames: The files or directories to update.
+//     fileCount: Number of items in fileNames and results.
+//     results: Buffer to be filled with the status of the individual items.
+int32_t ApplyCompiledPermissionsBatchCtx(native_context_t *context, const native_compiled_permissions_t *compiledPermissions, intptr_t dirFd, const char **fileNames, int32_t fileCount, native_batch_status_t *results);
+
+// Releases compiled permissions.
+//     compiledPermissions: The compiled permissions to release. May be NULL.
+void FreeCompiledPermissions(native_compiled_permissions_t *compiledPermissions);
+
+// Opens the given root directory for a recursive scan. The scanner must be released using "FreeTreeScanner".
+// The scan does not follow symbolic links; the root directory itself may be a symbolic link to a directory.
+//     context: The context to store errno.
+//     rootPath: The directory to scan.
+//     scanner: Receives the scanner, or NULL on failure.
+native_error_code_t CreateTreeScannerCtx(native_context_t *context, const char *rootPath, native_tree_scanner_t **scanner);
+
+// Continues the given scan, and fills the buffer with as many native_scan_record_t records as fit. The root directory is emitted first, each directory is emitted before its contents.
+// Failures of individual files are stored in their records. If a directory cannot be enumerated, NATIVE_ERROR_READ_DIRECTORY_FAILED is returned together with the records written so far; its remaining contents are skipped and the scan may be continued.
+// If not even a single record fits, NATIVE_ERROR_BUFFER_TOO_SMALL is returned and the required size is stored in bytesWritten. The scan is complete when no records are returned.
+//     context: The context used for reading the files.
+//     scanner: The scanner returned by "CreateTreeScannerCtx".
+//     buffer: Caller-supplied buffer to be filled with records. Should be 8-byte aligned.
+//     bufferLength: Size of the buffer in bytes.
+//     bytesWritten: Receives the number of bytes written.
+//     recordCount: Receives the number of records written.
+native_error_code_t ReadTreeScannerRecordsCtx(native_context_t *context, native_tree_scanner_t *scanner, char *buffer, int32_t bufferLength, int32_t *bytesWritten, int32_t *recordCount);
+
+// Releases the given scanner and closes its open directories.
+//     scanner: The scanner to release. May be NULL.
+void FreeTreeScanner(native_tree_scanner_t *scanner);
+
+// Recursively assigns compiled permissions to the given directory and all files and directories below it. Each directory is updated before its contents.
+// The traversal uses openat() relative to the open parent directory and does not follow symbolic links; the root directory itself may be a symbolic link to a directory.
+// Subdirectories are distributed over a pool of worker threads: each worker processes the directories it discovered itself first, and takes work from the other workers when it runs out.
+// Every worker uses its own context with the options of the given context, plus NATIVE_CONTEXT_OPTION_NO_FOLLOW; the writes run synchronously.
+// Failing files do not abort the operation; they are reported to the error callback. Returns NATIVE_ERROR_CANCELED if the callback canceled the operation.
+//     context: The context to store errno, if the root directory cannot be opened.
+//     rootPath: The directory to update.
+//     filePermissions: The permissions to assign to files other than directories, compiled with setDefaultAcl = 0. If NULL, these files are not modified.
+//     directoryPermissions: The permissions to assign to directories, compiled with setDefaultAcl = 0. If NULL, the access ACLs of directories are not modified.
+//     directoryDefaultPermissions: The default ACL to assign to directories, compiled with setDefaultAcl = 1. If NULL, the default ACLs of directories are not modified.
+//     threadCount: Number of worker threads, including the calling thread. If this is 0 or less, one thread per online CPU is used.
+//     errorCallback: Function to call for each failure. May be NULL.
+//     userData: Value passed to errorCallback.
+//     statistics: Receives the counters of the operation.
+native_error_code_t ApplyPermissionsRecursiveCtx(native_context_t *context, const char *rootPath, const native_compiled_permissions_t *filePermissions, const native_compiled_permissions_t *directoryPermissions, const native_compiled_permissions_t *directoryDefaultPermissions, int32_t threadCount, native_recursive_apply_error_callback_t errorCallback, void *userData, native_recursive_apply_statistics_t *statistics);
+
+// Determines the groups the given user is a member of, as listed in the user and group databases (getgrouplist()). The primary group of the user is included.
+// If the user is a member of more than groupIdsLength groups, NATIVE_ERROR_BUFFER_TOO_SMALL is returned and the required size is stored in groupCount; the call should then be repeated with a larger buffer.
+//     context: The context to store errno.
+//     userId: The UID of the user.
+//     groupIds: Array to store the GIDs of the groups.
+//     groupIdsLength: Length of the groupIds array.
+//     groupCount: Receives the number of groups.
+native_error_code_t GetUserGroupsCtx(native_context_t *context, int32_t userId, int32_t *groupIds, int32_t groupIdsLength, int32_t *groupCount);
+
+// Looks up the name of the given user in the user database.
+// If the name does not fit into the buffer, NATIVE_ERROR_BUFFER_TOO_SMALL is returned; the call should then be repeated with a buffer of the size stored in requiredLength.
+//     context: The context to store errno.
+//     userId: The UID of the user.
+//     name: Buffer to store the null-terminated name.
+//     nameLength: Length of the name buffer.
+//     requiredLength: Receives the length of the name including the terminating null byte.
+native_error_code_t GetUserNameCtx(native_context_t *context, int32_t userId, char *name, int32_t nameLength, int32_t *requiredLength);
+
+// Looks up the name of the given group in the group database. See GetUserNameCtx() for the handling of the buffer.
+//     context: The context to store errno.
+//     groupId: The GID of the group.
+//     name: Buffer to store the null-terminated name.
+//     nameLength: Length of the name buffer.
+//     requiredLength: Receives the length of the name including the terminating null byte.
+native_error_code_t GetGroupNameCtx(native_context_t *context, int32_t groupId, char *name, int32_t nameLength, int32_t *requiredLength);
+
+// Looks up the UID of the given user name in the user database.
+//     context: The context to store errno.
+//     name: The name of the user.
+//     userId: Receives the UID of the user.
+native_error_code_t GetUserIdCtx(native_context_t *context, const char *name, int32_t *userId);
+
+// Looks up the GID of the given group name in the group database.
+//     context: The context to store errno.
+//     name: The name of the group.
+//     groupId: Receives the GID of the group.
+native_error_code_t GetGroupIdCtx(native_context_t *context, const char *name, int32_t *groupId);
+
+// Creates a watcher for changes of file metadata. The watcher must be released using "FreeFileWatcher".
+// inotify watchers report changes of the files in explicitly watched directories. fanotify watchers need CAP_SYS_ADMIN and CAP_DAC_READ_SEARCH, and report changes on entire file systems, identified by absolute paths.
+//     context: The context to store errno.
+//     useFanotify: Specifies whether to use fanotify (1) or inotify (0).
+//     watcher: Receives the watcher, or NULL on failure.
+native_error_code_t CreateFileWatcherCtx(native_context_t *context, int32_t useFanotify, native_file_watcher_t **watcher);
+
+// Starts watching the given directory. inotify watchers watch the directory and its direct children; subdirectories need their own watches. Watching a directory again returns the same watch descriptor.
+// fanotify watchers watch the entire file system containing the given path.
+//     context: The context to store errno.
+//     watcher: The watcher returned by "CreateFileWatcherCtx".
+//     path: The directory to watch. Symbolic links are not followed.
+//     watchDescriptor: Receives the watch descriptor, or -1 for fanotify watchers.
+native_error_code_t AddFileWatchCtx(native_context_t *context, native_file_watcher_t *watcher, const char *path, int32_t *watchDescriptor);
+
+// Stops watching the directory with the given watch descriptor. A NATIVE_WATCH_EVENT_WATCH_REMOVED event is reported afterwards. Does nothing for fanotify watchers.
+//     context: The context to store errno.
+//     watcher: The watcher returned by "CreateFileWatcherCtx".
+//     watchDescriptor: The watch descriptor returned by "AddFileWatchCtx".
+native_error_code_t RemoveFileWatchCtx(native_context_t *context, native_file_watcher_t *watcher, int32_t watchDescriptor);
+
+// Waits until events are available, and fills the given buffers with as many events as fit. Events which do not fit are kept for the next call.
+// Returns NATIVE_ERROR_CANCELED when "CancelFileWatcher" was called. If the name of the next event does not fit into an empty name buffer, NATIVE_ERROR_BUFFER_TOO_SMALL is returned; a buffer of PATH_MAX bytes always suffices.
+//     context: The context to store errno.
+//     watcher: The watcher returned by "CreateFileWatcherCtx".
+//     events: Caller-supplied buffer to be filled with events.
+//     eventsLength: Number of events the buffer can hold.
+//     names: Caller-supplied buffer to be filled with the null-terminated names of the events.
+//     namesLength: Size of the name buffer in bytes.
+//     eventCount: Receives the number of events.
+native_error_code_t ReadFileWatchEventsCtx(native_context_t *context, native_file_watcher_t *watcher, native_watch_event_t *events, int32_t eventsLength, char *names, int32_t namesLength, int32_t *eventCount);
+
+// Makes all running and future calls of "ReadFileWatchEventsCtx" on the given watcher return NATIVE_ERROR_CANCELED. May be called from any thread.
+//     watcher: The watcher returned by "CreateFileWatcherCtx".
+void CancelFileWatcher(native_file_watcher_t *watcher);
+
+// Releases the given watcher and removes its watches.
+//     watcher: The watcher to release. May be NULL.
+void FreeFileWatcher(native_file_watcher_t *watcher);
+
+// Returns the last value of "errno" stored in the given context and its string representation.
+// This function will return 0 and an empty error string if called without an error actually having occured in the last function call using this context.
+//     context: The context passed to the failed function.
+//     errnoStringBuffer: Pointer to a string buffer to return the last value of strerror().
+//     errnoStringBufferLength: Length of the error string buffer passed in errnoStringBuffer.
+int64_t GetContextErrnoValue(native_context_t *context, char *errnoStringBuffer, int errnoStringBufferLength);
+
+// The following functions use an implicit context per calling thread.
+
 // Opens the ACL of the given file or directory, and reads its permission data. The file is kept open and must be closed using "ReadFileAclAndClose".
 //     fileName: The file or directory to query.
 //     loadDefaultAcl: Specifies whether to load a directory's default ACL (1) or not (0). This must be 0 for files.
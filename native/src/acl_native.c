@@ -1,5 +1,8 @@
 /* INCLUDES */
 
+// Needed for O_PATH and AT_EMPTY_PATH
+#define _GNU_SOURCE
+
 #include "acl_native.h"
 #include <unistd.h>
 #include <sys/stat.h>
@@ -9,388 +12,3687 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <sys/xattr.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <stdatomic.h>
+#include <pwd.h>
+#include <grp.h>
+#include <poll.h>
+#include <limits.h>
+#include <sys/inotify.h>
+#include <sys/fanotify.h>
+#include <sys/eventfd.h>
+#include <sys/statfs.h>
 
+#ifdef ACLNATIVE_RAW_XATTR
+#include <endian.h>
+#endif
 
-/* GLOBAL VARIABLES */
+#ifdef ACLNATIVE_IO_URING
+#ifndef ACLNATIVE_RAW_XATTR
+#error "ACLNATIVE_IO_URING requires ACLNATIVE_RAW_XATTR."
+#endif
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#endif
+
+
+/* TYPES */
+
+#ifdef ACLNATIVE_IO_URING
+
+// Queue depth of io_uring instances, unless configured otherwise.
+#define URING_DEFAULT_QUEUE_DEPTH 64
+
+// Size of the path buffer of an io_uring slot. Items with longer paths are processed synchronously.
+#define URING_PATH_SIZE 512
+
+// Size of the extended attribute buffer of an io_uring slot. Larger ACLs are read again synchronously.
+#define URING_XATTR_BUFFER_SIZE (4 + 32 * 8)
+
+// State of one batch item whose operations are in flight in an io_uring instance.
+typedef struct
+{
+	// Index of the item in the batch, or -1 if the slot is free.
+	int32_t index;
+	
+	// Number of submitted operations which have not completed yet.
+	int32_t pendingCount;
+	
+	// Result of the statx operation: 0 or a negative errno value.
+	int32_t statxResult;
+	
+	// Result of the getxattr or setxattr operation: the attribute length or a negative errno value.
+	int32_t xattrResult;
+	
+	// Descriptor which must stay open until the setxattr operation completed, or -1.
+	int fd;
+	
+	// Metadata returned by the statx operation.
+	struct statx statxBuffer;
+	
+	// Path passed to the xattr operation, which has no directory descriptor argument.
+	char path[URING_PATH_SIZE];
+	
+	// Buffer receiving the ACL extended attribute.
+	char xattr[URING_XATTR_BUFFER_SIZE];
+	
+} uring_slot_t;
+
+// An io_uring instance with its mapped rings. Operations are identified by their slot index times 2, plus 1 for xattr operations.
+typedef struct
+{
+	// Descriptor of the io_uring instance.
+	int ringFd;
+	
+	// Number of submission queue entries.
+	uint32_t sqEntries;
+	
+	// Mapped submission queue ring and its size.
+	void *sqRing;
+	size_t sqRingSize;
+	
+	// Mapped completion queue ring and its size. Equals sqRing if the kernel maps both rings at once.
+	void *cqRing;
+	size_t cqRingSize;
+	
+	// Mapped submission queue entries and their size.
+	struct io_uring_sqe *sqes;
+	size_t sqesSize;
+	
+	// Pointers into the submission queue ring.
+	uint32_t *sqHead;
+	uint32_t *sqTail;
+	uint32_t sqMask;
+	uint32_t *sqArray;
+	
+	// Tail of the submission queue including prepared, but not yet published entries.
+	uint32_t sqLocalTail;
+	
+	// Pointers into the completion queue ring.
+	uint32_t *cqHead;
+	uint32_t *cqTail;
+	uint32_t cqMask;
+	struct io_uring_cqe *cqes;
+	
+	// Item slots, one per submission queue entry.
+	uring_slot_t *slots;
+	
+} uring_engine_t;
+
+// State of a batch read running on an io_uring instance.
+typedef struct
+{
+	// Descriptor of the directory the names are relative to, or AT_FDCWD.
+	int dirFd;
+	
+	// The names of the items.
+	const char **fileNames;
+	
+	// Specifies whether to load the directories' default ACLs.
+	int32_t loadDefaultAcl;
+	
+	// Buffer receiving the results of the items.
+	native_batch_read_result_t *results;
+	
+	// Buffer receiving the ACL entries of all items, and its length.
+	native_acl_entry_t *entries;
+	int32_t entriesLength;
+	
+	// Number of entries used so far.
+	int32_t entriesUsed;
+	
+	// Number of items that failed so far.
+	int32_t failedCount;
+	
+} uring_read_batch_t;
+
+// State of a batch apply running on an io_uring instance.
+typedef struct
+{
+	// Descriptor of the directory the names are relative to, or AT_FDCWD.
+	int dirFd;
+	
+	// The names of the items.
+	const char **fileNames;
+	
+	// The permissions to assign. Always holds an xattr blob.
+	const native_compiled_permissions_t *compiledPermissions;
+	
+	// Buffer receiving the status of the items.
+	native_batch_status_t *results;
+	
+	// Number of items that failed so far.
+	int32_t failedCount;
+	
+} uring_apply_batch_t;
+
+// Prepares the operations of the batch item assigned to the given slot. Returns the number of submitted operations, or 0 if the item was completed synchronously.
+typedef int32_t (*uring_prepare_callback_t)(native_context_t *context, uring_engine_t *uring, uring_slot_t *slot, void *batch);
+
+// Completes the batch item assigned to the given slot, after all its operations finished.
+typedef void (*uring_complete_callback_t)(native_context_t *context, uring_slot_t *slot, void *batch);
+
+#endif
+
+// Holds the state of one native operation. Every thread or caller uses its own context, so the functions operating on a context are reentrant.
+struct native_context
+{
+	// Options controlling the behavior of this context.
+	native_context_options_t options;
+
+	// The file descriptor returned by open(), or -1 if no file is open. Opened with O_PATH, so it is only usable for statx() and fchownat(); other operations use fdPath.
+	int fd;
+	
+	// The path of fd in /proc/self/fd. Path-based functions resolve this without walking the original path again.
+	char fdPath[32];
+
+	// The current ACL handle.
+	acl_t acl;
+
+	// The last errno value.
+	int lastErrnoValue;
+
+	// The last value of strerror().
+	char lastErrnoString[256];
+	
+#ifdef ACLNATIVE_IO_URING
+	// Queue depth of the io_uring instance, or 0 for the default.
+	int32_t queueDepth;
+	
+	// The io_uring instance used by batch functions, created on first use.
+	uring_engine_t *uring;
+	
+	// Set when the io_uring instance could not be created or failed, so batch functions run synchronously.
+	int uringUnavailable;
+#endif
+};
+
+// Validated ACL together with owner, group and permission bits, ready to be assigned to many files.
+struct native_compiled_permissions
+{
+	// Specifies whether the ACL is assigned as a directory's default ACL. Owner, group and permission bits are not applied then.
+	int32_t setDefaultAcl;
+	
+	// Owner, group and permission bits to apply.
+	native_permission_data_container_t dataContainer;
+	
+	// The validated libacl ACL, or NULL if the xattr blob is used.
+	acl_t acl;
+	
+	// The ACL entries in the form returned by read_acl(), for comparing them with the current ACL of a file. See normalize_acl_entries().
+	native_acl_entry_t *normalizedEntries;
+	
+#ifdef ACLNATIVE_RAW_XATTR
+	// The serialized and validated posix_acl_xattr blob, or NULL if the libacl ACL is used.
+	char *xattr;
+	
+	// Size of the xattr blob in bytes.
+	size_t xattrLength;
+#endif
+};
+
+// The statx() fields needed for permission data. Requesting only these allows network file systems to skip revalidating other attributes.
+#define STATX_PERMISSION_DATA_MASK (STATX_TYPE | STATX_MODE | STATX_UID | STATX_GID)
+
+// Number of ACL entries which are compared on the stack; larger ACLs need a heap buffer.
+#define ACL_COMPARE_STACK_ENTRIES 32
+
+// Size of the getdents64() buffer of each directory being scanned.
+#define TREE_SCANNER_DIRENT_BUFFER_SIZE (32 * 1024)
+
+// Size of the buffer for "/proc/self/fd/<fd>" paths.
+#define TREE_SCANNER_ACL_PATH_SIZE 32
+
+// Directory entry as returned by the getdents64() system call.
+typedef struct
+{
+	// The inode number.
+	uint64_t d_ino;
+	
+	// Opaque offset of the next entry.
+	int64_t d_off;
+	
+	// Size of this entry in bytes.
+	unsigned short d_reclen;
+	
+	// The file type, or DT_UNKNOWN.
+	unsigned char d_type;
+	
+	// The null-terminated file name.
+	char d_name[];
+	
+} linux_dirent64_t;
+
+// A directory currently being enumerated by a tree scanner.
+typedef struct
+{
+	// Descriptor of the open directory.
+	int fd;
+	
+	// Buffer for getdents64() results.
+	char *entries;
+	
+	// Number of valid bytes in entries.
+	long entriesLength;
+	
+	// Offset of the next unprocessed entry in entries.
+	long entriesPosition;
+	
+	// Length of the directory's relative path in the scanner's path buffer.
+	size_t pathLength;
+	
+} tree_scanner_directory_t;
+
+// State of a recursive directory scan. Only the directories on the current path are kept open.
+struct native_tree_scanner
+{
+	// Stack of the directories being enumerated; the innermost one is on top.
+	tree_scanner_directory_t *directories;
+	
+	// Number of directories on the stack.
+	int32_t directoryCount;
+	
+	// Number of allocated stack slots.
+	int32_t directoryCapacity;
+	
+	// Relative path of the current file.
+	char *path;
+	
+	// Allocated size of the path buffer.
+	size_t pathCapacity;
+	
+	// Specifies whether the record of the root directory has been emitted.
+	int rootEmitted;
+};
+
+// An open directory whose contents are being updated by a recursive apply. Its subdirectories are opened relative to it.
+typedef struct
+{
+	// Descriptor of the open directory.
+	int fd;
+	
+	// Number of references: one of the worker enumerating the directory, and one of each queued subdirectory.
+	atomic_int referenceCount;
+	
+	// Path of the directory relative to the root directory.
+	char *path;
+	
+	// Length of path in bytes, excluding the null terminator.
+	size_t pathLength;
+	
+} recursive_apply_directory_t;
+
+// A directory waiting to be processed by a recursive apply.
+typedef struct
+{
+	// The parent directory, which holds a reference for this item.
+	recursive_apply_directory_t *parent;
+	
+	// Name of the directory relative to parent, or NULL if parent is the directory itself (only used for the root directory).
+	char *name;
+	
+} recursive_apply_item_t;
+
+// Queue of the directories discovered by one worker. The owner adds and takes items at the back, other workers steal from the front, where the items closest to the root are.
+typedef struct
+{
+	// Protects the queue contents.
+	pthread_mutex_t lock;
+	
+	// Ring buffer of queued items.
+	recursive_apply_item_t *items;
+	
+	// Number of allocated items.
+	int32_t capacity;
+	
+	// Index of the front item.
+	int32_t front;
+	
+	// Number of queued items. Can be read without holding the lock.
+	atomic_int count;
+	
+} recursive_apply_queue_t;
+
+typedef struct recursive_apply_state recursive_apply_state_t;
+
+// State of one worker thread of a recursive apply.
+typedef struct
+{
+	// The shared state.
+	recursive_apply_state_t *state;
+	
+	// Index of this worker in the worker array.
+	int32_t index;
+	
+	// The context used for updating files.
+	native_context_t context;
+	
+	// The directories discovered by this worker.
+	recursive_apply_queue_t queue;
+	
+	// Buffer for getdents64() results.
+	char *entries;
+	
+	// Buffer for building paths of failed files.
+	char *path;
+	
+	// Allocated size of the path buffer.
+	size_t pathCapacity;
+	
+	// The counters of this worker.
+	native_recursive_apply_statistics_t statistics;
+	
+} recursive_apply_worker_t;
+
+// Shared state of a recursive apply.
+struct recursive_apply_state
+{
+	// The permissions to assign to files, directories and as default ACL of directories. Each may be NULL.
+	const native_compiled_permissions_t *filePermissions;
+	const native_compiled_permissions_t *directoryPermissions;
+	const native_compiled_permissions_t *directoryDefaultPermissions;
+	
+	// The workers.
+	recursive_apply_worker_t *workers;
+	
+	// Number of workers.
+	int32_t workerCount;
+	
+	// Number of directories which are queued or being processed. The operation is complete when this drops to 0.
+	atomic_long pendingCount;
+	
+	// Number of workers waiting for new items.
+	atomic_int idleCount;
+	
+	// Set when the error callback requested cancellation.
+	atomic_int canceled;
+	
+	// Lock and condition variable for waking idle workers.
+	pthread_mutex_t idleLock;
+	pthread_cond_t idleCondition;
+	
+	// Serializes the calls of the error callback.
+	pthread_mutex_t callbackLock;
+	
+	// The error callback and its user data.
+	native_recursive_apply_error_callback_t errorCallback;
+	void *userData;
+};
 
-// The file descriptor returned by open().
-static int _fd = 0;
+// Size of the buffer for raw inotify or fanotify events. Large enough for several events with maximum name length.
+#define FILE_WATCHER_BUFFER_SIZE (64 * 1024)
 
-// The current ACL handle.
-static acl_t _acl = NULL;
+// The inotify events a file watcher subscribes to for each watched directory.
+#define FILE_WATCHER_INOTIFY_MASK (IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK)
 
-// The last errno value;
-static int _lastErrnoValue = 0;
+#ifdef FAN_REPORT_DFID_NAME
 
-// The last value of str_error().
-static char _lastErrnoString[256] = { 0 };
+// The fanotify events a file watcher subscribes to for each marked file system.
+#define FILE_WATCHER_FANOTIFY_MASK (FAN_ATTRIB | FAN_CREATE | FAN_DELETE | FAN_MOVED_FROM | FAN_MOVED_TO | FAN_ONDIR)
+
+#endif
+
+// A file system marked by a fanotify file watcher.
+typedef struct
+{
+	// The file system ID reported in the events (f_fsid).
+	fsid_t fsid;
+	
+	// A descriptor of a directory on the file system, for resolving file handles.
+	int fd;
+	
+} file_watcher_mount_t;
+
+// State of an inotify or fanotify file watcher.
+struct native_file_watcher
+{
+	// The inotify or fanotify descriptor.
+	int fd;
+	
+	// An eventfd which becomes readable when the watcher is canceled.
+	int cancelFd;
+	
+	// Specifies whether this watcher uses fanotify.
+	int isFanotify;
+	
+	// The file systems marked by a fanotify watcher.
+	file_watcher_mount_t *mounts;
+	
+	// Number of marked file systems.
+	int32_t mountCount;
+	
+	// Read position and end of the unprocessed events in the buffer.
+	size_t bufferPosition;
+	size_t bufferEnd;
+	
+	// Raw events read from the descriptor, which did not fit into the caller's buffers yet.
+	char buffer[FILE_WATCHER_BUFFER_SIZE] __attribute__((aligned(8)));
+};
+
+#ifdef ACLNATIVE_RAW_XATTR
+
+// Header of the kernel's posix_acl_xattr format, as stored in the "system.posix_acl_access" and "system.posix_acl_default" extended attributes. All fields are little endian.
+typedef struct
+{
+	// The format version, always XATTR_ACL_VERSION.
+	uint32_t version;
+	
+} xattr_acl_header_t;
+
+// One entry of the kernel's posix_acl_xattr format. All fields are little endian.
+typedef struct
+{
+	// The entry tag (one of the ACL_USER_OBJ, ... constants of libacl).
+	uint16_t tag;
+	
+	// The entry permissions (ACL_READ, ACL_WRITE, ACL_EXECUTE).
+	uint16_t perm;
+	
+	// The entry tag qualifier. Only meaningful for ACL_USER and ACL_GROUP.
+	uint32_t id;
+	
+} xattr_acl_entry_t;
+static_assert(sizeof(xattr_acl_header_t) == 4 && sizeof(xattr_acl_entry_t) == 8, "The posix_acl_xattr structures do not match the kernel format.");
+
+// The only posix_acl_xattr format version supported by the kernel.
+#define XATTR_ACL_VERSION 0x0002
+
+// Size of the stack buffer used for reading ACL extended attributes. Larger ACLs are read into a heap buffer.
+#define XATTR_ACL_STACK_BUFFER_SIZE (sizeof(xattr_acl_header_t) + 128 * sizeof(xattr_acl_entry_t))
+
+#endif
+
+
+/* GLOBAL VARIABLES */
+
+// The context used by the context-less API functions. Each thread has its own instance.
+static _Thread_local native_context_t _threadContext = { .options = NATIVE_CONTEXT_OPTION_NONE, .fd = -1, .fdPath = { 0 }, .acl = NULL, .lastErrnoValue = 0, .lastErrnoString = { 0 } };
 
 
 /* UTILITY FUNCTIONS */
 
-// Stores the current value of errno.
-static void store_errno(void)
+// Stores the current value of errno in the given context.
+static void store_errno(native_context_t *context)
+{
+	context->lastErrnoValue = errno;
+	
+	// The GNU variant of strerror_r() may return a static string instead of filling the buffer
+	const char *errnoString = strerror_r(errno, context->lastErrnoString, sizeof(context->lastErrnoString));
+	if(errnoString != context->lastErrnoString)
+	{
+		strncpy(context->lastErrnoString, errnoString, sizeof(context->lastErrnoString));
+		context->lastErrnoString[sizeof(context->lastErrnoString) - 1] = '\0';
+	}
+}
+
+// Frees the ACL handle of the given context, if set.
+static void free_context_acl(native_context_t *context)
+{
+	if(context->acl)
+	{
+		acl_free(context->acl);
+		context->acl = NULL;
+	}
+}
+
+// Cleans up the file descriptor and the ACL handle of the given context (if set), and returns the given error code.
+static native_error_code_t cleanup_with_error_code(native_context_t *context, native_error_code_t errorCode)
+{
+	free_context_acl(context);
+	if(context->fd >= 0)
+	{
+		close(context->fd);
+		context->fd = -1;
+	}
+	return errorCode;
+}
+
+// Initializes the given context with default options, and without an open file or ACL.
+static void init_native_context(native_context_t *context)
+{
+	context->options = NATIVE_CONTEXT_OPTION_NONE;
+	context->fd = -1;
+	context->fdPath[0] = '\0';
+	context->acl = NULL;
+	context->lastErrnoValue = 0;
+	context->lastErrnoString[0] = '\0';
+#ifdef ACLNATIVE_IO_URING
+	context->queueDepth = 0;
+	context->uring = NULL;
+	context->uringUnavailable = 0;
+#endif
+}
+
+// Returns the synchronization flag for statx() calls reading metadata with the given context.
+static int get_statx_sync_flag(const native_context_t *context)
+{
+	return (context->options & NATIVE_CONTEXT_OPTION_DONT_SYNC) ? AT_STATX_DONT_SYNC : AT_STATX_SYNC_AS_STAT;
+}
+
+// Fills the owner, group and UNIX permission fields of the given data container from the given file metadata.
+static void fill_permission_data(const struct statx *fileStat, native_permission_data_container_t *dataContainer)
+{
+	mode_t mode = fileStat->stx_mode;
+	dataContainer->ownerId = fileStat->stx_uid;
+	dataContainer->groupId = fileStat->stx_gid;
+	dataContainer->ownerPermissions = ((mode & S_IRUSR) ? FILE_PERMISSION_READ : FILE_PERMISSION_NONE)
+	                                | ((mode & S_IWUSR) ? FILE_PERMISSION_WRITE : FILE_PERMISSION_NONE)
+	                                | ((mode & S_IXUSR) ? FILE_PERMISSION_EXECUTE : FILE_PERMISSION_NONE)
+	                                | ((mode & S_ISUID) ? FILE_PERMISSION_SETID : FILE_PERMISSION_NONE)
+	                                | ((mode & S_ISVTX) ? FILE_PERMISSION_STICKY : FILE_PERMISSION_NONE);
+	dataContainer->groupPermissions = ((mode & S_IRGRP) ? FILE_PERMISSION_READ : FILE_PERMISSION_NONE)
+	                                | ((mode & S_IWGRP) ? FILE_PERMISSION_WRITE : FILE_PERMISSION_NONE)
+	                                | ((mode & S_IXGRP) ? FILE_PERMISSION_EXECUTE : FILE_PERMISSION_NONE)
+	                                | ((mode & S_ISGID) ? FILE_PERMISSION_SETID : FILE_PERMISSION_NONE);
+	dataContainer->otherPermissions = ((mode & S_IROTH) ? FILE_PERMISSION_READ : FILE_PERMISSION_NONE)
+	                                | ((mode & S_IWOTH) ? FILE_PERMISSION_WRITE : FILE_PERMISSION_NONE)
+	                                | ((mode & S_IXOTH) ? FILE_PERMISSION_EXECUTE : FILE_PERMISSION_NONE);
+}
+
+// Opens the given file or directory with O_PATH, so neither read permission on the file nor a full open is needed. The file descriptor and its /proc/self/fd path are stored in the given context.
+// Relative names are resolved against dirFd, which may be AT_FDCWD. Symbolic links are only followed if NATIVE_CONTEXT_OPTION_NO_FOLLOW is not set. On failure, errno is stored.
+static native_error_code_t open_file(native_context_t *context, int dirFd, const char *fileName)
+{
+	// Release leftovers of an incomplete previous operation
+	cleanup_with_error_code(context, NATIVE_ERROR_SUCCESS);
+	
+	// Open file or directory
+	context->fd = openat(dirFd, fileName, O_PATH | O_CLOEXEC | ((context->options & NATIVE_CONTEXT_OPTION_NO_FOLLOW) ? O_NOFOLLOW : 0));
+	if(context->fd < 0)
+	{
+		store_errno(context);
+		return NATIVE_ERROR_OPEN_FAILED;
+	}
+	snprintf(context->fdPath, sizeof(context->fdPath), "/proc/self/fd/%d", context->fd);
+	
+	return NATIVE_ERROR_SUCCESS;
+}
+
+// Fills the given buffer with the minimal ACL equivalent to the permission bits in the given data container, as far as it fits. The total entry count is stored in aclSize.
+static void fill_minimal_acl(const native_permission_data_container_t *dataContainer, native_acl_entry_t *entries, int32_t entriesLength, int32_t *aclSize)
+{
+	native_acl_entry_t minimalAcl[3] =
+	{
+		{ ACL_ENTRY_TAG_TYPE_USER_OBJ, 0, dataContainer->ownerPermissions & (FILE_PERMISSION_READ | FILE_PERMISSION_WRITE | FILE_PERMISSION_EXECUTE) },
+		{ ACL_ENTRY_TAG_TYPE_GROUP_OBJ, 0, dataContainer->groupPermissions & (FILE_PERMISSION_READ | FILE_PERMISSION_WRITE | FILE_PERMISSION_EXECUTE) },
+		{ ACL_ENTRY_TAG_TYPE_OTHER, 0, dataContainer->otherPermissions }
+	};
+	for(int i = 0; i < 3 && i < entriesLength; ++i)
+		entries[i] = minimalAcl[i];
+	*aclSize = 3;
+}
+
+// Returns the name of the extended attribute storing the access or default ACL.
+static const char *get_acl_attribute_name(int32_t loadDefaultAcl)
+{
+	return loadDefaultAcl > 0 ? "system.posix_acl_default" : "system.posix_acl_access";
+}
+
+// Fills the given buffer with the ACL of a file that has no ACL attribute, like libacl would return it: the access ACL is derived from the permission data, the default ACL is empty.
+static void fill_acl_without_xattr(int32_t loadDefaultAcl, const native_permission_data_container_t *dataContainer, native_acl_entry_t *entries, int32_t entriesLength, int32_t *aclSize)
+{
+	if(loadDefaultAcl > 0)
+		*aclSize = 0;
+	else
+		fill_minimal_acl(dataContainer, entries, entriesLength, aclSize);
+}
+
+// Copies device, inode number and change time from the given statx() result. Fields which were not returned are set to 0.
+static void fill_file_identity(const struct statx *fileStat, native_file_identity_t *identity)
+{
+	identity->device = makedev(fileStat->stx_dev_major, fileStat->stx_dev_minor);
+	identity->inode = (fileStat->stx_mask & STATX_INO) ? fileStat->stx_ino : 0;
+	identity->changeTimeSeconds = (fileStat->stx_mask & STATX_CTIME) ? fileStat->stx_ctime.tv_sec : 0;
+	identity->changeTimeNanoseconds = (fileStat->stx_mask & STATX_CTIME) ? fileStat->stx_ctime.tv_nsec : 0;
+	identity->reserved = 0;
+}
+
+// Opens the given file or directory relative to dirFd and reads its permission data. The file descriptor is stored in the given context, the file mode (including its type) in fileMode.
+// If identity is not NULL, inode number and change time are requested as well and stored there.
+// On failure, errno is stored and the context is cleaned up.
+static native_error_code_t open_file_and_read_metadata(native_context_t *context, int dirFd, const char *fileName, native_permission_data_container_t *dataContainer, mode_t *fileMode, native_file_identity_t *identity)
+{
+	// Open file or directory
+	native_error_code_t err = open_file(context, dirFd, fileName);
+	if(err != NATIVE_ERROR_SUCCESS)
+		return err;
+	
+	// Read file metadata; only the needed fields are requested
+	struct statx fileStat;
+	unsigned int mask = STATX_PERMISSION_DATA_MASK | (identity ? STATX_INO | STATX_CTIME : 0);
+	if(statx(context->fd, "", AT_EMPTY_PATH | get_statx_sync_flag(context), mask, &fileStat) < 0)
+	{
+		store_errno(context);
+		return cleanup_with_error_code(context, NATIVE_ERROR_FSTAT_FAILED);
+	}
+	
+	// Fill basic permission fields
+	fill_permission_data(&fileStat, dataContainer);
+	*fileMode = fileStat.stx_mode;
+	
+	if(identity)
+		fill_file_identity(&fileStat, identity);
+	
+	return NATIVE_ERROR_SUCCESS;
+}
+
+// Opens the given file or directory, reads its permission data and loads its ACL. The file descriptor and the ACL are stored in the given context.
+// On failure, errno is stored and the context is cleaned up.
+static native_error_code_t open_file_and_load_acl(native_context_t *context, const char *fileName, int32_t loadDefaultAcl, native_permission_data_container_t *dataContainer)
+{
+	// Open file and read permission data
+	mode_t fileMode;
+	native_error_code_t err = open_file_and_read_metadata(context, AT_FDCWD, fileName, dataContainer, &fileMode, NULL);
+	if(err != NATIVE_ERROR_SUCCESS)
+		return err;
+	
+	// Try to load ACL
+	context->acl = acl_get_file(context->fdPath, loadDefaultAcl > 0 ? ACL_TYPE_DEFAULT : ACL_TYPE_ACCESS);
+	if(!context->acl)
+	{
+		store_errno(context);
+		return cleanup_with_error_code(context, NATIVE_ERROR_GET_ACL_FAILED);
+	}
+	
+	return NATIVE_ERROR_SUCCESS;
+}
+
+// Converts the given libacl entry into its native representation. On failure, errno is stored; the context is not cleaned up.
+static native_error_code_t convert_acl_entry(native_context_t *context, acl_entry_t aclEntry, native_acl_entry_t *e)
+{
+	// Set tag type
+	acl_tag_t tagType;
+	if(acl_get_tag_type(aclEntry, &tagType) < 0)
+	{
+		store_errno(context);
+		return NATIVE_ERROR_GET_ACL_ENTRY_TAG_TYPE_FAILED;
+	}
+	switch(tagType)
+	{
+		case ACL_USER_OBJ:      e->tagType = ACL_ENTRY_TAG_TYPE_USER_OBJ;  break;
+		case ACL_USER:          e->tagType = ACL_ENTRY_TAG_TYPE_USER;      break;
+		case ACL_GROUP_OBJ:     e->tagType = ACL_ENTRY_TAG_TYPE_GROUP_OBJ; break;
+		case ACL_GROUP:         e->tagType = ACL_ENTRY_TAG_TYPE_GROUP;     break;
+		case ACL_MASK:          e->tagType = ACL_ENTRY_TAG_TYPE_MASK;      break;
+		case ACL_OTHER:         e->tagType = ACL_ENTRY_TAG_TYPE_OTHER;     break;
+		case ACL_UNDEFINED_TAG: /* TODO */                                 break;
+		default:                                                           break;
+	}
+	
+	// Set tag qualifier
+	switch(tagType)
+	{
+		case ACL_USER:
+		case ACL_GROUP:
+		{
+			void *tagQualifier = acl_get_qualifier(aclEntry);
+			if(!tagQualifier)
+			{
+				store_errno(context);
+				return NATIVE_ERROR_GET_ACL_ENTRY_QUALIFIER_FAILED;
+			}
+			e->tagQualifier = *(int32_t *)tagQualifier;
+			
+			acl_free(tagQualifier);
+			break;
+		}
+		
+		default:
+			e->tagQualifier = 0;
+			break;
+	}
+	
+	// Set permissions
+	acl_permset_t permset;
+	if(acl_get_permset(aclEntry, &permset) < 0)
+	{
+		store_errno(context);
+		return NATIVE_ERROR_GET_ACL_ENTRY_PERMSET_FAILED;
+	}
+	int canRead = acl_get_perm(permset, ACL_READ);
+	if(canRead < 0)
+	{
+		store_errno(context);
+		return NATIVE_ERROR_GET_ACL_ENTRY_PERM_FAILED;
+	}
+	int canWrite = acl_get_perm(permset, ACL_WRITE);
+	if(canWrite < 0)
+	{
+		store_errno(context);
+		return NATIVE_ERROR_GET_ACL_ENTRY_PERM_FAILED;
+	}
+	int canExecute = acl_get_perm(permset, ACL_EXECUTE);
+	if(canExecute < 0)
+	{
+		store_errno(context);
+		return NATIVE_ERROR_GET_ACL_ENTRY_PERM_FAILED;
+	}
+	e->permissions = (canRead > 0 ? FILE_PERMISSION_READ : FILE_PERMISSION_NONE)
+	               | (canWrite > 0 ? FILE_PERMISSION_WRITE : FILE_PERMISSION_NONE)
+	               | (canExecute > 0 ? FILE_PERMISSION_EXECUTE : FILE_PERMISSION_NONE);
+	
+	return NATIVE_ERROR_SUCCESS;
+}
+
+// Loads the ACL of the given file through libacl, and converts all entries that fit into the given buffer. The total entry count is stored in aclSize. The ACL is stored in the given context.
+// Files without an ACL attribute are detected with a single size query, and their ACL is derived from the permission data without libacl.
+// On failure, errno is stored; the context is not cleaned up.
+static native_error_code_t read_acl_libacl(native_context_t *context, const char *path, int32_t loadDefaultAcl, const native_permission_data_container_t *dataContainer, native_acl_entry_t *entries, int32_t entriesLength, int32_t *aclSize)
+{
+	// Most files do not have an extended ACL; other errors are left to libacl
+	if(getxattr(path, get_acl_attribute_name(loadDefaultAcl), NULL, 0) < 0 && errno == ENODATA)
+	{
+		fill_acl_without_xattr(loadDefaultAcl, dataContainer, entries, entriesLength, aclSize);
+		return NATIVE_ERROR_SUCCESS;
+	}
+	
+	// Try to load ACL; the other ACL of the same file may still be loaded
+	free_context_acl(context);
+	context->acl = acl_get_file(path, loadDefaultAcl > 0 ? ACL_TYPE_DEFAULT : ACL_TYPE_ACCESS);
+	if(!context->acl)
+	{
+		store_errno(context);
+		return NATIVE_ERROR_GET_ACL_FAILED;
+	}
+	
+	// Iterate ACL once, converting all entries that fit into the buffer while counting the total
+	int count = 0;
+	acl_entry_t currEntry;
+	int aclStatus = acl_get_entry(context->acl, ACL_FIRST_ENTRY, &currEntry);
+	while(aclStatus > 0)
+	{
+		if(count < entriesLength)
+		{
+			native_error_code_t err = convert_acl_entry(context, currEntry, &entries[count]);
+			if(err != NATIVE_ERROR_SUCCESS)
+				return err;
+		}
+		
+		++count;
+		aclStatus = acl_get_entry(context->acl, ACL_NEXT_ENTRY, &currEntry);
+	}
+	if(aclStatus < 0)
+	{
+		store_errno(context);
+		return NATIVE_ERROR_GET_ACL_ENTRY_FAILED;
+	}
+	
+	*aclSize = (int32_t)count;
+	return NATIVE_ERROR_SUCCESS;
+}
+
+#ifdef ACLNATIVE_RAW_XATTR
+
+// Decodes the given posix_acl_xattr blob, and converts all entries that fit into the given buffer. The total entry count is stored in aclSize.
+static native_error_code_t decode_xattr_acl(const char *buffer, size_t bufferLength, native_acl_entry_t *entries, int32_t entriesLength, int32_t *aclSize)
+{
+	// Check header
+	if(bufferLength < sizeof(xattr_acl_header_t) || (bufferLength - sizeof(xattr_acl_header_t)) % sizeof(xattr_acl_entry_t) != 0)
+		return NATIVE_ERROR_INVALID_XATTR;
+	const xattr_acl_header_t *header = (const xattr_acl_header_t *)buffer;
+	if(le32toh(header->version) != XATTR_ACL_VERSION)
+		return NATIVE_ERROR_INVALID_XATTR;
+	
+	// Convert entries
+	int count = (int)((bufferLength - sizeof(xattr_acl_header_t)) / sizeof(xattr_acl_entry_t));
+	const xattr_acl_entry_t *xattrEntries = (const xattr_acl_entry_t *)(buffer + sizeof(xattr_acl_header_t));
+	for(int i = 0; i < count && i < entriesLength; ++i)
+	{
+		native_acl_entry_t *e = &entries[i];
+		uint16_t perm = le16toh(xattrEntries[i].perm);
+		switch(le16toh(xattrEntries[i].tag))
+		{
+			case ACL_USER_OBJ:  e->tagType = ACL_ENTRY_TAG_TYPE_USER_OBJ;  e->tagQualifier = 0; break;
+			case ACL_USER:      e->tagType = ACL_ENTRY_TAG_TYPE_USER;      e->tagQualifier = (int32_t)le32toh(xattrEntries[i].id); break;
+			case ACL_GROUP_OBJ: e->tagType = ACL_ENTRY_TAG_TYPE_GROUP_OBJ; e->tagQualifier = 0; break;
+			case ACL_GROUP:     e->tagType = ACL_ENTRY_TAG_TYPE_GROUP;     e->tagQualifier = (int32_t)le32toh(xattrEntries[i].id); break;
+			case ACL_MASK:      e->tagType = ACL_ENTRY_TAG_TYPE_MASK;      e->tagQualifier = 0; break;
+			case ACL_OTHER:     e->tagType = ACL_ENTRY_TAG_TYPE_OTHER;     e->tagQualifier = 0; break;
+			default: return NATIVE_ERROR_INVALID_XATTR;
+		}
+		e->permissions = ((perm & ACL_READ) ? FILE_PERMISSION_READ : FILE_PERMISSION_NONE)
+		               | ((perm & ACL_WRITE) ? FILE_PERMISSION_WRITE : FILE_PERMISSION_NONE)
+		               | ((perm & ACL_EXECUTE) ? FILE_PERMISSION_EXECUTE : FILE_PERMISSION_NONE);
+	}
+	
+	*aclSize = (int32_t)count;
+	return NATIVE_ERROR_SUCCESS;
+}
+
+// Reads the ACL of the given file directly from its extended attribute, and converts all entries that fit into the given buffer. The total entry count is stored in aclSize.
+// Files without an ACL attribute get the same ACL that libacl would return: the access ACL is derived from the permission data, the default ACL is empty.
+// On failure, errno is stored; the context is not cleaned up.
+static native_error_code_t read_acl_xattr(native_context_t *context, const char *path, int32_t loadDefaultAcl, const native_permission_data_container_t *dataContainer, native_acl_entry_t *entries, int32_t entriesLength, int32_t *aclSize)
+{
+	const char *attributeName = get_acl_attribute_name(loadDefaultAcl);
+	
+	// Most ACLs fit into the stack buffer; if not, query the size and use a heap buffer
+	char stackBuffer[XATTR_ACL_STACK_BUFFER_SIZE];
+	char *buffer = stackBuffer;
+	ssize_t length = getxattr(path, attributeName, buffer, sizeof(stackBuffer));
+	while(length < 0 && errno == ERANGE)
+	{
+		if(buffer != stackBuffer)
+			free(buffer);
+		buffer = NULL;
+		
+		ssize_t requiredLength = getxattr(path, attributeName, NULL, 0);
+		if(requiredLength < 0)
+			break;
+		buffer = malloc(requiredLength);
+		if(!buffer)
+		{
+			errno = ENOMEM;
+			break;
+		}
+		length = getxattr(path, attributeName, buffer, requiredLength);
+	}
+	if(length < 0)
+	{
+		int lastError = errno;
+		if(buffer != stackBuffer)
+			free(buffer);
+		
+		// No extended ACL: Emulate libacl
+		if(lastError == ENODATA)
+		{
+			fill_acl_without_xattr(loadDefaultAcl, dataContainer, entries, entriesLength, aclSize);
+			return NATIVE_ERROR_SUCCESS;
+		}
+		
+		errno = lastError;
+		store_errno(context);
+		return NATIVE_ERROR_GET_XATTR_FAILED;
+	}
+	
+	// Decode
+	native_error_code_t err = decode_xattr_acl(buffer, (size_t)length, entries, entriesLength, aclSize);
+	if(buffer != stackBuffer)
+		free(buffer);
+	return err;
+}
+
+#endif
+
+// Reads the access or default ACL of the given file, using libacl or the extended attribute depending on the context options, and converts all entries that fit into the given buffer. The total entry count is stored in aclSize.
+// Symbolic links (only opened with NATIVE_CONTEXT_OPTION_NO_FOLLOW) cannot have an ACL of their own, so their access ACL is derived from the permission data.
+// On failure, errno is stored; the context is not cleaned up.
+static native_error_code_t read_acl(native_context_t *context, const char *path, int32_t loadDefaultAcl, mode_t fileMode, const native_permission_data_container_t *dataContainer, native_acl_entry_t *entries, int32_t entriesLength, int32_t *aclSize)
+{
+	if(S_ISLNK(fileMode) && loadDefaultAcl <= 0)
+	{
+		fill_minimal_acl(dataContainer, entries, entriesLength, aclSize);
+		return NATIVE_ERROR_SUCCESS;
+	}
+	
+	// Only directories have a default ACL; libacl reports EACCES for other files
+	if(loadDefaultAcl > 0 && !S_ISDIR(fileMode))
+	{
+		errno = EACCES;
+		store_errno(context);
+		return NATIVE_ERROR_GET_ACL_FAILED;
+	}
+	
+#ifdef ACLNATIVE_RAW_XATTR
+	if(!(context->options & NATIVE_CONTEXT_OPTION_USE_LIBACL))
+		return read_acl_xattr(context, path, loadDefaultAcl, dataContainer, entries, entriesLength, aclSize);
+#endif
+	return read_acl_libacl(context, path, loadDefaultAcl, dataContainer, entries, entriesLength, aclSize);
+}
+
+// Converts the owner, group and other permissions of the given data container into standard permission bits.
+static mode_t permission_data_to_mode(const native_permission_data_container_t *dataContainer)
+{
+	return ((dataContainer->ownerPermissions & FILE_PERMISSION_READ) ? S_IRUSR : 0)
+	     | ((dataContainer->ownerPermissions & FILE_PERMISSION_WRITE) ? S_IWUSR : 0)
+	     | ((dataContainer->ownerPermissions & FILE_PERMISSION_EXECUTE) ? S_IXUSR : 0)
+	     | ((dataContainer->ownerPermissions & FILE_PERMISSION_SETID) ? S_ISUID : 0)
+	     | ((dataContainer->ownerPermissions & FILE_PERMISSION_STICKY) ? S_ISVTX : 0)
+	     | ((dataContainer->groupPermissions & FILE_PERMISSION_READ) ? S_IRGRP : 0)
+	     | ((dataContainer->groupPermissions & FILE_PERMISSION_WRITE) ? S_IWGRP : 0)
+	     | ((dataContainer->groupPermissions & FILE_PERMISSION_EXECUTE) ? S_IXGRP : 0)
+	     | ((dataContainer->groupPermissions & FILE_PERMISSION_SETID) ? S_ISGID : 0)
+	     | ((dataContainer->otherPermissions & FILE_PERMISSION_READ) ? S_IROTH : 0)
+	     | ((dataContainer->otherPermissions & FILE_PERMISSION_WRITE) ? S_IWOTH : 0)
+	     | ((dataContainer->otherPermissions & FILE_PERMISSION_EXECUTE) ? S_IXOTH : 0);
+}
+
+// Orders native ACL entries like the kernel stores them: by tag, then by qualifier.
+static int compare_acl_entries(const void *a, const void *b)
+{
+	const native_acl_entry_t *entryA = a;
+	const native_acl_entry_t *entryB = b;
+	if(entryA->tagType != entryB->tagType)
+		return entryA->tagType < entryB->tagType ? -1 : 1;
+	if(entryA->tagQualifier != entryB->tagQualifier)
+		return (uint32_t)entryA->tagQualifier < (uint32_t)entryB->tagQualifier ? -1 : 1;
+	return 0;
+}
+
+// Copies the given entries into the given buffer in the form returned by read_acl(): ordered, without qualifiers for the non-named entries, and without special permission bits.
+static void normalize_acl_entries(const native_acl_entry_t *entries, int32_t entryCount, native_acl_entry_t *normalizedEntries)
+{
+	for(int i = 0; i < entryCount; ++i)
+	{
+		native_acl_entry_t *e = &normalizedEntries[i];
+		e->tagType = entries[i].tagType;
+		e->tagQualifier = (e->tagType == ACL_ENTRY_TAG_TYPE_USER || e->tagType == ACL_ENTRY_TAG_TYPE_GROUP) ? entries[i].tagQualifier : 0;
+		e->permissions = entries[i].permissions & (FILE_PERMISSION_READ | FILE_PERMISSION_WRITE | FILE_PERMISSION_EXECUTE);
+	}
+	qsort(normalizedEntries, entryCount, sizeof(native_acl_entry_t), compare_acl_entries);
+}
+
+// Returns the permission bits a file ends up with after the given chmod() bits and access ACL were applied: setting the ACL replaces the owner, group and other bits, where the mask entry takes precedence over the owning group entry.
+static mode_t get_mode_after_acl(mode_t chmodBits, const native_acl_entry_t *entries, int32_t entryCount)
+{
+	mode_t mode = chmodBits & (S_ISUID | S_ISGID | S_ISVTX);
+	mode_t groupBits = 0;
+	int hasMask = 0;
+	for(int i = 0; i < entryCount; ++i)
+	{
+		mode_t bits = entries[i].permissions & (FILE_PERMISSION_READ | FILE_PERMISSION_WRITE | FILE_PERMISSION_EXECUTE);
+		switch(entries[i].tagType)
+		{
+			case ACL_ENTRY_TAG_TYPE_USER_OBJ: mode |= bits << 6; break;
+			case ACL_ENTRY_TAG_TYPE_GROUP_OBJ: if(!hasMask) groupBits = bits; break;
+			case ACL_ENTRY_TAG_TYPE_MASK: groupBits = bits; hasMask = 1; break;
+			case ACL_ENTRY_TAG_TYPE_OTHER: mode |= bits; break;
+			default: break;
+		}
+	}
+	return mode | (groupBits << 3);
+}
+
+// Checks whether the access or default ACL of the file opened in the given context matches the given normalized entries. For files without an access ACL attribute, the ACL is derived from the given current permission data.
+// If the ACL cannot be read, it is reported as changed, so the following write reports the actual problem. Errno is not stored.
+static int is_acl_unchanged(native_context_t *context, int32_t defaultAcl, mode_t fileMode, const native_permission_data_container_t *currentData, const native_acl_entry_t *normalizedEntries, int32_t entryCount)
+{
+	// Entries beyond the expected count are not converted, but still counted
+	native_acl_entry_t stackEntries[ACL_COMPARE_STACK_ENTRIES];
+	native_acl_entry_t *currentEntries = stackEntries;
+	if(entryCount > ACL_COMPARE_STACK_ENTRIES)
+	{
+		currentEntries = malloc(entryCount * sizeof(native_acl_entry_t));
+		if(!currentEntries)
+			return 0;
+	}
+	int32_t aclSize = 0;
+	int unchanged = read_acl(context, context->fdPath, defaultAcl, fileMode, currentData, currentEntries, entryCount, &aclSize) == NATIVE_ERROR_SUCCESS
+	             && aclSize == entryCount;
+	for(int i = 0; unchanged && i < entryCount; ++i)
+	{
+		unchanged = currentEntries[i].tagType == normalizedEntries[i].tagType
+		         && currentEntries[i].tagQualifier == normalizedEntries[i].tagQualifier
+		         && currentEntries[i].permissions == normalizedEntries[i].permissions;
+	}
+	
+	if(currentEntries != stackEntries)
+		free(currentEntries);
+	free_context_acl(context);
+	context->lastErrnoValue = 0;
+	return unchanged;
+}
+
+// Opens the given file or directory relative to dirFd and applies owner, group and standard permission bits, unless setDefaultAcl is set. The file descriptor is stored in the given context.
+// If requireDirectory is set, nothing is changed if the file is not a directory.
+// If normalizedEntries is not NULL (see normalize_acl_entries()), the ACL to be written is compared with the current one first, and only differing permission bits are changed. The ACL flag is only stored in changes if the ACL differs; the caller must write it then.
+// Without normalizedEntries, the permission bits are always set and the ACL flag is always stored. The other modified parts are stored in changes, also on failure.
+// On failure, errno is stored and the context is cleaned up.
+static native_error_code_t open_file_and_update_metadata(native_context_t *context, int dirFd, const char *fileName, int32_t setDefaultAcl, int32_t requireDirectory, const native_permission_data_container_t *dataContainer, const native_acl_entry_t *normalizedEntries, int32_t *changes)
+{
+	*changes = NATIVE_PERMISSION_CHANGE_NONE;
+	
+	// Open file or directory
+	native_error_code_t err = open_file(context, dirFd, fileName);
+	if(err != NATIVE_ERROR_SUCCESS)
+		return err;
+	
+	// Read file metadata, to be able to detect whether owner, group or mode are modified; this must not be stale
+	struct statx fileStat;
+	if(statx(context->fd, "", AT_EMPTY_PATH | AT_STATX_SYNC_AS_STAT, STATX_PERMISSION_DATA_MASK, &fileStat) < 0)
+	{
+		store_errno(context);
+		return cleanup_with_error_code(context, NATIVE_ERROR_FSTAT_FAILED);
+	}
+	
+	// Symbolic links (only opened with NATIVE_CONTEXT_OPTION_NO_FOLLOW) have neither permission bits nor an ACL of their own
+	if(S_ISLNK(fileStat.stx_mode))
+	{
+		errno = EOPNOTSUPP;
+		store_errno(context);
+		return cleanup_with_error_code(context, setDefaultAcl > 0 ? NATIVE_ERROR_SET_ACL_FAILED : NATIVE_ERROR_CHMOD_FAILED);
+	}
+	
+	// Only directories have a default ACL; the kernel reports EACCES for other files
+	if(requireDirectory && !S_ISDIR(fileStat.stx_mode))
+	{
+		errno = EACCES;
+		store_errno(context);
+		return cleanup_with_error_code(context, NATIVE_ERROR_SET_ACL_FAILED);
+	}
+	
+	// Compare ACL
+	int aclUnchanged = 0;
+	if(normalizedEntries)
+	{
+		native_permission_data_container_t currentData;
+		fill_permission_data(&fileStat, &currentData);
+		aclUnchanged = is_acl_unchanged(context, setDefaultAcl, fileStat.stx_mode, &currentData, normalizedEntries, dataContainer->aclSize);
+	}
+	if(!aclUnchanged)
+		*changes |= setDefaultAcl > 0 ? NATIVE_PERMISSION_CHANGE_DEFAULT_ACL : NATIVE_PERMISSION_CHANGE_ACCESS_ACL;
+	
+	// Update owner and UNIX permissions
+	if(!setDefaultAcl)
+	{
+		// Change owner and group
+		uid_t newOwner = -1;
+		gid_t newGroup = -1;
+		if(dataContainer->ownerId != fileStat.stx_uid)
+			newOwner = dataContainer->ownerId;
+		if(dataContainer->groupId != fileStat.stx_gid)
+			newGroup = dataContainer->groupId;
+		if((newOwner != -1 || newGroup != -1) && fchownat(context->fd, "", newOwner, newGroup, AT_EMPTY_PATH) < 0)
+		{
+			store_errno(context);
+			return cleanup_with_error_code(context, NATIVE_ERROR_CHOWN_FAILED);
+		}
+		if(newOwner != -1)
+			*changes |= NATIVE_PERMISSION_CHANGE_OWNER;
+		if(newGroup != -1)
+			*changes |= NATIVE_PERMISSION_CHANGE_GROUP;
+		
+		// Set standard permission bits
+		mode_t chmodBits = permission_data_to_mode(dataContainer);
+		int chmodNeeded = 1;
+		if(normalizedEntries)
+		{
+			// Writing the ACL sets the owner, group and other bits anyway, so only the special bits need to be checked then.
+			// Changing owner or group may clear the SUID and SGID bits, so chmod() is always called in that case.
+			mode_t currentMode = fileStat.stx_mode & 07777;
+			mode_t finalMode = get_mode_after_acl(chmodBits, normalizedEntries, dataContainer->aclSize);
+			if(currentMode != finalMode)
+				*changes |= NATIVE_PERMISSION_CHANGE_MODE;
+			if(aclUnchanged)
+			{
+				chmodNeeded = currentMode != finalMode;
+				chmodBits = finalMode;
+			}
+			else
+				chmodNeeded = (currentMode & 07000) != (chmodBits & 07000);
+			chmodNeeded |= newOwner != -1 || newGroup != -1;
+		}
+		else
+			*changes |= NATIVE_PERMISSION_CHANGE_MODE;
+		if(chmodNeeded && chmod(context->fdPath, chmodBits) < 0)
+		{
+			store_errno(context);
+			return cleanup_with_error_code(context, NATIVE_ERROR_CHMOD_FAILED);
+		}
+	}
+	
+	return NATIVE_ERROR_SUCCESS;
+}
+
+// Builds a libacl ACL from the given entries and validates it. The ACL is stored in the given context.
+// On failure, errno is stored; the context is not cleaned up.
+static native_error_code_t build_acl_libacl(native_context_t *context, const native_acl_entry_t *entries, int32_t entryCount)
+{
+	// Create new ACL; the other ACL of the same file may still be loaded
+	free_context_acl(context);
+	context->acl = acl_init(entryCount);
+	if(!context->acl)
+	{
+		store_errno(context);
+		return NATIVE_ERROR_INIT_ACL_FAILED;
+	}
+	
+	// Build ACL entries
+	for(int i = 0; i < entryCount; ++i)
+	{
+		// Retrieve current entry data
+		const native_acl_entry_t *entryData = &entries[i];
+		
+		// Initialize ACL entry
+		acl_entry_t aclEntry;
+		int aclStatus = acl_create_entry(&context->acl, &aclEntry);
+		if(aclStatus < 0)
+		{
+			store_errno(context);
+			return NATIVE_ERROR_CREATE_ACL_ENTRY_FAILED;
+		}
+		
+		// Assign tag type
+		acl_tag_t tagType;
+		switch(entryData->tagType)
+		{
+			case ACL_ENTRY_TAG_TYPE_USER_OBJ:  tagType = ACL_USER_OBJ;  break;
+			case ACL_ENTRY_TAG_TYPE_USER:      tagType = ACL_USER;      break;
+			case ACL_ENTRY_TAG_TYPE_GROUP_OBJ: tagType = ACL_GROUP_OBJ; break;
+			case ACL_ENTRY_TAG_TYPE_GROUP:     tagType = ACL_GROUP;     break;
+			case ACL_ENTRY_TAG_TYPE_MASK:      tagType = ACL_MASK;      break;
+			case ACL_ENTRY_TAG_TYPE_OTHER:     tagType = ACL_OTHER;     break;
+			default: return NATIVE_ERROR_INVALID_TAG_TYPE;
+		}
+		if(acl_set_tag_type(aclEntry, tagType) < 0)
+		{
+			store_errno(context);
+			return NATIVE_ERROR_SET_ACL_ENTRY_TAG_TYPE_FAILED;
+		}
+		
+		// Assign tag qualifier
+		switch(entryData->tagType)
+		{
+			case ACL_ENTRY_TAG_TYPE_USER:
+			case ACL_ENTRY_TAG_TYPE_GROUP:
+			{
+				if(acl_set_qualifier(aclEntry, &entryData->tagQualifier) < 0)
+				{
+					store_errno(context);
+					return NATIVE_ERROR_SET_ACL_ENTRY_QUALIFIER_FAILED;
+				}
+				break;
+			}
+			
+			default: break;
+		}
+		
+		// Assign permissions
+		acl_permset_t permset;
+		if(acl_get_permset(aclEntry, &permset) < 0)
+		{
+			store_errno(context);
+			return NATIVE_ERROR_GET_ACL_ENTRY_PERMSET_FAILED;
+		}
+		if(acl_clear_perms(permset) < 0)
+		{
+			store_errno(context);
+			return NATIVE_ERROR_CLEAR_ACL_ENTRY_PERMS_FAILED;
+		}
+		if((entryData->permissions & FILE_PERMISSION_READ) && acl_add_perm(permset, ACL_READ) < 0)
+		{
+			store_errno(context);
+			return NATIVE_ERROR_ADD_ACL_ENTRY_PERM_FAILED;
+		}
+		if((entryData->permissions & FILE_PERMISSION_WRITE) && acl_add_perm(permset, ACL_WRITE) < 0)
+		{
+			store_errno(context);
+			return NATIVE_ERROR_ADD_ACL_ENTRY_PERM_FAILED;
+		}
+		if((entryData->permissions & FILE_PERMISSION_EXECUTE) && acl_add_perm(permset, ACL_EXECUTE) < 0)
+		{
+			store_errno(context);
+			return NATIVE_ERROR_ADD_ACL_ENTRY_PERM_FAILED;
+		}
+	}
+	
+	// Validate ACL
+	if(acl_valid(context->acl) < 0)
+	{
+		store_errno(context);
+		return NATIVE_ERROR_VALIDATE_ACL_FAILED;
+	}
+	
+	return NATIVE_ERROR_SUCCESS;
+}
+
+// Builds a libacl ACL from the given entries, validates it and assigns it to the given file. The ACL is stored in the given context.
+// On failure, errno is stored; the context is not cleaned up.
+static native_error_code_t write_acl_libacl(native_context_t *context, int32_t setDefaultAcl, const native_acl_entry_t *entries, int32_t entryCount)
+{
+	// Build ACL
+	native_error_code_t err = build_acl_libacl(context, entries, entryCount);
+	if(err != NATIVE_ERROR_SUCCESS)
+		return err;
+	
+	// Assign ACL to file or directory
+	if(acl_set_file(context->fdPath, setDefaultAcl > 0 ? ACL_TYPE_DEFAULT : ACL_TYPE_ACCESS, context->acl) < 0)
+	{
+		store_errno(context);
+		return NATIVE_ERROR_SET_ACL_FAILED;
+	}
+	
+	return NATIVE_ERROR_SUCCESS;
+}
+
+#ifdef ACLNATIVE_RAW_XATTR
+
+// Orders posix_acl_xattr entries (in host byte order) the way the kernel expects: by tag, then by qualifier.
+static int compare_xattr_acl_entries(const void *a, const void *b)
+{
+	const xattr_acl_entry_t *entryA = a;
+	const xattr_acl_entry_t *entryB = b;
+	if(entryA->tag != entryB->tag)
+		return entryA->tag < entryB->tag ? -1 : 1;
+	if(entryA->id != entryB->id)
+		return entryA->id < entryB->id ? -1 : 1;
+	return 0;
+}
+
+// Returns the size of the posix_acl_xattr blob holding the given number of entries.
+static size_t get_xattr_acl_length(int32_t entryCount)
+{
+	return sizeof(xattr_acl_header_t) + (size_t)(entryCount > 0 ? entryCount : 0) * sizeof(xattr_acl_entry_t);
+}
+
+// Serializes and validates the given ACL entries as posix_acl_xattr blob. The buffer must hold get_xattr_acl_length(entryCount) bytes.
+// The entries may be passed in any order. Validation follows acl_valid(): exactly one USER_OBJ, GROUP_OBJ and OTHER entry, no duplicate qualifiers, and a MASK entry if there are named USER or GROUP entries.
+// On failure, errno is stored.
+static native_error_code_t encode_xattr_acl(native_context_t *context, const native_acl_entry_t *entries, int32_t entryCount, char *buffer)
+{
+	xattr_acl_header_t *header = (xattr_acl_header_t *)buffer;
+	xattr_acl_entry_t *xattrEntries = (xattr_acl_entry_t *)(buffer + sizeof(xattr_acl_header_t));
+	
+	// Convert entries
+	native_error_code_t err = NATIVE_ERROR_SUCCESS;
+	for(int i = 0; i < entryCount && err == NATIVE_ERROR_SUCCESS; ++i)
+	{
+		xattr_acl_entry_t *e = &xattrEntries[i];
+		e->id = (uint32_t)-1;
+		switch(entries[i].tagType)
+		{
+			case ACL_ENTRY_TAG_TYPE_USER_OBJ:  e->tag = ACL_USER_OBJ;  break;
+			case ACL_ENTRY_TAG_TYPE_USER:      e->tag = ACL_USER;      e->id = (uint32_t)entries[i].tagQualifier; break;
+			case ACL_ENTRY_TAG_TYPE_GROUP_OBJ: e->tag = ACL_GROUP_OBJ; break;
+			case ACL_ENTRY_TAG_TYPE_GROUP:     e->tag = ACL_GROUP;     e->id = (uint32_t)entries[i].tagQualifier; break;
+			case ACL_ENTRY_TAG_TYPE_MASK:      e->tag = ACL_MASK;      break;
+			case ACL_ENTRY_TAG_TYPE_OTHER:     e->tag = ACL_OTHER;     break;
+			default: err = NATIVE_ERROR_INVALID_TAG_TYPE; break;
+		}
+		e->perm = ((entries[i].permissions & FILE_PERMISSION_READ) ? ACL_READ : 0)
+		        | ((entries[i].permissions & FILE_PERMISSION_WRITE) ? ACL_WRITE : 0)
+		        | ((entries[i].permissions & FILE_PERMISSION_EXECUTE) ? ACL_EXECUTE : 0);
+	}
+	
+	// Sort and validate
+	if(err == NATIVE_ERROR_SUCCESS)
+	{
+		qsort(xattrEntries, entryCount, sizeof(xattr_acl_entry_t), compare_xattr_acl_entries);
+		
+		int userObjCount = 0, groupObjCount = 0, otherCount = 0, maskCount = 0, namedCount = 0;
+		for(int i = 0; i < entryCount; ++i)
+		{
+			switch(xattrEntries[i].tag)
+			{
+				case ACL_USER_OBJ:  ++userObjCount;  break;
+				case ACL_GROUP_OBJ: ++groupObjCount; break;
+				case ACL_OTHER:     ++otherCount;    break;
+				case ACL_MASK:      ++maskCount;     break;
+				default:
+				{
+					// Named entries are sorted by qualifier, so duplicates are adjacent
+					++namedCount;
+					if(i > 0 && xattrEntries[i - 1].tag == xattrEntries[i].tag && xattrEntries[i - 1].id == xattrEntries[i].id)
+						err = NATIVE_ERROR_VALIDATE_ACL_FAILED;
+					break;
+				}
+			}
+		}
+		if(userObjCount != 1 || groupObjCount != 1 || otherCount != 1 || maskCount > 1 || (namedCount > 0 && maskCount == 0))
+			err = NATIVE_ERROR_VALIDATE_ACL_FAILED;
+		if(err == NATIVE_ERROR_VALIDATE_ACL_FAILED)
+		{
+			errno = EINVAL;
+			store_errno(context);
+		}
+	}
+	
+	// Convert to little endian
+	if(err == NATIVE_ERROR_SUCCESS)
+	{
+		header->version = htole32(XATTR_ACL_VERSION);
+		for(int i = 0; i < entryCount; ++i)
+		{
+			xattrEntries[i].tag = htole16(xattrEntries[i].tag);
+			xattrEntries[i].perm = htole16(xattrEntries[i].perm);
+			xattrEntries[i].id = htole32(xattrEntries[i].id);
+		}
+	}
+	
+	return err;
+}
+
+// Serializes, validates and assigns the given ACL entries as posix_acl_xattr blob to the file opened in the given context.
+// On failure, errno is stored; the context is not cleaned up.
+static native_error_code_t write_acl_xattr(native_context_t *context, int32_t setDefaultAcl, const native_acl_entry_t *entries, int32_t entryCount)
+{
+	// Most ACLs fit into a stack buffer
+	char stackBuffer[XATTR_ACL_STACK_BUFFER_SIZE];
+	size_t length = get_xattr_acl_length(entryCount);
+	char *buffer = stackBuffer;
+	if(length > sizeof(stackBuffer))
+	{
+		buffer = malloc(length);
+		if(!buffer)
+		{
+			errno = ENOMEM;
+			store_errno(context);
+			return NATIVE_ERROR_SET_XATTR_FAILED;
+		}
+	}
+	
+	// Serialize and assign
+	native_error_code_t err = encode_xattr_acl(context, entries, entryCount, buffer);
+	if(err == NATIVE_ERROR_SUCCESS)
+	{
+		const char *attributeName = get_acl_attribute_name(setDefaultAcl);
+		if(setxattr(context->fdPath, attributeName, buffer, length, 0) < 0)
+		{
+			store_errno(context);
+			err = NATIVE_ERROR_SET_XATTR_FAILED;
+		}
+	}
+	
+	if(buffer != stackBuffer)
+		free(buffer);
+	return err;
+}
+
+#endif
+
+// Assigns the given access or default ACL to the file opened in the given context, using libacl or the extended attribute depending on the context options.
+// On failure, errno is stored; the context is not cleaned up.
+static native_error_code_t write_acl(native_context_t *context, int32_t setDefaultAcl, const native_acl_entry_t *entries, int32_t entryCount)
+{
+#ifdef ACLNATIVE_RAW_XATTR
+	if(!(context->options & NATIVE_CONTEXT_OPTION_USE_LIBACL))
+		return write_acl_xattr(context, setDefaultAcl, entries, entryCount);
+#endif
+	return write_acl_libacl(context, setDefaultAcl, entries, entryCount);
+}
+
+// Removes the default ACL of the directory opened in the given context. Directories without a default ACL are left unchanged.
+// On failure, errno is stored; the context is not cleaned up.
+static native_error_code_t remove_default_acl(native_context_t *context)
+{
+#ifdef ACLNATIVE_RAW_XATTR
+	if(!(context->options & NATIVE_CONTEXT_OPTION_USE_LIBACL))
+	{
+		if(removexattr(context->fdPath, get_acl_attribute_name(1)) < 0 && errno != ENODATA)
+		{
+			store_errno(context);
+			return NATIVE_ERROR_SET_XATTR_FAILED;
+		}
+		return NATIVE_ERROR_SUCCESS;
+	}
+#endif
+	if(acl_delete_def_file(context->fdPath) < 0)
+	{
+		store_errno(context);
+		return NATIVE_ERROR_SET_ACL_FAILED;
+	}
+	return NATIVE_ERROR_SUCCESS;
+}
+
+// Pushes the given open directory onto the stack of the given scanner. The directory buffer is reused from an earlier push, if possible.
+// Returns 0 on success, and -1 if memory could not be allocated.
+static int push_scanner_directory(native_tree_scanner_t *scanner, int fd, size_t pathLength)
+{
+	if(scanner->directoryCount == scanner->directoryCapacity)
+	{
+		int32_t newCapacity = scanner->directoryCapacity > 0 ? 2 * scanner->directoryCapacity : 16;
+		tree_scanner_directory_t *newDirectories = realloc(scanner->directories, newCapacity * sizeof(tree_scanner_directory_t));
+		if(!newDirectories)
+			return -1;
+		for(int32_t i = scanner->directoryCapacity; i < newCapacity; ++i)
+			newDirectories[i].entries = NULL;
+		scanner->directories = newDirectories;
+		scanner->directoryCapacity = newCapacity;
+	}
+	
+	tree_scanner_directory_t *directory = &scanner->directories[scanner->directoryCount];
+	if(!directory->entries)
+	{
+		directory->entries = malloc(TREE_SCANNER_DIRENT_BUFFER_SIZE);
+		if(!directory->entries)
+			return -1;
+	}
+	directory->fd = fd;
+	directory->entriesLength = 0;
+	directory->entriesPosition = 0;
+	directory->pathLength = pathLength;
+	++scanner->directoryCount;
+	return 0;
+}
+
+// Closes the innermost directory of the given scanner and removes it from the stack.
+static void pop_scanner_directory(native_tree_scanner_t *scanner)
+{
+	--scanner->directoryCount;
+	close(scanner->directories[scanner->directoryCount].fd);
+}
+
+// Writes a scan record for the given file into the given buffer. The ACLs are read through aclPath, unless status indicates that the file could not be stat'ed.
+// If the record does not fit, NATIVE_ERROR_BUFFER_TOO_SMALL is returned and the buffer contents are undefined. The (required) record size is stored in recordLength.
+static native_error_code_t write_scan_record(native_context_t *context, const struct statx *fileStat, native_error_code_t status, int errnoValue, const char *aclPath, const char *path, size_t pathLength, int32_t depth, char *buffer, int32_t bufferLength, int32_t *recordLength)
+{
+	// The ACL entries are read directly behind the record header
+	int32_t entriesLength = bufferLength > (int32_t)sizeof(native_scan_record_t) ? (bufferLength - (int32_t)sizeof(native_scan_record_t)) / (int32_t)sizeof(native_acl_entry_t) : 0;
+	native_acl_entry_t *entries = (native_acl_entry_t *)(buffer + sizeof(native_scan_record_t));
+	
+	// Read ACLs
+	int32_t accessAclSize = 0;
+	int32_t defaultAclSize = 0;
+	if(status != NATIVE_ERROR_FSTAT_FAILED)
+	{
+		native_permission_data_container_t dataContainer;
+		fill_permission_data(fileStat, &dataContainer);
+		
+		native_error_code_t err = read_acl(context, aclPath, 0, fileStat->stx_mode, &dataContainer, entries, entriesLength, &accessAclSize);
+		if(err == NATIVE_ERROR_SUCCESS && S_ISDIR(fileStat->stx_mode))
+		{
+			int32_t usedEntries = accessAclSize < entriesLength ? accessAclSize : entriesLength;
+			err = read_acl(context, aclPath, 1, fileStat->stx_mode, &dataContainer, entries + usedEntries, entriesLength - usedEntries, &defaultAclSize);
+		}
+		cleanup_with_error_code(context, NATIVE_ERROR_SUCCESS);
+		
+		if(err != NATIVE_ERROR_SUCCESS)
+		{
+			accessAclSize = 0;
+			defaultAclSize = 0;
+			if(status == NATIVE_ERROR_SUCCESS)
+			{
+				status = err;
+				errnoValue = context->lastErrnoValue;
+			}
+		}
+	}
+	
+	// Check size
+	size_t length = sizeof(native_scan_record_t) + (size_t)(accessAclSize + defaultAclSize) * sizeof(native_acl_entry_t) + pathLength + 1;
+	length = (length + 7) & ~(size_t)7;
+	*recordLength = (int32_t)length;
+	if(length > (size_t)bufferLength)
+		return NATIVE_ERROR_BUFFER_TOO_SMALL;
+	
+	// Fill header and copy path
+	native_scan_record_t *record = (native_scan_record_t *)buffer;
+	record->recordLength = (uint32_t)length;
+	record->status = status;
+	record->errnoValue = errnoValue;
+	record->depth = depth;
+	record->device = (uint64_t)makedev(fileStat->stx_dev_major, fileStat->stx_dev_minor);
+	record->inode = fileStat->stx_ino;
+	record->ownerId = (int32_t)fileStat->stx_uid;
+	record->groupId = (int32_t)fileStat->stx_gid;
+	record->mode = (uint32_t)fileStat->stx_mode;
+	record->accessAclSize = accessAclSize;
+	record->defaultAclSize = defaultAclSize;
+	record->pathLength = (int32_t)pathLength;
+	char *recordPath = (char *)(entries + accessAclSize + defaultAclSize);
+	memcpy(recordPath, path, pathLength);
+	memset(recordPath + pathLength, 0, buffer + length - (recordPath + pathLength));
+	
+	return NATIVE_ERROR_SUCCESS;
+}
+
+// Assigns the given compiled ACL to the file opened in the given context.
+// On failure, errno is stored; the context is not cleaned up.
+static native_error_code_t write_compiled_acl(native_context_t *context, const native_compiled_permissions_t *compiledPermissions)
+{
+#ifdef ACLNATIVE_RAW_XATTR
+	if(compiledPermissions->xattr)
+	{
+		const char *attributeName = get_acl_attribute_name(compiledPermissions->setDefaultAcl);
+		if(setxattr(context->fdPath, attributeName, compiledPermissions->xattr, compiledPermissions->xattrLength, 0) < 0)
+		{
+			store_errno(context);
+			return NATIVE_ERROR_SET_XATTR_FAILED;
+		}
+		return NATIVE_ERROR_SUCCESS;
+	}
+#endif
+	
+	if(acl_set_file(context->fdPath, compiledPermissions->setDefaultAcl > 0 ? ACL_TYPE_DEFAULT : ACL_TYPE_ACCESS, compiledPermissions->acl) < 0)
+	{
+		store_errno(context);
+		return NATIVE_ERROR_SET_ACL_FAILED;
+	}
+	return NATIVE_ERROR_SUCCESS;
+}
+
+
+// Reads the given batch item into the remaining part of the entry buffer, and advances entriesUsed on success. Returns the status of the item.
+static native_error_code_t read_batch_item(native_context_t *context, int dirFd, const char *fileName, int32_t loadDefaultAcl, native_batch_read_result_t *result, native_acl_entry_t *entries, int32_t entriesLength, int32_t *entriesUsed)
+{
+	result->entriesOffset = *entriesUsed;
+	result->status = ReadPermissionDataAtCtx(context, dirFd, fileName, loadDefaultAcl, &result->dataContainer, entries + *entriesUsed, entriesLength - *entriesUsed);
+	result->errnoValue = context->lastErrnoValue;
+	
+	if(result->status == NATIVE_ERROR_SUCCESS)
+		*entriesUsed += result->dataContainer.aclSize;
+	return result->status;
+}
+
+// Assigns the given compiled permissions to the given batch item. Returns the status of the item.
+static native_error_code_t apply_batch_item(native_context_t *context, const native_compiled_permissions_t *compiledPermissions, int dirFd, const char *fileName, native_batch_status_t *result)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	
+	// Update owner and UNIX permissions, then assign the prebuilt ACL if needed
+	int32_t aclChange = compiledPermissions->setDefaultAcl > 0 ? NATIVE_PERMISSION_CHANGE_DEFAULT_ACL : NATIVE_PERMISSION_CHANGE_ACCESS_ACL;
+	const native_acl_entry_t *normalizedEntries = (context->options & NATIVE_CONTEXT_OPTION_SKIP_UNCHANGED) ? compiledPermissions->normalizedEntries : NULL;
+	native_error_code_t err = open_file_and_update_metadata(context, dirFd, fileName, compiledPermissions->setDefaultAcl, 0, &compiledPermissions->dataContainer, normalizedEntries, &result->changes);
+	if(err == NATIVE_ERROR_SUCCESS && (result->changes & aclChange))
+	{
+		err = write_compiled_acl(context, compiledPermissions);
+		if(err != NATIVE_ERROR_SUCCESS)
+			result->changes &= ~aclChange;
+	}
+	cleanup_with_error_code(context, NATIVE_ERROR_SUCCESS);
+	
+	result->status = err;
+	result->errnoValue = context->lastErrnoValue;
+	return err;
+}
+
+// Releases a reference to the given directory of a recursive apply, and closes and frees it when the last reference is gone.
+static void release_recursive_apply_directory(recursive_apply_directory_t *directory)
+{
+	if(atomic_fetch_sub(&directory->referenceCount, 1) == 1)
+	{
+		close(directory->fd);
+		free(directory->path);
+		free(directory);
+	}
+}
+
+// Wakes all idle workers of a recursive apply, so they recheck whether the operation is complete or canceled.
+static void wake_recursive_apply_workers(recursive_apply_state_t *state)
+{
+	pthread_mutex_lock(&state->idleLock);
+	pthread_cond_broadcast(&state->idleCondition);
+	pthread_mutex_unlock(&state->idleLock);
+}
+
+// Builds the relative path of the given entry of the given directory in the path buffer of the given worker. If name is NULL, the path of the directory itself is returned.
+// The path length is stored in pathLength. Returns NULL if memory could not be allocated.
+static const char *build_recursive_apply_path(recursive_apply_worker_t *worker, const recursive_apply_directory_t *directory, const char *name, size_t *pathLength)
+{
+	if(!name)
+	{
+		*pathLength = directory->pathLength;
+		return directory->path;
+	}
+	
+	size_t nameLength = strlen(name);
+	*pathLength = directory->pathLength + (directory->pathLength > 0 ? 1 : 0) + nameLength;
+	if(*pathLength + 1 > worker->pathCapacity)
+	{
+		size_t newCapacity = worker->pathCapacity > 0 ? worker->pathCapacity : 256;
+		while(newCapacity < *pathLength + 1)
+			newCapacity *= 2;
+		char *newPath = realloc(worker->path, newCapacity);
+		if(!newPath)
+			return NULL;
+		worker->path = newPath;
+		worker->pathCapacity = newCapacity;
+	}
+	memcpy(worker->path, directory->path, directory->pathLength);
+	if(directory->pathLength > 0)
+		worker->path[directory->pathLength] = '/';
+	memcpy(worker->path + *pathLength - nameLength, name, nameLength + 1);
+	return worker->path;
+}
+
+// Reports a failure of the given entry of the given directory (or of the directory itself, if name is NULL) to the error callback, and cancels the operation if the callback requests it.
+static void report_recursive_apply_error(recursive_apply_worker_t *worker, const recursive_apply_directory_t *directory, const char *name, native_error_code_t status, int errnoValue)
+{
+	recursive_apply_state_t *state = worker->state;
+	++worker->statistics.failedCount;
+	if(!state->errorCallback)
+		return;
+	
+	// Without memory for the full path, the failure is reported for the directory
+	size_t pathLength;
+	const char *path = build_recursive_apply_path(worker, directory, name, &pathLength);
+	if(!path)
+		path = directory->path;
+	
+	// The callback is not called anymore after it canceled the operation
+	pthread_mutex_lock(&state->callbackLock);
+	int32_t cancel = 0;
+	if(!atomic_load(&state->canceled))
+		cancel = state->errorCallback(path, status, errnoValue, state->userData);
+	pthread_mutex_unlock(&state->callbackLock);
+	if(cancel)
+	{
+		atomic_store(&state->canceled, 1);
+		wake_recursive_apply_workers(state);
+	}
+}
+
+// Assigns the given compiled permissions to the given entry of the given directory (or to the directory itself, if name is NULL), and reports a failure.
+// Returns the modified parts (native_permission_changes_t flags).
+static int32_t apply_recursive_apply_entry(recursive_apply_worker_t *worker, const native_compiled_permissions_t *compiledPermissions, const recursive_apply_directory_t *directory, const char *name)
+{
+	native_batch_status_t result;
+	if(apply_batch_item(&worker->context, compiledPermissions, directory->fd, name ? name : ".", &result) != NATIVE_ERROR_SUCCESS)
+		report_recursive_apply_error(worker, directory, name, result.status, result.errnoValue);
+	return result.changes;
+}
+
+// Adds the given item to the back of the queue of the given worker, and wakes an idle worker to steal it.
+// Returns 0 on success, and -1 if memory could not be allocated.
+static int push_recursive_apply_item(recursive_apply_worker_t *worker, recursive_apply_item_t item)
+{
+	recursive_apply_state_t *state = worker->state;
+	recursive_apply_queue_t *queue = &worker->queue;
+	
+	// The item is pending before anybody can take it, so the operation cannot appear complete in between
+	atomic_fetch_add(&state->pendingCount, 1);
+	
+	pthread_mutex_lock(&queue->lock);
+	int32_t count = atomic_load(&queue->count);
+	if(count == queue->capacity)
+	{
+		// Grow and unwrap the ring buffer
+		int32_t newCapacity = queue->capacity > 0 ? 2 * queue->capacity : 64;
+		recursive_apply_item_t *newItems = malloc(newCapacity * sizeof(recursive_apply_item_t));
+		if(!newItems)
+		{
+			pthread_mutex_unlock(&queue->lock);
+			atomic_fetch_sub(&state->pendingCount, 1);
+			return -1;
+		}
+		for(int32_t i = 0; i < count; ++i)
+			newItems[i] = queue->items[(queue->front + i) % queue->capacity];
+		free(queue->items);
+		queue->items = newItems;
+		queue->capacity = newCapacity;
+		queue->front = 0;
+	}
+	queue->items[(queue->front + count) % queue->capacity] = item;
+	atomic_store(&queue->count, count + 1);
+	pthread_mutex_unlock(&queue->lock);
+	
+	if(atomic_load(&state->idleCount) > 0)
+	{
+		pthread_mutex_lock(&state->idleLock);
+		pthread_cond_signal(&state->idleCondition);
+		pthread_mutex_unlock(&state->idleLock);
+	}
+	return 0;
+}
+
+// Returns whether any worker of the given recursive apply has queued items.
+static int has_queued_recursive_apply_items(recursive_apply_state_t *state)
+{
+	for(int32_t i = 0; i < state->workerCount; ++i)
+	{
+		if(atomic_load(&state->workers[i].queue.count) > 0)
+			return 1;
+	}
+	return 0;
+}
+
+// Takes the next item for the given worker: the newest item of its own queue, or else the oldest item of another worker's queue. If all queues are empty, waits until other workers queue new items.
+// Returns 0 if the operation is complete or canceled.
+static int take_recursive_apply_item(recursive_apply_worker_t *worker, recursive_apply_item_t *item)
+{
+	recursive_apply_state_t *state = worker->state;
+	while(!atomic_load(&state->canceled))
+	{
+		// Own queue, depth first
+		recursive_apply_queue_t *queue = &worker->queue;
+		if(atomic_load(&queue->count) > 0)
+		{
+			pthread_mutex_lock(&queue->lock);
+			int32_t count = atomic_load(&queue->count);
+			if(count > 0)
+			{
+				*item = queue->items[(queue->front + count - 1) % queue->capacity];
+				atomic_store(&queue->count, count - 1);
+				pthread_mutex_unlock(&queue->lock);
+				return 1;
+			}
+			pthread_mutex_unlock(&queue->lock);
+		}
+		
+		// Steal from the other workers, the items closest to the root first
+		for(int32_t i = 1; i < state->workerCount; ++i)
+		{
+			recursive_apply_queue_t *victimQueue = &state->workers[(worker->index + i) % state->workerCount].queue;
+			if(atomic_load(&victimQueue->count) == 0)
+				continue;
+			
+			pthread_mutex_lock(&victimQueue->lock);
+			int32_t count = atomic_load(&victimQueue->count);
+			if(count > 0)
+			{
+				*item = victimQueue->items[victimQueue->front];
+				victimQueue->front = (victimQueue->front + 1) % victimQueue->capacity;
+				atomic_store(&victimQueue->count, count - 1);
+				pthread_mutex_unlock(&victimQueue->lock);
+				return 1;
+			}
+			pthread_mutex_unlock(&victimQueue->lock);
+		}
+		
+		// Wait for new items, or for the remaining workers to finish
+		pthread_mutex_lock(&state->idleLock);
+		atomic_fetch_add(&state->idleCount, 1);
+		while(atomic_load(&state->pendingCount) > 0 && !atomic_load(&state->canceled) && !has_queued_recursive_apply_items(state))
+			pthread_cond_wait(&state->idleCondition, &state->idleLock);
+		atomic_fetch_sub(&state->idleCount, 1);
+		pthread_mutex_unlock(&state->idleLock);
+		if(atomic_load(&state->pendingCount) == 0)
+			return 0;
+	}
+	return 0;
+}
+
+// Updates the directory of the given item and all files in it, and queues its subdirectories. The item's reference to its parent is released.
+static void process_recursive_apply_item(recursive_apply_worker_t *worker, recursive_apply_item_t *item)
+{
+	recursive_apply_state_t *state = worker->state;
+	
+	// Update the directory before its contents; its name is resolved without following symbolic links
+	int32_t changes = 0;
+	if(state->directoryPermissions)
+		changes |= apply_recursive_apply_entry(worker, state->directoryPermissions, item->parent, item->name);
+	if(state->directoryDefaultPermissions)
+		changes |= apply_recursive_apply_entry(worker, state->directoryDefaultPermissions, item->parent, item->name);
+	++worker->statistics.directoryCount;
+	if(changes)
+		++worker->statistics.changedCount;
+	
+	// Open the directory; the root directory is already open
+	recursive_apply_directory_t *directory = item->parent;
+	if(item->name)
+	{
+		directory = NULL;
+		int fd = openat(item->parent->fd, item->name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+		if(fd < 0)
+			report_recursive_apply_error(worker, item->parent, item->name, NATIVE_ERROR_OPEN_FAILED, errno);
+		else
+		{
+			// Keep the relative path, for reporting failures of the directory's contents
+			size_t pathLength;
+			const char *path = build_recursive_apply_path(worker, item->parent, item->name, &pathLength);
+			directory = malloc(sizeof(recursive_apply_directory_t));
+			char *directoryPath = path ? malloc(pathLength + 1) : NULL;
+			if(!directory || !directoryPath)
+			{
+				free(directory);
+				free(directoryPath);
+				directory = NULL;
+				close(fd);
+				report_recursive_apply_error(worker, item->parent, item->name, NATIVE_ERROR_OUT_OF_MEMORY, ENOMEM);
+			}
+			else
+			{
+				memcpy(directoryPath, path, pathLength + 1);
+				directory->fd = fd;
+				atomic_init(&directory->referenceCount, 1);
+				directory->path = directoryPath;
+				directory->pathLength = pathLength;
+			}
+		}
+		free(item->name);
+		release_recursive_apply_directory(item->parent);
+	}
+	if(!directory)
+		return;
+	
+	// Update contents
+	while(!atomic_load(&state->canceled))
+	{
+		long length = syscall(SYS_getdents64, directory->fd, worker->entries, TREE_SCANNER_DIRENT_BUFFER_SIZE);
+		if(length <= 0)
+		{
+			if(length < 0)
+				report_recursive_apply_error(worker, directory, NULL, NATIVE_ERROR_READ_DIRECTORY_FAILED, errno);
+			break;
+		}
+		
+		for(long position = 0; position < length && !atomic_load(&state->canceled); )
+		{
+			linux_dirent64_t *entry = (linux_dirent64_t *)(worker->entries + position);
+			position += entry->d_reclen;
+			
+			// Skip "." and ".."
+			if(entry->d_name[0] == '.' && (entry->d_name[1] == '\0' || (entry->d_name[1] == '.' && entry->d_name[2] == '\0')))
+				continue;
+			
+			// Some file systems do not report the file type
+			unsigned char type = entry->d_type;
+			if(type == DT_UNKNOWN)
+			{
+				struct statx fileStat;
+				if(statx(directory->fd, entry->d_name, AT_SYMLINK_NOFOLLOW | get_statx_sync_flag(&worker->context), STATX_TYPE, &fileStat) < 0)
+				{
+					report_recursive_apply_error(worker, directory, entry->d_name, NATIVE_ERROR_FSTAT_FAILED, errno);
+					continue;
+				}
+				type = IFTODT(fileStat.stx_mode);
+			}
+			
+			if(type == DT_DIR)
+			{
+				// The queued subdirectory keeps this directory open
+				recursive_apply_item_t subdirectoryItem = { directory, strdup(entry->d_name) };
+				atomic_fetch_add(&directory->referenceCount, 1);
+				if(!subdirectoryItem.name || push_recursive_apply_item(worker, subdirectoryItem) < 0)
+				{
+					free(subdirectoryItem.name);
+					atomic_fetch_sub(&directory->referenceCount, 1);
+					report_recursive_apply_error(worker, directory, entry->d_name, NATIVE_ERROR_OUT_OF_MEMORY, ENOMEM);
+				}
+			}
+			else if(type == DT_LNK)
+				++worker->statistics.skippedCount;
+			else
+			{
+				++worker->statistics.fileCount;
+				if(state->filePermissions && apply_recursive_apply_entry(worker, state->filePermissions, directory, entry->d_name))
+					++worker->statistics.changedCount;
+			}
+		}
+	}
+	release_recursive_apply_directory(directory);
+}
+
+// Thread function of a recursive apply worker. Processes items until the operation is complete or canceled.
+static void *run_recursive_apply_worker(void *argument)
+{
+	recursive_apply_worker_t *worker = argument;
+	recursive_apply_item_t item;
+	while(take_recursive_apply_item(worker, &item))
+	{
+		process_recursive_apply_item(worker, &item);
+		if(atomic_fetch_sub(&worker->state->pendingCount, 1) == 1)
+			wake_recursive_apply_workers(worker->state);
+	}
+	return NULL;
+}
+
+#ifdef ACLNATIVE_IO_URING
+
+// Releases the given io_uring instance and its mappings.
+static void free_uring(uring_engine_t *uring)
+{
+	if(!uring)
+		return;
+	
+	if(uring->sqes)
+		munmap(uring->sqes, uring->sqesSize);
+	if(uring->cqRing && uring->cqRing != uring->sqRing)
+		munmap(uring->cqRing, uring->cqRingSize);
+	if(uring->sqRing)
+		munmap(uring->sqRing, uring->sqRingSize);
+	if(uring->ringFd >= 0)
+		close(uring->ringFd);
+	free(uring->slots);
+	free(uring);
+}
+
+// Creates an io_uring instance with the given queue depth, after checking that the kernel supports the statx, getxattr and setxattr operations. Returns NULL on failure.
+static uring_engine_t *create_uring(uint32_t queueDepth)
+{
+	uring_engine_t *uring = calloc(1, sizeof(uring_engine_t));
+	if(!uring)
+		return NULL;
+	uring->ringFd = -1;
+	
+	// Create instance; the operations of a batch are independent, so a failing submission must not stop the following ones
+	// Reads submit two operations per item, so at least two entries are needed
+	if(queueDepth < 2)
+		queueDepth = 2;
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	params.flags = IORING_SETUP_CLAMP | IORING_SETUP_SUBMIT_ALL;
+	uring->ringFd = (int)syscall(__NR_io_uring_setup, queueDepth, &params);
+	if(uring->ringFd < 0)
+		goto fail;
+	
+	// Check whether the needed operations are supported
+	struct io_uring_probe *probe = calloc(1, sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op));
+	if(!probe)
+		goto fail;
+	int supported = syscall(__NR_io_uring_register, uring->ringFd, IORING_REGISTER_PROBE, probe, 256) >= 0
+	             && probe->last_op >= IORING_OP_GETXATTR
+	             && (probe->ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED)
+	             && (probe->ops[IORING_OP_GETXATTR].flags & IO_URING_OP_SUPPORTED)
+	             && (probe->ops[IORING_OP_SETXATTR].flags & IO_URING_OP_SUPPORTED);
+	free(probe);
+	if(!supported)
+		goto fail;
+	
+	// Map rings; newer kernels map both rings at once
+	uring->sqEntries = params.sq_entries;
+	uring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+	uring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if(params.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if(uring->cqRingSize > uring->sqRingSize)
+			uring->sqRingSize = uring->cqRingSize;
+		uring->cqRingSize = uring->sqRingSize;
+	}
+	void *ring = mmap(NULL, uring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->ringFd, IORING_OFF_SQ_RING);
+	if(ring == MAP_FAILED)
+		goto fail;
+	uring->sqRing = ring;
+	if(params.features & IORING_FEAT_SINGLE_MMAP)
+		uring->cqRing = uring->sqRing;
+	else
+	{
+		ring = mmap(NULL, uring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->ringFd, IORING_OFF_CQ_RING);
+		if(ring == MAP_FAILED)
+			goto fail;
+		uring->cqRing = ring;
+	}
+	uring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring = mmap(NULL, uring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->ringFd, IORING_OFF_SQES);
+	if(ring == MAP_FAILED)
+		goto fail;
+	uring->sqes = ring;
+	
+	// Resolve ring fields
+	char *sqRing = uring->sqRing;
+	char *cqRing = uring->cqRing;
+	uring->sqHead = (uint32_t *)(sqRing + params.sq_off.head);
+	uring->sqTail = (uint32_t *)(sqRing + params.sq_off.tail);
+	uring->sqMask = *(uint32_t *)(sqRing + params.sq_off.ring_mask);
+	uring->sqArray = (uint32_t *)(sqRing + params.sq_off.array);
+	uring->sqLocalTail = *uring->sqTail;
+	uring->cqHead = (uint32_t *)(cqRing + params.cq_off.head);
+	uring->cqTail = (uint32_t *)(cqRing + params.cq_off.tail);
+	uring->cqMask = *(uint32_t *)(cqRing + params.cq_off.ring_mask);
+	uring->cqes = (struct io_uring_cqe *)(cqRing + params.cq_off.cqes);
+	
+	// Allocate slots
+	uring->slots = malloc(uring->sqEntries * sizeof(uring_slot_t));
+	if(!uring->slots)
+		goto fail;
+	for(uint32_t s = 0; s < uring->sqEntries; ++s)
+	{
+		uring->slots[s].index = -1;
+		uring->slots[s].fd = -1;
+	}
+	
+	return uring;
+	
+fail:
+	free_uring(uring);
+	return NULL;
+}
+
+// Returns the io_uring instance of the given context, and creates it on first use. Returns NULL if io_uring is not available.
+static uring_engine_t *get_uring(native_context_t *context)
+{
+	if(!context->uring && !context->uringUnavailable)
+	{
+		context->uring = create_uring(context->queueDepth > 0 ? (uint32_t)context->queueDepth : URING_DEFAULT_QUEUE_DEPTH);
+		context->uringUnavailable = !context->uring;
+	}
+	return context->uringUnavailable ? NULL : context->uring;
+}
+
+// Returns a cleared submission queue entry. It is published with the next io_uring_enter() call of "run_uring_batch".
+static struct io_uring_sqe *get_uring_sqe(uring_engine_t *uring)
+{
+	uint32_t index = uring->sqLocalTail++ & uring->sqMask;
+	struct io_uring_sqe *sqe = &uring->sqes[index];
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	uring->sqArray[index] = index;
+	return sqe;
+}
+
+// Processes all available completions, and completes the items whose operations have all finished.
+//     completedOperationCount: Incremented by the number of processed completions.
+// Returns the number of completed items.
+static int32_t reap_uring_completions(native_context_t *context, uring_engine_t *uring, uring_complete_callback_t complete, void *batch, uint32_t *completedOperationCount)
+{
+	int32_t completedItemCount = 0;
+	uint32_t head = *uring->cqHead;
+	uint32_t tail = __atomic_load_n(uring->cqTail, __ATOMIC_ACQUIRE);
+	for(; head != tail; ++head)
+	{
+		const struct io_uring_cqe *cqe = &uring->cqes[head & uring->cqMask];
+		uring_slot_t *slot = &uring->slots[cqe->user_data >> 1];
+		if(cqe->user_data & 1)
+			slot->xattrResult = cqe->res;
+		else
+			slot->statxResult = cqe->res;
+		++*completedOperationCount;
+		
+		if(--slot->pendingCount == 0)
+		{
+			complete(context, slot, batch);
+			slot->index = -1;
+			++completedItemCount;
+		}
+	}
+	__atomic_store_n(uring->cqHead, head, __ATOMIC_RELEASE);
+	return completedItemCount;
+}
+
+// Runs a batch on the given io_uring instance, and keeps as many items in flight as the submission queue can hold with operationsPerItem operations each.
+// Returns the number of items handed to io_uring. If io_uring fails, the items in flight are completed with the error, and the remaining items must be processed synchronously.
+static int32_t run_uring_batch(native_context_t *context, uring_engine_t *uring, int32_t fileCount, uint32_t operationsPerItem, uring_prepare_callback_t prepare, uring_complete_callback_t complete, void *batch)
+{
+	int32_t slotCount = (int32_t)(uring->sqEntries / operationsPerItem);
+	int32_t nextIndex = 0;
+	int32_t busyCount = 0;
+	uint32_t completedOperationCount = 0;
+	while(nextIndex < fileCount || busyCount > 0)
+	{
+		// Assign items to free slots, as long as the submission queue has room
+		for(int32_t s = 0; s < slotCount && nextIndex < fileCount; ++s)
+		{
+			uring_slot_t *slot = &uring->slots[s];
+			if(slot->index >= 0)
+				continue;
+			if(uring->sqEntries - (uring->sqLocalTail - __atomic_load_n(uring->sqHead, __ATOMIC_ACQUIRE)) < operationsPerItem)
+				break;
+			
+			slot->index = nextIndex++;
+			slot->pendingCount = prepare(context, uring, slot, batch);
+			if(slot->pendingCount > 0)
+				++busyCount;
+			else
+				slot->index = -1;
+		}
+		if(busyCount == 0)
+			continue;
+		
+		// Submit prepared operations and wait for at least one completion
+		__atomic_store_n(uring->sqTail, uring->sqLocalTail, __ATOMIC_RELEASE);
+		uint32_t submitCount = uring->sqLocalTail - __atomic_load_n(uring->sqHead, __ATOMIC_ACQUIRE);
+		if(syscall(__NR_io_uring_enter, uring->ringFd, submitCount, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+		{
+			// Do not use this instance again
+			int lastError = errno;
+			context->uringUnavailable = 1;
+			
+			// Withdraw the operations the kernel has not consumed yet
+			uint32_t pendingOperationCount = 0;
+			for(int32_t s = 0; s < slotCount; ++s)
+			{
+				if(uring->slots[s].index >= 0)
+					pendingOperationCount += (uint32_t)uring->slots[s].pendingCount;
+			}
+			uint32_t sqHead = __atomic_load_n(uring->sqHead, __ATOMIC_ACQUIRE);
+			uint32_t inFlightOperationCount = pendingOperationCount - (uring->sqLocalTail - sqHead);
+			uring->sqLocalTail = sqHead;
+			__atomic_store_n(uring->sqTail, sqHead, __ATOMIC_RELEASE);
+			
+			// Wait for the consumed operations, as they still use the descriptors and buffers of their slots.
+			// A closed descriptor could be reused by another file, which would then receive the ACL through its /proc/self/fd path.
+			int drained = 1;
+			uint32_t drainedOperationCount = 0;
+			while(drainedOperationCount < inFlightOperationCount)
+			{
+				if(syscall(__NR_io_uring_enter, uring->ringFd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+				{
+					drained = 0;
+					break;
+				}
+				reap_uring_completions(context, uring, complete, batch, &drainedOperationCount);
+			}
+			
+			for(int32_t s = 0; s < slotCount; ++s)
+			{
+				uring_slot_t *slot = &uring->slots[s];
+				if(slot->index < 0)
+					continue;
+				
+				// If operations may still be running, leak the descriptor instead of closing it
+				if(!drained)
+					slot->fd = -1;
+				
+				slot->statxResult = -lastError;
+				slot->xattrResult = -lastError;
+				complete(context, slot, batch);
+				slot->index = -1;
+			}
+			return nextIndex;
+		}
+		
+		// Process completions
+		busyCount -= reap_uring_completions(context, uring, complete, batch, &completedOperationCount);
+	}
+	
+	return fileCount;
+}
+
+// Submits a statx and a getxattr operation for the batch read item assigned to the given slot.
+// The getxattr operation follows symbolic links, so this is not used with NATIVE_CONTEXT_OPTION_NO_FOLLOW.
+static int32_t prepare_read_item(native_context_t *context, uring_engine_t *uring, uring_slot_t *slot, void *batch)
+{
+	uring_read_batch_t *readBatch = batch;
+	const char *fileName = readBatch->fileNames[slot->index];
+	uint64_t slotId = (uint64_t)(slot - uring->slots);
+	
+	// getxattr has no directory descriptor argument, so relative names are resolved through /proc/self/fd
+	int pathLength = (readBatch->dirFd == AT_FDCWD || fileName[0] == '/')
+	               ? snprintf(slot->path, sizeof(slot->path), "%s", fileName)
+	               : snprintf(slot->path, sizeof(slot->path), "/proc/self/fd/%d/%s", readBatch->dirFd, fileName);
+	if(pathLength < 0 || pathLength >= (int)sizeof(slot->path))
+	{
+		if(read_batch_item(context, readBatch->dirFd, fileName, readBatch->loadDefaultAcl, &readBatch->results[slot->index], readBatch->entries, readBatch->entriesLength, &readBatch->entriesUsed) != NATIVE_ERROR_SUCCESS)
+			++readBatch->failedCount;
+		return 0;
+	}
+	
+	// Both operations are independent, so they run concurrently
+	struct io_uring_sqe *sqe = get_uring_sqe(uring);
+	sqe->opcode = IORING_OP_STATX;
+	sqe->fd = readBatch->dirFd;
+	sqe->addr = (uintptr_t)fileName;
+	sqe->len = STATX_PERMISSION_DATA_MASK;
+	sqe->addr2 = (uintptr_t)&slot->statxBuffer;
+	sqe->statx_flags = ((context->options & NATIVE_CONTEXT_OPTION_NO_FOLLOW) ? AT_SYMLINK_NOFOLLOW : 0) | get_statx_sync_flag(context);
+	sqe->user_data = slotId * 2;
+	
+	sqe = get_uring_sqe(uring);
+	sqe->opcode = IORING_OP_GETXATTR;
+	sqe->addr = (uintptr_t)get_acl_attribute_name(readBatch->loadDefaultAcl);
+	sqe->addr2 = (uintptr_t)slot->xattr;
+	sqe->addr3 = (uintptr_t)slot->path;
+	sqe->len = sizeof(slot->xattr);
+	sqe->user_data = slotId * 2 + 1;
+	
+	return 2;
+}
+
+// Stores the result of the batch read item assigned to the given slot, with the same semantics as "ReadPermissionDataAtCtx".
+static void complete_read_item(native_context_t *context, uring_slot_t *slot, void *batch)
+{
+	uring_read_batch_t *readBatch = batch;
+	native_batch_read_result_t *result = &readBatch->results[slot->index];
+	
+	// The ACL did not fit into the slot buffer, read the item again synchronously
+	if(slot->statxResult == 0 && slot->xattrResult == -ERANGE)
+	{
+		if(read_batch_item(context, readBatch->dirFd, readBatch->fileNames[slot->index], readBatch->loadDefaultAcl, result, readBatch->entries, readBatch->entriesLength, &readBatch->entriesUsed) != NATIVE_ERROR_SUCCESS)
+			++readBatch->failedCount;
+		return;
+	}
+	
+	result->entriesOffset = readBatch->entriesUsed;
+	result->status = NATIVE_ERROR_SUCCESS;
+	result->errnoValue = 0;
+	if(slot->statxResult < 0)
+	{
+		// The file could not be looked up, like a failing open()
+		result->status = NATIVE_ERROR_OPEN_FAILED;
+		result->errnoValue = -slot->statxResult;
+	}
+	else
+	{
+		// Fill basic permission fields
+		mode_t fileMode = slot->statxBuffer.stx_mode;
+		fill_permission_data(&slot->statxBuffer, &result->dataContainer);
+		
+		// Decode ACL; missing attributes and symbolic links are handled like in "read_acl"
+		native_acl_entry_t *entries = readBatch->entries + readBatch->entriesUsed;
+		int32_t entriesLength = readBatch->entriesLength - readBatch->entriesUsed;
+		int32_t aclSize = 0;
+		if(readBatch->loadDefaultAcl > 0 && !S_ISDIR(fileMode))
+		{
+			result->status = NATIVE_ERROR_GET_ACL_FAILED;
+			result->errnoValue = EACCES;
+		}
+		else if(S_ISLNK(fileMode) || slot->xattrResult == -ENODATA)
+			fill_acl_without_xattr(readBatch->loadDefaultAcl, &result->dataContainer, entries, entriesLength, &aclSize);
+		else if(slot->xattrResult < 0)
+		{
+			result->status = NATIVE_ERROR_GET_XATTR_FAILED;
+			result->errnoValue = -slot->xattrResult;
+		}
+		else
+			result->status = decode_xattr_acl(slot->xattr, (size_t)slot->xattrResult, entries, entriesLength, &aclSize);
+		
+		result->dataContainer.aclSize = aclSize;
+		if(result->status == NATIVE_ERROR_SUCCESS && aclSize > entriesLength)
+			result->status = NATIVE_ERROR_BUFFER_TOO_SMALL;
+	}
+	
+	if(result->status == NATIVE_ERROR_SUCCESS)
+		readBatch->entriesUsed += result->dataContainer.aclSize;
+	else
+		++readBatch->failedCount;
+}
+
+// Updates owner and permission bits of the batch apply item assigned to the given slot, and submits a setxattr operation for its ACL.
+static int32_t prepare_apply_item(native_context_t *context, uring_engine_t *uring, uring_slot_t *slot, void *batch)
+{
+	uring_apply_batch_t *applyBatch = batch;
+	const native_compiled_permissions_t *compiledPermissions = applyBatch->compiledPermissions;
+	native_batch_status_t *result = &applyBatch->results[slot->index];
+	
+	// There are no io_uring operations for changing owner and permission bits
+	context->lastErrnoValue = 0;
+	native_error_code_t err = open_file_and_update_metadata(context, applyBatch->dirFd, applyBatch->fileNames[slot->index], compiledPermissions->setDefaultAcl, 0, &compiledPermissions->dataContainer, NULL, &result->changes);
+	if(err != NATIVE_ERROR_SUCCESS)
+	{
+		result->status = err;
+		result->errnoValue = context->lastErrnoValue;
+		++applyBatch->failedCount;
+		return 0;
+	}
+	
+	// The descriptor is moved into the slot, and stays open until the ACL was assigned through its /proc/self/fd path
+	slot->fd = context->fd;
+	context->fd = -1;
+	snprintf(slot->path, sizeof(slot->path), "/proc/self/fd/%d", slot->fd);
+	
+	struct io_uring_sqe *sqe = get_uring_sqe(uring);
+	sqe->opcode = IORING_OP_SETXATTR;
+	sqe->addr = (uintptr_t)get_acl_attribute_name(compiledPermissions->setDefaultAcl);
+	sqe->addr2 = (uintptr_t)compiledPermissions->xattr;
+	sqe->addr3 = (uintptr_t)slot->path;
+	sqe->len = (uint32_t)compiledPermissions->xattrLength;
+	sqe->user_data = (uint64_t)(slot - uring->slots) * 2 + 1;
+	
+	return 1;
+}
+
+// Stores the result of the batch apply item assigned to the given slot, and closes its descriptor.
+static void complete_apply_item(native_context_t *context, uring_slot_t *slot, void *batch)
+{
+	(void)context;
+	uring_apply_batch_t *applyBatch = batch;
+	native_batch_status_t *result = &applyBatch->results[slot->index];
+	
+	close(slot->fd);
+	slot->fd = -1;
+	
+	if(slot->xattrResult < 0)
+	{
+		result->status = NATIVE_ERROR_SET_XATTR_FAILED;
+		result->errnoValue = -slot->xattrResult;
+		result->changes &= ~(NATIVE_PERMISSION_CHANGE_ACCESS_ACL | NATIVE_PERMISSION_CHANGE_DEFAULT_ACL);
+		++applyBatch->failedCount;
+	}
+	else
+	{
+		result->status = NATIVE_ERROR_SUCCESS;
+		result->errnoValue = 0;
+	}
+}
+
+#endif
+
+
+// Converts the given inotify event mask into native_watch_event_flags_t.
+static uint32_t convert_inotify_event_mask(uint32_t mask)
+{
+	uint32_t flags = 0;
+	if(mask & IN_ATTRIB)
+		flags |= NATIVE_WATCH_EVENT_ATTRIBUTES;
+	if(mask & IN_CREATE)
+		flags |= NATIVE_WATCH_EVENT_CREATED;
+	if(mask & IN_DELETE)
+		flags |= NATIVE_WATCH_EVENT_DELETED;
+	if(mask & IN_MOVED_FROM)
+		flags |= NATIVE_WATCH_EVENT_DELETED | NATIVE_WATCH_EVENT_MOVED;
+	if(mask & IN_MOVED_TO)
+		flags |= NATIVE_WATCH_EVENT_CREATED | NATIVE_WATCH_EVENT_MOVED;
+	if(mask & IN_ISDIR)
+		flags |= NATIVE_WATCH_EVENT_DIRECTORY;
+	if(mask & IN_IGNORED)
+		flags |= NATIVE_WATCH_EVENT_WATCH_REMOVED;
+	if(mask & IN_Q_OVERFLOW)
+		flags |= NATIVE_WATCH_EVENT_OVERFLOW;
+	return flags;
+}
+
+// Converts the raw inotify event at the current buffer position of the given watcher, and stores its name at the given position of the name buffer.
+// Returns the number of name bytes used, or -1 if the name does not fit.
+static int32_t convert_inotify_event(native_file_watcher_t *watcher, native_watch_event_t *event, char *names, int32_t namesLength, int32_t namesUsed, size_t *rawEventLength)
+{
+	const struct inotify_event *rawEvent = (const struct inotify_event *)&watcher->buffer[watcher->bufferPosition];
+	*rawEventLength = sizeof(struct inotify_event) + rawEvent->len;
+	
+	event->watchDescriptor = rawEvent->wd;
+	event->flags = convert_inotify_event_mask(rawEvent->mask);
+	event->cookie = rawEvent->cookie;
+	event->nameOffset = -1;
+	
+	// The name is padded with null bytes
+	if(rawEvent->len == 0 || rawEvent->name[0] == '\0')
+		return 0;
+	int32_t nameLength = (int32_t)strlen(rawEvent->name) + 1;
+	if(nameLength > namesLength - namesUsed)
+		return -1;
+	memcpy(&names[namesUsed], rawEvent->name, nameLength);
+	event->nameOffset = namesUsed;
+	return nameLength;
+}
+
+#ifdef FAN_REPORT_DFID_NAME
+
+// Resolves the directory handle and name of a fanotify event to an absolute path, which is stored at the given position of the name buffer.
+// Returns the number of name bytes used, 0 if the path could not be resolved, or -1 if it does not fit.
+static int32_t resolve_fanotify_path(native_file_watcher_t *watcher, const struct fanotify_event_info_fid *info, char *names, int32_t namesLength, int32_t namesUsed)
+{
+	// The name follows the file handle
+	struct file_handle *handle = (struct file_handle *)info->handle;
+	const char *name = (const char *)handle->f_handle + handle->handle_bytes;
+	
+	// Find a descriptor on the file system of the directory
+	int mountFd = -1;
+	for(int32_t i = 0; i < watcher->mountCount; ++i)
+	{
+		if(memcmp(&watcher->mounts[i].fsid, &info->fsid, sizeof(fsid_t)) == 0)
+		{
+			mountFd = watcher->mounts[i].fd;
+			break;
+		}
+	}
+	if(mountFd < 0)
+		return 0;
+	
+	// Get the path of the directory. This fails if it was deleted in the meantime
+	int dirFd = open_by_handle_at(mountFd, handle, O_PATH | O_CLOEXEC);
+	if(dirFd < 0)
+		return 0;
+	char fdPath[32];
+	snprintf(fdPath, sizeof(fdPath), "/proc/self/fd/%d", dirFd);
+	char directoryPath[PATH_MAX];
+	ssize_t directoryPathLength = readlink(fdPath, directoryPath, sizeof(directoryPath));
+	close(dirFd);
+	if(directoryPathLength <= 0 || directoryPathLength == sizeof(directoryPath))
+		return 0;
+	
+	// Append the name; events on the directory itself have the name "."
+	int isDirectoryItself = name[0] == '\0' || strcmp(name, ".") == 0;
+	int separatorLength = isDirectoryItself || directoryPath[directoryPathLength - 1] == '/' ? 0 : 1;
+	size_t nameLength = isDirectoryItself ? 0 : strlen(name);
+	int32_t pathLength = (int32_t)(directoryPathLength + separatorLength + nameLength + 1);
+	if(pathLength > namesLength - namesUsed)
+		return -1;
+	char *path = &names[namesUsed];
+	memcpy(path, directoryPath, directoryPathLength);
+	if(separatorLength)
+		path[directoryPathLength] = '/';
+	memcpy(path + directoryPathLength + separatorLength, name, nameLength);
+	path[pathLength - 1] = '\0';
+	return pathLength;
+}
+
+// Converts the raw fanotify event at the current buffer position of the given watcher, and stores its absolute path at the given position of the name buffer.
+// Events which cannot be resolved to a path are reported as overflow, so the caller revalidates everything. Returns the number of name bytes used, or -1 if the path does not fit.
+static int32_t convert_fanotify_event(native_file_watcher_t *watcher, native_watch_event_t *event, char *names, int32_t namesLength, int32_t namesUsed, size_t *rawEventLength)
+{
+	const struct fanotify_event_metadata *rawEvent = (const struct fanotify_event_metadata *)&watcher->buffer[watcher->bufferPosition];
+	*rawEventLength = rawEvent->event_len;
+	
+	event->watchDescriptor = -1;
+	event->flags = 0;
+	event->cookie = 0;
+	event->nameOffset = -1;
+	if(rawEvent->mask & FAN_Q_OVERFLOW)
+	{
+		event->flags = NATIVE_WATCH_EVENT_OVERFLOW;
+		return 0;
+	}
+	
+	if(rawEvent->mask & FAN_ATTRIB)
+		event->flags |= NATIVE_WATCH_EVENT_ATTRIBUTES;
+	if(rawEvent->mask & FAN_CREATE)
+		event->flags |= NATIVE_WATCH_EVENT_CREATED;
+	if(rawEvent->mask & FAN_DELETE)
+		event->flags |= NATIVE_WATCH_EVENT_DELETED;
+	if(rawEvent->mask & FAN_MOVED_FROM)
+		event->flags |= NATIVE_WATCH_EVENT_DELETED | NATIVE_WATCH_EVENT_MOVED;
+	if(rawEvent->mask & FAN_MOVED_TO)
+		event->flags |= NATIVE_WATCH_EVENT_CREATED | NATIVE_WATCH_EVENT_MOVED;
+	if(rawEvent->mask & FAN_ONDIR)
+		event->flags |= NATIVE_WATCH_EVENT_DIRECTORY;
+	
+	// Find the directory handle and name
+	size_t infoPosition = rawEvent->metadata_len;
+	while(infoPosition + sizeof(struct fanotify_event_info_header) <= rawEvent->event_len)
+	{
+		const struct fanotify_event_info_header *header = (const struct fanotify_event_info_header *)((const char *)rawEvent + infoPosition);
+		if(header->len == 0)
+			break;
+		if(header->info_type == FAN_EVENT_INFO_TYPE_DFID_NAME)
+		{
+			int32_t pathLength = resolve_fanotify_path(watcher, (const struct fanotify_event_info_fid *)header, names, namesLength, namesUsed);
+			if(pathLength > 0)
+				event->nameOffset = namesUsed;
+			else if(pathLength == 0)
+				event->flags = NATIVE_WATCH_EVENT_OVERFLOW;
+			return pathLength;
+		}
+		infoPosition += header->len;
+	}
+	
+	event->flags = NATIVE_WATCH_EVENT_OVERFLOW;
+	return 0;
+}
+
+#endif
+
+/* EXPOSED API FUNCTIONS */
+
+extern native_error_code_t ReadPermissionDataCtx(native_context_t *context, const char *fileName, int32_t loadDefaultAcl, native_permission_data_container_t *dataContainer, native_acl_entry_t *entries, int32_t entriesLength)
+{
+	return ReadPermissionDataAtCtx(context, AT_FDCWD, fileName, loadDefaultAcl, dataContainer, entries, entriesLength);
+}
+
+extern native_error_code_t ReadPermissionDataAtCtx(native_context_t *context, intptr_t dirFd, const char *fileName, int32_t loadDefaultAcl, native_permission_data_container_t *dataContainer, native_acl_entry_t *entries, int32_t entriesLength)
+{
+	return ReadPermissionDataWithIdentityAtCtx(context, dirFd, fileName, loadDefaultAcl, dataContainer, entries, entriesLength, NULL);
+}
+
+extern native_error_code_t ReadPermissionDataWithIdentityAtCtx(native_context_t *context, intptr_t dirFd, const char *fileName, int32_t loadDefaultAcl, native_permission_data_container_t *dataContainer, native_acl_entry_t *entries, int32_t entriesLength, native_file_identity_t *identity)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	
+	// Read permission data
+	mode_t fileMode;
+	native_error_code_t err = open_file_and_read_metadata(context, (int)dirFd, fileName, dataContainer, &fileMode, identity);
+	if(err != NATIVE_ERROR_SUCCESS)
+		return err;
+	
+	// Read ACL
+	int32_t aclSize = 0;
+	err = read_acl(context, context->fdPath, loadDefaultAcl, fileMode, dataContainer, entries, entriesLength, &aclSize);
+	if(err != NATIVE_ERROR_SUCCESS)
+		return cleanup_with_error_code(context, err);
+	dataContainer->aclSize = aclSize;
+	
+	// Done, the file is never kept open
+	return cleanup_with_error_code(context, aclSize > entriesLength ? NATIVE_ERROR_BUFFER_TOO_SMALL : NATIVE_ERROR_SUCCESS);
+}
+
+extern native_error_code_t ReadFileIdentityAtCtx(native_context_t *context, intptr_t dirFd, const char *fileName, native_file_identity_t *identity)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	
+	// A single statx() on the name suffices, the file is not opened
+	struct statx fileStat;
+	int flags = get_statx_sync_flag(context) | ((context->options & NATIVE_CONTEXT_OPTION_NO_FOLLOW) ? AT_SYMLINK_NOFOLLOW : 0);
+	if(statx((int)dirFd, fileName, flags, STATX_INO | STATX_CTIME, &fileStat) < 0)
+	{
+		store_errno(context);
+		return NATIVE_ERROR_FSTAT_FAILED;
+	}
+	fill_file_identity(&fileStat, identity);
+	
+	return NATIVE_ERROR_SUCCESS;
+}
+
+extern int32_t ReadPermissionDataBatchCtx(native_context_t *context, intptr_t dirFd, const char **fileNames, int32_t fileCount, int32_t loadDefaultAcl, native_batch_read_result_t *results, native_acl_entry_t *entries, int32_t entriesLength)
+{
+	int32_t failedCount = 0;
+	int32_t entriesUsed = 0;
+	int32_t i = 0;
+	
+#ifdef ACLNATIVE_IO_URING
+	// Let io_uring look up and read the items concurrently.
+	// IORING_OP_GETXATTR only takes a path and always follows symbolic links, and IORING_OP_FGETXATTR does not accept O_PATH descriptors.
+	// The statx and the getxattr of an item could thus see different files if it is replaced by a symbolic link in between, so reads with NATIVE_CONTEXT_OPTION_NO_FOLLOW run synchronously
+	uring_engine_t *uring;
+	if((context->options & NATIVE_CONTEXT_OPTION_IO_URING) && !(context->options & (NATIVE_CONTEXT_OPTION_USE_LIBACL | NATIVE_CONTEXT_OPTION_NO_FOLLOW)) && (uring = get_uring(context)))
+	{
+		uring_read_batch_t batch = { (int)dirFd, fileNames, loadDefaultAcl, results, entries, entriesLength, 0, 0 };
+		i = run_uring_batch(context, uring, fileCount, 2, prepare_read_item, complete_read_item, &batch);
+		failedCount = batch.failedCount;
+		entriesUsed = batch.entriesUsed;
+	}
+#endif
+	
+	// Read remaining items one by one
+	for(; i < fileCount; ++i)
+	{
+		if(read_batch_item(context, (int)dirFd, fileNames[i], loadDefaultAcl, &results[i], entries, entriesLength, &entriesUsed) != NATIVE_ERROR_SUCCESS)
+			++failedCount;
+	}
+	
+	return failedCount;
+}
+
+extern native_error_code_t OpenFileAndReadPermissionDataCtx(native_context_t *context, const char *fileName, int32_t loadDefaultAcl, native_permission_data_container_t *dataContainer)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	
+	// Read permission data and load ACL
+	native_error_code_t err = open_file_and_load_acl(context, fileName, loadDefaultAcl, dataContainer);
+	if(err != NATIVE_ERROR_SUCCESS)
+		return err;
+	
+	// Iterate ACL and determine entry count
+	int aclSize = 0;
+	acl_entry_t currEntry;
+	int aclStatus = acl_get_entry(context->acl, ACL_FIRST_ENTRY, &currEntry);
+	while(aclStatus > 0)
+	{
+		++aclSize;
+		aclStatus = acl_get_entry(context->acl, ACL_NEXT_ENTRY, &currEntry);
+	}
+	if(aclStatus < 0)
+	{
+		store_errno(context);
+		return cleanup_with_error_code(context, NATIVE_ERROR_GET_ACL_ENTRY_FAILED);
+	}
+	dataContainer->aclSize = (int32_t)aclSize;
+	
+	// Done
+	return NATIVE_ERROR_SUCCESS;
+}
+
+extern native_error_code_t ReadFileAclAndCloseCtx(native_context_t *context, native_acl_entry_t *entries)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	
+	// Iterate ACL
+	acl_entry_t currEntry;
+	int aclStatus = acl_get_entry(context->acl, ACL_FIRST_ENTRY, &currEntry);
+	int i = 0;
+	while(aclStatus > 0)
+	{
+		native_error_code_t err = convert_acl_entry(context, currEntry, &entries[i]);
+		if(err != NATIVE_ERROR_SUCCESS)
+			return cleanup_with_error_code(context, err);
+		
+		// Next entry
+		++i;
+		aclStatus = acl_get_entry(context->acl, ACL_NEXT_ENTRY, &currEntry);
+	}
+	if(aclStatus < 0)
+	{
+		store_errno(context);
+		return cleanup_with_error_code(context, NATIVE_ERROR_GET_ACL_ENTRY_FAILED);
+	}
+	
+	// Done
+	return cleanup_with_error_code(context, NATIVE_ERROR_SUCCESS);
+}
+
+extern native_error_code_t SetFilePermissionDataAndAclCtx(native_context_t *context, const char *fileName, int32_t setDefaultAcl, native_permission_data_container_t *dataContainer, native_acl_entry_t *entries)
+{
+	return SetFilePermissionDataAndAclAtCtx(context, AT_FDCWD, fileName, setDefaultAcl, dataContainer, entries);
+}
+
+extern native_error_code_t SetFilePermissionDataAndAclAtCtx(native_context_t *context, intptr_t dirFd, const char *fileName, int32_t setDefaultAcl, native_permission_data_container_t *dataContainer, native_acl_entry_t *entries)
+{
+	return SetFilePermissionDataAndAclWithChangesAtCtx(context, dirFd, fileName, setDefaultAcl, dataContainer, entries, NULL);
+}
+
+extern native_error_code_t SetFilePermissionDataAndAclWithChangesAtCtx(native_context_t *context, intptr_t dirFd, const char *fileName, int32_t setDefaultAcl, native_permission_data_container_t *dataContainer, native_acl_entry_t *entries, int32_t *changes)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	int32_t localChanges;
+	if(!changes)
+		changes = &localChanges;
+	
+	// For comparing, the entries are brought into the order of the current ACL
+	native_acl_entry_t stackEntries[ACL_COMPARE_STACK_ENTRIES];
+	native_acl_entry_t *normalizedEntries = NULL;
+	if(context->options & NATIVE_CONTEXT_OPTION_SKIP_UNCHANGED)
+	{
+		normalizedEntries = dataContainer->aclSize <= ACL_COMPARE_STACK_ENTRIES ? stackEntries : malloc(dataContainer->aclSize * sizeof(native_acl_entry_t));
+		if(!normalizedEntries)
+		{
+			*changes = NATIVE_PERMISSION_CHANGE_NONE;
+			errno = ENOMEM;
+			store_errno(context);
+			return NATIVE_ERROR_OUT_OF_MEMORY;
+		}
+		normalize_acl_entries(entries, dataContainer->aclSize, normalizedEntries);
+	}
+	
+	// Open file and update owner and UNIX permissions
+	int32_t aclChange = setDefaultAcl > 0 ? NATIVE_PERMISSION_CHANGE_DEFAULT_ACL : NATIVE_PERMISSION_CHANGE_ACCESS_ACL;
+	native_error_code_t err = open_file_and_update_metadata(context, (int)dirFd, fileName, setDefaultAcl, 0, dataContainer, normalizedEntries, changes);
+	if(normalizedEntries != stackEntries)
+		free(normalizedEntries);
+	if(err != NATIVE_ERROR_SUCCESS)
+		return err;
+	
+	// Assign ACL
+	if(*changes & aclChange)
+	{
+		err = write_acl(context, setDefaultAcl, entries, dataContainer->aclSize);
+		if(err != NATIVE_ERROR_SUCCESS)
+			*changes &= ~aclChange;
+	}
+	
+	// Done
+	return cleanup_with_error_code(context, err);
+}
+
+extern native_error_code_t ReadDirectoryPermissionDataAtCtx(native_context_t *context, intptr_t dirFd, const char *dirName, native_permission_data_container_t *dataContainer, native_acl_entry_t *entries, int32_t entriesLength, int32_t *defaultAclSize)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	*defaultAclSize = 0;
+	
+	// Read permission data
+	mode_t fileMode;
+	native_error_code_t err = open_file_and_read_metadata(context, (int)dirFd, dirName, dataContainer, &fileMode, NULL);
+	if(err != NATIVE_ERROR_SUCCESS)
+		return err;
+	
+	// Read both ACLs through the same descriptor; the default ACL is stored behind the access ACL
+	int32_t accessAclSize = 0;
+	err = read_acl(context, context->fdPath, 0, fileMode, dataContainer, entries, entriesLength, &accessAclSize);
+	if(err == NATIVE_ERROR_SUCCESS)
+	{
+		int32_t usedEntries = accessAclSize < entriesLength ? accessAclSize : entriesLength;
+		err = read_acl(context, context->fdPath, 1, fileMode, dataContainer, entries + usedEntries, entriesLength - usedEntries, defaultAclSize);
+	}
+	if(err != NATIVE_ERROR_SUCCESS)
+		return cleanup_with_error_code(context, err);
+	dataContainer->aclSize = accessAclSize;
+	
+	// Done, the file is never kept open
+	return cleanup_with_error_code(context, accessAclSize + *defaultAclSize > entriesLength ? NATIVE_ERROR_BUFFER_TOO_SMALL : NATIVE_ERROR_SUCCESS);
+}
+
+extern native_error_code_t SetDirectoryPermissionDataAtCtx(native_context_t *context, intptr_t dirFd, const char *dirName, native_permission_data_container_t *dataContainer, native_acl_entry_t *entries, int32_t defaultAclSize, int32_t *changes)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	int32_t localChanges;
+	if(!changes)
+		changes = &localChanges;
+	
+	// For comparing, both ACLs are brought into the order of the current ones
+	int32_t entryCount = dataContainer->aclSize + defaultAclSize;
+	native_acl_entry_t stackEntries[ACL_COMPARE_STACK_ENTRIES];
+	native_acl_entry_t *normalizedEntries = NULL;
+	if(context->options & NATIVE_CONTEXT_OPTION_SKIP_UNCHANGED)
+	{
+		normalizedEntries = entryCount <= ACL_COMPARE_STACK_ENTRIES ? stackEntries : malloc(entryCount * sizeof(native_acl_entry_t));
+		if(!normalizedEntries)
+		{
+			*changes = NATIVE_PERMISSION_CHANGE_NONE;
+			errno = ENOMEM;
+			store_errno(context);
+			return NATIVE_ERROR_OUT_OF_MEMORY;
+		}
+		normalize_acl_entries(entries, dataContainer->aclSize, normalizedEntries);
+		normalize_acl_entries(entries + dataContainer->aclSize, defaultAclSize, normalizedEntries + dataContainer->aclSize);
+	}
+	
+	// Open directory and update owner and UNIX permissions
+	native_error_code_t err = open_file_and_update_metadata(context, (int)dirFd, dirName, 0, 1, dataContainer, normalizedEntries, changes);
+	if(err != NATIVE_ERROR_SUCCESS)
+	{
+		if(normalizedEntries != stackEntries)
+			free(normalizedEntries);
+		return err;
+	}
+	
+	// Assign both ACLs through the same descriptor. The directory type was already checked, and the permission data now matches the requested one.
+	if(!normalizedEntries || !is_acl_unchanged(context, 1, S_IFDIR, dataContainer, normalizedEntries + dataContainer->aclSize, defaultAclSize))
+		*changes |= NATIVE_PERMISSION_CHANGE_DEFAULT_ACL;
+	if(normalizedEntries != stackEntries)
+		free(normalizedEntries);
+	if(*changes & NATIVE_PERMISSION_CHANGE_ACCESS_ACL)
+	{
+		err = write_acl(context, 0, entries, dataContainer->aclSize);
+		if(err != NATIVE_ERROR_SUCCESS)
+			*changes &= ~(NATIVE_PERMISSION_CHANGE_ACCESS_ACL | NATIVE_PERMISSION_CHANGE_DEFAULT_ACL);
+	}
+	if(err == NATIVE_ERROR_SUCCESS && (*changes & NATIVE_PERMISSION_CHANGE_DEFAULT_ACL))
+	{
+		if(defaultAclSize > 0)
+			err = write_acl(context, 1, entries + dataContainer->aclSize, defaultAclSize);
+		else
+			err = remove_default_acl(context);
+		if(err != NATIVE_ERROR_SUCCESS)
+			*changes &= ~NATIVE_PERMISSION_CHANGE_DEFAULT_ACL;
+	}
+	
+	// Done
+	return cleanup_with_error_code(context, err);
+}
+
+extern native_error_code_t OpenDirectoryCtx(native_context_t *context, const char *dirName, intptr_t *dirFd)
+{
+	return OpenDirectoryAtCtx(context, AT_FDCWD, dirName, dirFd);
+}
+
+extern native_error_code_t OpenDirectoryAtCtx(native_context_t *context, intptr_t parentDirFd, const char *dirName, intptr_t *dirFd)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	
+	// Open with read access, so the directory can also be enumerated
+	int fd = openat((int)parentDirFd, dirName, O_RDONLY | O_DIRECTORY | O_CLOEXEC | ((context->options & NATIVE_CONTEXT_OPTION_NO_FOLLOW) ? O_NOFOLLOW : 0));
+	if(fd < 0)
+	{
+		store_errno(context);
+		*dirFd = -1;
+		return NATIVE_ERROR_OPEN_FAILED;
+	}
+	
+	*dirFd = fd;
+	return NATIVE_ERROR_SUCCESS;
+}
+
+extern void CloseDirectory(intptr_t dirFd)
+{
+	if(dirFd >= 0)
+		close((int)dirFd);
+}
+
+extern native_error_code_t CompilePermissionDataCtx(native_context_t *context, int32_t setDefaultAcl, const native_permission_data_container_t *dataContainer, const native_acl_entry_t *entries, native_compiled_permissions_t **compiledPermissions)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	*compiledPermissions = NULL;
+	
+	// Release leftovers of an incomplete previous operation
+	cleanup_with_error_code(context, NATIVE_ERROR_SUCCESS);
+	
+	native_compiled_permissions_t *compiled = calloc(1, sizeof(native_compiled_permissions_t));
+	if(!compiled)
+	{
+		errno = ENOMEM;
+		store_errno(context);
+		return NATIVE_ERROR_OUT_OF_MEMORY;
+	}
+	compiled->setDefaultAcl = setDefaultAcl;
+	compiled->dataContainer = *dataContainer;
+	
+	// Keep the entries for comparing them with the current ACLs of the files
+	compiled->normalizedEntries = malloc((dataContainer->aclSize > 0 ? dataContainer->aclSize : 1) * sizeof(native_acl_entry_t));
+	if(!compiled->normalizedEntries)
+	{
+		FreeCompiledPermissions(compiled);
+		errno = ENOMEM;
+		store_errno(context);
+		return NATIVE_ERROR_OUT_OF_MEMORY;
+	}
+	normalize_acl_entries(entries, dataContainer->aclSize, compiled->normalizedEntries);
+	
+	// Build and validate ACL
+	native_error_code_t err;
+#ifdef ACLNATIVE_RAW_XATTR
+	if(!(context->options & NATIVE_CONTEXT_OPTION_USE_LIBACL))
+	{
+		compiled->xattrLength = get_xattr_acl_length(dataContainer->aclSize);
+		compiled->xattr = malloc(compiled->xattrLength);
+		if(!compiled->xattr)
+		{
+			errno = ENOMEM;
+			store_errno(context);
+			err = NATIVE_ERROR_OUT_OF_MEMORY;
+		}
+		else
+			err = encode_xattr_acl(context, entries, dataContainer->aclSize, compiled->xattr);
+	}
+	else
+#endif
+	{
+		// The ACL is moved from the context into the compiled object
+		err = build_acl_libacl(context, entries, dataContainer->aclSize);
+		compiled->acl = context->acl;
+		context->acl = NULL;
+	}
+	if(err != NATIVE_ERROR_SUCCESS)
+	{
+		FreeCompiledPermissions(compiled);
+		return err;
+	}
+	
+	*compiledPermissions = compiled;
+	return NATIVE_ERROR_SUCCESS;
+}
+
+extern int32_t ApplyCompiledPermissionsBatchCtx(native_context_t *context, const native_compiled_permissions_t *compiledPermissions, intptr_t dirFd, const char **fileNames, int32_t fileCount, native_batch_status_t *results)
+{
+	int32_t failedCount = 0;
+	int32_t i = 0;
+	
+#ifdef ACLNATIVE_IO_URING
+	// Let io_uring write the ACLs concurrently
+	uring_engine_t *uring;
+	if((context->options & NATIVE_CONTEXT_OPTION_IO_URING) && !(context->options & NATIVE_CONTEXT_OPTION_SKIP_UNCHANGED) && compiledPermissions->xattr && (uring = get_uring(context)))
+	{
+		uring_apply_batch_t batch = { (int)dirFd, fileNames, compiledPermissions, results, 0 };
+		i = run_uring_batch(context, uring, fileCount, 1, prepare_apply_item, complete_apply_item, &batch);
+		failedCount = batch.failedCount;
+	}
+#endif
+	
+	// Update remaining items one by one
+	for(; i < fileCount; ++i)
+	{
+		if(apply_batch_item(context, compiledPermissions, (int)dirFd, fileNames[i], &results[i]) != NATIVE_ERROR_SUCCESS)
+			++failedCount;
+	}
+	
+	return failedCount;
+}
+
+extern void FreeCompiledPermissions(native_compiled_permissions_t *compiledPermissions)
+{
+	if(!compiledPermissions)
+		return;
+	
+	if(compiledPermissions->acl)
+		acl_free(compiledPermissions->acl);
+	free(compiledPermissions->normalizedEntries);
+#ifdef ACLNATIVE_RAW_XATTR
+	free(compiledPermissions->xattr);
+#endif
+	free(compiledPermissions);
+}
+
+extern native_error_code_t CreateTreeScannerCtx(native_context_t *context, const char *rootPath, native_tree_scanner_t **scanner)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	*scanner = NULL;
+	
+	native_tree_scanner_t *newScanner = calloc(1, sizeof(native_tree_scanner_t));
+	if(!newScanner)
+	{
+		errno = ENOMEM;
+		store_errno(context);
+		return NATIVE_ERROR_OUT_OF_MEMORY;
+	}
+	
+	// Open root directory
+	int fd = open(rootPath, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if(fd < 0)
+	{
+		store_errno(context);
+		free(newScanner);
+		return NATIVE_ERROR_OPEN_FAILED;
+	}
+	if(push_scanner_directory(newScanner, fd, 0) < 0)
+	{
+		close(fd);
+		FreeTreeScanner(newScanner);
+		errno = ENOMEM;
+		store_errno(context);
+		return NATIVE_ERROR_OUT_OF_MEMORY;
+	}
+	
+	*scanner = newScanner;
+	return NATIVE_ERROR_SUCCESS;
+}
+
+extern native_error_code_t ReadTreeScannerRecordsCtx(native_context_t *context, native_tree_scanner_t *scanner, char *buffer, int32_t bufferLength, int32_t *bytesWritten, int32_t *recordCount)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	*bytesWritten = 0;
+	*recordCount = 0;
+	
+	int32_t bufferPosition = 0;
+	int32_t recordLength;
+	native_error_code_t err = NATIVE_ERROR_SUCCESS;
+	char aclPath[TREE_SCANNER_ACL_PATH_SIZE];
+	
+	// The root directory is emitted first
+	if(!scanner->rootEmitted && scanner->directoryCount > 0)
+	{
+		tree_scanner_directory_t *root = &scanner->directories[0];
+		struct statx fileStat;
+		native_error_code_t status = NATIVE_ERROR_SUCCESS;
+		int errnoValue = 0;
+		if(statx(root->fd, "", AT_EMPTY_PATH | get_statx_sync_flag(context), STATX_PERMISSION_DATA_MASK | STATX_INO, &fileStat) < 0)
+		{
+			memset(&fileStat, 0, sizeof(fileStat));
+			status = NATIVE_ERROR_FSTAT_FAILED;
+			errnoValue = errno;
+		}
+		snprintf(aclPath, sizeof(aclPath), "/proc/self/fd/%d", root->fd);
+		
+		err = write_scan_record(context, &fileStat, status, errnoValue, aclPath, "", 0, 0, buffer, bufferLength, &recordLength);
+		if(err != NATIVE_ERROR_SUCCESS)
+		{
+			*bytesWritten = recordLength;
+			return err;
+		}
+		bufferPosition += recordLength;
+		++*recordCount;
+		scanner->rootEmitted = 1;
+	}
+	
+	// Depth-first traversal
+	while(scanner->directoryCount > 0)
+	{
+		tree_scanner_directory_t *directory = &scanner->directories[scanner->directoryCount - 1];
+		
+		// Fetch next batch of directory entries
+		if(directory->entriesPosition >= directory->entriesLength)
+		{
+			long length = syscall(SYS_getdents64, directory->fd, directory->entries, TREE_SCANNER_DIRENT_BUFFER_SIZE);
+			if(length <= 0)
+			{
+				// End of directory, or error: Continue with parent directory
+				if(length < 0)
+					store_errno(context);
+				pop_scanner_directory(scanner);
+				if(length < 0)
+				{
+					err = NATIVE_ERROR_READ_DIRECTORY_FAILED;
+					break;
+				}
+				continue;
+			}
+			directory->entriesLength = length;
+			directory->entriesPosition = 0;
+		}
+		linux_dirent64_t *entry = (linux_dirent64_t *)(directory->entries + directory->entriesPosition);
+		
+		// Skip "." and ".."
+		if(entry->d_name[0] == '.' && (entry->d_name[1] == '\0' || (entry->d_name[1] == '.' && entry->d_name[2] == '\0')))
+		{
+			directory->entriesPosition += entry->d_reclen;
+			continue;
+		}
+		
+		// Build relative path
+		size_t nameLength = strlen(entry->d_name);
+		size_t pathLength = directory->pathLength + (directory->pathLength > 0 ? 1 : 0) + nameLength;
+		if(pathLength + 1 > scanner->pathCapacity)
+		{
+			size_t newCapacity = scanner->pathCapacity > 0 ? scanner->pathCapacity : 256;
+			while(newCapacity < pathLength + 1)
+				newCapacity *= 2;
+			char *newPath = realloc(scanner->path, newCapacity);
+			if(!newPath)
+			{
+				errno = ENOMEM;
+				store_errno(context);
+				err = NATIVE_ERROR_OUT_OF_MEMORY;
+				break;
+			}
+			scanner->path = newPath;
+			scanner->pathCapacity = newCapacity;
+		}
+		if(directory->pathLength > 0)
+			scanner->path[directory->pathLength] = '/';
+		memcpy(scanner->path + pathLength - nameLength, entry->d_name, nameLength + 1);
+		
+		// Read metadata through an O_PATH descriptor that does not follow symbolic links. The ACLs are read through the same descriptor, so they belong to the same file, even if the entry is replaced in the meantime
+		struct statx fileStat;
+		native_error_code_t status = NATIVE_ERROR_SUCCESS;
+		int errnoValue = 0;
+		int entryFd = openat(directory->fd, entry->d_name, O_PATH | O_NOFOLLOW | O_CLOEXEC);
+		if(entryFd < 0 || statx(entryFd, "", AT_EMPTY_PATH | get_statx_sync_flag(context), STATX_PERMISSION_DATA_MASK | STATX_INO, &fileStat) < 0)
+		{
+			memset(&fileStat, 0, sizeof(fileStat));
+			status = NATIVE_ERROR_FSTAT_FAILED;
+			errnoValue = errno;
+		}
+		
+		// Open subdirectories before emitting their record, so a failure can be reported there. Opening "." relative to the O_PATH descriptor yields the same directory
+		int subdirectoryFd = -1;
+		if(status == NATIVE_ERROR_SUCCESS && S_ISDIR(fileStat.stx_mode))
+		{
+			subdirectoryFd = openat(entryFd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+			if(subdirectoryFd < 0)
+			{
+				status = NATIVE_ERROR_OPEN_FAILED;
+				errnoValue = errno;
+			}
+		}
+		
+		// Emit record; if it does not fit, the entry is processed again in the next call
+		snprintf(aclPath, sizeof(aclPath), "/proc/self/fd/%d", entryFd);
+		err = write_scan_record(context, &fileStat, status, errnoValue, aclPath, scanner->path, pathLength, scanner->directoryCount, buffer + bufferPosition, bufferLength - bufferPosition, &recordLength);
+		if(entryFd >= 0)
+			close(entryFd);
+		if(err != NATIVE_ERROR_SUCCESS)
+		{
+			if(subdirectoryFd >= 0)
+				close(subdirectoryFd);
+			
+			// Report required size if not even one record fits
+			if(*recordCount > 0)
+				err = NATIVE_ERROR_SUCCESS;
+			else
+				bufferPosition = recordLength;
+			break;
+		}
+		bufferPosition += recordLength;
+		++*recordCount;
+		directory->entriesPosition += entry->d_reclen;
+		
+		// Descend
+		if(subdirectoryFd >= 0 && push_scanner_directory(scanner, subdirectoryFd, pathLength) < 0)
+		{
+			close(subdirectoryFd);
+			errno = ENOMEM;
+			store_errno(context);
+			err = NATIVE_ERROR_OUT_OF_MEMORY;
+			break;
+		}
+	}
+	
+	*bytesWritten = bufferPosition;
+	return err;
+}
+
+extern void FreeTreeScanner(native_tree_scanner_t *scanner)
 {
-	_lastErrnoValue = errno;
-	strerror_r(errno, _lastErrnoString, sizeof(_lastErrnoString));
+	if(!scanner)
+		return;
+	
+	while(scanner->directoryCount > 0)
+		pop_scanner_directory(scanner);
+	for(int32_t i = 0; i < scanner->directoryCapacity; ++i)
+		free(scanner->directories[i].entries);
+	free(scanner->directories);
+	free(scanner->path);
+	free(scanner);
 }
 
-// Cleans up the file descriptor and the ACL handle (if set), and returns the given error code.
-static native_error_code_t cleanup_with_error_code(native_error_code_t errorCode)
+extern native_error_code_t ApplyPermissionsRecursiveCtx(native_context_t *context, const char *rootPath, const native_compiled_permissions_t *filePermissions, const native_compiled_permissions_t *directoryPermissions, const native_compiled_permissions_t *directoryDefaultPermissions, int32_t threadCount, native_recursive_apply_error_callback_t errorCallback, void *userData, native_recursive_apply_statistics_t *statistics)
 {
-	if(_acl)
+	// Reset errno
+	context->lastErrnoValue = 0;
+	memset(statistics, 0, sizeof(native_recursive_apply_statistics_t));
+	
+	if(threadCount <= 0)
 	{
-		acl_free(_acl);
-		_acl = NULL;
+		long processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+		threadCount = processorCount > 0 ? (int32_t)processorCount : 1;
 	}
-	if(_fd)
+	
+	// Open root directory
+	recursive_apply_directory_t *root = malloc(sizeof(recursive_apply_directory_t));
+	char *rootDirectoryPath = calloc(1, 1);
+	if(!root || !rootDirectoryPath)
 	{
-		close(_fd);
-		_fd = 0;
+		free(root);
+		free(rootDirectoryPath);
+		errno = ENOMEM;
+		store_errno(context);
+		return NATIVE_ERROR_OUT_OF_MEMORY;
 	}
-	return errorCode;
-}
-
-
-/* EXPOSED API FUNCTIONS */
-
-extern native_error_code_t OpenFileAndReadPermissionData(const char *fileName, int32_t loadDefaultAcl, native_permission_data_container_t *dataContainer)
-{
-	// Reset errno
-	_lastErrnoValue = 0;
-	
-	// Open file or directory
-	_fd = open(fileName, O_RDONLY);
-	if(_fd < 0)
+	root->fd = open(rootPath, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if(root->fd < 0)
 	{
-		store_errno();
+		store_errno(context);
+		free(root);
+		free(rootDirectoryPath);
 		return NATIVE_ERROR_OPEN_FAILED;
 	}
+	atomic_init(&root->referenceCount, 1);
+	root->path = rootDirectoryPath;
+	root->pathLength = 0;
 	
-	// Read file metadata
-	struct stat fileStat;
-	if(fstat(_fd, &fileStat) < 0)
+	// Initialize shared state and workers
+	recursive_apply_state_t state;
+	state.filePermissions = filePermissions;
+	state.directoryPermissions = directoryPermissions;
+	state.directoryDefaultPermissions = directoryDefaultPermissions;
+	state.workerCount = threadCount;
+	atomic_init(&state.pendingCount, 0);
+	atomic_init(&state.idleCount, 0);
+	atomic_init(&state.canceled, 0);
+	pthread_mutex_init(&state.idleLock, NULL);
+	pthread_cond_init(&state.idleCondition, NULL);
+	pthread_mutex_init(&state.callbackLock, NULL);
+	state.errorCallback = errorCallback;
+	state.userData = userData;
+	state.workers = calloc(threadCount, sizeof(recursive_apply_worker_t));
+	pthread_t *threads = malloc(threadCount * sizeof(pthread_t));
+	int32_t initializedCount = 0;
+	native_error_code_t err = state.workers && threads ? NATIVE_ERROR_SUCCESS : NATIVE_ERROR_OUT_OF_MEMORY;
+	for(; err == NATIVE_ERROR_SUCCESS && initializedCount < threadCount; ++initializedCount)
 	{
-		store_errno();
-		return cleanup_with_error_code(NATIVE_ERROR_FSTAT_FAILED);
+		recursive_apply_worker_t *worker = &state.workers[initializedCount];
+		worker->state = &state;
+		worker->index = initializedCount;
+		init_native_context(&worker->context);
+		worker->context.options = context->options | NATIVE_CONTEXT_OPTION_NO_FOLLOW;
+		pthread_mutex_init(&worker->queue.lock, NULL);
+		atomic_init(&worker->queue.count, 0);
+		worker->entries = malloc(TREE_SCANNER_DIRENT_BUFFER_SIZE);
+		if(!worker->entries)
+			err = NATIVE_ERROR_OUT_OF_MEMORY;
 	}
 	
-	// Fill basic permission fields
-	dataContainer->ownerId = fileStat.st_uid;
-	dataContainer->groupId = fileStat.st_gid;
-	dataContainer->ownerPermissions = ((fileStat.st_mode & S_IRUSR) ? FILE_PERMISSION_READ : FILE_PERMISSION_NONE)
-	                                | ((fileStat.st_mode & S_IWUSR) ? FILE_PERMISSION_WRITE : FILE_PERMISSION_NONE)
-	                                | ((fileStat.st_mode & S_IXUSR) ? FILE_PERMISSION_EXECUTE : FILE_PERMISSION_NONE)
-	                                | ((fileStat.st_mode & S_ISUID) ? FILE_PERMISSION_SETID : FILE_PERMISSION_NONE)
-	                                | ((fileStat.st_mode & S_ISVTX) ? FILE_PERMISSION_STICKY : FILE_PERMISSION_NONE);
-	dataContainer->groupPermissions = ((fileStat.st_mode & S_IRGRP) ? FILE_PERMISSION_READ : FILE_PERMISSION_NONE)
-	                                | ((fileStat.st_mode & S_IWGRP) ? FILE_PERMISSION_WRITE : FILE_PERMISSION_NONE)
-	                                | ((fileStat.st_mode & S_IXGRP) ? FILE_PERMISSION_EXECUTE : FILE_PERMISSION_NONE)
-	                                | ((fileStat.st_mode & S_ISGID) ? FILE_PERMISSION_SETID : FILE_PERMISSION_NONE);
-	dataContainer->otherPermissions = ((fileStat.st_mode & S_IROTH) ? FILE_PERMISSION_READ : FILE_PERMISSION_NONE)
-	                                | ((fileStat.st_mode & S_IWOTH) ? FILE_PERMISSION_WRITE : FILE_PERMISSION_NONE)
-	                                | ((fileStat.st_mode & S_IXOTH) ? FILE_PERMISSION_EXECUTE : FILE_PERMISSION_NONE);
-	
-	// Try to load ACL
-	_acl = acl_get_file(fileName, loadDefaultAcl > 0 ? ACL_TYPE_DEFAULT : ACL_TYPE_ACCESS);
-	if(!_acl)
+	// Queue root directory, and run the calling thread as first worker
+	recursive_apply_item_t rootItem = { root, NULL };
+	if(err == NATIVE_ERROR_SUCCESS && push_recursive_apply_item(&state.workers[0], rootItem) < 0)
+		err = NATIVE_ERROR_OUT_OF_MEMORY;
+	if(err == NATIVE_ERROR_SUCCESS)
 	{
-		store_errno();
-		return cleanup_with_error_code(NATIVE_ERROR_GET_ACL_FAILED);
+		// If a thread cannot be created, the others do its share
+		int32_t startedCount = 1;
+		while(startedCount < threadCount && pthread_create(&threads[startedCount], NULL, run_recursive_apply_worker, &state.workers[startedCount]) == 0)
+			++startedCount;
+		run_recursive_apply_worker(&state.workers[0]);
+		for(int32_t i = 1; i < startedCount; ++i)
+			pthread_join(threads[i], NULL);
+		
+		if(atomic_load(&state.canceled))
+			err = NATIVE_ERROR_CANCELED;
 	}
-	
-	// Iterate ACL and determine entry count
-	int aclSize = 0;
-	acl_entry_t currEntry;
-	int aclStatus = acl_get_entry(_acl, ACL_FIRST_ENTRY, &currEntry);
-	while(aclStatus > 0)
+	else
 	{
-		++aclSize;
-		aclStatus = acl_get_entry(_acl, ACL_NEXT_ENTRY, &currEntry);
+		errno = ENOMEM;
+		store_errno(context);
+		release_recursive_apply_directory(root);
 	}
-	if(aclStatus < 0)
+	
+	// Release items left over after cancellation, and the workers
+	for(int32_t i = 0; i < initializedCount; ++i)
 	{
-		store_errno();
-		return cleanup_with_error_code(NATIVE_ERROR_GET_ACL_ENTRY_FAILED);
+		recursive_apply_worker_t *worker = &state.workers[i];
+		recursive_apply_queue_t *queue = &worker->queue;
+		for(int32_t j = 0; j < atomic_load(&queue->count); ++j)
+		{
+			recursive_apply_item_t *item = &queue->items[(queue->front + j) % queue->capacity];
+			free(item->name);
+			release_recursive_apply_directory(item->parent);
+		}
+		free(queue->items);
+		pthread_mutex_destroy(&queue->lock);
+		free(worker->entries);
+		free(worker->path);
+		cleanup_with_error_code(&worker->context, NATIVE_ERROR_SUCCESS);
+		
+		statistics->directoryCount += worker->statistics.directoryCount;
+		statistics->fileCount += worker->statistics.fileCount;
+		statistics->changedCount += worker->statistics.changedCount;
+		statistics->skippedCount += worker->statistics.skippedCount;
+		statistics->failedCount += worker->statistics.failedCount;
 	}
-	dataContainer->aclSize = (int32_t)aclSize;
+	free(state.workers);
+	free(threads);
+	pthread_mutex_destroy(&state.callbackLock);
+	pthread_cond_destroy(&state.idleCondition);
+	pthread_mutex_destroy(&state.idleLock);
 	
-	// Done
-	return NATIVE_ERROR_SUCCESS;
+	return err;
 }
 
-extern native_error_code_t ReadFileAclAndClose(native_acl_entry_t *entries)
+// Looks up the given user by name, or by UID if name is NULL. The strings of the entry are stored in *buffer, which is enlarged until the entry fits; the caller must free it, also on failure.
+// If the user does not exist, NATIVE_ERROR_USER_NOT_FOUND is returned and errno stays 0.
+static native_error_code_t lookup_user(native_context_t *context, const char *name, uid_t userId, struct passwd *user, char **buffer)
 {
-	// Reset errno
-	_lastErrnoValue = 0;
-	
-	// Iterate ACL
-	acl_entry_t currEntry;
-	int aclStatus = acl_get_entry(_acl, ACL_FIRST_ENTRY, &currEntry);
-	int i = 0;
-	while(aclStatus > 0)
+	struct passwd *userResult = NULL;
+	size_t bufferLength = 1024;
+	int err;
+	do
 	{
-		// Get pointer to current target array entry
-		native_acl_entry_t *e = &entries[i];
-		
-		// Set tag type
-		acl_tag_t tagType;
-		if(acl_get_tag_type(currEntry, &tagType) < 0)
-		{
-			store_errno();
-			return cleanup_with_error_code(NATIVE_ERROR_GET_ACL_ENTRY_TAG_TYPE_FAILED);
-		}
-		switch(tagType)
+		char *newBuffer = realloc(*buffer, bufferLength);
+		if(!newBuffer)
 		{
-			case ACL_USER_OBJ:      e->tagType = ACL_ENTRY_TAG_TYPE_USER_OBJ;  break;
-			case ACL_USER:          e->tagType = ACL_ENTRY_TAG_TYPE_USER;      break;
-			case ACL_GROUP_OBJ:     e->tagType = ACL_ENTRY_TAG_TYPE_GROUP_OBJ; break;
-			case ACL_GROUP:         e->tagType = ACL_ENTRY_TAG_TYPE_GROUP;     break;
-			case ACL_MASK:          e->tagType = ACL_ENTRY_TAG_TYPE_MASK;      break;
-			case ACL_OTHER:         e->tagType = ACL_ENTRY_TAG_TYPE_OTHER;     break;
-			case ACL_UNDEFINED_TAG: /* TODO */                                 break;
-			default:                                                           break;
-		}
-		
-		// Set tag qualifier
-		switch(tagType)
-		{
-			case ACL_USER:
-			case ACL_GROUP:
-			{
-				void *tagQualifier = acl_get_qualifier(currEntry);
-				if(!tagQualifier)
-				{
-					store_errno();
-					return cleanup_with_error_code(NATIVE_ERROR_GET_ACL_ENTRY_QUALIFIER_FAILED);
-				}
-				e->tagQualifier = *(int32_t *)tagQualifier;
-				
-				acl_free(tagQualifier);
-				break;
-			}
-			
-			default:
-				e->tagQualifier = 0;
-				break;
+			errno = ENOMEM;
+			store_errno(context);
+			return NATIVE_ERROR_OUT_OF_MEMORY;
 		}
+		*buffer = newBuffer;
 		
-		// Set permissions
-		acl_permset_t permset;
-		if(acl_get_permset(currEntry, &permset) < 0)
-		{
-			store_errno();
-			return cleanup_with_error_code(NATIVE_ERROR_GET_ACL_ENTRY_PERMSET_FAILED);
-		}
-		int canRead = acl_get_perm(permset, ACL_READ);
-		if(canRead < 0)
+		err = name ? getpwnam_r(name, user, *buffer, bufferLength, &userResult) : getpwuid_r(userId, user, *buffer, bufferLength, &userResult);
+		bufferLength *= 2;
+	}
+	while(err == ERANGE);
+	if(!userResult)
+	{
+		// A missing entry is not an error of getpwnam_r()/getpwuid_r(), so errno stays 0 in this case
+		if(err != 0)
 		{
-			store_errno();
-			return cleanup_with_error_code(NATIVE_ERROR_GET_ACL_ENTRY_PERM_FAILED);
+			errno = err;
+			store_errno(context);
 		}
-		int canWrite = acl_get_perm(permset, ACL_WRITE);
-		if(canWrite < 0)
+		return NATIVE_ERROR_USER_NOT_FOUND;
+	}
+	return NATIVE_ERROR_SUCCESS;
+}
+
+// Looks up the given group by name, or by GID if name is NULL. The strings of the entry are stored in *buffer, which is enlarged until the entry fits; the caller must free it, also on failure.
+// If the group does not exist, NATIVE_ERROR_GROUP_NOT_FOUND is returned and errno stays 0.
+static native_error_code_t lookup_group(native_context_t *context, const char *name, gid_t groupId, struct group *group, char **buffer)
+{
+	struct group *groupResult = NULL;
+	size_t bufferLength = 1024;
+	int err;
+	do
+	{
+		char *newBuffer = realloc(*buffer, bufferLength);
+		if(!newBuffer)
 		{
-			store_errno();
-			return cleanup_with_error_code(NATIVE_ERROR_GET_ACL_ENTRY_PERM_FAILED);
+			errno = ENOMEM;
+			store_errno(context);
+			return NATIVE_ERROR_OUT_OF_MEMORY;
 		}
-		int canExecute = acl_get_perm(permset, ACL_EXECUTE);
-		if(canExecute < 0)
+		*buffer = newBuffer;
+		
+		err = name ? getgrnam_r(name, group, *buffer, bufferLength, &groupResult) : getgrgid_r(groupId, group, *buffer, bufferLength, &groupResult);
+		bufferLength *= 2;
+	}
+	while(err == ERANGE);
+	if(!groupResult)
+	{
+		if(err != 0)
 		{
-			store_errno();
-			return cleanup_with_error_code(NATIVE_ERROR_GET_ACL_ENTRY_PERM_FAILED);
+			errno = err;
+			store_errno(context);
 		}
-		e->permissions = (canRead > 0 ? FILE_PERMISSION_READ : FILE_PERMISSION_NONE)
-		               | (canWrite > 0 ? FILE_PERMISSION_WRITE : FILE_PERMISSION_NONE)
-		               | (canExecute > 0 ? FILE_PERMISSION_EXECUTE : FILE_PERMISSION_NONE);
-		
-		// Next entry
-		++i;
-		aclStatus = acl_get_entry(_acl, ACL_NEXT_ENTRY, &currEntry);
+		return NATIVE_ERROR_GROUP_NOT_FOUND;
 	}
-	if(aclStatus < 0)
+	return NATIVE_ERROR_SUCCESS;
+}
+
+// Copies the given name into the given buffer, or stores the required buffer size if it does not fit.
+static native_error_code_t copy_name(const char *source, char *name, int32_t nameLength, int32_t *requiredLength)
+{
+	size_t length = strlen(source) + 1;
+	*requiredLength = (int32_t)length;
+	if(length > (size_t)(nameLength > 0 ? nameLength : 0))
+		return NATIVE_ERROR_BUFFER_TOO_SMALL;
+	memcpy(name, source, length);
+	return NATIVE_ERROR_SUCCESS;
+}
+
+extern native_error_code_t GetUserGroupsCtx(native_context_t *context, int32_t userId, int32_t *groupIds, int32_t groupIdsLength, int32_t *groupCount)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	*groupCount = 0;
+	
+	// Look up user name and primary group
+	struct passwd user;
+	char *buffer = NULL;
+	native_error_code_t err = lookup_user(context, NULL, (uid_t)userId, &user, &buffer);
+	if(err != NATIVE_ERROR_SUCCESS)
 	{
-		store_errno();
-		return cleanup_with_error_code(NATIVE_ERROR_GET_ACL_ENTRY_FAILED);
+		free(buffer);
+		return err;
 	}
 	
-	// Done
-	return cleanup_with_error_code(NATIVE_ERROR_SUCCESS);
+	// Collect groups. On overflow, getgrouplist() returns -1 and stores the required size
+	int count = groupIdsLength > 0 ? groupIdsLength : 0;
+	int result = getgrouplist(user.pw_name, user.pw_gid, (gid_t *)groupIds, &count);
+	free(buffer);
+	
+	*groupCount = count;
+	if(result < 0)
+		return NATIVE_ERROR_BUFFER_TOO_SMALL;
+	return NATIVE_ERROR_SUCCESS;
 }
 
-extern native_error_code_t SetFilePermissionDataAndAcl(const char *fileName, int32_t setDefaultAcl, native_permission_data_container_t *dataContainer, native_acl_entry_t *entries)
+extern native_error_code_t GetUserNameCtx(native_context_t *context, int32_t userId, char *name, int32_t nameLength, int32_t *requiredLength)
 {
 	// Reset errno
-	_lastErrnoValue = 0;
+	context->lastErrnoValue = 0;
+	*requiredLength = 0;
 	
-	// Open file or directory
-	_fd = open(fileName, O_RDONLY);
-	if(_fd < 0)
+	struct passwd user;
+	char *buffer = NULL;
+	native_error_code_t err = lookup_user(context, NULL, (uid_t)userId, &user, &buffer);
+	if(err == NATIVE_ERROR_SUCCESS)
+		err = copy_name(user.pw_name, name, nameLength, requiredLength);
+	free(buffer);
+	return err;
+}
+
+extern native_error_code_t GetGroupNameCtx(native_context_t *context, int32_t groupId, char *name, int32_t nameLength, int32_t *requiredLength)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	*requiredLength = 0;
+	
+	struct group group;
+	char *buffer = NULL;
+	native_error_code_t err = lookup_group(context, NULL, (gid_t)groupId, &group, &buffer);
+	if(err == NATIVE_ERROR_SUCCESS)
+		err = copy_name(group.gr_name, name, nameLength, requiredLength);
+	free(buffer);
+	return err;
+}
+
+extern native_error_code_t GetUserIdCtx(native_context_t *context, const char *name, int32_t *userId)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	
+	struct passwd user;
+	char *buffer = NULL;
+	native_error_code_t err = lookup_user(context, name, 0, &user, &buffer);
+	if(err == NATIVE_ERROR_SUCCESS)
+		*userId = (int32_t)user.pw_uid;
+	free(buffer);
+	return err;
+}
+
+extern native_error_code_t GetGroupIdCtx(native_context_t *context, const char *name, int32_t *groupId)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	
+	struct group group;
+	char *buffer = NULL;
+	native_error_code_t err = lookup_group(context, name, 0, &group, &buffer);
+	if(err == NATIVE_ERROR_SUCCESS)
+		*groupId = (int32_t)group.gr_gid;
+	free(buffer);
+	return err;
+}
+
+extern native_error_code_t CreateFileWatcherCtx(native_context_t *context, int32_t useFanotify, native_file_watcher_t **watcher)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	*watcher = NULL;
+	
+	native_file_watcher_t *newWatcher = calloc(1, sizeof(native_file_watcher_t));
+	if(!newWatcher)
 	{
-		store_errno();
-		return NATIVE_ERROR_OPEN_FAILED;
+		errno = ENOMEM;
+		store_errno(context);
+		return NATIVE_ERROR_OUT_OF_MEMORY;
 	}
+	newWatcher->isFanotify = useFanotify != 0;
 	
-	// Read file metadata, to be able to detect whether owner or group are modified
-	struct stat fileStat;
-	if(fstat(_fd, &fileStat) < 0)
+	// Create notification descriptor, which is read non-blocking after polling it together with the cancellation eventfd
+	if(useFanotify)
+	{
+#ifdef FAN_REPORT_DFID_NAME
+		newWatcher->fd = fanotify_init(FAN_CLASS_NOTIF | FAN_REPORT_DFID_NAME | FAN_NONBLOCK | FAN_CLOEXEC, O_RDONLY | O_CLOEXEC);
+#else
+		newWatcher->fd = -1;
+		errno = ENOTSUP;
+#endif
+	}
+	else
+		newWatcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(newWatcher->fd < 0)
 	{
-		store_errno();
-		return cleanup_with_error_code(NATIVE_ERROR_FSTAT_FAILED);
+		store_errno(context);
+		free(newWatcher);
+		return NATIVE_ERROR_WATCH_INIT_FAILED;
+	}
+	newWatcher->cancelFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(newWatcher->cancelFd < 0)
+	{
+		store_errno(context);
+		close(newWatcher->fd);
+		free(newWatcher);
+		return NATIVE_ERROR_WATCH_INIT_FAILED;
 	}
 	
-	// Update owner and UNIX permissions
-	if(!setDefaultAcl)
+	*watcher = newWatcher;
+	return NATIVE_ERROR_SUCCESS;
+}
+
+extern native_error_code_t AddFileWatchCtx(native_context_t *context, native_file_watcher_t *watcher, const char *path, int32_t *watchDescriptor)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	*watchDescriptor = -1;
+	
+	if(!watcher->isFanotify)
 	{
-		// Change owner and group
-		uid_t newOwner = -1;
-		gid_t newGroup = -1;
-		if(dataContainer->ownerId != fileStat.st_uid)
-			newOwner = dataContainer->ownerId;
-		if(dataContainer->groupId != fileStat.st_gid)
-			newGroup = dataContainer->groupId;
-		if((newOwner != -1 || newGroup != -1) && fchown(_fd, newOwner, newGroup) < 0)
-		{
-			store_errno();
-			return cleanup_with_error_code(NATIVE_ERROR_CHOWN_FAILED);
-		}
-		
-		// Build standard permission bitfield
-		mode_t chmodBits = ((dataContainer->ownerPermissions & FILE_PERMISSION_READ) ? S_IRUSR : 0)
-						 | ((dataContainer->ownerPermissions & FILE_PERMISSION_WRITE) ? S_IWUSR : 0)
-						 | ((dataContainer->ownerPermissions & FILE_PERMISSION_EXECUTE) ? S_IXUSR : 0)
-						 | ((dataContainer->ownerPermissions & FILE_PERMISSION_SETID) ? S_ISUID : 0)
-						 | ((dataContainer->ownerPermissions & FILE_PERMISSION_STICKY) ? S_ISVTX : 0)
-						 | ((dataContainer->groupPermissions & FILE_PERMISSION_READ) ? S_IRGRP : 0)
-						 | ((dataContainer->groupPermissions & FILE_PERMISSION_WRITE) ? S_IWGRP : 0)
-						 | ((dataContainer->groupPermissions & FILE_PERMISSION_EXECUTE) ? S_IXGRP : 0)
-						 | ((dataContainer->groupPermissions & FILE_PERMISSION_SETID) ? S_ISGID : 0)
-						 | ((dataContainer->otherPermissions & FILE_PERMISSION_READ) ? S_IROTH : 0)
-						 | ((dataContainer->otherPermissions & FILE_PERMISSION_WRITE) ? S_IWOTH : 0)
-						 | ((dataContainer->otherPermissions & FILE_PERMISSION_EXECUTE) ? S_IXOTH : 0);
-		if(fchmod(_fd, chmodBits) < 0)
+		// Watch the directory and its direct children
+		int wd = inotify_add_watch(watcher->fd, path, FILE_WATCHER_INOTIFY_MASK);
+		if(wd < 0)
 		{
-			store_errno();
-			return cleanup_with_error_code(NATIVE_ERROR_CHMOD_FAILED);
+			store_errno(context);
+			return NATIVE_ERROR_WATCH_FAILED;
 		}
+		*watchDescriptor = wd;
+		return NATIVE_ERROR_SUCCESS;
 	}
 	
-	// Create new ACL
-	_acl = acl_init(dataContainer->aclSize);
-	if(!_acl)
+#ifdef FAN_REPORT_DFID_NAME
+	// Keep a descriptor for resolving the file handles of this file system. open_by_handle_at() does not accept O_PATH descriptors
+	int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if(fd < 0)
+	{
+		store_errno(context);
+		return NATIVE_ERROR_OPEN_FAILED;
+	}
+	struct statfs fileSystemStat;
+	if(fstatfs(fd, &fileSystemStat) < 0)
 	{
-		store_errno();
-		return cleanup_with_error_code(NATIVE_ERROR_INIT_ACL_FAILED);
+		store_errno(context);
+		close(fd);
+		return NATIVE_ERROR_FSTAT_FAILED;
 	}
 	
-	// Build ACL entries
-	for(int i = 0; i < dataContainer->aclSize; ++i)
+	// File systems are only marked once, so a failure below never removes the mark of an earlier call
+	for(int32_t i = 0; i < watcher->mountCount; ++i)
 	{
-		// Retrieve current entry data
-		native_acl_entry_t *entryData = &entries[i];
-		
-		// Initialize ACL entry
-		acl_entry_t aclEntry;
-		int aclStatus = acl_create_entry(&_acl, &aclEntry);
-		if(aclStatus < 0)
-		{
-			store_errno();
-			return cleanup_with_error_code(NATIVE_ERROR_CREATE_ACL_ENTRY_FAILED);
-		}
-		
-		// Assign tag type
-		acl_tag_t tagType;
-		switch(entryData->tagType)
-		{
-			case ACL_ENTRY_TAG_TYPE_USER_OBJ:  tagType = ACL_USER_OBJ;  break;
-			case ACL_ENTRY_TAG_TYPE_USER:      tagType = ACL_USER;      break;
-			case ACL_ENTRY_TAG_TYPE_GROUP_OBJ: tagType = ACL_GROUP_OBJ; break;
-			case ACL_ENTRY_TAG_TYPE_GROUP:     tagType = ACL_GROUP;     break;
-			case ACL_ENTRY_TAG_TYPE_MASK:      tagType = ACL_MASK;      break;
-			case ACL_ENTRY_TAG_TYPE_OTHER:     tagType = ACL_OTHER;     break;
-			default: return cleanup_with_error_code(NATIVE_ERROR_INVALID_TAG_TYPE);
-		}
-		if(acl_set_tag_type(aclEntry, tagType) < 0)
+		if(memcmp(&watcher->mounts[i].fsid, &fileSystemStat.f_fsid, sizeof(fsid_t)) == 0)
 		{
-			store_errno();
-			return cleanup_with_error_code(NATIVE_ERROR_SET_ACL_ENTRY_TAG_TYPE_FAILED);
+			close(fd);
+			return NATIVE_ERROR_SUCCESS;
 		}
-		
-		// Assign tag qualifier
-		switch(entryData->tagType)
+	}
+	
+	// Mark the entire file system
+	if(fanotify_mark(watcher->fd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, FILE_WATCHER_FANOTIFY_MASK, fd, NULL) < 0)
+	{
+		store_errno(context);
+		close(fd);
+		return NATIVE_ERROR_WATCH_FAILED;
+	}
+	file_watcher_mount_t *mounts = realloc(watcher->mounts, (watcher->mountCount + 1) * sizeof(file_watcher_mount_t));
+	if(!mounts)
+	{
+		// Do not leave a mark that no descriptor can resolve events of
+		fanotify_mark(watcher->fd, FAN_MARK_REMOVE | FAN_MARK_FILESYSTEM, FILE_WATCHER_FANOTIFY_MASK, fd, NULL);
+		close(fd);
+		errno = ENOMEM;
+		store_errno(context);
+		return NATIVE_ERROR_OUT_OF_MEMORY;
+	}
+	watcher->mounts = mounts;
+	watcher->mounts[watcher->mountCount].fsid = fileSystemStat.f_fsid;
+	watcher->mounts[watcher->mountCount].fd = fd;
+	++watcher->mountCount;
+	return NATIVE_ERROR_SUCCESS;
+#else
+	(void)path;
+	errno = ENOTSUP;
+	store_errno(context);
+	return NATIVE_ERROR_WATCH_FAILED;
+#endif
+}
+
+extern native_error_code_t RemoveFileWatchCtx(native_context_t *context, native_file_watcher_t *watcher, int32_t watchDescriptor)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	
+	// fanotify marks stay until the watcher is released
+	if(watcher->isFanotify)
+		return NATIVE_ERROR_SUCCESS;
+	
+	if(inotify_rm_watch(watcher->fd, watchDescriptor) < 0)
+	{
+		store_errno(context);
+		return NATIVE_ERROR_WATCH_FAILED;
+	}
+	return NATIVE_ERROR_SUCCESS;
+}
+
+extern native_error_code_t ReadFileWatchEventsCtx(native_context_t *context, native_file_watcher_t *watcher, native_watch_event_t *events, int32_t eventsLength, char *names, int32_t namesLength, int32_t *eventCount)
+{
+	// Reset errno
+	context->lastErrnoValue = 0;
+	*eventCount = 0;
+	
+	int32_t namesUsed = 0;
+	while(1)
+	{
+		// Convert buffered events, as far as they fit
+		while(watcher->bufferPosition < watcher->bufferEnd && *eventCount < eventsLength)
 		{
-			case ACL_ENTRY_TAG_TYPE_USER:
-			case ACL_ENTRY_TAG_TYPE_GROUP:
+			size_t rawEventLength;
+			int32_t nameLength;
+#ifdef FAN_REPORT_DFID_NAME
+			if(watcher->isFanotify)
+				nameLength = convert_fanotify_event(watcher, &events[*eventCount], names, namesLength, namesUsed, &rawEventLength);
+			else
+#endif
+				nameLength = convert_inotify_event(watcher, &events[*eventCount], names, namesLength, namesUsed, &rawEventLength);
+			if(nameLength < 0)
 			{
-				if(acl_set_qualifier(aclEntry, &entryData->tagQualifier) < 0)
-				{
-					store_errno();
-					return cleanup_with_error_code(NATIVE_ERROR_SET_ACL_ENTRY_QUALIFIER_FAILED);
-				}
-				break;
+				// Keep the event for the next call
+				if(*eventCount == 0)
+					return NATIVE_ERROR_BUFFER_TOO_SMALL;
+				return NATIVE_ERROR_SUCCESS;
 			}
 			
-			default: break;
+			namesUsed += nameLength;
+			watcher->bufferPosition += rawEventLength;
+			++*eventCount;
 		}
+		if(*eventCount > 0)
+			return NATIVE_ERROR_SUCCESS;
 		
-		// Assign permissions
-		acl_permset_t permset;
-		if(acl_get_permset(aclEntry, &permset) < 0)
-		{
-			store_errno();
-			return cleanup_with_error_code(NATIVE_ERROR_GET_ACL_ENTRY_PERMSET_FAILED);
-		}
-		if(acl_clear_perms(permset) < 0)
+		// Wait for new events or cancellation
+		struct pollfd pollFds[2] =
 		{
-			store_errno();
-			return cleanup_with_error_code(NATIVE_ERROR_CLEAR_ACL_ENTRY_PERMS_FAILED);
-		}
-		if((entryData->permissions & FILE_PERMISSION_READ) && acl_add_perm(permset, ACL_READ) < 0)
-		{
-			store_errno();
-			return cleanup_with_error_code(NATIVE_ERROR_ADD_ACL_ENTRY_PERM_FAILED);
-		}
-		if((entryData->permissions & FILE_PERMISSION_WRITE) && acl_add_perm(permset, ACL_WRITE) < 0)
+			{ .fd = watcher->fd, .events = POLLIN },
+			{ .fd = watcher->cancelFd, .events = POLLIN }
+		};
+		if(poll(pollFds, 2, -1) < 0)
 		{
-			store_errno();
-			return cleanup_with_error_code(NATIVE_ERROR_ADD_ACL_ENTRY_PERM_FAILED);
+			if(errno == EINTR)
+				continue;
+			store_errno(context);
+			return NATIVE_ERROR_READ_EVENTS_FAILED;
 		}
-		if((entryData->permissions & FILE_PERMISSION_EXECUTE) && acl_add_perm(permset, ACL_EXECUTE) < 0)
+		if(pollFds[1].revents & POLLIN)
+			return NATIVE_ERROR_CANCELED;
+		
+		ssize_t bytesRead = read(watcher->fd, watcher->buffer, sizeof(watcher->buffer));
+		if(bytesRead < 0)
 		{
-			store_errno();
-			return cleanup_with_error_code(NATIVE_ERROR_ADD_ACL_ENTRY_PERM_FAILED);
+			if(errno == EAGAIN || errno == EINTR)
+				continue;
+			store_errno(context);
+			return NATIVE_ERROR_READ_EVENTS_FAILED;
 		}
+		watcher->bufferPosition = 0;
+		watcher->bufferEnd = (size_t)bytesRead;
 	}
+}
+
+extern void CancelFileWatcher(native_file_watcher_t *watcher)
+{
+	// The counter is never reset, so all further reads return immediately
+	uint64_t value = 1;
+	ssize_t bytesWritten = write(watcher->cancelFd, &value, sizeof(value));
+	(void)bytesWritten;
+}
+
+extern void FreeFileWatcher(native_file_watcher_t *watcher)
+{
+	if(!watcher)
+		return;
 	
-	// Validate ACL
-	if(acl_valid(_acl) < 0)
-	{
-		store_errno();
-		return cleanup_with_error_code(NATIVE_ERROR_VALIDATE_ACL_FAILED);
-	}
+	close(watcher->fd);
+	close(watcher->cancelFd);
+	for(int32_t i = 0; i < watcher->mountCount; ++i)
+		close(watcher->mounts[i].fd);
+	free(watcher->mounts);
+	free(watcher);
+}
+
+extern native_context_t *CreateNativeContext(void)
+{
+	native_context_t *context = malloc(sizeof(native_context_t));
+	if(!context)
+		return NULL;
 	
-	// Assign ACL to file or directory
-	if(acl_set_file(fileName, setDefaultAcl > 0 ? ACL_TYPE_DEFAULT : ACL_TYPE_ACCESS, _acl) < 0)
+	init_native_context(context);
+	return context;
+}
+
+extern void FreeNativeContext(native_context_t *context)
+{
+	if(!context)
+		return;
+	
+	// Release a file which might still be open from an incomplete read
+	cleanup_with_error_code(context, NATIVE_ERROR_SUCCESS);
+#ifdef ACLNATIVE_IO_URING
+	free_uring(context->uring);
+#endif
+	free(context);
+}
+
+extern void SetNativeContextOptions(native_context_t *context, native_context_options_t options)
+{
+	context->options = options;
+}
+
+extern void SetNativeContextQueueDepth(native_context_t *context, int32_t queueDepth)
+{
+#ifdef ACLNATIVE_IO_URING
+	// The instance is recreated with the new depth on next use
+	if(queueDepth != context->queueDepth)
 	{
-		store_errno();
-		return cleanup_with_error_code(NATIVE_ERROR_SET_ACL_FAILED);
+		free_uring(context->uring);
+		context->uring = NULL;
+		context->uringUnavailable = 0;
+		context->queueDepth = queueDepth;
 	}
-	
-	// Done
-	return cleanup_with_error_code(NATIVE_ERROR_SUCCESS);
+#else
+	(void)context;
+	(void)queueDepth;
+#endif
 }
 
-int64_t GetLastErrnoValue(char *errnoStringBuffer, int errnoStringBufferLength)
+extern int32_t IsIoUringAvailableCtx(native_context_t *context)
+{
+#ifdef ACLNATIVE_IO_URING
+	return get_uring(context) ? 1 : 0;
+#else
+	(void)context;
+	return 0;
+#endif
+}
+
+extern int64_t GetContextErrnoValue(native_context_t *context, char *errnoStringBuffer, int errnoStringBufferLength)
 {
 	// Only copy error string if errno is set
-	if(_lastErrnoValue == 0)
+	if(context->lastErrnoValue == 0)
 		errnoStringBuffer[0] = '\0';
 	else
 	{
 		// Make sure that the output buffer does not overflow
 		// strncpy will fill the remainder of the output buffer with null bytes
-		strncpy(errnoStringBuffer, _lastErrnoString, errnoStringBufferLength);
+		strncpy(errnoStringBuffer, context->lastErrnoString, errnoStringBufferLength);
 		errnoStringBuffer[errnoStringBufferLength - 1] = '\0';
 	}
-	return _lastErrnoValue;
+	return context->lastErrnoValue;
+}
+
+extern native_error_code_t OpenFileAndReadPermissionData(const char *fileName, int32_t loadDefaultAcl, native_permission_data_container_t *dataContainer)
+{
+	return OpenFileAndReadPermissionDataCtx(&_threadContext, fileName, loadDefaultAcl, dataContainer);
+}
+
+extern native_error_code_t ReadFileAclAndClose(native_acl_entry_t *entries)
+{
+	return ReadFileAclAndCloseCtx(&_threadContext, entries);
+}
+
+extern native_error_code_t SetFilePermissionDataAndAcl(const char *fileName, int32_t setDefaultAcl, native_permission_data_container_t *dataContainer, native_acl_entry_t *entries)
+{
+	return SetFilePermissionDataAndAclCtx(&_threadContext, fileName, setDefaultAcl, dataContainer, entries);
+}
+
+int64_t GetLastErrnoValue(char *errnoStringBuffer, int errnoStringBufferLength)
+{
+	return GetContextErrnoValue(&_threadContext, errnoStringBuffer, errnoStringBufferLength);
 }
\ No newline at end of file